@@ -495,9 +495,9 @@ static int API_env_set(va_list ap)
  */
 static int API_env_enum(va_list ap)
 {
-	int i, buflen;
+	int buflen;
 	char *last, **next, *s;
-	ENTRY *match, search;
+	ENTRY *match;
 	static char *var;
 
 	last = (char *)va_arg(ap, unsigned long);
@@ -507,23 +507,18 @@ static int API_env_enum(va_list ap)
 
 	if (last == NULL) {
 		var = NULL;
-		i = 0;
 	} else {
 		var = strdup(last);
+		if (var == NULL)
+			return API_ENOMEM;
 		s = strchr(var, '=');
 		if (s != NULL)
 			*s = 0;
-		search.key = var;
-		i = hsearch_r(search, FIND, &match, &env_htab, 0);
-		if (i == 0) {
-			i = API_EINVAL;
-			goto done;
-		}
 	}
 
-	/* match the next entry after i */
-	i = hmatch_r("", i, &match, &env_htab);
-	if (i == 0)
+	/* match the entry after the last one, by name */
+	match = hnext_r(&env_htab, var);
+	if (match == NULL)
 		goto done;
 	buflen = strlen(match->key) + strlen(match->data) + 2;
 	var = realloc(var, buflen);
@@ -535,7 +530,7 @@ done:
 	free(var);
 	var = NULL;
 	*next = NULL;
-	return i;
+	return 0;
 }
 
 /*
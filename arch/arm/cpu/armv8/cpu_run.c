@@ -0,0 +1,172 @@
+/*
+ * Running work on secondary CPUs started with PSCI
+ *
+ * U-Boot normally leaves the secondary CPUs off until the OS starts them.
+ * Here they are started with PSCI CPU_ON to run a function for U-Boot and
+ * power themselves off again with CPU_OFF once it returns, so that they
+ * are in the same state as before when the OS boots.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <libfdt.h>
+#include <malloc.h>
+#include <asm/psci.h>
+#include <asm/system.h>
+#include <asm/armv8/cpu_run.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define CPU_RUN_MAX_CPUS	8
+#define CPU_RUN_STACK_SIZE	SZ_32K
+
+/* Time allowed for a CPU to finish its function and power off */
+#define CPU_RUN_TIMEOUT_MS	10000
+
+#define MPIDR_HWID_MASK		0xff00ffffffUL
+
+static struct cpu_run_ctx cpu_run_ctx[CPU_RUN_MAX_CPUS];
+static void *cpu_run_stack[CPU_RUN_MAX_CPUS];
+static u64 cpu_run_mpidr[CPU_RUN_MAX_CPUS];
+/* CPUs which were started and have not been seen to finish */
+static bool cpu_run_busy[CPU_RUN_MAX_CPUS];
+static int cpu_run_cpus;
+
+/* Find the other CPUs which PSCI can start, from the device tree */
+static int cpu_run_scan(void)
+{
+	const void *blob = gd->fdt_blob;
+	u64 self = read_mpidr() & MPIDR_HWID_MASK;
+	const char *prop;
+	const fdt32_t *reg;
+	int cpus, node, ac, len;
+	int count = 1;
+	u64 mpidr;
+
+	if (!blob)
+		return count;
+	cpus = fdt_path_offset(blob, "/cpus");
+	if (cpus < 0)
+		return count;
+	ac = fdt_address_cells(blob, cpus);
+	fdt_for_each_subnode(node, blob, cpus) {
+		prop = fdt_getprop(blob, node, "device_type", NULL);
+		if (!prop || strcmp(prop, "cpu"))
+			continue;
+		prop = fdt_getprop(blob, node, "enable-method", NULL);
+		if (!prop || strcmp(prop, "psci"))
+			continue;
+		reg = fdt_getprop(blob, node, "reg", &len);
+		if (!reg || ac < 1 || ac > 2 || len < ac * (int)sizeof(*reg))
+			continue;
+		mpidr = fdt32_to_cpu(reg[0]);
+		if (ac == 2)
+			mpidr = mpidr << 32 | fdt32_to_cpu(reg[1]);
+		if (mpidr == self)
+			continue;
+		if (count == CPU_RUN_MAX_CPUS)
+			break;
+		cpu_run_mpidr[count++] = mpidr;
+	}
+
+	return count;
+}
+
+int cpu_run_count(void)
+{
+	if (!cpu_run_cpus)
+		cpu_run_cpus = cpu_run_scan();
+
+	return cpu_run_cpus;
+}
+
+#define CPU_RUN_SAVE_EL(ctx, el) do { \
+	asm volatile("mrs %0, mair_el" #el : "=r" ((ctx)->mair)); \
+	asm volatile("mrs %0, tcr_el" #el : "=r" ((ctx)->tcr)); \
+	asm volatile("mrs %0, ttbr0_el" #el : "=r" ((ctx)->ttbr)); \
+	asm volatile("mrs %0, vbar_el" #el : "=r" ((ctx)->vbar)); \
+	asm volatile("mrs %0, sctlr_el" #el : "=r" ((ctx)->sctlr)); \
+} while (0)
+
+int cpu_run(int nr, void (*func)(void *arg), void *arg)
+{
+	struct cpu_run_ctx *ctx;
+	struct pt_regs regs;
+
+	if (nr < 1 || nr >= cpu_run_count())
+		return -EINVAL;
+	if (cpu_run_busy[nr])
+		return -EBUSY;
+	if (!cpu_run_stack[nr]) {
+		cpu_run_stack[nr] = memalign(16, CPU_RUN_STACK_SIZE);
+		if (!cpu_run_stack[nr])
+			return -ENOMEM;
+	}
+
+	ctx = &cpu_run_ctx[nr];
+	ctx->sp = (ulong)cpu_run_stack[nr] + CPU_RUN_STACK_SIZE;
+	ctx->gd = (ulong)gd;
+	ctx->func = (ulong)func;
+	ctx->arg = (ulong)arg;
+	ctx->done = 0;
+	switch (current_el()) {
+	case 1:
+		CPU_RUN_SAVE_EL(ctx, 1);
+		break;
+	case 2:
+		CPU_RUN_SAVE_EL(ctx, 2);
+		break;
+	default:
+		CPU_RUN_SAVE_EL(ctx, 3);
+		break;
+	}
+
+	/* The CPU reads this before turning its caches on */
+	flush_dcache_range((ulong)ctx, (ulong)(ctx + 1));
+
+	regs.regs[0] = ARM_PSCI_0_2_FN64_CPU_ON;
+	regs.regs[1] = cpu_run_mpidr[nr];
+	regs.regs[2] = (ulong)cpu_run_entry;
+	regs.regs[3] = (ulong)ctx;
+	smc_call(&regs);
+	if (regs.regs[0]) {
+		debug("%s: CPU %llx failed to start: %d\n", __func__,
+		      cpu_run_mpidr[nr], (int)regs.regs[0]);
+		return -EIO;
+	}
+	cpu_run_busy[nr] = true;
+
+	return 0;
+}
+
+int cpu_run_wait(int nr)
+{
+	struct cpu_run_ctx *ctx = &cpu_run_ctx[nr];
+	struct pt_regs regs;
+	ulong start = get_timer(0);
+
+	if (nr < 1 || nr >= cpu_run_count())
+		return -EINVAL;
+	while (!*(volatile u64 *)&ctx->done) {
+		if (get_timer(start) > CPU_RUN_TIMEOUT_MS)
+			return -ETIMEDOUT;
+	}
+	dmb();
+
+	/* Wait until the CPU is off, so that it can be started again */
+	do {
+		regs.regs[0] = ARM_PSCI_0_2_FN64_AFFINITY_INFO;
+		regs.regs[1] = cpu_run_mpidr[nr];
+		regs.regs[2] = 0;
+		smc_call(&regs);
+		if (regs.regs[0] == PSCI_AFFINITY_LEVEL_OFF) {
+			cpu_run_busy[nr] = false;
+			return 0;
+		}
+	} while (get_timer(start) < CPU_RUN_TIMEOUT_MS);
+
+	/* The CPU stays busy, so that cpu_run() does not use it again */
+	return -ETIMEDOUT;
+}
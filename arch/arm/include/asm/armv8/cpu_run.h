@@ -0,0 +1,61 @@
+/*
+ * Running work on secondary CPUs started with PSCI
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ASM_ARMV8_CPU_RUN_H
+#define __ASM_ARMV8_CPU_RUN_H
+
+/* Offsets of the fields of struct cpu_run_ctx, for cpu_run_entry() */
+#define CPU_RUN_CTX_SP		0
+#define CPU_RUN_CTX_GD		8
+#define CPU_RUN_CTX_FUNC	16
+#define CPU_RUN_CTX_ARG		24
+#define CPU_RUN_CTX_MAIR	32
+#define CPU_RUN_CTX_TCR		40
+#define CPU_RUN_CTX_TTBR	48
+#define CPU_RUN_CTX_VBAR	56
+#define CPU_RUN_CTX_SCTLR	64
+#define CPU_RUN_CTX_DONE	72
+
+#ifndef __ASSEMBLY__
+
+#include <asm/cache.h>
+
+/**
+ * struct cpu_run_ctx - what a secondary CPU needs to run a function
+ *
+ * The CPU starts with its MMU off, so it sets up the boot CPU's memory map
+ * from here before calling the function.
+ *
+ * @sp:		Top of the stack to use
+ * @gd:		Global data pointer
+ * @func:	Function to call
+ * @arg:	Argument to pass to @func
+ * @mair:	Memory attributes, from MAIR_ELx
+ * @tcr:	Translation control, from TCR_ELx
+ * @ttbr:	Page tables, from TTBR0_ELx
+ * @vbar:	Exception vectors, from VBAR_ELx
+ * @sctlr:	System control, from SCTLR_ELx
+ * @done:	Set to 1 by the CPU when @func returns
+ */
+struct cpu_run_ctx {
+	u64 sp;
+	u64 gd;
+	u64 func;
+	u64 arg;
+	u64 mair;
+	u64 tcr;
+	u64 ttbr;
+	u64 vbar;
+	u64 sctlr;
+	u64 done;
+} __aligned(ARCH_DMA_MINALIGN);
+
+/* Entry point for secondary CPUs, which is passed a struct cpu_run_ctx */
+void cpu_run_entry(void);
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __ASM_ARMV8_CPU_RUN_H */
@@ -0,0 +1,41 @@
+/*
+ * CRC32 using the ARMv8 CRC32 instructions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ASM_ARM_CRC32_ARMV8_H
+#define __ASM_ARM_CRC32_ARMV8_H
+
+/* Field of ID_AA64ISAR0_EL1 which shows the CRC32 instructions */
+#define ID_AA64ISAR0_CRC32_SHIFT	16
+
+/*
+ * The instructions are optional in ARMv8.0, so check for them before each
+ * use. This also works before relocation, when there is nowhere to keep
+ * the result.
+ */
+static inline bool crc32_armv8_available(void)
+{
+	unsigned long isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> ID_AA64ISAR0_CRC32_SHIFT) & 0xf;
+}
+
+/**
+ * crc32_armv8_le() - update a CRC-32 using the CRC32 instructions
+ *
+ * This works like crc32_no_comp(): the CRC is neither inverted on entry
+ * nor on exit.
+ *
+ * @crc:	CRC of the data so far
+ * @p:		Data to add, which need not be aligned
+ * @len:	Number of bytes of data
+ * @return the updated CRC
+ */
+uint32_t crc32_armv8_le(uint32_t crc, const unsigned char *p,
+			unsigned int len);
+
+#endif
@@ -349,10 +349,74 @@ out:
 	return retval;
 }
 
+#elif defined(CONFIG_ARM64)
+/*
+ * memset() and memcpy() make unaligned accesses and use DC ZVA, which fault
+ * on Device memory. So I/O memory is accessed in naturally aligned
+ * doublewords where both sides allow it, and in bytes otherwise.
+ */
+static inline void __memset_io(void __iomem *dst, int c, size_t count)
+{
+	u64 qc = (u8)c;
+
+	qc |= qc << 8;
+	qc |= qc << 16;
+	qc |= qc << 32;
+	while (count && ((unsigned long)dst & 7)) {
+		__raw_writeb(c, dst);
+		dst++;
+		count--;
+	}
+	for (; count >= 8; count -= 8, dst += 8)
+		__raw_writeq(qc, dst);
+	for (; count; count--, dst++)
+		__raw_writeb(c, dst);
+}
+
+static inline void __memcpy_fromio(void *to, const void __iomem *from,
+				   size_t count)
+{
+	while (count && ((unsigned long)from & 7)) {
+		*(u8 *)to = __raw_readb(from);
+		from++;
+		to++;
+		count--;
+	}
+	if (!((unsigned long)to & 7)) {
+		for (; count >= 8; count -= 8, from += 8, to += 8)
+			*(u64 *)to = __raw_readq(from);
+	}
+	for (; count; count--, from++, to++)
+		*(u8 *)to = __raw_readb(from);
+}
+
+static inline void __memcpy_toio(void __iomem *to, const void *from,
+				 size_t count)
+{
+	while (count && ((unsigned long)to & 7)) {
+		__raw_writeb(*(const u8 *)from, to);
+		from++;
+		to++;
+		count--;
+	}
+	if (!((unsigned long)from & 7)) {
+		for (; count >= 8; count -= 8, from += 8, to += 8)
+			__raw_writeq(*(const u64 *)from, to);
+	}
+	for (; count; count--, from++, to++)
+		__raw_writeb(*(const u8 *)from, to);
+}
+
+#define memset_io(a, b, c)	__memset_io((void __iomem *)(a), (b), (c))
+#define memcpy_fromio(a, b, c)	__memcpy_fromio((a), (void __iomem *)(b), (c))
+#define memcpy_toio(a, b, c)	__memcpy_toio((void __iomem *)(a), (b), (c))
 #else
 #define memset_io(a, b, c)		memset((void *)(a), (b), (c))
 #define memcpy_fromio(a, b, c)		memcpy((a), (void *)(b), (c))
 #define memcpy_toio(a, b, c)		memcpy((void *)(a), (b), (c))
+#endif
+
+#ifndef __mem_pci
 
 #if !defined(readb)
 
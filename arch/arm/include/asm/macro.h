@@ -78,6 +78,21 @@ lr	.req	x30
 	b.eq	\el1_label
 .endm
 
+/*
+ * Branch if the MMU is off at the current exception level. All data
+ * accesses are then to Device memory, where unaligned accesses and DC ZVA
+ * fault.
+ */
+.macro	branch_if_mmu_off, xreg, label
+	switch_el \xreg, 3f, 2f, 1f
+3:	mrs	\xreg, sctlr_el3
+	b	0f
+2:	mrs	\xreg, sctlr_el2
+	b	0f
+1:	mrs	\xreg, sctlr_el1
+0:	tbz	\xreg, #0, \label		/* SCTLR_ELx.M */
+.endm
+
 /*
  * Branch if current processor is a Cortex-A57 core.
  */
@@ -0,0 +1,58 @@
+/*
+ * SHA-1 and SHA-256 using the ARMv8 Crypto Extensions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ASM_ARM_SHA_CE_H
+#define __ASM_ARM_SHA_CE_H
+
+/* Fields of ID_AA64ISAR0_EL1 which give the supported SHA instructions */
+#define ID_AA64ISAR0_SHA1_SHIFT		8
+#define ID_AA64ISAR0_SHA2_SHIFT		12
+
+static inline unsigned int sha_ce_isar0_field(int shift)
+{
+	unsigned long isar0;
+
+	asm volatile("mrs %0, id_aa64isar0_el1" : "=r" (isar0));
+
+	return (isar0 >> shift) & 0xf;
+}
+
+/*
+ * The instructions are optional even on cores which implement ARMv8, so
+ * check for them before each use. Reading the ID register is cheap and
+ * this avoids having to store the result before relocation.
+ */
+static inline bool sha1_ce_available(void)
+{
+	return sha_ce_isar0_field(ID_AA64ISAR0_SHA1_SHIFT) != 0;
+}
+
+static inline bool sha256_ce_available(void)
+{
+	return sha_ce_isar0_field(ID_AA64ISAR0_SHA2_SHIFT) != 0;
+}
+
+/**
+ * sha1_ce_transform() - hash blocks using the SHA-1 instructions
+ *
+ * @state:	Hash state, updated in place
+ * @data:	Input data, which need not be aligned
+ * @blocks:	Number of 64-byte blocks to process (must be non-zero)
+ */
+void sha1_ce_transform(uint32_t state[5], const uint8_t *data,
+		       uint32_t blocks);
+
+/**
+ * sha256_ce_transform() - hash blocks using the SHA-256 instructions
+ *
+ * @state:	Hash state, updated in place
+ * @data:	Input data, which need not be aligned
+ * @blocks:	Number of 64-byte blocks to process (must be non-zero)
+ */
+void sha256_ce_transform(uint32_t state[8], const uint8_t *data,
+			 uint32_t blocks);
+
+#endif
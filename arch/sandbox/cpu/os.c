@@ -98,6 +98,11 @@ int os_unlink(const char *pathname)
 	return unlink(pathname);
 }
 
+int os_mkstemp(char *fname)
+{
+	return mkstemp(fname);
+}
+
 void os_exit(int exit_code)
 {
 	exit(exit_code);
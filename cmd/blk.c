@@ -0,0 +1,122 @@
+/*
+ * Block device access and diagnostics
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <command.h>
+#include <dm.h>
+#include <mapmem.h>
+#include <part.h>
+
+#ifdef CONFIG_CMD_BLOCK_READAHEAD
+static int blk_readahead_show(void)
+{
+	struct blk_readahead_stats stats;
+	struct udevice *dev;
+	struct uclass *uc;
+	int ret;
+
+	ret = uclass_get(UCLASS_BLK, &uc);
+	if (ret)
+		return CMD_RET_FAILURE;
+
+	printf("%-20s %8s %8s %8s %10s %8s\n", "Device", "reads", "hits",
+	       "cmds", "blocks", "window");
+	uclass_foreach_dev(dev, uc) {
+		if (blk_readahead_get_stats(dev, &stats))
+			continue;
+		printf("%-20s %8lu %8lu %8lu %10lu %8lu\n", dev->name,
+		       stats.reads, stats.hits, stats.cmds, stats.blocks,
+		       stats.window);
+	}
+
+	return 0;
+}
+
+static int do_blk_readahead(cmd_tbl_t *cmdtp, int flag,
+			    int argc, char * const argv[])
+{
+	ulong bytes;
+
+	if (argc == 1)
+		return blk_readahead_show();
+	if (argc != 2)
+		return CMD_RET_USAGE;
+
+	bytes = simple_strtoul(argv[1], NULL, 0);
+	blk_readahead_configure(bytes);
+	printf("read-ahead window limited to %lu bytes\n", bytes);
+
+	return 0;
+}
+#endif
+
+static int do_blk_rw(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	bool write = argv[0][0] == 'w';
+	struct blk_desc *desc;
+	lbaint_t blk, cnt;
+	ulong addr, n;
+	void *buf;
+
+	if (argc != 6)
+		return CMD_RET_USAGE;
+
+	if (blk_get_device_by_str(argv[1], argv[2], &desc) < 0)
+		return CMD_RET_FAILURE;
+	addr = simple_strtoul(argv[3], NULL, 16);
+	blk = simple_strtoul(argv[4], NULL, 16);
+	cnt = simple_strtoul(argv[5], NULL, 16);
+
+	buf = map_sysmem(addr, cnt * desc->blksz);
+	if (write)
+		n = blk_dwrite(desc, blk, cnt, buf);
+	else
+		n = blk_dread(desc, blk, cnt, buf);
+	unmap_sysmem(buf);
+	printf("%lu blocks %s: %s\n", n, write ? "written" : "read",
+	       n == cnt ? "OK" : "ERROR");
+
+	return n == cnt ? 0 : CMD_RET_FAILURE;
+}
+
+static cmd_tbl_t cmd_blk_sub[] = {
+#ifdef CONFIG_CMD_BLOCK_READAHEAD
+	U_BOOT_CMD_MKENT(readahead, 2, 0, do_blk_readahead, "", ""),
+#endif
+	U_BOOT_CMD_MKENT(read, 6, 0, do_blk_rw, "", ""),
+	U_BOOT_CMD_MKENT(write, 6, 0, do_blk_rw, "", ""),
+};
+
+static int do_blk(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], &cmd_blk_sub[0], ARRAY_SIZE(cmd_blk_sub));
+	if (!c)
+		return CMD_RET_USAGE;
+
+	return c->cmd(cmdtp, flag, argc, argv);
+}
+
+U_BOOT_CMD(
+	blk, 7, 0, do_blk,
+	"block device access and diagnostics",
+#ifdef CONFIG_CMD_BLOCK_READAHEAD
+	"readahead - show read-ahead statistics for each block device\n"
+	"blk readahead <bytes> - set the maximum read-ahead window (0 = off)\n"
+	"blk "
+#endif
+	"read <interface> <dev[.hwpart]> addr blk# cnt - read raw blocks\n"
+	"blk write <interface> <dev[.hwpart]> addr blk# cnt - write raw blocks"
+);
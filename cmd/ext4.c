@@ -92,3 +92,27 @@ U_BOOT_CMD(ext4load, 7, 0, do_ext4_load,
 	   "<interface> [<dev[:part]> [addr [filename [bytes [pos]]]]]\n"
 	   "    - load binary file 'filename' from 'dev' on 'interface'\n"
 	   "      to address 'addr' from ext4 filesystem");
+
+#ifdef CONFIG_CMD_EXT4_STATS
+int do_ext4_stats(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct ext4_dir_stats stats;
+
+	ext4fs_dir_stats(&stats);
+	printf("lookups:      %lu\n"
+	       "cache hits:   %lu\n"
+	       "htree:        %lu\n"
+	       "dir blocks:   %lu\n"
+	       "last lookup:  %u blocks\n",
+	       stats.lookups, stats.hits, stats.htree, stats.blocks,
+	       stats.last_blocks);
+
+	return 0;
+}
+
+U_BOOT_CMD(ext4stats, 1, 0, do_ext4_stats,
+	   "show ext4 directory lookup statistics",
+	   "\n"
+	   "    - show directory lookups, dentry cache hits and\n"
+	   "      directory blocks read since boot");
+#endif
@@ -17,6 +17,7 @@
 #include <fdt_support.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <dm/of_access.h>
 
 #define MAX_LEVEL	32		/* how deeply nested we will go */
 #define SCRATCHPAD	1024		/* bytes of scratchpad memory */
@@ -48,6 +49,48 @@ void set_working_fdt_addr(ulong addr)
 	setenv_hex("fdtaddr", addr);
 }
 
+/*
+ * The live tree points into the control FDT and devices point into the
+ * live tree, so the control FDT must not be changed in place while the
+ * live tree is in use. Check whether an FDT is the one in use, and if so
+ * say why it cannot be changed.
+ */
+static bool fdt_in_live_use(const void *blob)
+{
+	if (!of_live_active() || blob != gd->fdt_blob)
+		return false;
+	puts("The control FDT cannot be changed while the live tree is in use\n");
+
+	return true;
+}
+
+/*
+ * Use a new control FDT. If the live tree is in use, it is built again
+ * from the new FDT and the old one is left for devices which still point
+ * to it.
+ */
+static int set_control_fdt(const void *blob)
+{
+	if (of_live_active() && blob != gd->fdt_blob) {
+		if (of_live_replace(blob)) {
+			puts("Cannot build the live tree for the new control FDT\n");
+			return CMD_RET_FAILURE;
+		}
+		return CMD_RET_SUCCESS;
+	}
+	gd->fdt_blob = blob;
+
+	return CMD_RET_SUCCESS;
+}
+
+/* Check whether a sub-command leaves the working FDT as it is */
+static bool fdt_cmd_read_only(const char *cmd)
+{
+	return cmd[0] == 'p' || cmd[0] == 'l' || cmd[0] == 'g' ||
+	       cmd[0] == 'h' || !strncmp(cmd, "mo", 2) ||
+	       !strncmp(cmd, "che", 3);
+}
+
 /*
  * Get a value from the fdt and format it to be set in the environment
  */
@@ -121,10 +164,8 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		blob = map_sysmem(addr, 0);
 		if (!fdt_valid(&blob))
 			return 1;
-		if (control)
-			gd->fdt_blob = blob;
-		else
-			set_working_fdt_addr(addr);
+		if (argc >= 2 && fdt_in_live_use(blob))
+			return CMD_RET_FAILURE;
 
 		if (argc >= 2) {
 			int  len;
@@ -149,6 +190,11 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			}
 		}
 
+		/* The live tree is built from the FDT with its new length */
+		if (control)
+			return set_control_fdt(blob);
+		set_working_fdt_addr(addr);
+
 		return CMD_RET_SUCCESS;
 	}
 
@@ -159,6 +205,8 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			"Aborting!\n");
 		return CMD_RET_FAILURE;
 	}
+	if (!fdt_cmd_read_only(argv[1]) && fdt_in_live_use(working_fdt))
+		return CMD_RET_FAILURE;
 
 	/*
 	 * Move the working_fdt
@@ -179,6 +227,8 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			return 1;
 
 		newaddr = (struct fdt_header *)simple_strtoul(argv[3],NULL,16);
+		if (fdt_in_live_use(newaddr))
+			return CMD_RET_FAILURE;
 
 		/*
 		 * If the user specifies a length, use that.  Otherwise use the
@@ -620,8 +670,9 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		}
 		if (!fdt_valid(&blob))
 			return 1;
+		if (set_control_fdt(blob))
+			return CMD_RET_FAILURE;
 
-		gd->fdt_blob = blob;
 		cfg_noffset = fit_conf_get_node(working_fdt, NULL);
 		if (!cfg_noffset) {
 			printf("Could not find configuration node: %s\n",
@@ -13,13 +13,78 @@
 #include <common.h>
 #include <command.h>
 #include <hash.h>
+#include <malloc.h>
+#include <div64.h>
 #include <linux/ctype.h>
+#include <linux/sizes.h>
+
+/* Minimum time spent hashing for each benchmark result */
+#define HASH_BENCH_US	1000000
+
+/* Time @algo over @size bytes at @buf, returning the rate in units of 10KB/s */
+static ulong hash_bench_rate(struct hash_algo *algo, const void *buf,
+			     uint size)
+{
+	uint8_t output[HASH_MAX_DIGEST_SIZE];
+	ulong start, elapsed;
+	uint64_t bytes = 0;
+
+	start = timer_get_us();
+	do {
+		algo->hash_func_ws(buf, size, output, algo->chunk_size);
+		bytes += size;
+		elapsed = timer_get_us() - start;
+	} while (elapsed < HASH_BENCH_US);
+
+	return lldiv(bytes * 100, elapsed);
+}
+
+static int do_hash_bench(int argc, char * const argv[])
+{
+	static const char *const names[] = { "crc32", "sha1", "sha256" };
+	struct hash_algo *algo;
+	ulong aligned, unaligned;
+	uint size = SZ_1M;
+	uint8_t *buf;
+	int i;
+
+	if (argc > 2)
+		size = simple_strtoul(argv[2], NULL, 16);
+	if (!size)
+		return CMD_RET_USAGE;
+	buf = malloc(size + sizeof(long));
+	if (!buf) {
+		printf("Cannot allocate %#x bytes\n", size);
+		return CMD_RET_FAILURE;
+	}
+	for (i = 0; i < size + sizeof(long); i++)
+		buf[i] = i * 7;
+
+	printf("%-8s %14s %14s\n", "algo", "aligned", "unaligned");
+	for (i = 0; i < ARRAY_SIZE(names); i++) {
+		if (argc > 1 && strcmp(argv[1], names[i]))
+			continue;
+		if (hash_lookup_algo(names[i], &algo))
+			continue;
+		aligned = hash_bench_rate(algo, buf, size);
+		unaligned = hash_bench_rate(algo, buf + 1, size);
+		printf("%-8s %6lu.%02lu MB/s %6lu.%02lu MB/s\n", algo->name,
+		       aligned / 100, aligned % 100, unaligned / 100,
+		       unaligned % 100);
+	}
+	free(buf);
+
+	return 0;
+}
 
 static int do_hash(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	char *s;
 	int flags = HASH_FLAG_ENV;
 
+	if (argc >= 2 && !strcmp(argv[1], "bench"))
+		return do_hash_bench(argc - 1, argv + 1);
+
 #ifdef CONFIG_HASH_VERIFY
 	if (argc < 4)
 		return CMD_RET_USAGE;
@@ -47,7 +112,9 @@ U_BOOT_CMD(
 	hash,	HARGS,	1,	do_hash,
 	"compute hash message digest",
 	"algorithm address count [[*]hash_dest]\n"
-		"    - compute message digest [save to env var / *address]"
+		"    - compute message digest [save to env var / *address]\n"
+	"hash bench [algorithm [size]]\n"
+		"    - measure hashing speed over size bytes (default 0x100000)"
 #ifdef CONFIG_HASH_VERIFY
 	"\nhash -v algorithm address count [*]hash\n"
 		"    - verify message digest of memory area to immediate value, \n"
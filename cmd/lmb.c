@@ -0,0 +1,88 @@
+/*
+ * Show the logical memory blocks used by bootm
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <bootm.h>
+#include <command.h>
+#include <lmb.h>
+
+/*
+ * Run @show on the regions of the current bootm, or if there is none, on
+ * those that bootm would start with
+ */
+static int lmb_show(void (*show)(struct lmb *lmb))
+{
+	struct lmb tmp;
+
+	if (images.lmb.memory.cnt) {
+		show(&images.lmb);
+	} else {
+		bootm_init_lmb(&tmp);
+		show(&tmp);
+		lmb_uninit(&tmp);
+	}
+
+	return 0;
+}
+
+static void lmb_show_stats(struct lmb *lmb)
+{
+	phys_size_t free, largest;
+
+	free = lmb_get_free(lmb, &largest);
+	printf("memory:   %lu regions, %#llx bytes\n", lmb->memory.cnt,
+	       (unsigned long long)lmb->memory.size);
+	printf("reserved: %lu regions (peak %lu), %#llx bytes\n",
+	       lmb->reserved.cnt, lmb->reserved.max_cnt,
+	       (unsigned long long)lmb->reserved.size);
+	printf("free:     %#llx bytes, largest block %#llx bytes\n",
+	       (unsigned long long)free, (unsigned long long)largest);
+}
+
+static int do_lmb_dump(cmd_tbl_t *cmdtp, int flag, int argc,
+		       char * const argv[])
+{
+	return lmb_show(lmb_dump_all);
+}
+
+static int do_lmb_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	return lmb_show(lmb_show_stats);
+}
+
+static cmd_tbl_t cmd_lmb_sub[] = {
+	U_BOOT_CMD_MKENT(dump, 1, 1, do_lmb_dump, "", ""),
+	U_BOOT_CMD_MKENT(stats, 1, 1, do_lmb_stats, "", ""),
+};
+
+static int do_lmb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], &cmd_lmb_sub[0], ARRAY_SIZE(cmd_lmb_sub));
+	if (!c)
+		return CMD_RET_USAGE;
+
+	return c->cmd(cmdtp, flag, argc, argv);
+}
+
+U_BOOT_CMD(
+	lmb,	2,	1,	do_lmb,
+	"logical memory blocks used by bootm",
+	"dump - show the memory and reserved regions\n"
+	"lmb stats - show the number and size of the regions and free memory\n"
+	"\n"
+	"The regions of the bootm in progress are shown, or if there is\n"
+	"none, those that bootm would start with."
+);
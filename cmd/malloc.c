@@ -0,0 +1,159 @@
+/*
+ * Show malloc() pool and slab usage
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+#include <malloc_trace.h>
+#include <slab.h>
+
+/* Return @part as a percentage of @whole */
+static uint malloc_percent(ulong part, ulong whole)
+{
+	return whole ? (u64)part * 100 / whole : 0;
+}
+
+static void malloc_show_pool(void)
+{
+	struct mallinfo info = mallinfo();
+	ulong scattered = info.fordblks - info.keepcost;
+
+	printf("malloc() pool: %#lx bytes at %#lx\n",
+	       mem_malloc_end - mem_malloc_start, mem_malloc_start);
+	printf("  in use:      %#x bytes\n", info.uordblks);
+	printf("  peak:        %#x bytes\n", info.usmblks);
+	printf("  free:        %#x bytes in %d chunks, %#x at the top\n",
+	       info.fordblks, info.ordblks, info.keepcost);
+	/* Free space below the top chunk can only be used by smaller blocks */
+	printf("  fragmented:  %u%%\n", malloc_percent(scattered,
+						       info.fordblks));
+}
+
+static void malloc_show_slab(void)
+{
+	struct slab_stats stats;
+	uint slots, used;
+	int i;
+
+	slab_get_stats(&stats);
+	if (!stats.arena_size) {
+		printf("Slab arena not in use\n");
+		return;
+	}
+	printf("Slab arena: %#lx bytes, %u of %u pages used, peak %u\n",
+	       stats.arena_size, stats.pages_used, stats.pages,
+	       stats.pages_peak);
+	printf("  %5s %6s %6s %6s %6s\n", "size", "pages", "used", "free",
+	       "peak");
+	for (i = 0, slots = 0, used = 0; i < SLAB_CLASS_COUNT; i++) {
+		struct slab_class_stats *cls = &stats.cls[i];
+		uint count = cls->pages * (SLAB_PAGE_SIZE / cls->size);
+
+		printf("  %5u %6u %6u %6u %6u\n", cls->size, cls->pages,
+		       cls->used, count - cls->used, cls->peak);
+		slots += count * cls->size;
+		used += cls->used * cls->size;
+	}
+	printf("  in use:      %#lx bytes\n", stats.inuse);
+	printf("  fallbacks:   %lu\n", stats.fallbacks);
+	/* Free objects in pages that are in use cannot go to other sizes */
+	printf("  fragmented:  %u%%\n", malloc_percent(slots - used, slots));
+}
+
+static int do_malloc_info(cmd_tbl_t *cmdtp, int flag, int argc,
+			  char * const argv[])
+{
+	malloc_show_pool();
+	malloc_show_slab();
+
+	return 0;
+}
+
+#if CONFIG_IS_ENABLED(MALLOC_TRACE)
+static int malloc_site_cmp(const void *a, const void *b)
+{
+	const struct malloc_trace_site *sa = a, *sb = b;
+
+	return sa->peak < sb->peak ? 1 : sa->peak > sb->peak ? -1 : 0;
+}
+
+static int do_malloc_trace(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	struct malloc_trace_site sites[CONFIG_MALLOC_TRACE_SITES + 2];
+	const struct malloc_trace_site *table;
+	struct malloc_trace_stats stats;
+	int count, used, i;
+	int show = 10;
+
+	if (argc > 1)
+		show = simple_strtoul(argv[1], NULL, 10);
+	count = malloc_trace_get_stats(&stats, &table);
+	for (i = 0, used = 0; i < count; i++) {
+		if (table[i].count)
+			sites[used++] = table[i];
+	}
+	qsort(sites, used, sizeof(sites[0]), malloc_site_cmp);
+
+	printf("%-18s %4s %8s %10s %10s\n", "Caller", "Pool", "Count",
+	       "Live", "Peak");
+	for (i = 0; i < used && i < show; i++) {
+		struct malloc_trace_site *site = &sites[i];
+
+		if (site->caller)
+			printf("%#-18lx", site->caller);
+		else
+			printf("%-18s", "(others)");
+		printf(" %4s %8u %10lx %10lx\n", site->early ? "f" : "",
+		       site->count, site->live, site->peak);
+	}
+	printf("Pre-relocation pool peak: %#lx bytes\n", stats.early_peak);
+	printf("Live: %#lx bytes, peak %#lx bytes", stats.live, stats.peak);
+	if (stats.untracked)
+		printf(", %u allocations not tracked", stats.untracked);
+	printf("\n");
+
+	return 0;
+}
+#endif
+
+static cmd_tbl_t cmd_malloc_sub[] = {
+	U_BOOT_CMD_MKENT(info, 1, 1, do_malloc_info, "", ""),
+#if CONFIG_IS_ENABLED(MALLOC_TRACE)
+	U_BOOT_CMD_MKENT(trace, 2, 1, do_malloc_trace, "", ""),
+#endif
+};
+
+static int do_malloc(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], &cmd_malloc_sub[0],
+			 ARRAY_SIZE(cmd_malloc_sub));
+	if (!c)
+		return CMD_RET_USAGE;
+
+	return c->cmd(cmdtp, flag, argc, argv);
+}
+
+U_BOOT_CMD(
+	malloc,	3,	1,	do_malloc,
+	"malloc() pool information",
+	"info - show the usage, peak and fragmentation of the malloc() pool\n"
+	"    and of the slab arena for driver-model objects"
+#if CONFIG_IS_ENABLED(MALLOC_TRACE)
+	"\nmalloc trace [n] - show the 'n' callers (default 10) which used\n"
+	"    most memory at their peak ('f' if before relocation)"
+#endif
+);
@@ -22,10 +22,13 @@
 #endif
 #include <hash.h>
 #include <inttypes.h>
+#include <malloc.h>
 #include <mapmem.h>
+#include <memalign.h>
 #include <watchdog.h>
 #include <asm/io.h>
 #include <linux/compiler.h>
+#include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -1318,6 +1321,126 @@ static int do_mem_info(cmd_tbl_t *cmdtp, int flag, int argc,
 }
 #endif
 
+#ifdef CONFIG_CMD_MEM_BENCH
+/* Bytes handled by each measurement, unless given on the command line */
+#define MEM_BENCH_TOTAL		SZ_256M
+
+static const ulong mem_bench_sizes[] = { 16, 128, SZ_4K, SZ_64K, SZ_1M };
+
+enum {
+	MEM_BENCH_MEMCPY,
+	MEM_BENCH_MEMMOVE,
+	MEM_BENCH_MEMSET,
+	MEM_BENCH_ZERO,
+
+	MEM_BENCH_COUNT,
+};
+
+/* Run one function @count times and return the time taken in us */
+static ulong mem_bench_run(int func, char *buf, ulong size, ulong count)
+{
+	ulong start = timer_get_us();
+	ulong i;
+
+	for (i = 0; i < count; i++) {
+		switch (func) {
+		case MEM_BENCH_MEMCPY:
+			memcpy(buf + size, buf, size);
+			break;
+		case MEM_BENCH_MEMMOVE:
+			/* overlapping, so that it must copy backwards */
+			memmove(buf + 8, buf, size);
+			break;
+		case MEM_BENCH_MEMSET:
+			memset(buf, 0x5a, size);
+			break;
+		case MEM_BENCH_ZERO:
+			memset(buf, '\0', size);
+			break;
+		}
+	}
+
+	return max(timer_get_us() - start, 1UL);
+}
+
+static int do_mem_bench(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	ulong max_size = SZ_1M, total = MEM_BENCH_TOTAL;
+	ulong size, count, mbps;
+	char *buf;
+	int i, func;
+
+	if (argc > 3)
+		return CMD_RET_USAGE;
+	if (argc > 1)
+		max_size = simple_strtoul(argv[1], NULL, 16);
+	if (argc > 2)
+		total = simple_strtoul(argv[2], NULL, 16);
+	if (!max_size || !total)
+		return CMD_RET_USAGE;
+
+	buf = malloc_cache_aligned(2 * max_size);
+	if (!buf) {
+		printf("Cannot allocate %#lx bytes\n", 2 * max_size);
+		return CMD_RET_FAILURE;
+	}
+	memset(buf, '\0', 2 * max_size);
+
+	printf("%10s %9s %9s %9s %9s (GB/s)\n", "size", "memcpy", "memmove",
+	       "memset", "zero");
+	for (i = 0; i <= ARRAY_SIZE(mem_bench_sizes); i++) {
+		if (i == ARRAY_SIZE(mem_bench_sizes)) {
+			/* finish with the largest size, unless already done */
+			size = max_size;
+			if (i && mem_bench_sizes[i - 1] >= max_size)
+				break;
+		} else {
+			size = mem_bench_sizes[i];
+			if (size > max_size)
+				continue;
+		}
+		count = max(total / size, 1UL);
+		printf("%#10lx", size);
+		for (func = 0; func < MEM_BENCH_COUNT; func++) {
+			/* bytes per microsecond is MB/s */
+			mbps = size * count / mem_bench_run(func, buf, size,
+							    count);
+			printf(" %5lu.%03lu", mbps / 1000, mbps % 1000);
+			if (ctrlc())
+				goto out;
+		}
+		printf("\n");
+	}
+out:
+	free(buf);
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_mem_sub[] = {
+	U_BOOT_CMD_MKENT(bench, 3, 0, do_mem_bench, "", ""),
+};
+
+static int do_mem(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Strip off leading argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], &cmd_mem_sub[0], ARRAY_SIZE(cmd_mem_sub));
+	if (!c)
+		return CMD_RET_USAGE;
+
+	return c->cmd(cmdtp, flag, argc, argv);
+}
+#endif /* CONFIG_CMD_MEM_BENCH */
+
 U_BOOT_CMD(
 	base,	2,	1,	do_mem_base,
 	"print or set address offset",
@@ -1384,3 +1507,13 @@ U_BOOT_CMD(
 	""
 );
 #endif
+
+#ifdef CONFIG_CMD_MEM_BENCH
+U_BOOT_CMD(
+	mem,	4,	0,	do_mem,
+	"memory utilities",
+	"bench [size [total]] - time memcpy(), memmove() and memset() on\n"
+	"    sizes up to 'size' bytes (default 0x100000), handling 'total'\n"
+	"    bytes (default 0x10000000) for each"
+);
+#endif
@@ -577,6 +577,32 @@ int do_env_flags(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 }
 #endif
 
+#if defined(CONFIG_CMD_ENV_STATS)
+/*
+ * Print the size and use of the environment hash table
+ */
+static int do_env_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			char * const argv[])
+{
+	struct hsearch_stats stats;
+	ulong avg;
+
+	hstats_r(&env_htab, &stats);
+	printf("Entries:  %u in %u slots (%u%% full)\n", stats.filled,
+	       stats.size, stats.size ? stats.filled * 100 / stats.size : 0);
+	if (stats.old_left)
+		printf("Growing:  %u slots of the old table to move\n",
+		       stats.old_left);
+	printf("Grown:    %u times\n", stats.grows);
+	avg = stats.lookups ? stats.probes * 100 / stats.lookups : 0;
+	printf("Searches: %lu, %lu.%02lu slots each, at most %u\n",
+	       stats.lookups, avg / 100, avg % 100, stats.max_probes);
+	printf("Memory:   %#lx bytes\n", stats.mem);
+
+	return 0;
+}
+#endif
+
 /*
  * Interactively edit an environment variable
  */
@@ -1147,6 +1173,9 @@ static cmd_tbl_t cmd_env_sub[] = {
 	U_BOOT_CMD_MKENT(save, 1, 0, do_env_save, "", ""),
 #endif
 	U_BOOT_CMD_MKENT(set, CONFIG_SYS_MAXARGS, 0, do_env_set, "", ""),
+#if defined(CONFIG_CMD_ENV_STATS)
+	U_BOOT_CMD_MKENT(stats, 1, 0, do_env_stats, "", ""),
+#endif
 #if defined(CONFIG_CMD_ENV_EXISTS)
 	U_BOOT_CMD_MKENT(exists, 2, 0, do_env_exists, "", ""),
 #endif
@@ -1218,7 +1247,11 @@ static char env_help_text[] =
 #if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_ENV_IS_NOWHERE)
 	"env save - save environment\n"
 #endif
-	"env set [-f] name [arg ...]\n";
+	"env set [-f] name [arg ...]\n"
+#if defined(CONFIG_CMD_ENV_STATS)
+	"env stats - print hash table statistics\n"
+#endif
+	;
 #endif
 
 U_BOOT_CMD(
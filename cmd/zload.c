@@ -0,0 +1,59 @@
+/*
+ * Load a compressed image from a block device, decompressing it as it
+ * arrives
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <bootm.h>
+#include <command.h>
+#include <mapmem.h>
+#include <part.h>
+
+static int do_zload(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct blk_desc *desc;
+	disk_partition_t info;
+	ulong addr, blk, len, max_len = ~0UL, unc_len;
+	int comp = IH_COMP_GZIP;
+	int ret;
+
+	if (argc < 6)
+		return CMD_RET_USAGE;
+	if (argc > 6) {
+		comp = genimg_get_comp_id(argv[6]);
+		if (comp < 0)
+			return CMD_RET_USAGE;
+	}
+	if (argc > 7)
+		max_len = simple_strtoul(argv[7], NULL, 16);
+
+	ret = blk_get_device_part_str(argv[1], argv[2], &desc, &info, 1);
+	if (ret < 0)
+		return CMD_RET_FAILURE;
+	addr = simple_strtoul(argv[3], NULL, 16);
+	blk = simple_strtoul(argv[4], NULL, 16);
+	len = simple_strtoul(argv[5], NULL, 16);
+
+	ret = bootm_stream_load(desc, info.start + blk, len, comp,
+				map_sysmem(addr, 0), max_len, &unc_len);
+	if (ret) {
+		printf("Error loading image (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("%lu bytes read, %lu bytes decompressed\n", len, unc_len);
+	setenv_hex("filesize", unc_len);
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	zload,	8,	0,	do_zload,
+	"load and decompress an image from a block device",
+	"<interface> <dev[:part]> <addr> <blk#> <size> [gzip|lz4|none [maxsize]]\n"
+	"    - read 'size' bytes (hex) from block 'blk#' of 'dev' on\n"
+	"      'interface', decompressing to 'addr' while reading"
+);
@@ -21,6 +21,8 @@
 #include <dataflash.h>
 #endif
 #include <dm.h>
+#include <dm/bind_table.h>
+#include <dm/of_access.h>
 #include <environment.h>
 #include <fdtdec.h>
 #if defined(CONFIG_CMD_IDE)
@@ -303,6 +305,33 @@ static int initr_noncached(void)
 }
 #endif
 
+#ifdef CONFIG_OF_LIVE
+static int initr_of_live(void)
+{
+	int ret;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_OF_LIVE, "of_live");
+	ret = of_live_init();
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_OF_LIVE);
+	if (ret)
+		printf("Cannot build live tree (err=%d), using flat tree\n",
+		       ret);
+
+	return 0;
+}
+#endif
+
+#ifdef CONFIG_OF_BIND_TABLE
+static int initr_bind_table(void)
+{
+	/* If the table does not match, the device tree is used as normal */
+	if (dm_bind_table_init(&dm_bind_table))
+		debug("Bind table does not match the device tree\n");
+
+	return 0;
+}
+#endif
+
 #ifdef CONFIG_DM
 static int initr_dm(void)
 {
@@ -327,6 +356,16 @@ static int initr_dm(void)
 }
 #endif
 
+#ifdef CONFIG_DM_PROBE_ASYNC
+static int initr_dm_probe(void)
+{
+	/* Devices which fail are reported again when they are used */
+	dm_probe_uclasses(CONFIG_DM_PROBE_ASYNC_UCLASSES);
+
+	return 0;
+}
+#endif
+
 static int initr_bootstage(void)
 {
 	/* We cannot do this before initr_dm() */
@@ -761,6 +800,12 @@ static init_fnc_t init_sequence_r[] = {
 	initr_noncached,
 #endif
 	bootstage_relocate,
+#ifdef CONFIG_OF_LIVE
+	initr_of_live,
+#endif
+#ifdef CONFIG_OF_BIND_TABLE
+	initr_bind_table,
+#endif
 #ifdef CONFIG_DM
 	initr_dm,
 #endif
@@ -847,6 +892,9 @@ static init_fnc_t init_sequence_r[] = {
 	initr_malloc_bootparams,
 #endif
 	INIT_FUNC_WATCHDOG_RESET
+#ifdef CONFIG_DM_PROBE_ASYNC
+	initr_dm_probe,
+#endif
 	initr_secondary_cpu,
 #if defined(CONFIG_ID_EEPROM) || defined(CONFIG_SYS_I2C_MAC_OFFSET)
 	mac_read_from_eeprom,
@@ -19,6 +19,7 @@
 #include <lzma/LzmaTypes.h>
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
+#include <zstd.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
 #endif
@@ -48,20 +49,25 @@ static const void *boot_get_kernel(cmd_tbl_t *cmdtp, int flag, int argc,
 				   ulong *os_data, ulong *os_len);
 
 #ifdef CONFIG_LMB
-static void boot_start_lmb(bootm_headers_t *images)
+void bootm_init_lmb(struct lmb *lmb)
 {
 	ulong		mem_start;
 	phys_size_t	mem_size;
 
-	lmb_init(&images->lmb);
+	lmb_init(lmb);
 
 	mem_start = getenv_bootm_low();
 	mem_size = getenv_bootm_size();
 
-	lmb_add(&images->lmb, (phys_addr_t)mem_start, mem_size);
+	lmb_add(lmb, (phys_addr_t)mem_start, mem_size);
+
+	arch_lmb_reserve(lmb);
+	board_lmb_reserve(lmb);
+}
 
-	arch_lmb_reserve(&images->lmb);
-	board_lmb_reserve(&images->lmb);
+static void boot_start_lmb(bootm_headers_t *images)
+{
+	bootm_init_lmb(&images->lmb);
 }
 #else
 #define lmb_reserve(lmb, base, size)
@@ -71,6 +77,10 @@ static inline void boot_start_lmb(bootm_headers_t *images) { }
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
+#ifdef CONFIG_LMB
+	/* Free the regions left by an earlier bootm which did not boot */
+	lmb_uninit(&images.lmb);
+#endif
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = getenv_yesno("verify");
 
@@ -351,6 +361,16 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 	 * this, image_len will be set to the number of uncompressed bytes
 	 * loaded, ret will be non-zero on error.
 	 */
+#ifdef CONFIG_BOOTM_CHUNKED
+	if (comp != IH_COMP_NONE && bootm_chunk_check(image_buf, image_len)) {
+		ulong size;
+
+		ret = bootm_chunk_decomp(comp, load_buf, unc_len, image_buf,
+					 image_len, &size);
+		image_len = size;
+		goto done;
+	}
+#endif
 	switch (comp) {
 	case IH_COMP_NONE:
 		if (load == image_start)
@@ -410,11 +430,23 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
 	}
 
+#ifdef CONFIG_BOOTM_CHUNKED
+done:
+#endif
 	if (ret)
 		return handle_decomp_error(comp, image_len, unc_len, ret);
 	*load_end = load + image_len;
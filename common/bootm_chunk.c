@@ -0,0 +1,240 @@
+/*
+ * Parallel decompression of chunked images
+ *
+ * A chunked image is made up of chunks which were compressed one by one,
+ * each decompressing to a known size at a known place in the output. The
+ * chunks are shared out between the CPUs available with cpu_run(), each of
+ * which decompresses every n'th chunk, and the boot CPU does its share
+ * before waiting for the others. Without secondary CPUs the boot CPU
+ * simply decompresses all of the chunks itself.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <bootm.h>
+#include <image.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <zstd.h>
+
+/**
+ * struct chunk_job - the chunks decompressed by one CPU
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @src:	Start of the chunked image
+ * @offset:	Offset of each chunk from @src, with an extra entry for the
+ *		end of the last chunk
+ * @count:	Number of chunks
+ * @chunk_size:	Uncompressed size of each chunk except the last
+ * @dst:	Place to decompress to
+ * @dst_len:	Available space for decompression
+ * @first:	First chunk for this job to decompress
+ * @stride:	Distance to the job's next chunk, i.e. the number of jobs
+ * @ws:		Workspace for the decompressor
+ * @started:	true if the job was started on a secondary CPU
+ * @last_len:	Uncompressed size of the last chunk, if this job has it
+ * @ret:	0 if OK, -ve on error
+ */
+struct chunk_job {
+	int comp;
+	const void *src;
+	const ulong *offset;
+	uint count;
+	ulong chunk_size;
+	void *dst;
+	ulong dst_len;
+	uint first;
+	uint stride;
+	void *ws;
+	bool started;
+	ulong last_len;
+	int ret;
+};
+
+static ulong chunk_ws_size(int comp)
+{
+	switch (comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		return GUNZIP_WS_SIZE;
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD:
+		return zstd_ws_size();
+#endif
+	}
+
+	return 0;
+}
+
+static int chunk_decomp(int comp, const void *src, ulong len, void *dst,
+			ulong *dst_len, void *ws)
+{
+	int ret = -EPROTONOSUPPORT;
+
+	switch (comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP: {
+		unsigned long size = len;
+
+		ret = gunzip_ws(dst, *dst_len, (uchar *)src, &size, ws,
+				GUNZIP_WS_SIZE);
+		*dst_len = size;
+		if (ret)
+			ret = -EINVAL;
+		break;
+	}
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = *dst_len;
+
+		ret = zstd_decompress_ws(src, len, dst, &size, ws);
+		*dst_len = size;
+		break;
+	}
+#endif
+	}
+
+	return ret;
+}
+
+static void chunk_job_run(void *arg)
+{
+	struct chunk_job *job = arg;
+	ulong pos, size;
+	uint i;
+
+	for (i = job->first; i < job->count && !job->ret; i += job->stride) {
+		pos = i * job->chunk_size;
+		if (i == job->count - 1)
+			size = job->dst_len - pos;
+		else
+			size = job->chunk_size;
+		job->ret = chunk_decomp(job->comp, job->src + job->offset[i],
+					job->offset[i + 1] - job->offset[i],
+					job->dst + pos, &size, job->ws);
+		if (i == job->count - 1)
+			job->last_len = size;
+		else if (!job->ret && size != job->chunk_size)
+			job->ret = -EINVAL;
+	}
+}
+
+bool bootm_chunk_check(const void *src, ulong len)
+{
+	const struct image_chunk_header *hdr = src;
+
+	return len >= sizeof(*hdr) && be32_to_cpu(hdr->ch_magic) ==
+		IH_CHUNK_MAGIC;
+}
+
+int bootm_chunk_decomp(int comp, void *dst, ulong dst_len, const void *src,
+		       ulong src_len, ulong *lenp)
+{
+	const struct image_chunk_header *hdr = src;
+	struct chunk_job *jobs;
+	ulong chunk_size, ws_size;
+	ulong *offset;
+	uint count, njobs, i;
+	bool stuck;
+	int ret;
+
+	*lenp = 0;
+	if (!bootm_chunk_check(src, src_len))
+		return -EINVAL;
+	count = be32_to_cpu(hdr->ch_count);
+	chunk_size = be32_to_cpu(hdr->ch_size);
+	if (!count || !chunk_size ||
+	    count > (src_len - sizeof(*hdr)) / sizeof(hdr->ch_len[0]))
+		return -EINVAL;
+	ws_size = chunk_ws_size(comp);
+	if (!ws_size)
+		return -EPROTONOSUPPORT;
+	if (!dst_len || count - 1 > (dst_len - 1) / chunk_size) {
+		*lenp = dst_len;
+		return -ENOBUFS;
+	}
+
+	offset = malloc((count + 1) * sizeof(*offset));
+	if (!offset)
+		return -ENOMEM;
+	offset[0] = sizeof(*hdr) + count * sizeof(hdr->ch_len[0]);
+	for (i = 0; i < count; i++) {
+		ulong len = be32_to_cpu(hdr->ch_len[i]);
+
+		if (len > src_len - offset[i]) {
+			free(offset);
+			return -EINVAL;
+		}
+		offset[i + 1] = offset[i] + len;
+	}
+
+	njobs = min_t(uint, max(cpu_run_count(), 1), count);
+	jobs = calloc(njobs, sizeof(*jobs));
+	if (!jobs) {
+		free(offset);
+		return -ENOMEM;
+	}
+	for (i = 0; i < njobs; i++) {
+		struct chunk_job *job = &jobs[i];
+
+		job->ws = malloc_cache_aligned(ws_size);
+		if (!job->ws) {
+			njobs = i;
+			ret = -ENOMEM;
+			goto out;
+		}
+		job->comp = comp;
+		job->src = src;
+		job->offset = offset;
+		job->count = count;
+		job->chunk_size = chunk_size;
+		job->dst = dst;
+		job->dst_len = dst_len;
+		job->first = i;
+		job->stride = njobs;
+	}
+	debug("%s: %u chunks of %lx bytes on %u CPUs\n", __func__, count,
+	      chunk_size, njobs);
+
+	/* Start the secondary CPUs, then do our own share */
+	for (i = 1; i < njobs; i++)
+		jobs[i].started = !cpu_run(i, chunk_job_run, &jobs[i]);
+	chunk_job_run(&jobs[0]);
+
+	/* Any job which could not be started is done here instead */
+	stuck = false;
+	for (i = 1; i < njobs; i++) {
+		if (!jobs[i].started)
+			chunk_job_run(&jobs[i]);
+		else if (cpu_run_wait(i))
+			stuck = true;
+	}
+
+	/*
+	 * A CPU which did not finish may still be using its job, so leave
+	 * the jobs allocated rather than let it write over freed memory
+	 */
+	if (stuck) {
+		printf("Chunked image: a CPU did not finish decompressing\n");
+		return -ETIMEDOUT;
+	}
+
+	ret = 0;
+	for (i = 0; i < njobs; i++) {
+		if (jobs[i].ret && !ret)
+			ret = jobs[i].ret;
+	}
+	*lenp = (count - 1) * chunk_size +
+		jobs[(count - 1) % njobs].last_len;
+
+out:
+	for (i = 0; i < njobs; i++)
+		free(jobs[i].ws);
+	free(jobs);
+	free(offset);
+
+	return ret;
+}
@@ -0,0 +1,270 @@
+/*
+ * Pipelined loading and decompression of images
+ *
+ * bootm_decomp_image() can only start once the whole compressed image is in
+ * memory, so the time taken to read the image and to decompress it add up.
+ * Here the image is read from a block device into a ring of buffers using
+ * asynchronous requests and each buffer is decompressed as soon as it
+ * arrives, while the following buffers are still being read.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <bootm.h>
+#include <bootstage.h>
+#include <lz4.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <u-boot/zlib.h>
+
+/* Number of buffers in the ring */
+#define BOOTM_STREAM_BUFS	4
+
+/* Room for a gzip header, including the file name */
+#define GZIP_HDR_MAX		256
+
+#ifdef CONFIG_GZIP
+struct gzip_stream {
+	z_stream s;
+	bool inflating;
+	int hdr_len;
+	unsigned char hdr[GZIP_HDR_MAX];
+};
+
+static int gzip_stream_inflate(struct gzip_stream *gz, const void *src,
+			       ulong len)
+{
+	int r;
+
+	gz->s.next_in = (void *)src;
+	gz->s.avail_in = len;
+	r = inflate(&gz->s, Z_NO_FLUSH);
+	if (r == Z_STREAM_END)
+		return 1;
+	if (r != Z_OK && r != Z_BUF_ERROR) {
+		printf("Error: inflate() returned %d\n", r);
+		return -EINVAL;
+	}
+	if (gz->s.avail_in)
+		return -ENOBUFS;	/* output overrun */
+
+	return 0;
+}
+
+static int gzip_stream_feed(struct gzip_stream *gz, const void *src,
+			    ulong len)
+{
+	int n, offset;
+	int ret;
+
+	if (gz->inflating)
+		return gzip_stream_inflate(gz, src, len);
+
+	/* gather the header, which must fit in GZIP_HDR_MAX bytes */
+	n = min(len, (ulong)(GZIP_HDR_MAX - gz->hdr_len));
+	memcpy(gz->hdr + gz->hdr_len, src, n);
+	gz->hdr_len += n;
+	src += n;
+	len -= n;
+	if (gz->hdr_len < 10)
+		return 0;
+	offset = gzip_parse_header(gz->hdr, gz->hdr_len);
+	if (offset < 0 || (!offset && gz->hdr_len == GZIP_HDR_MAX)) {
+		puts("Error: Bad gzipped data\n");
+		return -EINVAL;
+	}
+	if (!offset)
+		return 0;
+
+	ret = inflateInit2(&gz->s, -MAX_WBITS);
+	if (ret != Z_OK) {
+		printf("Error: inflateInit2() returned %d\n", ret);
+		return -EINVAL;
+	}
+	gz->inflating = true;
+	ret = gzip_stream_inflate(gz, gz->hdr + offset, gz->hdr_len - offset);
+	if (ret || !len)
+		return ret;
+
+	return gzip_stream_inflate(gz, src, len);
+}
+#endif
+
+int bootm_stream_init(struct bootm_stream *bs, int comp, void *dst,
+		      ulong dst_len)
+{
+	bs->comp = comp;
+	bs->dst = dst;
+	bs->dst_len = dst_len;
+	bs->out_len = 0;
+	bs->priv = NULL;
+
+	switch (comp) {
+	case IH_COMP_NONE:
+		break;
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP: {
+		struct gzip_stream *gz;
+
+		gz = calloc(1, sizeof(*gz));
+		if (!gz)
+			return -ENOMEM;
+		gz->s.zalloc = gzalloc;
+		gz->s.zfree = gzfree;
+		gz->s.next_out = dst;
+		gz->s.avail_out = dst_len;
+		bs->priv = gz;
+		break;
+	}
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4: {
+		struct ulz4_stream *lz;
+
+		lz = malloc(sizeof(*lz));
+		if (!lz)
+			return -ENOMEM;
+		ulz4_stream_init(lz, dst, dst_len);
+		bs->priv = lz;
+		break;
+	}
+#endif
+	default:
+		printf("Compression type %d cannot be streamed\n", comp);
+		return BOOTM_ERR_UNIMPLEMENTED;
+	}
+
+	return 0;
+}
+
+int bootm_stream_feed(struct bootm_stream *bs, const void *src, ulong len)
+{
+	switch (bs->comp) {
+	case IH_COMP_NONE:
+		if (len > bs->dst_len - bs->out_len)
+			return -ENOBUFS;
+		memcpy(bs->dst + bs->out_len, src, len);
+		bs->out_len += len;
+		return 0;
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		return gzip_stream_feed(bs->priv, src, len);
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		return ulz4_stream_feed(bs->priv, src, len);
+#endif
+	}
+
+	return BOOTM_ERR_UNIMPLEMENTED;
+}
+
+ulong bootm_stream_end(struct bootm_stream *bs)
+{
+	ulong len = bs->out_len;
+
+	switch (bs->comp) {
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP: {
+		struct gzip_stream *gz = bs->priv;
+
+		len = gz->s.next_out - (unsigned char *)bs->dst;
+		if (gz->inflating)
+			inflateEnd(&gz->s);
+		break;
+	}
+#endif
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+		len = ulz4_stream_end(bs->priv);
+		break;
+#endif
+	}
+	free(bs->priv);
+	bs->priv = NULL;
+
+	return len;
+}
+
+#ifdef CONFIG_BLK_ASYNC
+int bootm_stream_load(struct blk_desc *desc, lbaint_t start, ulong image_len,
+		      int comp, void *load_buf, ulong unc_len, ulong *lenp)
+{
+	struct blk_request req[BOOTM_STREAM_BUFS];
+	lbaint_t chunk, blocks, next = 0;
+	struct bootm_stream bs;
+	ulong fed = 0, n;
+	char *bufs;
+	long res;
+	int i, k, ret;
+
+	chunk = CONFIG_BOOTM_STREAM_BUF_SIZE * 1024 / desc->blksz;
+	if (!chunk)
+		return -EINVAL;
+	blocks = DIV_ROUND_UP(image_len, desc->blksz);
+	bufs = memalign(ARCH_DMA_MINALIGN,
+			BOOTM_STREAM_BUFS * chunk * desc->blksz);
+	if (!bufs)
+		return -ENOMEM;
+	ret = bootm_stream_init(&bs, comp, load_buf, unc_len);
+	if (ret) {
+		free(bufs);
+		return ret;
+	}
+
+	bootstage_mark_name(BOOTSTAGE_ID_ALLOC, "stream_start");
+	memset(req, '\0', sizeof(req));
+	for (i = 0; i < BOOTM_STREAM_BUFS; i++) {
+		req[i].dev = desc->bdev;
+		req[i].op = BLK_REQ_READ;
+		req[i].buffer = bufs + i * chunk * desc->blksz;
+		req[i].complete = true;
+	}
+
+	/* keep every buffer busy, consuming them in turn */
+	for (k = 0; !ret && fed < image_len; k++) {
+		while (next < blocks && next / chunk < k + BOOTM_STREAM_BUFS) {
+			struct blk_request *r;
+
+			r = &req[(next / chunk) % BOOTM_STREAM_BUFS];
+			r->start = start + next;
+			r->blkcnt = min(chunk, blocks - next);
+			ret = blk_submit(r);
+			if (ret)
+				goto err;
+			next += r->blkcnt;
+		}
+
+		i = k % BOOTM_STREAM_BUFS;
+		bootstage_start(BOOTSTAGE_ID_ACCUM_LOAD, "stream_load");
+		res = blk_wait(&req[i]);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_LOAD);
+		if (res != req[i].blkcnt) {
+			ret = res < 0 ? res : -EIO;
+			goto err;
+		}
+
+		n = min((ulong)res * desc->blksz, image_len - fed);
+		bootstage_start(BOOTSTAGE_ID_ACCUM_DECOMP, "stream_decomp");
+		ret = bootm_stream_feed(&bs, req[i].buffer, n);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DECOMP);
+		fed += n;
+	}
+	if (ret >= 0 && comp != IH_COMP_NONE && ret != 1) {
+		puts("Error: compressed data is truncated\n");
+		ret = -EINVAL;
+	}
+
+err:
+	/* the buffers must not be freed while a request is using them */
+	for (i = 0; i < BOOTM_STREAM_BUFS; i++)
+		blk_wait(&req[i]);
+	*lenp = bootm_stream_end(&bs);
+	free(bufs);
+	bootstage_mark_name(BOOTSTAGE_ID_ALLOC, "stream_done");
+
+	return ret < 0 ? ret : 0;
+}
+#endif
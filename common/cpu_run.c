@@ -0,0 +1,26 @@
+/*
+ * Defaults for running work on secondary CPUs
+ *
+ * Architectures which can start their other CPUs to run functions for
+ * U-Boot override these. Without that, everything runs on the boot CPU.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+
+__weak int cpu_run_count(void)
+{
+	return 1;
+}
+
+__weak int cpu_run(int nr, void (*func)(void *arg), void *arg)
+{
+	return -ENOSYS;
+}
+
+__weak int cpu_run_wait(int nr)
+{
+	return -ENOSYS;
+}
@@ -5,14 +5,42 @@
 #endif
 
 #include <malloc.h>
+#include <malloc_trace.h>
 #include <asm/io.h>
 
-#ifdef DEBUG
+#if CONFIG_IS_ENABLED(MALLOC_TRACE)
+/*
+ * Build the allocator under other names, so that the calls it makes to
+ * itself are not traced. The usual names are wrappers at the end of the
+ * file which record each call against its caller.
+ */
+#undef mALLOc
+#undef fREe
+#undef rEALLOc
+#undef mEMALIGn
+#undef cALLOc
+#define mALLOc		malloc_untraced
+#define fREe		free_untraced
+#define rEALLOc		realloc_untraced
+#define mEMALIGn	memalign_untraced
+#define cALLOc		calloc_untraced
+
+Void_t *mALLOc(size_t);
+void fREe(Void_t *);
+Void_t *rEALLOc(Void_t *, size_t);
+Void_t *mEMALIGn(size_t, size_t);
+Void_t *cALLOc(size_t, size_t);
+#endif
+
 #if __STD_C
 static void malloc_update_mallinfo (void);
-void malloc_stats (void);
 #else
 static void malloc_update_mallinfo ();
+#endif
+#ifdef DEBUG
+#if __STD_C
+void malloc_stats (void);
+#else
 void malloc_stats();
 #endif
 #endif	/* DEBUG */
@@ -2245,7 +2273,6 @@ size_t malloc_usable_size(mem) Void_t* mem;
 
 /* Utility to update current_mallinfo for malloc_stats and mallinfo() */
 
-#ifdef DEBUG
 static void malloc_update_mallinfo()
 {
   int i;
@@ -2281,9 +2308,9 @@ static void malloc_update_mallinfo()
   current_mallinfo.hblks = n_mmaps;
   current_mallinfo.hblkhd = mmapped_mem;
   current_mallinfo.keepcost = chunksize(top);
+  current_mallinfo.usmblks = max_total_mem;
 
 }
-#endif	/* DEBUG */
 
 
 
@@ -2323,13 +2350,11 @@ void malloc_stats()
   mallinfo returns a copy of updated current mallinfo.
 */
 
-#ifdef DEBUG
 struct mallinfo mALLINFo()
 {
   malloc_update_mallinfo();
   return current_mallinfo;
 }
-#endif	/* DEBUG */
 
 
 
@@ -2384,6 +2409,54 @@ int initf_malloc(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(MALLOC_TRACE)
+void *malloc(size_t bytes)
+{
+	void *ptr = mALLOc(bytes);
+
+	malloc_trace_alloc(ptr, bytes, __builtin_return_address(0));
+
+	return ptr;
+}
+
+void free(void *mem)
+{
+	malloc_trace_free(mem);
+	fREe(mem);
+}
+
+void *realloc(void *oldmem, size_t bytes)
+{
+	void *ptr = rEALLOc(oldmem, bytes);
+
+	/* On failure the old memory is left as it was */
+	if (ptr || !bytes) {
+		malloc_trace_free(oldmem);
+		malloc_trace_alloc(ptr, bytes, __builtin_return_address(0));
+	}
+
+	return ptr;
+}
+
+void *memalign(size_t alignment, size_t bytes)
+{
+	void *ptr = mEMALIGn(alignment, bytes);
+
+	malloc_trace_alloc(ptr, bytes, __builtin_return_address(0));
+
+	return ptr;
+}
+
+void *calloc(size_t n, size_t elem_size)
+{
+	void *ptr = cALLOc(n, elem_size);
+
+	malloc_trace_alloc(ptr, n * elem_size, __builtin_return_address(0));
+
+	return ptr;
+}
+#endif
+
 /*
 
 History:
@@ -17,6 +17,8 @@
 #include <linux/kconfig.h>
 #include <common.h>
 #include <errno.h>
+#include <lz4.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
 DECLARE_GLOBAL_DATA_PTR;
@@ -990,8 +992,122 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 	return 0;
 }
 
+#ifndef USE_HOSTCC
+void fit_image_hash_start(struct fit_hash_stream *hs, const void *fit,
+			  int image_noffset)
+{
+	struct hash_algo *algo;
+	int noffset, ignore;
+	char *algo_name;
+
+	hs->fit = fit;
+	hs->image_noffset = image_noffset;
+	hs->count = 0;
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (hs->count == FIT_HASH_STREAM_MAX)
+			break;
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)) ||
+		    fit_image_hash_get_algo(fit, noffset, &algo_name))
+			continue;
+		if (IMAGE_ENABLE_IGNORE) {
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+			if (ignore)
+				continue;
+		}
+		if (hash_progressive_lookup_algo(algo_name, &algo) ||
+		    algo->hash_init(algo, &hs->hash[hs->count].ctx))
+			continue;
+		hs->hash[hs->count].noffset = noffset;
+		hs->hash[hs->count].algo = algo;
+		hs->count++;
+	}
+}
+
+void fit_image_hash_update(struct fit_hash_stream *hs, const void *data,
+			   size_t size)
+{
+	struct hash_algo *algo;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		algo = hs->hash[i].algo;
+		if (!hs->hash[i].ctx)
+			continue;
+		/* the context is freed on error */
+		if (algo->hash_update(algo, hs->hash[i].ctx, data, size, 0))
+			hs->hash[i].ctx = NULL;
+	}
+}
+
+/* Finish each progressive hash, leaving value_len as 0 on failure */
+static void fit_image_hash_complete(struct fit_hash_stream *hs)
+{
+	struct hash_algo *algo;
+	uint32_t crc;
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		algo = hs->hash[i].algo;
+		hs->hash[i].value_len = 0;
+		if (!hs->hash[i].ctx ||
+		    algo->hash_finish(algo, hs->hash[i].ctx, hs->hash[i].value,
+				      sizeof(hs->hash[i].value)))
+			continue;
+		hs->hash[i].ctx = NULL;
+		hs->hash[i].value_len = algo->digest_size;
+
+		/* the FIT holds crc32 values in image byte order */
+		if (!strcmp(algo->name, "crc32")) {
+			memcpy(&crc, hs->hash[i].value, sizeof(crc));
+			crc = cpu_to_uimage(crc);
+			memcpy(hs->hash[i].value, &crc, sizeof(crc));
+		}
+	}
+}
+
+void fit_image_hash_abort(struct fit_hash_stream *hs)
+{
+	struct hash_algo *algo;
+	int i;
+
+	/* finishing a hash is the only way to release its context */
+	for (i = 0; i < hs->count; i++) {
+		algo = hs->hash[i].algo;
+		if (hs->hash[i].ctx)
+			algo->hash_finish(algo, hs->hash[i].ctx,
+					  hs->hash[i].value,
+					  sizeof(hs->hash[i].value));
+		hs->hash[i].ctx = NULL;
+		hs->hash[i].value_len = 0;
+	}
+}
+
+/* Look up the progressively calculated value of a hash node, if any */
+static int fit_image_hash_lookup(struct fit_hash_stream *hs, int noffset,
+				 uint8_t *value, int *value_len)
+{
+	int i;
+
+	for (i = 0; hs && i < hs->count; i++) {
+		if (hs->hash[i].noffset == noffset) {
+			if (!hs->hash[i].value_len)
+				return -EIO;
+			memcpy(value, hs->hash[i].value, hs->hash[i].value_len);
+			*value_len = hs->hash[i].value_len;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+#endif
+
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, struct fit_hash_stream *hs,
+				char **err_msgp)
 {
 	uint8_t value[FIT_MAX_HASH_LEN];
 	int value_len;
@@ -999,6 +1115,7 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	uint8_t *fit_value;
 	int fit_value_len;
 	int ignore;
+	int ret;
 
 	*err_msgp = NULL;
 
@@ -1022,7 +1139,16 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+#ifndef USE_HOSTCC
+	ret = fit_image_hash_lookup(hs, noffset, value, &value_len);
+#else
+	ret = -ENOENT;
+#endif
+	if (ret == -EIO) {
+		*err_msgp = "Progressive hash failed";
+		return -1;
+	}
+	if (ret && calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1038,34 +1164,19 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
-/**
- * fit_image_verify - verify data integrity
- * @fit: pointer to the FIT format image header
- * @image_noffset: component image node offset
- *
- * fit_image_verify() goes over component image hash nodes,
- * re-calculates each data hash and compares with the value stored in hash
- * node.
- *
- * returns:
- *     1, if all hashes are valid
- *     0, otherwise (or on error)
+/*
+ * Verify the hashes and signatures of an image's data, using the values
+ * already calculated in @hs where there are any
  */
-int fit_image_verify(const void *fit, int image_noffset)
+static int fit_image_verify_data(const void *fit, int image_noffset,
+				 const void *data, size_t size,
+				 struct fit_hash_stream *hs)
 {
-	const void	*data;
-	size_t		size;
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
 	int ret;
 
-	/* Get image data and data length */
-	if (fit_image_get_data(fit, image_noffset, &data, &size)) {
-		err_msg = "Can't get image data/size";
-		goto error;
-	}
-
 	/* Verify all required signatures */
 	if (IMAGE_ENABLE_VERIFY &&
 	    fit_image_verify_required_sigs(fit, image_noffset, data, size,
@@ -1085,7 +1196,7 @@ int fit_image_verify(const void *fit, int image_noffset)
 		 */
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
-			if (fit_image_check_hash(fit, noffset, data, size,
+			if (fit_image_check_hash(fit, noffset, data, size, hs,
 						 &err_msg))
 				goto error;
 			puts("+ ");
@@ -1122,6 +1233,46 @@ error:
 	return 0;
 }
 
+/**
+ * fit_image_verify - verify data integrity
+ * @fit: pointer to the FIT format image header
+ * @image_noffset: component image node offset
+ *
+ * fit_image_verify() goes over component image hash nodes,
+ * re-calculates each data hash and compares with the value stored in hash
+ * node.
+ *
+ * returns:
+ *     1, if all hashes are valid
+ *     0, otherwise (or on error)
+ */
+int fit_image_verify(const void *fit, int image_noffset)
+{
+	const void	*data;
+	size_t		size;
+
+	/* Get image data and data length */
+	if (fit_image_get_data(fit, image_noffset, &data, &size)) {
+		printf(" error!\nCan't get image data/size for '%s' hash node"
+		       " in '%s' image node\n", fit_get_name(fit, 0, NULL),
+		       fit_get_name(fit, image_noffset, NULL));
+		return 0;
+	}
+
+	return fit_image_verify_data(fit, image_noffset, data, size, NULL);
+}
+
+#ifndef USE_HOSTCC
+int fit_image_hash_finish(struct fit_hash_stream *hs, const void *data,
+			  size_t size)
+{
+	fit_image_hash_complete(hs);
+
+	return fit_image_verify_data(hs->fit, hs->image_noffset, data, size,
+				     hs);
+}
+#endif
+
 /**
  * fit_all_image_verify - verify data integrity for all images
  * @fit: pointer to the FIT format image header
@@ -1633,6 +1784,100 @@ static const char *fit_get_image_type_property(int type)
 	return "unknown";
 }
 
+#if !defined(USE_HOSTCC) && !defined(CONFIG_SPL_BUILD) && defined(CONFIG_LZ4)
+/**
+ * fit_image_get_bundle() - get the bundle which holds an image's data
+ *
+ * @fit:	FIT to check
+ * @noffset:	Offset of the image node
+ * @return offset of the image node named by the image's 'bundle' property,
+ *	-ENOENT if it has none, or -EINVAL if there is no such image
+ */
+static int fit_image_get_bundle(const void *fit, int noffset)
+{
+	const char *name;
+
+	name = fdt_getprop(fit, noffset, FIT_BUNDLE_PROP, NULL);
+	if (!name)
+		return -ENOENT;
+	noffset = fit_image_get_node(fit, name);
+
+	return noffset < 0 ? -EINVAL : noffset;
+}
+
+/**
+ * fit_image_get_bundled_fdt() - extract an FDT from an LZ4-compressed bundle
+ *
+ * The bundle holds many FDTs one after the other. Only the LZ4 blocks
+ * which hold the one at the image's 'bundle-offset' are decompressed.
+ *
+ * @fit:	FIT to use
+ * @noffset:	Offset of the FDT image node
+ * @bundle:	Offset of the bundle image node
+ * @datap:	Returns a pointer to the FDT, which the caller must free
+ * @sizep:	Returns the size of the FDT
+ * @return 0 if OK, -ve on error
+ */
+static int fit_image_get_bundled_fdt(const void *fit, int noffset, int bundle,
+				     void **datap, size_t *sizep)
+{
+	struct ulz4_index idx;
+	struct fdt_header hdr;
+	const fdt32_t *offsetp;
+	const void *src;
+	size_t srcn, size, len;
+	void *fdt;
+	int ret;
+
+	offsetp = fdt_getprop(fit, noffset, FIT_BUNDLE_OFFSET_PROP, NULL);
+	if (!offsetp || !fit_image_check_comp(fit, bundle, IH_COMP_LZ4) ||
+	    fit_image_get_data(fit, bundle, &src, &srcn))
+		return -EINVAL;
+
+	ret = ulz4_index_init(&idx, src, srcn);
+	if (ret)
+		return ret;
+	len = sizeof(hdr);
+	ret = ulz4_index_read(&idx, fdt32_to_cpu(*offsetp), &hdr, &len);
+	if (!ret && (len != sizeof(hdr) || fdt_check_header(&hdr)))
+		ret = -ENOEXEC;
+	if (ret)
+		goto out;
+
+	size = fdt_totalsize(&hdr);
+	fdt = malloc(size);
+	if (!fdt) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	len = size;
+	ret = ulz4_index_read(&idx, fdt32_to_cpu(*offsetp), fdt, &len);
+	if (!ret && len != size)
+		ret = -ENOEXEC;
+	if (ret) {
+		free(fdt);
+		goto out;
+	}
+	*datap = fdt;
+	*sizep = size;
+out:
+	ulz4_index_free(&idx);
+
+	return ret;
+}
+#else
+static int fit_image_get_bundle(const void *fit, int noffset)
+{
+	return -ENOENT;
+}
+
+static int fit_image_get_bundled_fdt(const void *fit, int noffset, int bundle,
+				     void **datap, size_t *sizep)
+{
+	return -ENOSYS;
+}
+#endif
+
 int fit_image_load(bootm_headers_t *images, ulong addr,
 		   const char **fit_unamep, const char **fit_uname_configp,
 		   int arch, int image_type, int bootstage_id,
@@ -1643,8 +1888,10 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	const char *fit_uname_config;
 	const void *fit;
 	const void *buf;
+	void *bundled = NULL;
 	size_t size;
 	int type_ok, os_ok;
+	int bundle;
 	ulong load, data, len;
 	uint8_t os;
 #ifndef USE_HOSTCC
@@ -1719,7 +1966,18 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 
 	printf("   Trying '%s' %s subimage\n", fit_uname, prop_name);
 
-	ret = fit_image_select(fit, noffset, images->verify);
+	/* An FDT in a bundle is covered by the bundle's hashes */
+	bundle = image_type == IH_TYPE_FLATDT ?
+		fit_image_get_bundle(fit, noffset) : -ENOENT;
+	if (bundle >= 0) {
+		printf("   Using bundle '%s'\n", fit_get_name(fit, bundle, NULL));
+	} else if (bundle != -ENOENT) {
+		puts("Could not find bundle image node\n");
+		bootstage_error(bootstage_id + BOOTSTAGE_SUB_SUBNODE);
+		return bundle;
+	}
+	ret = fit_image_select(fit, bundle >= 0 ? bundle : noffset,
+			       images->verify);
 	if (ret) {
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_HASH);
 		return ret;
@@ -1775,7 +2033,17 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_CHECK_ALL_OK);
 
 	/* get image data address and length */
-	if (fit_image_get_data(fit, noffset, &buf, &size)) {
+	if (bundle >= 0) {
+		ret = fit_image_get_bundled_fdt(fit, noffset, bundle, &bundled,
+						&size);
+		if (ret) {
+			printf("Could not extract %s from bundle: %d\n",
+			       prop_name, ret);
+			bootstage_error(bootstage_id + BOOTSTAGE_SUB_GET_DATA);
+			return ret;
+		}
+		buf = bundled;
+	} else if (fit_image_get_data(fit, noffset, &buf, &size)) {
 		printf("Could not find %s subimage data!\n", prop_name);
 		bootstage_error(bootstage_id + BOOTSTAGE_SUB_GET_DATA);
 		return -ENOENT;
@@ -1791,6 +2059,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 	/* verify that image data is a proper FDT blob */
 	if (image_type == IH_TYPE_FLATDT && fdt_check_header(buf)) {
 		puts("Subimage data is not a FDT");
+		free(bundled);
 		return -ENOEXEC;
 	}
 
@@ -1814,6 +2083,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 			printf("Can't get %s subimage load address!\n",
 			       prop_name);
 			bootstage_error(bootstage_id + BOOTSTAGE_SUB_LOAD);
+			free(bundled);
 			return -EBADF;
 		}
 	} else if (load_op != FIT_LOAD_OPTIONAL_NON_ZERO || load) {
@@ -1832,6 +2102,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		if (image_type != IH_TYPE_KERNEL &&
 		    load < image_end && load_end > image_start) {
 			printf("Error: %s overwritten\n", prop_name);
+			free(bundled);
 			return -EXDEV;
 		}
 
@@ -1841,6 +2112,7 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		dst = map_sysmem(load, len);
 		memmove(dst, buf, len);
 		data = load;
+		free(bundled);
 	}
 	bootstage_mark(bootstage_id + BOOTSTAGE_SUB_LOAD);
 
@@ -291,6 +291,47 @@ int fit_image_verify_required_sigs(const void *fit, int image_noffset,
 	return 0;
 }
 
+/**
+ * fit_config_check_bundles() - check that signed images' bundles are signed
+ *
+ * An FDT in a bundle takes its data from the bundle image, so a signature
+ * over the FDT image means nothing unless the bundle is signed with it.
+ *
+ * @fit:	FIT to check
+ * @node_inc:	Paths of the nodes covered by the signature
+ * @count:	Number of paths
+ * @return 0 if OK, -EPERM if an image's bundle is not covered
+ */
+static int fit_config_check_bundles(const void *fit, char * const node_inc[],
+				    int count)
+{
+	const char *bundle;
+	char path[200];
+	int noffset;
+	int i, j;
+
+	for (i = 0; i < count; i++) {
+		noffset = fdt_path_offset(fit, node_inc[i]);
+		if (noffset < 0)
+			continue;
+		bundle = fdt_getprop(fit, noffset, FIT_BUNDLE_PROP, NULL);
+		if (!bundle)
+			continue;
+		noffset = fit_image_get_node(fit, bundle);
+		if (noffset < 0 || fdt_get_path(fit, noffset, path,
+						sizeof(path)))
+			return -EPERM;
+		for (j = 0; j < count; j++) {
+			if (!strcmp(node_inc[j], path))
+				break;
+		}
+		if (j == count)
+			return -EPERM;
+	}
+
+	return 0;
+}
+
 int fit_config_check_sig(const void *fit, int noffset, int required_keynode,
 			 char **err_msgp)
 {
@@ -344,6 +385,10 @@ int fit_config_check_sig(const void *fit, int noffset, int required_keynode,
 		debug("   '%s'\n", name);
 		node_inc[i] = (char *)name;
 	}
+	if (fit_config_check_bundles(fit, node_inc, count)) {
+		*err_msgp = "Bundle is not signed";
+		return -1;
+	}
 
 	/*
 	 * Each node can generate one region for each sub-node. Allow for
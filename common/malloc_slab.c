@@ -0,0 +1,211 @@
+/*
+ * Size-class allocator for small driver-model objects
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <slab.h>
+#include <linux/list.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * The arena is split into pages of SLAB_PAGE_SIZE bytes. A page is given to
+ * one size class when that class runs out of free objects, and goes back to
+ * the pool of free pages once all its objects are freed again, so that a
+ * burst of one size does not keep memory from the others.
+ */
+
+/**
+ * struct slab_page - state of one page of the arena
+ *
+ * @node:	Link in the list of free pages, or of partly used pages of a
+ *		size class
+ * @free:	List of free objects in the page, linked through their first
+ *		word
+ * @used:	Number of objects in use
+ * @cls:	Size class of the page, or -1 if it is free
+ */
+struct slab_page {
+	struct list_head node;
+	void *free;
+	u16 used;
+	s8 cls;
+};
+
+/**
+ * struct slab_class - a size class
+ *
+ * @partial:	Pages of this class with at least one free object
+ * @stats:	Usage of the class
+ */
+struct slab_class {
+	struct list_head partial;
+	struct slab_class_stats stats;
+};
+
+static struct slab_info {
+	char *base;
+	char *end;
+	struct slab_page *page;
+	struct list_head free_pages;
+	struct slab_class cls[SLAB_CLASS_COUNT];
+	uint pages;
+	uint pages_used;
+	uint pages_peak;
+	ulong fallbacks;
+	bool failed;
+} slab;
+
+static int slab_init(void)
+{
+	ulong size = CONFIG_SYS_MALLOC_SLAB_LEN;
+	int i;
+
+	slab.pages = size / SLAB_PAGE_SIZE;
+	slab.base = memalign(SLAB_PAGE_SIZE, size);
+	slab.page = calloc(slab.pages, sizeof(struct slab_page));
+	if (!slab.base || !slab.page) {
+		free(slab.base);
+		free(slab.page);
+		slab.base = NULL;
+		slab.failed = true;
+		debug("%s: Cannot allocate %#lx bytes\n", __func__, size);
+		return -ENOMEM;
+	}
+	slab.end = slab.base + slab.pages * SLAB_PAGE_SIZE;
+
+	INIT_LIST_HEAD(&slab.free_pages);
+	for (i = 0; i < slab.pages; i++) {
+		slab.page[i].cls = -1;
+		list_add_tail(&slab.page[i].node, &slab.free_pages);
+	}
+	for (i = 0; i < SLAB_CLASS_COUNT; i++) {
+		INIT_LIST_HEAD(&slab.cls[i].partial);
+		slab.cls[i].stats.size = SLAB_MIN_SIZE << i;
+	}
+
+	return 0;
+}
+
+static inline char *slab_page_addr(struct slab_page *page)
+{
+	return slab.base + (page - slab.page) * SLAB_PAGE_SIZE;
+}
+
+/* Give a free page to size class @cls and build its list of objects */
+static struct slab_page *slab_new_page(int cls)
+{
+	uint size = SLAB_MIN_SIZE << cls;
+	struct slab_page *page;
+	char *obj, *end;
+	void **link;
+
+	if (list_empty(&slab.free_pages))
+		return NULL;
+	page = list_first_entry(&slab.free_pages, struct slab_page, node);
+	list_move(&page->node, &slab.cls[cls].partial);
+	page->cls = cls;
+	page->used = 0;
+
+	obj = slab_page_addr(page);
+	end = obj + SLAB_PAGE_SIZE;
+	link = &page->free;
+	for (; obj + size <= end; obj += size) {
+		*link = obj;
+		link = (void **)obj;
+	}
+	*link = NULL;
+
+	slab.cls[cls].stats.pages++;
+	if (++slab.pages_used > slab.pages_peak)
+		slab.pages_peak = slab.pages_used;
+
+	return page;
+}
+
+void *slab_zalloc(size_t size)
+{
+	struct slab_class *sc;
+	struct slab_page *page;
+	void *ptr;
+	int cls;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) || size > SLAB_MAX_SIZE)
+		goto fallback;
+	if (!slab.base && (slab.failed || slab_init()))
+		goto fallback;
+
+	cls = size <= SLAB_MIN_SIZE ? 0 : fls(size - 1) - 4;
+	sc = &slab.cls[cls];
+	if (list_empty(&sc->partial)) {
+		page = slab_new_page(cls);
+		if (!page)
+			goto fallback;
+	} else {
+		page = list_first_entry(&sc->partial, struct slab_page, node);
+	}
+
+	ptr = page->free;
+	page->free = *(void **)ptr;
+	page->used++;
+	if (!page->free)
+		list_del_init(&page->node);
+	if (++sc->stats.used > sc->stats.peak)
+		sc->stats.peak = sc->stats.used;
+	memset(ptr, '\0', sc->stats.size);
+
+	return ptr;
+
+fallback:
+	if (gd->flags & GD_FLG_FULL_MALLOC_INIT)
+		slab.fallbacks++;
+	return calloc(1, size);
+}
+
+void slab_free(void *ptr)
+{
+	struct slab_class *sc;
+	struct slab_page *page;
+
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) || (char *)ptr < slab.base ||
+	    (char *)ptr >= slab.end) {
+		free(ptr);
+		return;
+	}
+
+	page = &slab.page[((char *)ptr - slab.base) / SLAB_PAGE_SIZE];
+	sc = &slab.cls[page->cls];
+	if (!page->free)
+		list_add(&page->node, &sc->partial);
+	*(void **)ptr = page->free;
+	page->free = ptr;
+	sc->stats.used--;
+
+	if (!--page->used) {
+		list_move(&page->node, &slab.free_pages);
+		page->cls = -1;
+		sc->stats.pages--;
+		slab.pages_used--;
+	}
+}
+
+void slab_get_stats(struct slab_stats *stats)
+{
+	int i;
+
+	memset(stats, '\0', sizeof(*stats));
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) || !slab.base)
+		return;
+	stats->arena_size = slab.end - slab.base;
+	stats->pages = slab.pages;
+	stats->pages_used = slab.pages_used;
+	stats->pages_peak = slab.pages_peak;
+	stats->fallbacks = slab.fallbacks;
+	for (i = 0; i < SLAB_CLASS_COUNT; i++) {
+		stats->cls[i] = slab.cls[i].stats;
+		stats->inuse += slab.cls[i].stats.used * slab.cls[i].stats.size;
+	}
+}
@@ -0,0 +1,177 @@
+/*
+ * Heap usage by call site
+ *
+ * Each allocation is charged to the address it returns to. The call sites
+ * are kept in a small fixed table. Nothing is recorded before relocation,
+ * since the tables may be in read-only memory then; only the total used in
+ * the pre-relocation pool is reported for that part of the boot. Once the
+ * full pool is ready, each allocation from it is also recorded in a table
+ * of live allocations, so that free() can give the memory back to the site
+ * which allocated it.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <malloc_trace.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define TRACE_SITES	CONFIG_MALLOC_TRACE_SITES
+#define TRACE_LIVE	CONFIG_MALLOC_TRACE_LIVE
+
+/**
+ * struct trace_live - a live allocation from the full pool
+ *
+ * @ptr:	Memory allocated, or NULL if the entry is empty
+ * @size:	Number of bytes requested
+ * @site:	Index of the call site in trace_site[]
+ */
+struct trace_live {
+	void *ptr;
+	u32 size;
+	u16 site;
+};
+
+/* The last two entries collect the callers which do not fit in the table */
+static struct malloc_trace_site trace_site[TRACE_SITES + 2];
+
+static struct trace_live trace_live[TRACE_LIVE];
+static uint trace_live_count;
+static struct malloc_trace_stats trace_stats;
+
+static struct malloc_trace_site *trace_find_site(ulong caller, bool early)
+{
+	struct malloc_trace_site *site;
+	uint i, n;
+
+	i = (caller >> 2) % TRACE_SITES;
+	for (n = 0; n < TRACE_SITES; n++, i = (i + 1) % TRACE_SITES) {
+		site = &trace_site[i];
+		if (!site->count) {
+			site->caller = caller;
+			site->early = early;
+			return site;
+		}
+		if (site->caller == caller && site->early == early)
+			return site;
+	}
+	site = &trace_site[TRACE_SITES + early];
+	site->early = early;
+
+	return site;
+}
+
+static uint trace_live_hash(void *ptr)
+{
+	ulong val = (ulong)ptr;
+
+	return ((val >> 4) ^ (val >> 14)) % TRACE_LIVE;
+}
+
+static struct trace_live *trace_live_find(void *ptr)
+{
+	uint i;
+
+	for (i = trace_live_hash(ptr); trace_live[i].ptr;
+	     i = (i + 1) % TRACE_LIVE) {
+		if (trace_live[i].ptr == ptr)
+			return &trace_live[i];
+	}
+
+	return NULL;
+}
+
+/* Remove an entry, moving up any later ones which would no longer be found */
+static void trace_live_remove(struct trace_live *entry)
+{
+	uint i = entry - trace_live;
+	uint j = i;
+	uint k;
+
+	for (;;) {
+		j = (j + 1) % TRACE_LIVE;
+		if (!trace_live[j].ptr)
+			break;
+		k = trace_live_hash(trace_live[j].ptr);
+		if (i <= j ? i < k && k <= j : i < k || k <= j)
+			continue;
+		trace_live[i] = trace_live[j];
+		i = j;
+	}
+	trace_live[i].ptr = NULL;
+	trace_live_count--;
+}
+
+static void trace_release(struct trace_live *entry)
+{
+	trace_site[entry->site].live -= entry->size;
+	trace_stats.live -= entry->size;
+	trace_live_remove(entry);
+}
+
+void malloc_trace_alloc(void *ptr, size_t size, void *caller)
+{
+	struct malloc_trace_site *site;
+	struct trace_live *entry;
+	ulong addr = (ulong)caller;
+	bool early;
+	uint i;
+
+	if (!ptr || !(gd->flags & GD_FLG_RELOC))
+		return;
+	early = !(gd->flags & GD_FLG_FULL_MALLOC_INIT);
+	addr -= gd->reloc_off;
+	site = trace_find_site(addr, early);
+	site->count++;
+
+	if (!early) {
+		/* Memory freed without going through free() may be reused */
+		entry = trace_live_find(ptr);
+		if (entry)
+			trace_release(entry);
+		/* Keep one entry empty so that searches end */
+		if (trace_live_count == TRACE_LIVE - 1) {
+			trace_stats.untracked++;
+			return;
+		}
+		for (i = trace_live_hash(ptr); trace_live[i].ptr;
+		     i = (i + 1) % TRACE_LIVE)
+			;
+		trace_live[i].ptr = ptr;
+		trace_live[i].size = size;
+		trace_live[i].site = site - trace_site;
+		trace_live_count++;
+
+		trace_stats.live += size;
+		if (trace_stats.live > trace_stats.peak)
+			trace_stats.peak = trace_stats.live;
+	}
+	site->live += size;
+	if (site->live > site->peak)
+		site->peak = site->live;
+}
+
+void malloc_trace_free(void *ptr)
+{
+	struct trace_live *entry;
+
+	if (!ptr || !(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return;
+	entry = trace_live_find(ptr);
+	if (entry)
+		trace_release(entry);
+}
+
+int malloc_trace_get_stats(struct malloc_trace_stats *stats,
+			   const struct malloc_trace_site **sitesp)
+{
+	*stats = trace_stats;
+#ifdef CONFIG_SYS_MALLOC_F_LEN
+	stats->early_peak = gd->malloc_ptr;
+#endif
+	*sitesp = trace_site;
+
+	return ARRAY_SIZE(trace_site);
+}
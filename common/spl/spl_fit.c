@@ -10,6 +10,16 @@
 #include <image.h>
 #include <libfdt.h>
 #include <spl.h>
+#include <zstd.h>
+#include <linux/sizes.h>
+
+/* Amount of data read at a time when hashing images as they are loaded */
+#define SPL_FIT_HASH_CHUNK	SZ_64K
+
+#ifndef CONFIG_SYS_BOOTM_LEN
+/* use 8MByte as default max uncompressed image size, as bootm does */
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
 
 static ulong fdt_getprop_u32(const void *fdt, int node, const char *prop)
 {
@@ -22,7 +32,8 @@ static ulong fdt_getprop_u32(const void *fdt, int node, const char *prop)
 	return fdt32_to_cpu(*cell);
 }
 
-static int spl_fit_select_fdt(const void *fdt, int images, int *fdt_offsetp)
+static int spl_fit_select_fdt(const void *fdt, int images, int *fdt_offsetp,
+			      int *fdt_nodep)
 {
 	const char *name, *fdt_name;
 	int conf, node, fdt_node;
@@ -65,6 +76,7 @@ static int spl_fit_select_fdt(const void *fdt, int images, int *fdt_offsetp)
 			return -EINVAL;
 		}
 
+		*fdt_nodep = fdt_node;
 		*fdt_offsetp = fdt_getprop_u32(fdt, fdt_node, "data-offset");
 		len = fdt_getprop_u32(fdt, fdt_node, "data-size");
 		debug("FIT: Selected '%s'\n", name);
@@ -123,6 +135,55 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return (data_size + info->bl_len - 1) / info->bl_len;
 }
 
+/*
+ * Read an image from the FIT into @dst. The image data starts @overhead
+ * bytes into the buffer, since only whole blocks can be read. When hashes
+ * are verified, the image is read a chunk at a time and each chunk is
+ * hashed while it is still in the cache, instead of in a second pass over
+ * the whole image.
+ */
+static int spl_fit_read_image(struct spl_load_info *info, int src_sector,
+			      int sectors, void *dst, const void *fit,
+			      int node, int overhead, int size)
+{
+#ifdef CONFIG_SPL_FIT_HASH_VERIFY
+	int unit = info->filename ? 1 : info->bl_len;
+	int chunk = max(SPL_FIT_HASH_CHUNK / unit, 1);
+	struct fit_hash_stream hs;
+	int done, n, start, end;
+	unsigned long count;
+
+	fit_image_hash_start(&hs, fit, node);
+	for (done = 0; done < sectors; done += n) {
+		n = min(chunk, sectors - done);
+		count = info->read(info, src_sector + done, n,
+				   dst + done * unit);
+		if (count != n)
+			goto err;
+		start = max(done * unit, overhead);
+		end = min((done + n) * unit, overhead + size);
+		if (end > start)
+			fit_image_hash_update(&hs, dst + start, end - start);
+	}
+	if (!fit_image_hash_finish(&hs, dst + overhead, size))
+		return -EPERM;
+
+	return 0;
+
+err:
+	fit_image_hash_abort(&hs);
+	return -EIO;
+#else
+	unsigned long count;
+
+	count = info->read(info, src_sector, sectors, dst);
+	if (count != sectors)
+		return -EIO;
+#endif
+
+	return 0;
+}
+
 int spl_load_simple_fit(struct spl_image_info *spl_image,
 			struct spl_load_info *info, ulong sector, void *fit)
 {
@@ -131,11 +192,13 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	unsigned long count;
 	int node, images;
 	void *load_ptr;
-	int fdt_offset, fdt_len;
+	int fdt_offset, fdt_len, fdt_node;
+	int ret;
 	int data_offset, data_size;
 	int base_offset, align_len = ARCH_DMA_MINALIGN - 1;
 	int src_sector;
 	void *dst, *src;
+	bool compressed = false;
 
 	/*
 	 * Figure out where the external images start. This is the base for the
@@ -188,6 +251,10 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	spl_image->load_addr = load;
 	spl_image->entry_point = load;
 	spl_image->os = IH_OS_U_BOOT;
+#ifdef CONFIG_SPL_ZSTD
+	src = (void *)fdt_getprop(fit, node, FIT_COMP_PROP, NULL);
+	compressed = src && genimg_get_comp_id(src) == IH_COMP_ZSTD;
+#endif
 
 	/*
 	 * Work out where to place the image. We read it so that the first
@@ -200,13 +267,24 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	debug("U-Boot size %x, data %p\n", data_size, load_ptr);
 	dst = load_ptr;
 
+	/*
+	 * A compressed image is read to just below the FIT and decompressed
+	 * from there to the load address
+	 */
+	if (compressed) {
+		size = sectors * (info->filename ? 1 : info->bl_len);
+		dst = (void *)(((ulong)fit - size) & ~align_len);
+	}
+
 	/* Read the image */
 	src_sector = sector + get_aligned_image_offset(info, data_offset);
 	debug("Aligned image read: dst=%p, src_sector=%x, sectors=%x\n",
 	      dst, src_sector, sectors);
-	count = info->read(info, src_sector, sectors, dst);
-	if (count != sectors)
-		return -EIO;
+	ret = spl_fit_read_image(info, src_sector, sectors, dst, fit, node,
+				 get_aligned_image_overhead(info, data_offset),
+				 data_size);
+	if (ret)
+		return ret;
 	debug("image: dst=%p, data_offset=%x, size=%x\n", dst, data_offset,
 	      data_size);
 	src = dst + get_aligned_image_overhead(info, data_offset);
@@ -215,10 +293,23 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	board_fit_image_post_process((void **)&src, (size_t *)&data_size);
 #endif
 
-	memcpy(dst, src, data_size);
+#ifdef CONFIG_SPL_ZSTD
+	if (compressed) {
+		size_t unc_len = CONFIG_SYS_BOOTM_LEN;
+
+		ret = zstd_decompress(src, data_size, load_ptr, &unc_len);
+		if (ret) {
+			debug("%s: zstd error %d\n", __func__, ret);
+			return ret;
+		}
+		data_size = unc_len;
+	}
+#endif
+	if (!compressed)
+		memcpy(dst, src, data_size);
 
 	/* Figure out which device tree the board wants to use */
-	fdt_len = spl_fit_select_fdt(fit, images, &fdt_offset);
+	fdt_len = spl_fit_select_fdt(fit, images, &fdt_offset, &fdt_node);
 	if (fdt_len < 0)
 		return fdt_len;
 
@@ -231,11 +322,13 @@ int spl_load_simple_fit(struct spl_image_info *spl_image,
 	fdt_offset += base_offset;
 	sectors = get_aligned_image_size(info, fdt_len, fdt_offset);
 	src_sector = sector + get_aligned_image_offset(info, fdt_offset);
-	count = info->read(info, src_sector, sectors, dst);
+	ret = spl_fit_read_image(info, src_sector, sectors, dst, fit, fdt_node,
+				 get_aligned_image_overhead(info, fdt_offset),
+				 fdt_len);
 	debug("Aligned fdt read: dst %p, src_sector = %x, sectors %x\n",
 	      dst, src_sector, sectors);
-	if (count != sectors)
-		return -EIO;
+	if (ret)
+		return ret;
 
 	/*
 	 * Copy the device tree so that it starts immediately after the image.
@@ -308,12 +308,16 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 int blk_select_hwpart(struct udevice *dev, int hwpart)
 {
 	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
 
 	if (!ops)
 		return -ENOSYS;
 	if (!ops->select_hwpart)
 		return 0;
 
+	/* MMC reselects the current partition before every read */
+	if (desc->hwpart != hwpart)
+		blk_readahead_invalidate(dev);
 	return ops->select_hwpart(dev, hwpart);
 }
 
@@ -399,7 +403,11 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+#ifdef CONFIG_BLOCK_READAHEAD
+	blks_read = blk_readahead_read(dev, start, blkcnt, buffer);
+#else
 	blks_read = ops->read(dev, start, blkcnt, buffer);
+#endif
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
 			      start, blkcnt, block_dev->blksz, buffer);
@@ -407,6 +415,13 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	return blks_read;
 }
 
+void blk_mark_changed(struct blk_desc *block_dev)
+{
+	static ulong seq;
+
+	block_dev->change_seq = ++seq;
+}
+
 unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			 lbaint_t blkcnt, const void *buffer)
 {
@@ -417,6 +432,8 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_readahead_invalidate(dev);
+	blk_mark_changed(block_dev);
 	return ops->write(dev, start, blkcnt, buffer);
 }
 
@@ -430,6 +447,8 @@ unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_readahead_invalidate(dev);
+	blk_mark_changed(block_dev);
 	return ops->erase(dev, start, blkcnt);
 }
 
@@ -489,6 +508,7 @@ int blk_create_device(struct udevice *parent, const char *drv_name,
 	desc->part_type = PART_TYPE_UNKNOWN;
 	desc->bdev = dev;
 	desc->devnum = devnum;
+	blk_mark_changed(desc);
 	*devp = dev;
 
 	return 0;
@@ -542,8 +562,34 @@ int blk_unbind_all(int if_type)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+
+	blk_async_cancel(dev);
+	blk_readahead_release(dev);
+	blkcache_invalidate(desc->if_type, desc->devnum);
+
+	return 0;
+}
+
+static int blk_pre_unbind(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+
+	/* Another device may be given the same number later */
+	blkcache_invalidate(desc->if_type, desc->devnum);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
+	.pre_unbind	= blk_pre_unbind,
+	.pre_remove	= blk_pre_remove,
+#ifdef CONFIG_BLOCK_READAHEAD
+	.per_device_auto_alloc_size = sizeof(struct blk_readahead),
+#endif
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
@@ -0,0 +1,176 @@
+/*
+ * Asynchronous block device requests
+ *
+ * A request is submitted with blk_submit() and completes later, calling its
+ * callback from blk_poll(). This lets the caller overlap a transfer with
+ * other work such as hashing or decompressing data which has already
+ * arrived. Drivers which can run transfers in the background provide
+ * submit() and poll() methods. For all other drivers the request is queued
+ * here and carried out by blk_poll() a chunk at a time using the driver's
+ * synchronous methods.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+
+/* Number of blocks transferred by each blk_poll() in the fallback path */
+#define BLK_ASYNC_CHUNK		128
+
+/* Requests for devices whose driver has no submit() method */
+static LIST_HEAD(blk_async_queue);
+
+int blk_submit(struct blk_request *req)
+{
+	struct udevice *dev = req->dev;
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	int ret;
+
+	switch (req->op) {
+	case BLK_REQ_READ:
+		if (!ops->read)
+			return -ENOSYS;
+		break;
+	case BLK_REQ_WRITE:
+		if (!ops->write)
+			return -ENOSYS;
+		blkcache_invalidate(desc->if_type, desc->devnum);
+		blk_readahead_invalidate(dev);
+		blk_mark_changed(desc);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	req->done = 0;
+	req->result = 0;
+	req->complete = false;
+	if (ops->submit) {
+		ret = ops->submit(dev, req);
+		if (ret)
+			return ret;
+	} else {
+		list_add_tail(&req->sibling, &blk_async_queue);
+	}
+
+	return 0;
+}
+
+void blk_request_complete(struct blk_request *req, long result)
+{
+	req->result = result;
+	req->complete = true;
+	if (req->callback)
+		req->callback(req);
+}
+
+/* Carry out the next chunk of the first queued request for a device */
+static int blk_async_step(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_request *req;
+	lbaint_t cnt;
+	char *buf;
+	ulong ret;
+
+	list_for_each_entry(req, &blk_async_queue, sibling) {
+		if (req->dev == dev)
+			break;
+	}
+	if (&req->sibling == &blk_async_queue)
+		return 0;
+
+	cnt = min(req->blkcnt - req->done, (lbaint_t)BLK_ASYNC_CHUNK);
+	buf = (char *)req->buffer + req->done * desc->blksz;
+	if (req->op == BLK_REQ_READ)
+		ret = ops->read(dev, req->start + req->done, cnt, buf);
+	else
+		ret = ops->write(dev, req->start + req->done, cnt, buf);
+
+	if (IS_ERR_VALUE(ret)) {
+		list_del(&req->sibling);
+		blk_request_complete(req, req->done ? req->done : (long)ret);
+		return 1;
+	}
+	req->done += ret;
+	if (ret < cnt || req->done == req->blkcnt) {
+		list_del(&req->sibling);
+		blk_request_complete(req, req->done);
+	}
+
+	return 1;
+}
+
+static int blk_poll_dev(struct udevice *dev)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	struct blk_request *req;
+	int count = 0;
+
+	if (ops->poll)
+		return ops->poll(dev);
+
+	blk_async_step(dev);
+	list_for_each_entry(req, &blk_async_queue, sibling) {
+		if (req->dev == dev)
+			count++;
+	}
+
+	return count;
+}
+
+int blk_poll(struct udevice *dev)
+{
+	struct uclass *uc;
+	int count = 0;
+	int ret;
+
+	if (dev)
+		return blk_poll_dev(dev);
+
+	ret = uclass_get(UCLASS_BLK, &uc);
+	if (ret)
+		return ret;
+	uclass_foreach_dev(dev, uc) {
+		if (!device_active(dev))
+			continue;
+		ret = blk_poll_dev(dev);
+		if (ret < 0)
+			return ret;
+		count += ret;
+	}
+
+	return count;
+}
+
+long blk_wait(struct blk_request *req)
+{
+	int ret;
+
+	while (!req->complete) {
+		ret = blk_poll(req->dev);
+		if (ret < 0)
+			return ret;
+		if (!ret && !req->complete)
+			return -EIO;
+	}
+
+	return req->result;
+}
+
+void blk_async_cancel(struct udevice *dev)
+{
+	struct blk_request *req, *n;
+
+	list_for_each_entry_safe(req, n, &blk_async_queue, sibling) {
+		if (req->dev == dev) {
+			list_del(&req->sibling);
+			blk_request_complete(req, req->done ? req->done :
+					     -ENODEV);
+		}
+	}
+}
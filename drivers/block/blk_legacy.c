@@ -8,6 +8,13 @@
 #include <common.h>
 #include <linux/err.h>
 
+void blk_mark_changed(struct blk_desc *block_dev)
+{
+	static ulong seq;
+
+	block_dev->change_seq = ++seq;
+}
+
 struct blk_driver *blk_driver_lookup_type(int if_type)
 {
 	struct blk_driver *drv = ll_entry_start(struct blk_driver, blk_driver);
@@ -243,7 +250,7 @@ ulong blk_write_devnum(enum if_type if_type, int devnum, lbaint_t start,
 	ret = get_desc(drv, devnum, &desc);
 	if (ret)
 		return ret;
-	return desc->block_write(desc, start, blkcnt, buffer);
+	return blk_dwrite(desc, start, blkcnt, buffer);
 }
 
 int blk_select_hwpart_devnum(enum if_type if_type, int devnum, int hwpart)
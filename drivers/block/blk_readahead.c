@@ -0,0 +1,172 @@
+/*
+ * Adaptive read-ahead for block devices
+ *
+ * Filesystems tend to read files a cluster or block at a time, so loading a
+ * large file results in thousands of small commands to the device. On SD
+ * cards and USB mass storage the per-command overhead dominates. This
+ * detects sequential streams on each block device and services them from a
+ * staging window filled by a single large read. The window starts small and
+ * doubles on each refill, up to a configurable limit.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+
+/* Smallest read-ahead window, in blocks */
+#define BLK_READAHEAD_MIN	8
+
+static ulong readahead_size = CONFIG_BLOCK_READAHEAD_SIZE * 1024;
+
+static ulong blk_readahead_direct(struct udevice *dev,
+				  struct blk_readahead *ra, lbaint_t start,
+				  lbaint_t blkcnt, void *buffer)
+{
+	ulong ret;
+
+	ra->stats.cmds++;
+	ret = blk_get_ops(dev)->read(dev, start, blkcnt, buffer);
+	if (!IS_ERR_VALUE(ret))
+		ra->stats.blocks += ret;
+
+	return ret;
+}
+
+/* Fill the staging window starting at @start, returning blocks read */
+static ulong blk_readahead_fill(struct udevice *dev, struct blk_readahead *ra,
+				lbaint_t start, lbaint_t blkcnt)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	lbaint_t count = ra->window;
+	ulong bytes = readahead_size;
+	ulong ret;
+
+	if (ra->buf_size != bytes) {
+		free(ra->buf);
+		ra->buf_size = 0;
+		ra->buf = memalign(ARCH_DMA_MINALIGN, bytes);
+		if (!ra->buf)
+			return 0;
+		ra->buf_size = bytes;
+	}
+
+	/* don't read beyond the end of the device */
+	if (desc->lba && start + count > desc->lba)
+		count = max(desc->lba - start, blkcnt);
+
+	ret = blk_readahead_direct(dev, ra, start, count, ra->buf);
+	if (IS_ERR_VALUE(ret))
+		return 0;
+	ra->buf_start = start;
+	ra->buf_cnt = ret;
+
+	return ret;
+}
+
+ulong blk_readahead_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+			 void *buffer)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+	lbaint_t max_blocks = readahead_size / desc->blksz;
+	lbaint_t done = 0;
+	char *dst = buffer;
+	ulong ret;
+
+	if (!ra || max_blocks < BLK_READAHEAD_MIN)
+		return blk_get_ops(dev)->read(dev, start, blkcnt, buffer);
+
+	ra->stats.reads++;
+
+	/* serve the front of the request from the staging window */
+	if (start >= ra->buf_start && start < ra->buf_start + ra->buf_cnt) {
+		done = min(blkcnt, ra->buf_start + ra->buf_cnt - start);
+		memcpy(dst, ra->buf + (start - ra->buf_start) * desc->blksz,
+		       done * desc->blksz);
+		ra->next = start + done;
+		if (done == blkcnt) {
+			ra->stats.hits++;
+			return blkcnt;
+		}
+		start += done;
+		blkcnt -= done;
+		dst += done * desc->blksz;
+	}
+
+	/* a read at block 0 never continues a stream */
+	if (start && start == ra->next) {
+		if (ra->window)
+			ra->window = min(ra->window * 2, max_blocks);
+		else
+			ra->window = min(max(blkcnt * 2,
+					     (lbaint_t)BLK_READAHEAD_MIN),
+					 max_blocks);
+	} else {
+		ra->window = 0;
+	}
+	ra->next = start + blkcnt;
+	ra->stats.window = ra->window;
+
+	/* large and random reads go straight to the device */
+	if (blkcnt < ra->window &&
+	    blk_readahead_fill(dev, ra, start, blkcnt) >= blkcnt) {
+		memcpy(dst, ra->buf, blkcnt * desc->blksz);
+		return done + blkcnt;
+	}
+
+	ret = blk_readahead_direct(dev, ra, start, blkcnt, dst);
+	if (IS_ERR_VALUE(ret))
+		return done ? done : ret;
+
+	return done + ret;
+}
+
+void blk_readahead_invalidate(struct udevice *dev)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	if (!ra)
+		return;
+	ra->next = 0;
+	ra->window = 0;
+	ra->buf_cnt = 0;
+}
+
+void blk_readahead_release(struct udevice *dev)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	if (!ra)
+		return;
+	blk_readahead_invalidate(dev);
+	free(ra->buf);
+	ra->buf = NULL;
+	ra->buf_size = 0;
+}
+
+void blk_readahead_configure(ulong bytes)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+
+	readahead_size = bytes;
+	if (uclass_get(UCLASS_BLK, &uc))
+		return;
+	uclass_foreach_dev(dev, uc)
+		blk_readahead_release(dev);
+}
+
+int blk_readahead_get_stats(struct udevice *dev,
+			    struct blk_readahead_stats *stats)
+{
+	struct blk_readahead *ra = dev_get_uclass_priv(dev);
+
+	if (!ra)
+		return -ENODEV;
+	*stats = ra->stats;
+
+	return 0;
+}
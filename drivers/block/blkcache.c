@@ -12,8 +12,18 @@
 #include <linux/ctype.h>
 #include <linux/list.h>
 
+/*
+ * Cached ranges never straddle a 'line' of 2^line_shift blocks, where the
+ * line is the smallest power of two holding max_blocks_per_entry blocks.
+ * This lets a lookup go straight to the one hash bucket that can hold the
+ * range, rather than walking every entry in the cache.
+ */
+#define BLKCACHE_HASH_BITS	8
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+
 struct block_cache_node {
-	struct list_head lh;
+	struct list_head lh;		/* LRU list, most recently used first */
+	struct hlist_node hash;		/* hash bucket chain */
 	int iftype;
 	int devnum;
 	lbaint_t start;
@@ -23,22 +33,60 @@ struct block_cache_node {
 };
 
 static LIST_HEAD(block_cache);
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
+static unsigned int line_shift = 4;
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 2,
-	.max_entries = 32
+	.max_blocks_per_entry = 16,
+	.max_entries = 256,
+	.max_bytes = CONFIG_BLOCK_CACHE_SIZE * 1024,
 };
 
+static inline lbaint_t cache_line(lbaint_t start)
+{
+	return start >> line_shift;
+}
+
+static struct hlist_head *cache_bucket(int iftype, int devnum, lbaint_t line)
+{
+	u32 key;
+
+	key = (u32)line ^ (u32)((u64)line >> 32);
+	key ^= ((u32)iftype << 24) ^ ((u32)devnum << 16);
+
+	/* Fibonacci hashing, as used by hash_32() in Linux */
+	return &block_cache_hash[(key * 0x9e370001U) >>
+				 (32 - BLKCACHE_HASH_BITS)];
+}
+
+static inline bool cache_match(struct block_cache_node *node, int iftype,
+			       int devnum, unsigned long blksz, lbaint_t line)
+{
+	return node->iftype == iftype && node->devnum == devnum &&
+	       node->blksz == blksz && cache_line(node->start) == line;
+}
+
+static void cache_drop(struct block_cache_node *node)
+{
+	list_del(&node->lh);
+	hlist_del(&node->hash);
+	_stats.entries--;
+	_stats.bytes -= node->blkcnt * node->blksz;
+	free(node->cache);
+	free(node);
+}
+
 static struct block_cache_node *cache_find(int iftype, int devnum,
 					   lbaint_t start, lbaint_t blkcnt,
 					   unsigned long blksz)
 {
 	struct block_cache_node *node;
+	struct hlist_node *pos;
+	lbaint_t line = cache_line(start);
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
+	hlist_for_each_entry(node, pos, cache_bucket(iftype, devnum, line),
+			     hash)
+		if (cache_match(node, iftype, devnum, blksz, line) &&
 		    (node->start <= start) &&
 		    (node->start + node->blkcnt >= start + blkcnt)) {
 			if (block_cache.next != &node->lh) {
@@ -55,62 +103,98 @@ int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	struct block_cache_node *node;
+	char *dst = buffer;
+	lbaint_t pos, end = start + blkcnt;
+	lbaint_t cnt;
+
+	/* serve the request one line at a time */
+	for (pos = start; pos < end; pos += cnt) {
+		cnt = min(end, (cache_line(pos) + 1) << line_shift) - pos;
+		node = cache_find(iftype, devnum, pos, cnt, blksz);
+		if (!node) {
+			debug("miss: start " LBAF ", count " LBAFU "\n",
+			      start, blkcnt);
+			++_stats.misses;
+			return 0;
+		}
+		memcpy(dst, node->cache + (pos - node->start) * blksz,
+		       cnt * blksz);
+		dst += cnt * blksz;
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
+	debug("hit: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	++_stats.hits;
+	return 1;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+/* Add a range which lies within a single line, merging with neighbours */
+static void cache_insert(int iftype, int devnum, lbaint_t start,
+			 lbaint_t blkcnt, unsigned long blksz,
+			 const char *buffer)
 {
-	lbaint_t bytes;
 	struct block_cache_node *node;
+	struct hlist_node *pos, *n;
+	struct hlist_head *bucket;
+	lbaint_t line = cache_line(start);
+	lbaint_t first = start, last = start + blkcnt;
+	unsigned long bytes;
+	char *cache;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	/* find the extent of all entries touching or overlapping this one */
+	bucket = cache_bucket(iftype, devnum, line);
+	hlist_for_each_entry(node, pos, bucket, hash) {
+		if (!cache_match(node, iftype, devnum, blksz, line) ||
+		    node->start > last || node->start + node->blkcnt < first)
+			continue;
+		first = min(first, node->start);
+		last = max(last, node->start + node->blkcnt);
+	}
 
-	if (_stats.max_entries == 0)
+	/* don't let merging build an entry bigger than we would cache */
+	if (last - first > _stats.max_blocks_per_entry) {
+		first = start;
+		last = start + blkcnt;
+	}
+
+	bytes = (last - first) * blksz;
+	if (bytes > _stats.max_bytes)
 		return;
+	cache = malloc(bytes);
+	if (!cache)
+		return;
+
+	/* gather the old data and drop the entries being merged */
+	hlist_for_each_entry_safe(node, pos, n, bucket, hash) {
+		if (!cache_match(node, iftype, devnum, blksz, line) ||
+		    node->start < first ||
+		    node->start + node->blkcnt > last)
+			continue;
+		memcpy(cache + (node->start - first) * blksz, node->cache,
+		       node->blkcnt * blksz);
+		debug("merge: start " LBAF ", count " LBAFU "\n",
+		      node->start, node->blkcnt);
+		cache_drop(node);
+	}
+	memcpy(cache + (start - first) * blksz, buffer, blkcnt * blksz);
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
+	/* pop LRU entries until there is room */
+	while (!list_empty(&block_cache) &&
+	       (_stats.entries >= _stats.max_entries ||
+		_stats.bytes + bytes > _stats.max_bytes)) {
+		node = list_entry(block_cache.prev, struct block_cache_node,
+				  lh);
 		debug("drop: start " LBAF ", count " LBAFU "\n",
 		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
+		cache_drop(node);
+		_stats.evictions++;
 	}
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
+	node = malloc(sizeof(*node));
+	if (!node) {
+		free(cache);
+		return;
 	}
 
 	debug("fill: start " LBAF ", count " LBAFU "\n",
@@ -118,51 +202,73 @@ void blkcache_fill(int iftype, int devnum,
 
 	node->iftype = iftype;
 	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
+	node->start = first;
+	node->blkcnt = last - first;
 	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
+	node->cache = cache;
 	list_add(&node->lh, &block_cache);
+	hlist_add_head(&node->hash, bucket);
 	_stats.entries++;
+	_stats.bytes += bytes;
+}
+
+void blkcache_fill(int iftype, int devnum,
+		   lbaint_t start, lbaint_t blkcnt,
+		   unsigned long blksz, void const *buffer)
+{
+	const char *src = buffer;
+	lbaint_t pos, end = start + blkcnt;
+	lbaint_t cnt;
+
+	/* don't cache big stuff */
+	if (blkcnt > _stats.max_blocks_per_entry)
+		return;
+
+	if (_stats.max_entries == 0)
+		return;
+
+	for (pos = start; pos < end; pos += cnt) {
+		cnt = min(end, (cache_line(pos) + 1) << line_shift) - pos;
+		cache_insert(iftype, devnum, pos, cnt, blksz, src);
+		src += cnt * blksz;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
 		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
+		    (node->devnum == devnum))
+			cache_drop(node);
 	}
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_configure(unsigned blocks, unsigned entries,
+			unsigned long bytes)
 {
 	struct block_cache_node *node;
+
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries)) {
+	    (entries != _stats.max_entries) ||
+	    (bytes != _stats.max_bytes)) {
 		/* invalidate cache */
 		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
+			node = list_first_entry(&block_cache,
+						struct block_cache_node, lh);
+			cache_drop(node);
 		}
-		_stats.entries = 0;
 	}
 
 	_stats.max_blocks_per_entry = blocks;
 	_stats.max_entries = entries;
+	_stats.max_bytes = bytes;
+	line_shift = blocks > 1 ? fls(blocks - 1) : 0;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -170,4 +276,5 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
 }
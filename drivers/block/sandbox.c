@@ -180,6 +180,7 @@ int host_dev_bind(int dev, char *filename)
 	struct blk_desc *blk_dev = &host_dev->blk_dev;
 	blk_dev->if_type = IF_TYPE_HOST;
 	blk_dev->priv = host_dev;
+	blk_mark_changed(blk_dev);
 	blk_dev->blksz = 512;
 	blk_dev->lba = os_lseek(host_dev->fd, 0, OS_SEEK_END) / blk_dev->blksz;
 	blk_dev->block_read = host_block_read;
@@ -218,15 +219,86 @@ int host_get_dev_err(int devnum, struct blk_desc **blk_devp)
 }
 
 #ifdef CONFIG_BLK
+#ifdef CONFIG_BLK_ASYNC
+static int host_block_submit(struct udevice *dev, struct blk_request *req)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+
+	list_add_tail(&req->sibling, &host_dev->queue);
+
+	return 0;
+}
+
+/* Complete one request per call, as a controller would */
+static int host_block_poll(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+	struct blk_request *req;
+	int count = 0;
+	ulong ret;
+
+	if (list_empty(&host_dev->queue))
+		return 0;
+
+	req = list_first_entry(&host_dev->queue, struct blk_request, sibling);
+	list_del(&req->sibling);
+	if (req->op == BLK_REQ_READ)
+		ret = host_block_read(dev, req->start, req->blkcnt,
+				      req->buffer);
+	else
+		ret = host_block_write(dev, req->start, req->blkcnt,
+				       req->buffer);
+	if (IS_ERR_VALUE(ret))
+		blk_request_complete(req, -EIO);
+	else
+		blk_request_complete(req, ret);
+
+	list_for_each_entry(req, &host_dev->queue, sibling)
+		count++;
+
+	return count;
+}
+
+static int host_block_probe(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+
+	INIT_LIST_HEAD(&host_dev->queue);
+
+	return 0;
+}
+
+static int host_block_remove(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+	struct blk_request *req, *n;
+
+	list_for_each_entry_safe(req, n, &host_dev->queue, sibling) {
+		list_del(&req->sibling);
+		blk_request_complete(req, -ENODEV);
+	}
+
+	return 0;
+}
+#endif
+
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+#ifdef CONFIG_BLK_ASYNC
+	.submit	= host_block_submit,
+	.poll	= host_block_poll,
+#endif
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
 	.name		= "sandbox_host_blk",
 	.id		= UCLASS_BLK,
 	.ops		= &sandbox_host_blk_ops,
+#ifdef CONFIG_BLK_ASYNC
+	.probe		= host_block_probe,
+	.remove		= host_block_remove,
+#endif
 	.priv_auto_alloc_size	= sizeof(struct host_block_dev),
 };
 #else
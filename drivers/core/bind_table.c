@@ -0,0 +1,95 @@
+/*
+ * Binding devices from a table generated when U-Boot is built
+ *
+ * dtoc records, for each node in the U-Boot device tree, everything that
+ * driver model reads from the tree to decide whether and how to bind a
+ * device: the compatible strings, the status and pre-relocation flags,
+ * where the node is in the tree and which aliases give it a sequence
+ * number. With this, binding does not need to walk the device tree at all.
+ * Drivers still read their own properties from it.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <libfdt.h>
+#include <dm/bind_table.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static const struct dm_bind_table *bind_table;
+static const void *bind_blob;
+
+int dm_bind_table_init(const struct dm_bind_table *table)
+{
+	const void *blob = gd->fdt_blob;
+
+	bind_table = NULL;
+	bind_blob = NULL;
+	if (!table)
+		return -ENOENT;
+	if (!blob || fdt_check_header(blob) ||
+	    fdt_totalsize(blob) != table->fdt_size ||
+	    crc32(0, blob, table->fdt_size) != table->fdt_crc32) {
+		debug("%s: Device tree does not match the table\n", __func__);
+		return -EINVAL;
+	}
+	bind_table = table;
+	bind_blob = blob;
+
+	return 0;
+}
+
+const struct dm_bind_node *dm_bind_table_find(const void *blob, int offset)
+{
+	int low = 0, high;
+
+	if (!bind_table || blob != bind_blob)
+		return NULL;
+	high = bind_table->node_count;
+	while (low < high) {
+		int mid = (low + high) / 2;
+		const struct dm_bind_node *node = &bind_table->nodes[mid];
+
+		if (node->offset == offset)
+			return node;
+		if (node->offset < offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return NULL;
+}
+
+const struct dm_bind_node *dm_bind_table_node(int idx)
+{
+	return idx < 0 ? NULL : &bind_table->nodes[idx];
+}
+
+int dm_bind_table_alias_seq(const char *base, int offset, int *seqp)
+{
+	const struct dm_bind_alias *alias;
+	int base_len = strlen(base);
+	int low = 0, high = bind_table->alias_count;
+
+	/* Find the first alias for the node */
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (bind_table->aliases[mid].offset < offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	for (alias = &bind_table->aliases[low];
+	     alias < bind_table->aliases + bind_table->alias_count &&
+	     alias->offset == offset; alias++) {
+		if (!strncmp(alias->name, base, base_len)) {
+			*seqp = alias->seq;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
@@ -12,6 +12,7 @@
 #include <common.h>
 #include <errno.h>
 #include <malloc.h>
+#include <slab.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/uclass.h>
@@ -91,21 +92,23 @@ int device_unbind(struct udevice *dev)
 	if (ret)
 		return ret;
 
+	/* pre_unbind() may still need the platform data */
+	ret = uclass_unbind_device(dev);
+	if (ret)
+		return ret;
+
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
-		free(dev->platdata);
+		slab_free(dev->platdata);
 		dev->platdata = NULL;
 	}
 	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA) {
-		free(dev->uclass_platdata);
+		slab_free(dev->uclass_platdata);
 		dev->uclass_platdata = NULL;
 	}
 	if (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA) {
-		free(dev->parent_platdata);
+		slab_free(dev->parent_platdata);
 		dev->parent_platdata = NULL;
 	}
-	ret = uclass_unbind_device(dev);
-	if (ret)
-		return ret;
 
 	if (dev->parent)
 		list_del(&dev->sibling_node);
@@ -114,7 +117,7 @@ int device_unbind(struct udevice *dev)
 
 	if (dev->flags & DM_FLAG_NAME_ALLOCED)
 		free((char *)dev->name);
-	free(dev);
+	slab_free(dev);
 
 	return 0;
 }
@@ -128,12 +131,12 @@ void device_free(struct udevice *dev)
 	int size;
 
 	if (dev->driver->priv_auto_alloc_size) {
-		free(dev->priv);
+		slab_free(dev->priv);
 		dev->priv = NULL;
 	}
 	size = dev->uclass->uc_drv->per_device_auto_alloc_size;
 	if (size) {
-		free(dev->uclass_priv);
+		slab_free(dev->uclass_priv);
 		dev->uclass_priv = NULL;
 	}
 	if (dev->parent) {
@@ -143,7 +146,7 @@ void device_free(struct udevice *dev)
 					per_child_auto_alloc_size;
 		}
 		if (size) {
-			free(dev->parent_priv);
+			slab_free(dev->parent_priv);
 			dev->parent_priv = NULL;
 		}
 	}
@@ -159,6 +162,9 @@ int device_remove(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
+	/* Let a pending probe finish, so that the driver can be removed */
+	if (dev->flags & DM_FLAG_PROBE_PENDING)
+		device_probe(dev);
 	if (!(dev->flags & DM_FLAG_ACTIVATED))
 		return 0;
 
@@ -189,7 +195,7 @@ int device_remove(struct udevice *dev)
 
 	device_free(dev);
 
-	dev->seq = -1;
+	uclass_set_seq(dev, -1);
 	dev->flags &= ~DM_FLAG_ACTIVATED;
 
 	return ret;
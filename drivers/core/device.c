@@ -14,6 +14,8 @@
 #include <fdtdec.h>
 #include <fdt_support.h>
 #include <malloc.h>
+#include <slab.h>
+#include <watchdog.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -47,7 +49,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		return ret;
 	}
 
-	dev = calloc(1, sizeof(struct udevice));
+	dev = slab_zalloc(sizeof(struct udevice));
 	if (!dev)
 		return -ENOMEM;
 
@@ -60,7 +62,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	dev->platdata = platdata;
 	dev->driver_data = driver_data;
 	dev->name = name;
-	dev->of_offset = of_offset;
+	dev_set_of_offset(dev, of_offset);
 	dev->parent = parent;
 	dev->driver = drv;
 	dev->uclass = uc;
@@ -97,8 +99,8 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (alloc) {
 			dev->flags |= DM_FLAG_ALLOC_PDATA;
-			dev->platdata = calloc(1,
-					       drv->platdata_auto_alloc_size);
+			dev->platdata =
+				slab_zalloc(drv->platdata_auto_alloc_size);
 			if (!dev->platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc1;
@@ -113,7 +115,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	size = uc->uc_drv->per_device_platdata_auto_alloc_size;
 	if (size) {
 		dev->flags |= DM_FLAG_ALLOC_UCLASS_PDATA;
-		dev->uclass_platdata = calloc(1, size);
+		dev->uclass_platdata = slab_zalloc(size);
 		if (!dev->uclass_platdata) {
 			ret = -ENOMEM;
 			goto fail_alloc2;
@@ -128,7 +130,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (size) {
 			dev->flags |= DM_FLAG_ALLOC_PARENT_PDATA;
-			dev->parent_platdata = calloc(1, size);
+			dev->parent_platdata = slab_zalloc(size);
 			if (!dev->parent_platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc3;
@@ -191,24 +193,24 @@ fail_uclass_bind:
 	if (CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)) {
 		list_del(&dev->sibling_node);
 		if (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA) {
-			free(dev->parent_platdata);
+			slab_free(dev->parent_platdata);
 			dev->parent_platdata = NULL;
 		}
 	}
 fail_alloc3:
 	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA) {
-		free(dev->uclass_platdata);
+		slab_free(dev->uclass_platdata);
 		dev->uclass_platdata = NULL;
 	}
 fail_alloc2:
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
-		free(dev->platdata);
+		slab_free(dev->platdata);
 		dev->platdata = NULL;
 	}
 fail_alloc1:
 	devres_release_all(dev);
 
-	free(dev);
+	slab_free(dev);
 
 	return ret;
 }
@@ -258,13 +260,43 @@ static void *alloc_priv(int size, uint flags)
 		if (priv)
 			memset(priv, '\0', size);
 	} else {
-		priv = calloc(1, size);
+		priv = slab_zalloc(size);
 	}
 
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+/* Undo a failed probe, freeing the memory allocated for it */
+static void device_probe_undo(struct udevice *dev)
+{
+	dev->flags &= ~(DM_FLAG_ACTIVATED | DM_FLAG_PROBE_PENDING);
+
+	uclass_set_seq(dev, -1);
+	device_free(dev);
+}
+
+/* Complete a probe once the driver has finished, as device_probe() does */
+static int device_probe_finish(struct udevice *dev)
+{
+	int ret;
+
+	ret = uclass_post_probe_device(dev);
+	if (ret) {
+		if (device_remove(dev)) {
+			dm_warn("%s: Device '%s' failed to remove on error path\n",
+				__func__, dev->name);
+		}
+		device_probe_undo(dev);
+		return ret;
+	}
+
+	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
+		pinctrl_select_state(dev, "default");
+
+	return 0;
+}
+
+int device_probe_start(struct udevice *dev)
 {
 	const struct driver *drv;
 	int size = 0;
@@ -274,6 +306,8 @@ int device_probe(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
+	if (dev->flags & DM_FLAG_PROBE_PENDING)
+		return -EINPROGRESS;
 	if (dev->flags & DM_FLAG_ACTIVATED)
 		return 0;
 
@@ -291,7 +325,7 @@ int device_probe(struct udevice *dev)
 	/* Allocate private data if requested and not reentered */
 	size = dev->uclass->uc_drv->per_device_auto_alloc_size;
 	if (size && !dev->uclass_priv) {
-		dev->uclass_priv = calloc(1, size);
+		dev->uclass_priv = slab_zalloc(size);
 		if (!dev->uclass_priv) {
 			ret = -ENOMEM;
 			goto fail;
@@ -323,6 +357,8 @@ int device_probe(struct udevice *dev)
 		 * (e.g. PCI bridge devices). Test the flags again
 		 * so that we don't mess up the device.
 		 */
+		if (dev->flags & DM_FLAG_PROBE_PENDING)
+			return -EINPROGRESS;
 		if (dev->flags & DM_FLAG_ACTIVATED)
 			return 0;
 	}
@@ -332,7 +368,7 @@ int device_probe(struct udevice *dev)
 		ret = seq;
 		goto fail;
 	}
-	dev->seq = seq;
+	uclass_set_seq(dev, seq);
 
 	dev->flags |= DM_FLAG_ACTIVATED;
 
@@ -369,24 +405,77 @@ int device_probe(struct udevice *dev)
 		}
 	}
 
-	ret = uclass_post_probe_device(dev);
-	if (ret)
-		goto fail_uclass;
+	/* The uclass is told about the device once the driver is done */
+	if (drv->probe_poll) {
+		dev->flags |= DM_FLAG_PROBE_PENDING;
+		return -EINPROGRESS;
+	}
 
-	if (dev->parent && device_get_uclass_id(dev) == UCLASS_PINCTRL)
-		pinctrl_select_state(dev, "default");
+	return device_probe_finish(dev);
+fail:
+	device_probe_undo(dev);
 
-	return 0;
-fail_uclass:
-	if (device_remove(dev)) {
+	return ret;
+}
+
+int device_probe_poll(struct udevice *dev)
+{
+	int ret;
+
+	if (!(dev->flags & DM_FLAG_PROBE_PENDING))
+		return device_active(dev) ? 0 : -ENODEV;
+
+	ret = dev->driver->probe_poll(dev);
+	if (ret == -EAGAIN)
+		return ret;
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+	if (ret) {
+		device_probe_undo(dev);
+		return ret;
+	}
+
+	return device_probe_finish(dev);
+}
+
+bool device_probe_timed_out(ulong start)
+{
+	return CONFIG_DM_PROBE_TIMEOUT &&
+		get_timer(start) > CONFIG_DM_PROBE_TIMEOUT;
+}
+
+int device_probe_cancel(struct udevice *dev)
+{
+	if (!(dev->flags & DM_FLAG_PROBE_PENDING))
+		return device_active(dev) ? 0 : -ENODEV;
+
+	dm_warn("Device '%s' did not finish probing\n", dev->name);
+	dev->flags &= ~DM_FLAG_PROBE_PENDING;
+
+	/* Let the driver stop the work which probe() started */
+	if (dev->driver->remove && dev->driver->remove(dev)) {
 		dm_warn("%s: Device '%s' failed to remove on error path\n",
 			__func__, dev->name);
 	}
-fail:
-	dev->flags &= ~DM_FLAG_ACTIVATED;
+	device_probe_undo(dev);
 
-	dev->seq = -1;
-	device_free(dev);
+	return -ETIMEDOUT;
+}
+
+int device_probe(struct udevice *dev)
+{
+	ulong start;
+	int ret;
+
+	ret = device_probe_start(dev);
+	if (ret != -EINPROGRESS)
+		return ret;
+	start = get_timer(0);
+	do {
+		WATCHDOG_RESET();
+		if (device_probe_timed_out(start))
+			return device_probe_cancel(dev);
+		ret = device_probe_poll(dev);
+	} while (ret == -EAGAIN);
 
 	return ret;
 }
@@ -650,8 +739,8 @@ fdt_addr_t dev_get_addr_index(struct udevice *dev, int index)
 			return FDT_ADDR_T_NONE;
 		}
 
-		reg = fdt_getprop(gd->fdt_blob, dev_of_offset(dev), "reg",
-				  &len);
+		reg = fdtdec_getprop(gd->fdt_blob, dev_of_offset(dev), "reg",
+				     &len);
 		if (!reg || (len <= (index * sizeof(fdt32_t) * (na + ns)))) {
 			debug("Req index out of range\n");
 			return FDT_ADDR_T_NONE;
@@ -787,15 +876,30 @@ void device_set_name_alloced(struct udevice *dev)
 
 int device_set_name(struct udevice *dev, const char *name)
 {
+	bool indexed;
+
 	name = strdup(name);
 	if (!name)
 		return -ENOMEM;
+	indexed = uclass_unindex_device(dev);
 	dev->name = name;
+	if (indexed)
+		uclass_index_device(dev);
 	device_set_name_alloced(dev);
 
 	return 0;
 }
 
+void dev_set_of_offset(struct udevice *dev, int of_offset)
+{
+	bool indexed = uclass_unindex_device(dev);
+
+	dev->of_offset = of_offset;
+	dev->node = offset_to_ofnode(of_offset);
+	if (indexed)
+		uclass_index_device(dev);
+}
+
 bool of_device_is_compatible(struct udevice *dev, const char *compat)
 {
 	const void *fdt = gd->fdt_blob;
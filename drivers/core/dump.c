@@ -8,6 +8,7 @@
 #include <dm.h>
 #include <mapmem.h>
 #include <dm/root.h>
+#include <dm/uclass-internal.h>
 
 static void show_devices(struct udevice *dev, int depth, int last_flag)
 {
@@ -72,6 +73,26 @@ static void dm_display_line(struct udevice *dev)
 	puts("\n");
 }
 
+static void dm_display_index(struct uclass *uc)
+{
+	struct uclass_index_stats stats;
+
+	if (uclass_get_index_stats(uc, &stats))
+		return;
+	printf("  index: %u lookups, %u list walks, seq table %d\n",
+	       stats.lookups, stats.walks, stats.seq_size);
+	printf("  name %u/%u, offset %u/%u, phandle %u/%u (devices/buckets)",
+	       stats.count[UCLASS_INDEX_NAME], stats.buckets[UCLASS_INDEX_NAME],
+	       stats.count[UCLASS_INDEX_OF_OFFSET],
+	       stats.buckets[UCLASS_INDEX_OF_OFFSET],
+	       stats.count[UCLASS_INDEX_PHANDLE],
+	       stats.buckets[UCLASS_INDEX_PHANDLE]);
+	printf(", longest chain %u\n",
+	       max3(stats.longest[UCLASS_INDEX_NAME],
+		    stats.longest[UCLASS_INDEX_OF_OFFSET],
+		    stats.longest[UCLASS_INDEX_PHANDLE]));
+}
+
 void dm_dump_uclass(void)
 {
 	struct uclass *uc;
@@ -91,6 +112,7 @@ void dm_dump_uclass(void)
 		list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 			dm_display_line(dev);
 		}
+		dm_display_index(uc);
 		puts("\n");
 	}
 }
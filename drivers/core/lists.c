@@ -17,6 +17,9 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <u-boot/fnv.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -126,36 +129,134 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
-		   struct udevice **devp)
+static struct driver *lists_driver_scan_compat(const char *compat,
+					       const struct udevice_id **idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/**
+ * struct compat_slot - a compatible string in the index
+ *
+ * @hash:	Hash value of the string
+ * @drv:	First driver in the linker list with this string, or NULL if
+ *		the slot is empty
+ * @id:		The driver's match for the string
+ */
+struct compat_slot {
+	uint hash;
+	struct driver *drv;
+	const struct udevice_id *id;
+};
+
+/* Hash table of every compatible string, with linear probing */
+static struct compat_slot *compat_index;
+static uint compat_mask;
+
+static struct compat_slot *compat_find_slot(const char *compat, uint hash)
+{
+	struct compat_slot *slot;
+	uint i;
+
+	for (i = hash & compat_mask;; i = (i + 1) & compat_mask) {
+		slot = &compat_index[i];
+		if (!slot->drv || (slot->hash == hash &&
+				   !strcmp(slot->id->compatible, compat)))
+			return slot;
+	}
+}
+
+/*
+ * Build the index on first use. This is not done before relocation, since
+ * the pre-relocation malloc() pool is small and only a few nodes are bound
+ * then; nor before any manual relocation of the driver list.
+ */
+static int compat_index_init(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct compat_slot *slot;
+	struct driver *entry;
+	uint count = 0, size;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++)
+			count++;
+	}
+
+	/* Keep the table at most half full */
+	for (size = 16; size < count * 2; size <<= 1)
+		;
+	compat_index = calloc(size, sizeof(struct compat_slot));
+	if (!compat_index)
+		return -ENOMEM;
+	compat_mask = size - 1;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			uint hash = fnv1a_str(id->compatible);
+
+			/* The first driver with a string takes priority */
+			slot = compat_find_slot(id->compatible, hash);
+			if (slot->drv)
+				continue;
+			slot->hash = hash;
+			slot->drv = entry;
+			slot->id = id;
+		}
+	}
+	dm_dbg("Indexed %u compatible strings in %u slots\n", count, size);
+
+	return 0;
+}
+#endif
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
+{
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	struct compat_slot *slot;
+
+	if (!compat_index && (gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		compat_index_init();
+	if (compat_index) {
+		slot = compat_find_slot(compat, fnv1a_str(compat));
+		*idp = slot->id;
+
+		return slot->drv;
+	}
+#endif
+
+	return lists_driver_scan_compat(compat, idp);
+}
+
+int lists_bind_fdt_compat(struct udevice *parent, const char *name,
+			  const char *compat_list, int compat_length,
+			  int offset, struct udevice **devp)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
 	bool found = false;
-	const char *name, *compat_list, *compat;
-	int compat_length, i;
+	const char *compat;
+	int i;
 	int result = 0;
 	int ret = 0;
 
-	name = fdt_get_name(blob, offset, NULL);
-	dm_dbg("bind node %s\n", name);
 	if (devp)
 		*devp = NULL;
 
-	compat_list = fdt_getprop(blob, offset, "compatible", &compat_length);
-	if (!compat_list) {
-		if (compat_length == -FDT_ERR_NOTFOUND) {
-			dm_dbg("Device '%s' has no compatible string\n", name);
-			return 0;
-		}
-
-		dm_warn("Device tree error at offset %d\n", offset);
-		return compat_length;
-	}
-
 	/*
 	 * Walk through the compatible string list, attempting to match each
 	 * compatible string in order such that we match in order of priority
@@ -166,13 +267,8 @@ int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 		dm_dbg("   - attempt to match compatible string '%s'\n",
 		       compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		entry = lists_driver_lookup_compat(compat, &id);
+		if (!entry)
 			continue;
 
 		dm_dbg("   - found match at '%s'\n", entry->name);
@@ -199,4 +295,31 @@ int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 
 	return result;
 }
+
+int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
+		   struct udevice **devp)
+{
+	const char *name, *compat_list;
+	int compat_length;
+
+	name = fdt_get_name(blob, offset, NULL);
+	dm_dbg("bind node %s\n", name);
+	if (devp)
+		*devp = NULL;
+
+	compat_list = fdtdec_getprop(blob, offset, "compatible",
+				     &compat_length);
+	if (!compat_list) {
+		if (compat_length == -FDT_ERR_NOTFOUND) {
+			dm_dbg("Device '%s' has no compatible string\n", name);
+			return 0;
+		}
+
+		dm_warn("Device tree error at offset %d\n", offset);
+		return compat_length;
+	}
+
+	return lists_bind_fdt_compat(parent, name, compat_list, compat_length,
+				     offset, devp);
+}
 #endif
@@ -0,0 +1,204 @@
+/*
+ * Live device tree, built from the flat tree after relocation
+ *
+ * The nodes are kept in one array, in the order they appear in the flat
+ * tree. Since offsets increase through the flat tree, the node for an
+ * offset can be found with a binary search. Property names and values are
+ * not copied: each property points into the flat tree, with a hash of its
+ * name so that looking up a property seldom needs to compare strings. So
+ * the control FDT must not be changed in place once the live tree is in
+ * use, though it can be replaced by another one with of_live_replace().
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <libfdt.h>
+#include <malloc.h>
+#include <dm/of_access.h>
+#include <u-boot/fnv.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define OF_LIVE_MAX_DEPTH	32
+
+static const void *of_blob;
+static int of_node_count;
+
+/* Count the nodes and properties, checking that the tree can be read */
+static int of_live_count(const void *blob, int *nodesp, int *propsp)
+{
+	int offset, depth, prop;
+	int nodes = 0, props = 0;
+
+	for (offset = 0, depth = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		if (depth >= OF_LIVE_MAX_DEPTH)
+			return -FDT_ERR_BADSTRUCTURE;
+		nodes++;
+		fdt_for_each_property_offset(prop, blob, offset)
+			props++;
+		if (prop != -FDT_ERR_NOTFOUND)
+			return prop;
+	}
+	if (offset != -FDT_ERR_NOTFOUND && depth >= 0)
+		return offset;
+	*nodesp = nodes;
+	*propsp = props;
+
+	return 0;
+}
+
+/* Build a live tree for @blob, returning its nodes in @nodesp */
+static int of_live_build(const void *blob, struct device_node **nodesp,
+			 int *node_countp)
+{
+	struct device_node *last[OF_LIVE_MAX_DEPTH] = { NULL };
+	struct device_node *nodes, *np;
+	struct property *pp, **linkp;
+	int offset, depth, prop;
+	int node_count = 0, prop_count = 0;
+	int ret;
+
+	ret = of_live_count(blob, &node_count, &prop_count);
+	if (ret) {
+		debug("%s: Cannot read device tree: %s\n", __func__,
+		      fdt_strerror(ret));
+		return -EINVAL;
+	}
+	nodes = calloc(1, node_count * sizeof(*nodes) +
+		       prop_count * sizeof(*pp));
+	if (!nodes)
+		return -ENOMEM;
+	pp = (struct property *)(nodes + node_count);
+
+	np = nodes;
+	for (offset = 0, depth = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth), np++) {
+		np->name = fdt_get_name(blob, offset, NULL);
+		np->offset = offset;
+		linkp = &np->properties;
+		fdt_for_each_property_offset(prop, blob, offset) {
+			pp->value = fdt_getprop_by_offset(blob, prop, &pp->name,
+							  &pp->length);
+			pp->hash = fnv1a_str(pp->name);
+			*linkp = pp;
+			linkp = &pp->next;
+			pp++;
+		}
+
+		/* The last node at this depth is our older sibling, if any */
+		if (depth) {
+			np->parent = last[depth - 1];
+			if (last[depth] && last[depth]->parent == np->parent)
+				last[depth]->sibling = np;
+			else
+				np->parent->child = np;
+		}
+		last[depth] = np;
+	}
+	*nodesp = nodes;
+	*node_countp = node_count;
+	debug("%s: %d nodes, %d properties\n", __func__, node_count,
+	      prop_count);
+
+	return 0;
+}
+
+int of_live_init(void)
+{
+	struct device_node *nodes;
+	int node_count;
+	int ret;
+
+	/* Devices point to the nodes, so they must stay as they are */
+	if (of_live_active())
+		return -EBUSY;
+
+	/* Use the flat tree if this fails */
+	ret = of_live_build(gd->fdt_blob, &nodes, &node_count);
+	if (ret)
+		return ret;
+	of_blob = gd->fdt_blob;
+	of_node_count = node_count;
+	gd->of_root = nodes;
+
+	return 0;
+}
+
+int of_live_replace(const void *blob)
+{
+	struct device_node *nodes;
+	int node_count;
+	int ret;
+
+	ret = of_live_build(blob, &nodes, &node_count);
+	if (ret)
+		return ret;
+	gd->fdt_blob = blob;
+	of_blob = blob;
+	of_node_count = node_count;
+	gd->of_root = nodes;
+
+	return 0;
+}
+
+struct device_node *of_live_node(int offset)
+{
+	struct device_node *nodes = gd->of_root;
+	int low = 0, high = of_node_count;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (nodes[mid].offset == offset)
+			return &nodes[mid];
+		if (nodes[mid].offset < offset)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return NULL;
+}
+
+struct device_node *of_live_find(const void *blob, int offset)
+{
+	if (!of_live_active() || blob != of_blob || offset < 0)
+		return NULL;
+
+	return of_live_node(offset);
+}
+
+const struct property *of_find_property(const struct device_node *np,
+					const char *name, int *lenp)
+{
+	const struct property *pp;
+	uint hash;
+
+	if (!np) {
+		if (lenp)
+			*lenp = -FDT_ERR_BADOFFSET;
+		return NULL;
+	}
+	hash = fnv1a_str(name);
+	for (pp = np->properties; pp; pp = pp->next) {
+		if (pp->hash == hash && !strcmp(pp->name, name)) {
+			if (lenp)
+				*lenp = pp->length;
+			return pp;
+		}
+	}
+	if (lenp)
+		*lenp = -FDT_ERR_NOTFOUND;
+
+	return NULL;
+}
+
+const void *of_get_property(const struct device_node *np, const char *name,
+			    int *lenp)
+{
+	const struct property *pp = of_find_property(np, name, lenp);
+
+	return pp ? pp->value : NULL;
+}
@@ -0,0 +1,147 @@
+/*
+ * Device tree node handles, for either the live or the flat tree
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <libfdt.h>
+#include <dm/ofnode.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+const void *ofnode_read_prop(ofnode node, const char *propname, int *sizep)
+{
+	if (of_live_active())
+		return of_get_property(ofnode_to_np(node), propname, sizep);
+
+	return fdt_getprop(gd->fdt_blob, ofnode_to_offset(node), propname,
+			   sizep);
+}
+
+int ofnode_read_u32(ofnode node, const char *propname, u32 *outp)
+{
+	const fdt32_t *cell;
+	int len;
+
+	cell = ofnode_read_prop(node, propname, &len);
+	if (!cell) {
+		debug("%s: Missing property '%s'\n", __func__, propname);
+		return -EINVAL;
+	}
+	if (len < sizeof(*cell)) {
+		debug("%s: Property '%s' is too short\n", __func__, propname);
+		return -EOVERFLOW;
+	}
+	*outp = fdt32_to_cpu(*cell);
+
+	return 0;
+}
+
+u32 ofnode_read_u32_default(ofnode node, const char *propname, u32 def)
+{
+	ofnode_read_u32(node, propname, &def);
+
+	return def;
+}
+
+const char *ofnode_read_string(ofnode node, const char *propname)
+{
+	const char *str;
+	int len;
+
+	str = ofnode_read_prop(node, propname, &len);
+	if (!str || !len)
+		return NULL;
+	if (strnlen(str, len) >= len) {
+		debug("%s: Property '%s' is not a string\n", __func__,
+		      propname);
+		return NULL;
+	}
+
+	return str;
+}
+
+bool ofnode_read_bool(ofnode node, const char *propname)
+{
+	return ofnode_read_prop(node, propname, NULL) != NULL;
+}
+
+const char *ofnode_get_name(ofnode node)
+{
+	if (!ofnode_valid(node))
+		return NULL;
+	if (of_live_active())
+		return ofnode_to_np(node)->name;
+
+	return fdt_get_name(gd->fdt_blob, ofnode_to_offset(node), NULL);
+}
+
+ofnode ofnode_get_parent(ofnode node)
+{
+	if (!ofnode_valid(node))
+		return ofnode_null();
+	if (of_live_active())
+		return np_to_ofnode(ofnode_to_np(node)->parent);
+
+	return offset_to_ofnode(fdt_parent_offset(gd->fdt_blob,
+						  ofnode_to_offset(node)));
+}
+
+ofnode ofnode_first_subnode(ofnode node)
+{
+	if (!ofnode_valid(node))
+		return ofnode_null();
+	if (of_live_active())
+		return np_to_ofnode(ofnode_to_np(node)->child);
+
+	return offset_to_ofnode(fdt_first_subnode(gd->fdt_blob,
+						  ofnode_to_offset(node)));
+}
+
+ofnode ofnode_next_subnode(ofnode node)
+{
+	if (!ofnode_valid(node))
+		return ofnode_null();
+	if (of_live_active())
+		return np_to_ofnode(ofnode_to_np(node)->sibling);
+
+	return offset_to_ofnode(fdt_next_subnode(gd->fdt_blob,
+						 ofnode_to_offset(node)));
+}
+
+ofnode ofnode_find_subnode(ofnode node, const char *subnode_name)
+{
+	const struct device_node *np;
+	int len = strlen(subnode_name);
+	int offset;
+
+	if (!ofnode_valid(node))
+		return ofnode_null();
+	if (!of_live_active()) {
+		offset = fdt_subnode_offset(gd->fdt_blob,
+					    ofnode_to_offset(node),
+					    subnode_name);
+		return offset_to_ofnode(offset);
+	}
+
+	for (np = ofnode_to_np(node)->child; np; np = np->sibling) {
+		if (strncmp(np->name, subnode_name, len))
+			continue;
+		if (!np->name[len])
+			return np_to_ofnode(np);
+		if (np->name[len] == '@' && !strchr(subnode_name, '@'))
+			return np_to_ofnode(np);
+	}
+
+	return ofnode_null();
+}
+
+bool ofnode_is_available(ofnode node)
+{
+	const char *status;
+
+	status = ofnode_read_prop(node, "status", NULL);
+
+	return !status || !strcmp(status, "okay");
+}
@@ -0,0 +1,370 @@
+/*
+ * Probing devices concurrently
+ *
+ * Some devices take a long time to become ready after they are probed, for
+ * example while an Ethernet PHY negotiates a link or a USB hub powers its
+ * ports. Their drivers can start the work in probe() and finish it in
+ * probe_poll(). dm_probe_devices() starts probing each device in a list as
+ * soon as the devices it depends on are ready, then polls the pending ones
+ * in turn, so that their waits overlap. A device which is still not ready
+ * after CONFIG_DM_PROBE_TIMEOUT milliseconds fails to probe.
+ *
+ * A device depends on its nearest ancestor in the list and on the devices
+ * in the list which its device tree node refers to by phandle, in
+ * properties such as "clocks" and "vmmc-supply". Devices outside the list
+ * are probed as usual, when a driver asks for them.
+ *
+ * Everything runs on the boot CPU: driver model, malloc() and most drivers
+ * are not safe to use from more than one CPU at once.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <errno.h>
+#include <fdtdec.h>
+#include <malloc.h>
+#include <watchdog.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/uclass-internal.h>
+#include <dm/util.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Longest uclass name accepted by dm_probe_uclasses() */
+#define PROBE_UCLASS_NAME_LEN	32
+
+enum probe_state {
+	PROBE_WAITING,
+	PROBE_PENDING,
+	PROBE_DONE,
+};
+
+/**
+ * struct probe_job - a device to be probed by dm_probe_devices()
+ *
+ * @dev:	Device to probe
+ * @state:	How far the probe has got
+ * @start:	Value of get_timer(0) when the probe became pending
+ * @dep_start:	Index of the first dependency in probe_sched->dep[]
+ * @dep_count:	Number of dependencies
+ */
+struct probe_job {
+	struct udevice *dev;
+	enum probe_state state;
+	ulong start;
+	int dep_start;
+	int dep_count;
+};
+
+/**
+ * struct probe_sched - the state of dm_probe_devices()
+ *
+ * @job:	One job for each device
+ * @count:	Number of jobs
+ * @dep:	Indexes of the jobs which each job depends on
+ * @dep_count:	Number of entries used in @dep
+ * @dep_size:	Number of entries allocated in @dep
+ */
+struct probe_sched {
+	struct probe_job *job;
+	int count;
+	int *dep;
+	int dep_count;
+	int dep_size;
+};
+
+/*
+ * Properties which refer to other devices by phandle, followed by any
+ * arguments. A property also matches if its name ends in '-' and the
+ * string, e.g. "vmmc-supply" and "cd-gpios".
+ */
+static const struct {
+	const char *name;
+	const char *cells_name;
+} probe_dep_props[] = {
+	{ "clocks", "#clock-cells" },
+	{ "resets", "#reset-cells" },
+	{ "power-domains", "#power-domain-cells" },
+	{ "phys", "#phy-cells" },
+	{ "dmas", "#dma-cells" },
+	{ "mboxes", "#mbox-cells" },
+	{ "gpios", "#gpio-cells" },
+	{ "supply", NULL },
+};
+
+static int probe_find_dev(struct probe_sched *sched, struct udevice *dev)
+{
+	int i;
+
+	for (i = 0; i < sched->count; i++) {
+		if (sched->job[i].dev == dev)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Find the job for a node, or for its nearest ancestor */
+static int probe_find_node(struct probe_sched *sched, int offset)
+{
+	int i;
+
+	for (; offset >= 0; offset = fdt_parent_offset(gd->fdt_blob, offset)) {
+		for (i = 0; i < sched->count; i++) {
+			if (dev_of_offset(sched->job[i].dev) == offset)
+				return i;
+		}
+	}
+
+	return -1;
+}
+
+static int probe_add_dep(struct probe_sched *sched, int self, int dep)
+{
+	struct probe_job *job = &sched->job[self];
+	int i;
+
+	if (dep < 0 || dep == self)
+		return 0;
+	for (i = job->dep_start; i < sched->dep_count; i++) {
+		if (sched->dep[i] == dep)
+			return 0;
+	}
+	if (sched->dep_count == sched->dep_size) {
+		int size = sched->dep_size ? sched->dep_size * 2 : 16;
+		int *dep;
+
+		dep = realloc(sched->dep, size * sizeof(*dep));
+		if (!dep)
+			return -ENOMEM;
+		sched->dep = dep;
+		sched->dep_size = size;
+	}
+	sched->dep[sched->dep_count++] = dep;
+	job->dep_count++;
+
+	return 0;
+}
+
+static bool probe_dep_prop_match(const char *prop, const char *name)
+{
+	int prop_len = strlen(prop);
+	int len = strlen(name);
+
+	if (prop_len < len || strcmp(prop + prop_len - len, name))
+		return false;
+
+	return prop_len == len || prop[prop_len - len - 1] == '-';
+}
+
+/* Add the jobs which the device tree node of a job refers to */
+static int probe_add_node_deps(struct probe_sched *sched, int self)
+{
+	const void *blob = gd->fdt_blob;
+	int node = dev_of_offset(sched->job[self].dev);
+	struct fdtdec_phandle_args args;
+	const char *prop;
+	int offset;
+	int i, j;
+	int ret;
+
+	if (node < 0)
+		return 0;
+	fdt_for_each_property_offset(offset, blob, node) {
+		fdt_getprop_by_offset(blob, offset, &prop, NULL);
+		for (i = 0; i < ARRAY_SIZE(probe_dep_props); i++) {
+			if (probe_dep_prop_match(prop, probe_dep_props[i].name))
+				break;
+		}
+		if (i == ARRAY_SIZE(probe_dep_props))
+			continue;
+		for (j = 0; !fdtdec_parse_phandle_with_args(blob, node, prop,
+				probe_dep_props[i].cells_name, 0, j, &args);
+		     j++) {
+			ret = probe_add_dep(sched, self,
+					    probe_find_node(sched, args.node));
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int probe_add_deps(struct probe_sched *sched, int self)
+{
+	struct probe_job *job = &sched->job[self];
+	struct udevice *parent;
+	int ret;
+
+	job->dep_start = sched->dep_count;
+	for (parent = job->dev->parent; parent; parent = parent->parent) {
+		ret = probe_add_dep(sched, self, probe_find_dev(sched, parent));
+		if (ret)
+			return ret;
+		if (job->dep_count)
+			break;
+	}
+
+	return probe_add_node_deps(sched, self);
+}
+
+/* Check whether all the jobs which a job depends on are done */
+static bool probe_job_ready(struct probe_sched *sched, struct probe_job *job)
+{
+	int i;
+
+	for (i = 0; i < job->dep_count; i++) {
+		if (sched->job[sched->dep[job->dep_start + i]].state !=
+		    PROBE_DONE)
+			return false;
+	}
+
+	return true;
+}
+
+static void probe_job_done(struct probe_job *job, int ret, int *errp)
+{
+	job->state = PROBE_DONE;
+	if (ret) {
+		dm_warn("Device '%s' failed to probe: %d\n", job->dev->name,
+			ret);
+		if (!*errp)
+			*errp = ret;
+	}
+}
+
+static int probe_run(struct probe_sched *sched)
+{
+	int waiting, pending, first;
+	int force = -1;
+	bool progress;
+	int err = 0;
+	int ret;
+	int i;
+
+	do {
+		WATCHDOG_RESET();
+		progress = false;
+		waiting = 0;
+		pending = 0;
+		first = -1;
+		for (i = 0; i < sched->count; i++) {
+			struct probe_job *job = &sched->job[i];
+
+			if (job->state == PROBE_WAITING &&
+			    (i == force || probe_job_ready(sched, job))) {
+				ret = device_probe_start(job->dev);
+				if (ret == -EINPROGRESS) {
+					job->state = PROBE_PENDING;
+					job->start = get_timer(0);
+				} else {
+					probe_job_done(job, ret, &err);
+				}
+				progress = true;
+			}
+			if (job->state == PROBE_PENDING) {
+				if (device_probe_timed_out(job->start))
+					ret = device_probe_cancel(job->dev);
+				else
+					ret = device_probe_poll(job->dev);
+				if (ret != -EAGAIN) {
+					probe_job_done(job, ret, &err);
+					progress = true;
+				}
+			}
+			if (job->state == PROBE_WAITING) {
+				if (first < 0)
+					first = i;
+				waiting++;
+			} else if (job->state == PROBE_PENDING) {
+				pending++;
+			}
+		}
+
+		/*
+		 * If nothing has happened, the devices still waiting depend on
+		 * each other, so start the first one anyway. It probes those
+		 * it needs itself, as with device_probe().
+		 */
+		force = progress || pending ? -1 : first;
+	} while (waiting || pending);
+
+	return err;
+}
+
+int dm_probe_devices(struct udevice *const devs[], int count)
+{
+	struct probe_sched sched = { .count = count };
+	int ret;
+	int i;
+
+	sched.job = calloc(count, sizeof(*sched.job));
+	if (!sched.job)
+		return -ENOMEM;
+	for (i = 0; i < count; i++)
+		sched.job[i].dev = devs[i];
+	for (i = 0; i < count; i++) {
+		ret = probe_add_deps(&sched, i);
+		if (ret)
+			goto out;
+	}
+	ret = probe_run(&sched);
+out:
+	free(sched.dep);
+	free(sched.job);
+
+	return ret;
+}
+
+int dm_probe_uclasses(const char *names)
+{
+	struct udevice **devs = NULL;
+	char name[PROBE_UCLASS_NAME_LEN];
+	int count = 0, size = 0;
+	struct udevice *dev;
+	struct uclass *uc;
+	enum uclass_id id;
+	const char *end;
+	int ret;
+
+	for (; *names; names = end) {
+		names += strspn(names, " ");
+		end = strchr(names, ' ');
+		if (!end)
+			end = names + strlen(names);
+		if (end == names)
+			break;
+		strlcpy(name, names, min_t(int, end - names + 1, sizeof(name)));
+		id = uclass_get_by_name(name);
+		if (id == UCLASS_INVALID) {
+			dm_warn("%s: Unknown uclass '%s'\n", __func__, name);
+			continue;
+		}
+		ret = uclass_get(id, &uc);
+		if (ret)
+			goto out;
+		uclass_foreach_dev(dev, uc) {
+			if (count == size) {
+				struct udevice **new;
+
+				size = size ? size * 2 : 16;
+				new = realloc(devs, size * sizeof(*devs));
+				if (!new) {
+					ret = -ENOMEM;
+					goto out;
+				}
+				devs = new;
+			}
+			devs[count++] = dev;
+		}
+	}
+	ret = count ? dm_probe_devices(devs, count) : 0;
+out:
+	free(devs);
+
+	return ret;
+}
@@ -12,9 +12,11 @@
 #include <fdtdec.h>
 #include <malloc.h>
 #include <libfdt.h>
+#include <dm/bind_table.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <dm/of_access.h>
 #include <dm/platdata.h>
 #include <dm/root.h>
 #include <dm/uclass.h>
@@ -165,7 +167,7 @@ int dm_init(void)
 	if (ret)
 		return ret;
 #if CONFIG_IS_ENABLED(OF_CONTROL)
-	DM_ROOT_NON_CONST->of_offset = 0;
+	dev_set_of_offset(DM_ROOT_NON_CONST, 0);
 #endif
 	ret = device_probe(DM_ROOT_NON_CONST);
 	if (ret)
@@ -196,26 +198,87 @@ int dm_scan_platdata(bool pre_reloc_only)
 }
 
 #if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+/* Bind a device to a node, if it is enabled and wanted at this stage */
+static int dm_scan_fdt_subnode(struct udevice *parent, const void *blob,
+			       int offset, bool pre_reloc_only)
+{
+	int ret;
+
+	if (pre_reloc_only &&
+	    !fdtdec_getprop(blob, offset, "u-boot,dm-pre-reloc", NULL))
+		return 0;
+	if (!fdtdec_get_is_enabled(blob, offset)) {
+		dm_dbg("   - ignoring disabled device\n");
+		return 0;
+	}
+	ret = lists_bind_fdt(parent, blob, offset, NULL);
+	if (ret)
+		debug("%s: ret=%d\n", fdt_get_name(blob, offset, NULL), ret);
+
+	return ret;
+}
+
+/* Bind a device to a node, using what the bind table says about it */
+static int dm_scan_bind_node(struct udevice *parent, const void *blob,
+			     const struct dm_bind_node *node,
+			     bool pre_reloc_only)
+{
+	const char *name;
+	int ret;
+
+	if (pre_reloc_only && !(node->flags & DM_BIND_PRE_RELOC))
+		return 0;
+	if (!(node->flags & DM_BIND_ENABLED)) {
+		dm_dbg("   - ignoring disabled device\n");
+		return 0;
+	}
+	name = fdt_get_name(blob, node->offset, NULL);
+	dm_dbg("bind node %s\n", name);
+	if (!node->compat) {
+		dm_dbg("Device '%s' has no compatible string\n", name);
+		return 0;
+	}
+	ret = lists_bind_fdt_compat(parent, name, node->compat,
+				    node->compat_len, node->offset, NULL);
+	if (ret)
+		debug("%s: ret=%d\n", name, ret);
+
+	return ret;
+}
+
 int dm_scan_fdt_node(struct udevice *parent, const void *blob, int offset,
 		     bool pre_reloc_only)
 {
+	const struct dm_bind_node *node;
+	const struct device_node *np;
 	int ret = 0, err;
 
-	for (offset = fdt_first_subnode(blob, offset);
-	     offset > 0;
-	     offset = fdt_next_subnode(blob, offset)) {
-		if (pre_reloc_only &&
-		    !fdt_getprop(blob, offset, "u-boot,dm-pre-reloc", NULL))
-			continue;
-		if (!fdtdec_get_is_enabled(blob, offset)) {
-			dm_dbg("   - ignoring disabled device\n");
-			continue;
+	/* The bind table, or the live tree, avoid walking the blob */
+	node = dm_bind_table_find(blob, offset);
+	np = node ? NULL : of_live_find(blob, offset);
+	if (node) {
+		for (node = dm_bind_table_node(node->child); node;
+		     node = dm_bind_table_node(node->sibling)) {
+			err = dm_scan_bind_node(parent, blob, node,
+						pre_reloc_only);
+			if (err && !ret)
+				ret = err;
+		}
+	} else if (np) {
+		for (np = np->child; np; np = np->sibling) {
+			err = dm_scan_fdt_subnode(parent, blob, np->offset,
+						  pre_reloc_only);
+			if (err && !ret)
+				ret = err;
 		}
-		err = lists_bind_fdt(parent, blob, offset, NULL);
-		if (err && !ret) {
-			ret = err;
-			debug("%s: ret=%d\n", fdt_get_name(blob, offset, NULL),
-			      ret);
+	} else {
+		for (offset = fdt_first_subnode(blob, offset);
+		     offset > 0;
+		     offset = fdt_next_subnode(blob, offset)) {
+			err = dm_scan_fdt_subnode(parent, blob, offset,
+						  pre_reloc_only);
+			if (err && !ret)
+				ret = err;
 		}
 	}
 
@@ -245,15 +308,11 @@ __weak int dm_scan_other(bool pre_reloc_only)
 	return 0;
 }
 
-int dm_init_and_scan(bool pre_reloc_only)
+/* Bind all devices from platform data, the device tree and elsewhere */
+static int dm_scan(bool pre_reloc_only)
 {
 	int ret;
 
-	ret = dm_init();
-	if (ret) {
-		debug("dm_init() failed: %d\n", ret);
-		return ret;
-	}
 	ret = dm_scan_platdata(pre_reloc_only);
 	if (ret) {
 		debug("dm_scan_platdata() failed: %d\n", ret);
@@ -275,6 +334,36 @@ int dm_init_and_scan(bool pre_reloc_only)
 	return 0;
 }
 
+int dm_init_and_scan(bool pre_reloc_only)
+{
+	enum bootstage_id id;
+	const char *name;
+	int ret;
+
+	ret = dm_init();
+	if (ret) {
+		debug("dm_init() failed: %d\n", ret);
+		return ret;
+	}
+
+	/* Record the time taken to bind devices */
+	if (IS_ENABLED(CONFIG_SPL_BUILD)) {
+		id = BOOTSTAGE_ID_ACCUM_DM_SPL;
+		name = "dm_spl";
+	} else if (pre_reloc_only) {
+		id = BOOTSTAGE_ID_ACCUM_DM_F;
+		name = "dm_f";
+	} else {
+		id = BOOTSTAGE_ID_ACCUM_DM_R;
+		name = "dm_r";
+	}
+	bootstage_start(id, name);
+	ret = dm_scan(pre_reloc_only);
+	bootstage_accum(id);
+
+	return ret;
+}
+
 /* This is the root driver - all drivers are children of this */
 U_BOOT_DRIVER(root_driver) = {
 	.name	= "root_driver",
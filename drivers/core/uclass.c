@@ -10,12 +10,14 @@
 #include <common.h>
 #include <errno.h>
 #include <malloc.h>
+#include <slab.h>
 #include <dm/device.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
+#include <u-boot/fnv.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -38,6 +40,355 @@ struct uclass *uclass_find(enum uclass_id key)
 	return NULL;
 }
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/*
+ * Each uclass keeps hash tables of its devices, so that finding a device by
+ * name, device tree node or phandle does not have to walk the list. Each
+ * table has one bucket per device at most, and is doubled in size as
+ * devices are bound. Probed devices are also kept in a table by sequence
+ * number, which grows to fit the highest number used (up to DM_MAX_SEQ).
+ *
+ * The tables are only set up for uclasses created once the full malloc()
+ * pool is ready, since the pre-relocation pool is small and few devices
+ * are bound before relocation. Lookups in other uclasses walk the list.
+ */
+#define UCLASS_INDEX_MIN_SIZE	16
+
+static uint uclass_hash_int(uint val)
+{
+	val *= 0x9e3779b1;
+
+	return val ^ (val >> 16);
+}
+
+static int uclass_dev_phandle(struct udevice *dev)
+{
+	if (!CONFIG_IS_ENABLED(OF_CONTROL) || CONFIG_IS_ENABLED(OF_PLATDATA) ||
+	    !gd->fdt_blob || dev_of_offset(dev) < 0)
+		return 0;
+
+	return fdt_get_phandle(gd->fdt_blob, dev_of_offset(dev));
+}
+
+/* Work out the hash of a device, returning false if it is not indexed */
+static bool uclass_index_hash(struct udevice *dev, enum uclass_index_id idx,
+			      uint *hashp)
+{
+	uint phandle;
+
+	switch (idx) {
+	case UCLASS_INDEX_NAME:
+		*hashp = fnv1a_str(dev->name);
+		return true;
+	case UCLASS_INDEX_OF_OFFSET:
+		*hashp = uclass_hash_int(dev_of_offset(dev));
+		return true;
+	case UCLASS_INDEX_PHANDLE:
+		phandle = uclass_dev_phandle(dev);
+		*hashp = uclass_hash_int(phandle);
+		return phandle != 0;
+	default:
+		return false;
+	}
+}
+
+static struct udevice **uclass_index_tail(struct uclass_index *index,
+					  enum uclass_index_id idx, uint hash)
+{
+	struct udevice **link = &index->bucket[hash & index->mask];
+
+	while (*link)
+		link = &(*link)->index_next[idx];
+
+	return link;
+}
+
+/* Double the number of buckets, keeping devices with the same hash in order */
+static void uclass_index_grow(struct uclass_index *index,
+			      enum uclass_index_id idx)
+{
+	struct udevice **old = index->bucket;
+	uint old_size = index->mask + 1;
+	struct udevice *dev, *next;
+	uint i;
+
+	index->bucket = calloc(old_size * 2, sizeof(struct udevice *));
+	if (!index->bucket) {
+		/* The chains will just be longer */
+		index->bucket = old;
+		return;
+	}
+	index->mask = old_size * 2 - 1;
+	for (i = 0; i < old_size; i++) {
+		for (dev = old[i]; dev; dev = next) {
+			next = dev->index_next[idx];
+			dev->index_next[idx] = NULL;
+			*uclass_index_tail(index, idx,
+					   dev->index_hash[idx]) = dev;
+		}
+	}
+	free(old);
+}
+
+static void uclass_index_add(struct uclass_index *index,
+			     enum uclass_index_id idx, struct udevice *dev)
+{
+	uint hash;
+
+	dev->index_next[idx] = NULL;
+	if (!uclass_index_hash(dev, idx, &hash))
+		return;
+	if (index->count > index->mask)
+		uclass_index_grow(index, idx);
+	dev->index_hash[idx] = hash;
+	*uclass_index_tail(index, idx, hash) = dev;
+	index->count++;
+}
+
+static bool uclass_index_remove(struct uclass_index *index,
+				enum uclass_index_id idx, struct udevice *dev)
+{
+	struct udevice **link;
+
+	for (link = &index->bucket[dev->index_hash[idx] & index->mask]; *link;
+	     link = &(*link)->index_next[idx]) {
+		if (*link == dev) {
+			*link = dev->index_next[idx];
+			index->count--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static struct udevice *uclass_index_first(struct uclass *uc,
+					  enum uclass_index_id idx, uint hash)
+{
+	struct uclass_index *index = &uc->index[idx];
+
+	return index->bucket[hash & index->mask];
+}
+
+static bool uclass_indexed(struct uclass *uc)
+{
+	return uc->seq_size >= 0;
+}
+
+void uclass_index_device(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+	int idx;
+
+	if (!uclass_indexed(uc))
+		return;
+	for (idx = 0; idx < UCLASS_INDEX_COUNT; idx++)
+		uclass_index_add(&uc->index[idx], idx, dev);
+}
+
+bool uclass_unindex_device(struct udevice *dev)
+{
+	struct uclass *uc = dev->uclass;
+	bool found = false;
+	int idx;
+
+	if (!uc || !uclass_indexed(uc))
+		return false;
+	for (idx = 0; idx < UCLASS_INDEX_COUNT; idx++) {
+		if (uclass_index_remove(&uc->index[idx], idx, dev))
+			found = true;
+	}
+
+	return found;
+}
+
+/* Set up the indexes of a new uclass, if the full malloc() pool is ready */
+static void uclass_index_init(struct uclass *uc)
+{
+	int idx;
+
+	uc->seq_size = -1;
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return;
+	for (idx = 0; idx < UCLASS_INDEX_COUNT; idx++) {
+		uc->index[idx].bucket = calloc(UCLASS_INDEX_MIN_SIZE,
+					       sizeof(struct udevice *));
+		if (!uc->index[idx].bucket)
+			goto err;
+		uc->index[idx].mask = UCLASS_INDEX_MIN_SIZE - 1;
+	}
+	uc->seq_size = 0;
+
+	return;
+err:
+	while (idx--)
+		free(uc->index[idx].bucket);
+}
+
+static void uclass_index_destroy(struct uclass *uc)
+{
+	int idx;
+
+	if (!uclass_indexed(uc))
+		return;
+	for (idx = 0; idx < UCLASS_INDEX_COUNT; idx++)
+		free(uc->index[idx].bucket);
+	free(uc->seq_dev);
+}
+
+/* Make room in the table by sequence number, returning false on failure */
+static bool uclass_seq_grow(struct uclass *uc, int seq)
+{
+	struct udevice **seq_dev;
+	int size;
+
+	for (size = UCLASS_INDEX_MIN_SIZE; size <= seq; size <<= 1)
+		;
+	size = min(size, DM_MAX_SEQ + 1);
+	seq_dev = realloc(uc->seq_dev, size * sizeof(struct udevice *));
+	if (!seq_dev)
+		return false;
+	memset(seq_dev + uc->seq_size, '\0',
+	       (size - uc->seq_size) * sizeof(struct udevice *));
+	uc->seq_dev = seq_dev;
+	uc->seq_size = size;
+
+	return true;
+}
+
+int uclass_get_index_stats(struct uclass *uc, struct uclass_index_stats *stats)
+{
+	struct udevice *dev;
+	uint i, len;
+	int idx;
+
+	if (!uclass_indexed(uc))
+		return -ENOENT;
+	memset(stats, '\0', sizeof(*stats));
+	for (idx = 0; idx < UCLASS_INDEX_COUNT; idx++) {
+		struct uclass_index *index = &uc->index[idx];
+
+		stats->count[idx] = index->count;
+		stats->buckets[idx] = index->mask + 1;
+		for (i = 0; i <= index->mask; i++) {
+			len = 0;
+			for (dev = index->bucket[i]; dev;
+			     dev = dev->index_next[idx])
+				len++;
+			stats->longest[idx] = max(stats->longest[idx], len);
+		}
+	}
+	stats->seq_size = uc->seq_size;
+	stats->lookups = uc->lookups;
+	stats->walks = uc->walks;
+
+	return 0;
+}
+
+/**
+ * uclass_index_find() - Find the first device with a key, using an index
+ *
+ * @uc:		uclass to search
+ * @idx:	Index to use
+ * @name:	Name to find, for UCLASS_INDEX_NAME
+ * @val:	Device tree offset or phandle to find, for the other indexes
+ * @devp:	Returns the device found
+ * @return 0 if found, -ENODEV if there is no such device, -ENOSYS if the
+ * index cannot be used so the list must be walked
+ */
+static int uclass_index_find(struct uclass *uc, enum uclass_index_id idx,
+			     const char *name, int val, struct udevice **devp)
+{
+	struct udevice *dev;
+	uint hash;
+
+	if (!uclass_indexed(uc)) {
+		uc->walks++;
+		return -ENOSYS;
+	}
+	hash = idx == UCLASS_INDEX_NAME ? fnv1a_str(name) :
+		uclass_hash_int(val);
+	for (dev = uclass_index_first(uc, idx, hash); dev;
+	     dev = dev->index_next[idx]) {
+		if (dev->index_hash[idx] != hash)
+			continue;
+		if (idx == UCLASS_INDEX_NAME ? !strcmp(dev->name, name) :
+		    idx == UCLASS_INDEX_OF_OFFSET ? dev_of_offset(dev) == val :
+		    uclass_dev_phandle(dev) == val) {
+			uc->lookups++;
+			*devp = dev;
+			return 0;
+		}
+	}
+
+	/* A name which is not found may still be the start of one */
+	if (idx == UCLASS_INDEX_NAME) {
+		uc->walks++;
+		return -ENOSYS;
+	}
+	uc->lookups++;
+
+	return -ENODEV;
+}
+
+/* As uclass_index_find(), but for a sequence number of a probed device */
+static int uclass_index_find_seq(struct uclass *uc, int seq,
+				 struct udevice **devp)
+{
+	if (seq < 0 || seq >= uc->seq_size) {
+		uc->walks++;
+		return -ENOSYS;
+	}
+	uc->lookups++;
+	*devp = uc->seq_dev[seq];
+
+	return *devp ? 0 : -ENODEV;
+}
+
+void uclass_set_seq(struct udevice *dev, int seq)
+{
+	struct uclass *uc = dev->uclass;
+
+	if (dev->seq >= 0 && dev->seq < uc->seq_size &&
+	    uc->seq_dev[dev->seq] == dev)
+		uc->seq_dev[dev->seq] = NULL;
+	dev->seq = seq;
+
+	/* Devices which do not fit in the table are found by walking */
+	if (seq < 0 || !uclass_indexed(uc) || seq > DM_MAX_SEQ)
+		return;
+	if (seq >= uc->seq_size && !uclass_seq_grow(uc, seq))
+		return;
+	uc->seq_dev[seq] = dev;
+}
+#else
+static inline bool uclass_indexed(struct uclass *uc)
+{
+	return false;
+}
+
+static inline void uclass_index_init(struct uclass *uc) {}
+static inline void uclass_index_destroy(struct uclass *uc) {}
+
+static inline int uclass_index_find(struct uclass *uc,
+				    enum uclass_index_id idx, const char *name,
+				    int val, struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+static inline int uclass_index_find_seq(struct uclass *uc, int seq,
+					struct udevice **devp)
+{
+	return -ENOSYS;
+}
+
+void uclass_set_seq(struct udevice *dev, int seq)
+{
+	dev->seq = seq;
+}
+#endif
+
 /**
  * uclass_add() - Create new uclass in list
  * @id: Id number to create
@@ -65,11 +416,11 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 		 */
 		return -EPFNOSUPPORT;
 	}
-	uc = calloc(1, sizeof(*uc));
+	uc = slab_zalloc(sizeof(*uc));
 	if (!uc)
 		return -ENOMEM;
 	if (uc_drv->priv_auto_alloc_size) {
-		uc->priv = calloc(1, uc_drv->priv_auto_alloc_size);
+		uc->priv = slab_zalloc(uc_drv->priv_auto_alloc_size);
 		if (!uc->priv) {
 			ret = -ENOMEM;
 			goto fail_mem;
@@ -78,6 +429,7 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	uc->uc_drv = uc_drv;
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
+	uclass_index_init(uc);
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
 
 	if (uc_drv->init) {
@@ -91,12 +443,13 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	return 0;
 fail:
 	if (uc_drv->priv_auto_alloc_size) {
-		free(uc->priv);
+		slab_free(uc->priv);
 		uc->priv = NULL;
 	}
 	list_del(&uc->sibling_node);
+	uclass_index_destroy(uc);
 fail_mem:
-	free(uc);
+	slab_free(uc);
 
 	return ret;
 }
@@ -129,8 +482,9 @@ int uclass_destroy(struct uclass *uc)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
-		free(uc->priv);
-	free(uc);
+		slab_free(uc->priv);
+	uclass_index_destroy(uc);
+	slab_free(uc);
 
 	return 0;
 }
@@ -157,6 +511,20 @@ const char *uclass_get_name(enum uclass_id id)
 	return uc->uc_drv->name;
 }
 
+enum uclass_id uclass_get_by_name(const char *name)
+{
+	int i;
+
+	for (i = 0; i < UCLASS_COUNT; i++) {
+		struct uclass_driver *uc_drv = lists_uclass_lookup(i);
+
+		if (uc_drv && !strcmp(uc_drv->name, name))
+			return i;
+	}
+
+	return UCLASS_INVALID;
+}
+
 int uclass_find_device(enum uclass_id id, int index, struct udevice **devp)
 {
 	struct uclass *uc;
@@ -224,14 +592,20 @@ int uclass_find_device_by_name(enum uclass_id id, const char *name,
 	if (ret)
 		return ret;
 
+	/* The index finds an exact match; otherwise look for the start */
+	ret = uclass_index_find(uc, UCLASS_INDEX_NAME, name, 0, devp);
+	if (ret != -ENOSYS)
+		return ret;
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
-		if (!strncmp(dev->name, name, strlen(name))) {
+		if (!strcmp(dev->name, name)) {
 			*devp = dev;
 			return 0;
 		}
+		if (!*devp && !strncmp(dev->name, name, strlen(name)))
+			*devp = dev;
 	}
 
-	return -ENODEV;
+	return *devp ? 0 : -ENODEV;
 }
 
 int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
@@ -249,6 +623,14 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+	/* Requested sequence numbers are set by drivers, so are not indexed */
+	if (!find_req_seq) {
+		ret = uclass_index_find_seq(uc, seq_or_req_seq, devp);
+		if (ret != -ENOSYS) {
+			debug("   - %s\n", ret ? "not found" : "found");
+			return ret;
+		}
+	}
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		debug("   - %d %d\n", dev->req_seq, dev->seq);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
@@ -277,6 +659,9 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find(uc, UCLASS_INDEX_OF_OFFSET, NULL, node, devp);
+	if (ret != -ENOSYS)
+		return ret;
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		if (dev_of_offset(dev) == node) {
 			*devp = dev;
@@ -307,6 +692,10 @@ static int uclass_find_device_by_phandle(enum uclass_id id,
 	if (ret)
 		return ret;
 
+	ret = uclass_index_find(uc, UCLASS_INDEX_PHANDLE, NULL, find_phandle,
+				devp);
+	if (ret != -ENOSYS)
+		return ret;
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		uint phandle;
 
@@ -464,6 +853,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_index_device(dev);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -478,6 +868,7 @@ int uclass_bind_device(struct udevice *dev)
 	return 0;
 err:
 	/* There is no need to undo the parent's post_bind call */
+	uclass_unindex_device(dev);
 	list_del(&dev->uclass_node);
 
 	return ret;
@@ -496,6 +887,7 @@ int uclass_unbind_device(struct udevice *dev)
 			return ret;
 	}
 
+	uclass_unindex_device(dev);
 	list_del(&dev->uclass_node);
 	return 0;
 }
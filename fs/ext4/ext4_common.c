@@ -2200,7 +2200,7 @@ static int ext4fs_find_file1(const char *currpath,
 		oldnode = currnode;
 
 		/* Iterate over the directory. */
-		found = ext4fs_iterate_dir(currnode, name, &currnode, &type);
+		found = ext4fs_dir_lookup(currnode, name, &currnode, &type);
 		if (found == 0)
 			return 0;
 
@@ -2332,6 +2332,8 @@ int ext4fs_mount(unsigned part_length)
 		goto fail;
 
 
+	ext4fs_dcache_check(&data->sblock);
+
 	if (le32_to_cpu(data->sblock.revision_level) == 0) {
 		fs->inodesz = 128;
 		fs->gdsize = 32;
@@ -0,0 +1,586 @@
+/*
+ * Directory lookups for ext4: dentry cache and hash tree (dir_index) support
+ *
+ * Looking up a path component used to mean reading every entry of the
+ * directory, two ext4fs_read_file() calls per entry. Here a directory is
+ * read a block at a time, directories with a hash tree index only have the
+ * index blocks and one leaf block read, and the results are remembered in a
+ * dentry cache which persists as long as the same filesystem is mounted.
+ *
+ * The hash functions are taken from Linux fs/ext4/hash.c:
+ * Copyright (C) 2002 by Theodore Ts'o
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <ext4fs.h>
+#include <memalign.h>
+#include <linux/list.h>
+#include "ext4_common.h"
+
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+
+#define DX_HASH_LEGACY			0
+#define DX_HASH_HALF_MD4		1
+#define DX_HASH_TEA			2
+#define DX_HASH_LEGACY_UNSIGNED		3
+#define DX_HASH_HALF_MD4_UNSIGNED	4
+#define DX_HASH_TEA_UNSIGNED		5
+
+#define EXT4_HTREE_EOF_32BIT		0x7fffffff
+#define EXT4_HTREE_MAX_LEVELS		3
+
+/* Offset of struct dx_root_info in the first block of an indexed directory */
+#define DX_ROOT_INFO_OFFSET		24
+
+struct dx_root_info {
+	__le32 reserved_zero;
+	__u8 hash_version;
+	__u8 info_length;
+	__u8 indirect_levels;
+	__u8 unused_flags;
+};
+
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+/* Overlays the hash of the first struct dx_entry in each index block */
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+#define EXT4_DCACHE_HASH_SIZE		64
+#define EXT4_DCACHE_MAX_ENTRIES		128
+
+struct ext4_dcache_entry {
+	struct list_head lru;		/* LRU list, most recently used first */
+	struct hlist_node hash;		/* hash bucket chain */
+	int dir_ino;
+	int ino;
+	int type;
+	struct ext2_inode inode;
+	char name[];
+};
+
+static LIST_HEAD(dcache_lru);
+static struct hlist_head dcache_hash[EXT4_DCACHE_HASH_SIZE];
+static int dcache_entries;
+static struct blk_desc *dcache_dev;
+static lbaint_t dcache_part_start;
+static ulong dcache_change_seq;
+static struct ext2_sblock dcache_sblock;
+static struct ext4_dir_stats dir_stats;
+
+#define DELTA 0x9E3779B9
+
+static void tea_transform(__u32 buf[4], __u32 const in[])
+{
+	__u32 sum = 0;
+	__u32 b0 = buf[0], b1 = buf[1];
+	__u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+/* F, G and H are basic MD4 functions: selection, majority, parity */
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) (((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+
+#define MD4_ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + x, a = (a << s) | (a >> (32 - s)))
+#define K1 0
+#define K2 013240474631UL
+#define K3 015666365641UL
+
+static void half_md4_transform(__u32 buf[4], __u32 const in[8])
+{
+	__u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	MD4_ROUND(F, a, b, c, d, in[0] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[1] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[2] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[3] + K1, 19);
+	MD4_ROUND(F, a, b, c, d, in[4] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[5] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[6] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	/* Round 2 */
+	MD4_ROUND(G, a, b, c, d, in[1] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[3] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[5] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[7] + K2, 13);
+	MD4_ROUND(G, a, b, c, d, in[0] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[2] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[4] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	/* Round 3 */
+	MD4_ROUND(H, a, b, c, d, in[3] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[7] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[2] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[6] + K3, 15);
+	MD4_ROUND(H, a, b, c, d, in[1] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[5] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[0] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+/* The old legacy hash */
+static __u32 dx_hack_hash(const char *name, int len, bool is_unsigned)
+{
+	__u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+	int c;
+
+	while (len--) {
+		if (is_unsigned)
+			c = (unsigned char)*name++;
+		else
+			c = (signed char)*name++;
+		hash = hash1 + (hash0 ^ (c * 7152373));
+
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+	}
+
+	return hash0 << 1;
+}
+
+static void str2hashbuf(const char *msg, int len, __u32 *buf, int num,
+			bool is_unsigned)
+{
+	__u32 pad, val;
+	int i, c;
+
+	pad = (__u32)len | ((__u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		if (is_unsigned)
+			c = (unsigned char)msg[i];
+		else
+			c = (signed char)msg[i];
+		val = c + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+/*
+ * Compute the directory index hash of a name, as ext4fs_dirhash() in Linux.
+ * Return 0 if OK, -EINVAL if the hash version is not known.
+ */
+static int ext4fs_dx_hash(const char *name, int len, int version,
+			  const __le32 *seed, __u32 *hashp)
+{
+	bool is_unsigned = version >= DX_HASH_LEGACY_UNSIGNED;
+	__u32 buf[4], in[8];
+	__u32 hash;
+	int i;
+
+	/* Initialize the default seed for the hash checksum functions */
+	buf[0] = 0x67452301;
+	buf[1] = 0xefcdab89;
+	buf[2] = 0x98badcfe;
+	buf[3] = 0x10325476;
+
+	/* Use the filesystem seed unless it is all zeroes */
+	for (i = 0; i < 4; i++) {
+		if (seed[i]) {
+			for (i = 0; i < 4; i++)
+				buf[i] = le32_to_cpu(seed[i]);
+			break;
+		}
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY:
+	case DX_HASH_LEGACY_UNSIGNED:
+		hash = dx_hack_hash(name, len, is_unsigned);
+		break;
+	case DX_HASH_HALF_MD4:
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		for (; len > 0; len -= 32, name += 32) {
+			str2hashbuf(name, len, in, 8, is_unsigned);
+			half_md4_transform(buf, in);
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA:
+	case DX_HASH_TEA_UNSIGNED:
+		for (; len > 0; len -= 16, name += 16) {
+			str2hashbuf(name, len, in, 4, is_unsigned);
+			tea_transform(buf, in);
+		}
+		hash = buf[0];
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	hash &= ~1;
+	if (hash == (EXT4_HTREE_EOF_32BIT << 1))
+		hash = (EXT4_HTREE_EOF_32BIT - 1) << 1;
+	*hashp = hash;
+
+	return 0;
+}
+
+static struct hlist_head *ext4fs_dcache_bucket(int dir_ino, const char *name)
+{
+	__u32 hash = dir_ino;
+
+	while (*name)
+		hash = hash * 31 + (unsigned char)*name++;
+
+	return &dcache_hash[hash % EXT4_DCACHE_HASH_SIZE];
+}
+
+void ext4fs_dcache_invalidate(void)
+{
+	struct ext4_dcache_entry *entry, *n;
+
+	list_for_each_entry_safe(entry, n, &dcache_lru, lru) {
+		list_del(&entry->lru);
+		hlist_del(&entry->hash);
+		free(entry);
+	}
+	dcache_entries = 0;
+}
+
+/*
+ * Keep the cache only if the same partition of the same device is mounted
+ * again, with the same superblock, and nothing has been written to the
+ * device since. Two partitions can hold identical superblocks, e.g. A/B
+ * copies of a root filesystem.
+ */
+void ext4fs_dcache_check(const struct ext2_sblock *sblock)
+{
+	struct blk_desc *dev = get_fs()->dev_desc;
+
+	if (dcache_dev != dev || dcache_part_start != part_offset ||
+	    dcache_change_seq != dev->change_seq ||
+	    memcmp(&dcache_sblock, sblock, sizeof(dcache_sblock))) {
+		ext4fs_dcache_invalidate();
+		dcache_dev = dev;
+		dcache_part_start = part_offset;
+		dcache_change_seq = dev->change_seq;
+		memcpy(&dcache_sblock, sblock, sizeof(dcache_sblock));
+	}
+}
+
+static struct ext4_dcache_entry *ext4fs_dcache_find(int dir_ino,
+						    const char *name)
+{
+	struct ext4_dcache_entry *entry;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry(entry, pos, ext4fs_dcache_bucket(dir_ino, name),
+			     hash) {
+		if (entry->dir_ino == dir_ino && !strcmp(entry->name, name)) {
+			list_del(&entry->lru);
+			list_add(&entry->lru, &dcache_lru);
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+static void ext4fs_dcache_add(int dir_ino, const char *name,
+			      struct ext2fs_node *node, int type)
+{
+	struct ext4_dcache_entry *entry;
+
+	if (dcache_entries >= EXT4_DCACHE_MAX_ENTRIES) {
+		entry = list_entry(dcache_lru.prev, struct ext4_dcache_entry,
+				   lru);
+		list_del(&entry->lru);
+		hlist_del(&entry->hash);
+		free(entry);
+		dcache_entries--;
+	}
+
+	entry = malloc(sizeof(*entry) + strlen(name) + 1);
+	if (!entry)
+		return;
+	entry->dir_ino = dir_ino;
+	entry->ino = node->ino;
+	entry->type = type;
+	entry->inode = node->inode;
+	strcpy(entry->name, name);
+	list_add(&entry->lru, &dcache_lru);
+	hlist_add_head(&entry->hash, ext4fs_dcache_bucket(dir_ino, name));
+	dcache_entries++;
+}
+
+/* Read logical block @blk of directory @dir */
+static int ext4fs_dir_read_block(struct ext2fs_node *dir, __u32 blk,
+				 char *buf, int blksz)
+{
+	loff_t actread;
+
+	dir_stats.blocks++;
+	dir_stats.last_blocks++;
+	if (ext4fs_read_file(dir, (loff_t)blk * blksz, blksz, buf,
+			     &actread) < 0 || actread != blksz)
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * Look for @name in a block of directory entries.
+ * Return 1 and set @inop if found, 0 if not, -EINVAL if the block is corrupt.
+ */
+static int ext4fs_dir_block_find(const char *buf, int blksz, const char *name,
+				 int *inop)
+{
+	int namelen = strlen(name);
+	struct ext2_dirent *dirent;
+	int off, len;
+
+	for (off = 0; off + sizeof(struct ext2_dirent) <= blksz; off += len) {
+		dirent = (struct ext2_dirent *)(buf + off);
+		len = le16_to_cpu(dirent->direntlen);
+		if (len < sizeof(struct ext2_dirent) || off + len > blksz)
+			return -EINVAL;
+
+		if (dirent->inode && dirent->namelen == namelen &&
+		    !memcmp(dirent + 1, name, namelen)) {
+			*inop = le32_to_cpu(dirent->inode);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Look for @name by reading every block of the directory */
+static int ext4fs_dir_scan(struct ext2fs_node *dir, const char *name,
+			   int *inop)
+{
+	int blksz = EXT2_BLOCK_SIZE(dir->data);
+	__u32 blk, nblocks;
+	char *buf;
+	int ret = 0;
+
+	buf = malloc(blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	nblocks = DIV_ROUND_UP(le32_to_cpu(dir->inode.size), blksz);
+	for (blk = 0; blk < nblocks && !ret; blk++) {
+		ret = ext4fs_dir_read_block(dir, blk, buf, blksz);
+		if (!ret)
+			ret = ext4fs_dir_block_find(buf, blksz, name, inop);
+	}
+	free(buf);
+
+	return ret;
+}
+
+/*
+ * Look for @name using the hash tree index of the directory.
+ * Return 1 if found, 0 if not, -ve value if the index cannot be used.
+ */
+static int ext4fs_dir_htree(struct ext2fs_node *dir, const char *name,
+			    int *inop)
+{
+	struct ext2_sblock *sblock = &dir->data->sblock;
+	int blksz = EXT2_BLOCK_SIZE(dir->data);
+	struct dx_root_info *info;
+	struct dx_countlimit *cl;
+	struct dx_entry *entries;
+	char *node, *leaf;
+	int count, levels, version, i;
+	__u32 hash;
+	int ret;
+
+	node = malloc(blksz);
+	leaf = malloc(blksz);
+	if (!node || !leaf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = ext4fs_dir_read_block(dir, 0, node, blksz);
+	if (ret)
+		goto out;
+
+	ret = -EAGAIN;
+	info = (struct dx_root_info *)(node + DX_ROOT_INFO_OFFSET);
+	levels = info->indirect_levels;
+	version = info->hash_version;
+	if (info->reserved_zero || info->info_length != sizeof(*info) ||
+	    levels >= EXT4_HTREE_MAX_LEVELS)
+		goto out;
+	if (version <= DX_HASH_TEA &&
+	    (le32_to_cpu(sblock->flags) & EXT2_FLAGS_UNSIGNED_HASH))
+		version += DX_HASH_LEGACY_UNSIGNED;
+	if (ext4fs_dx_hash(name, strlen(name), version, sblock->hash_seed,
+			   &hash))
+		goto out;
+
+	entries = (struct dx_entry *)((char *)info + info->info_length);
+	for (;;) {
+		cl = (struct dx_countlimit *)entries;
+		count = le16_to_cpu(cl->count);
+		if (!count || count > le16_to_cpu(cl->limit) ||
+		    (char *)(entries + count) > node + blksz)
+			goto out;
+
+		/* Find the last entry whose hash is not above ours */
+		for (i = 1; i < count && le32_to_cpu(entries[i].hash) <= hash;
+		     i++)
+			;
+		i--;
+		if (!levels--)
+			break;
+
+		ret = ext4fs_dir_read_block(dir,
+				le32_to_cpu(entries[i].block) & 0x0fffffff,
+				node, blksz);
+		if (ret)
+			goto out;
+		ret = -EAGAIN;
+		entries = (struct dx_entry *)(node + sizeof(struct ext2_dirent));
+	}
+
+	/* Names with the same hash may continue into the next leaves */
+	for (;;) {
+		ret = ext4fs_dir_read_block(dir,
+				le32_to_cpu(entries[i].block) & 0x0fffffff,
+				leaf, blksz);
+		if (!ret)
+			ret = ext4fs_dir_block_find(leaf, blksz, name, inop);
+		if (ret)
+			break;
+		if (++i == count) {
+			/* The next leaf is under another index block */
+			ret = -EAGAIN;
+			break;
+		}
+		if ((le32_to_cpu(entries[i].hash) & ~1) != hash)
+			break;
+	}
+
+out:
+	free(leaf);
+	free(node);
+
+	return ret;
+}
+
+int ext4fs_dir_lookup(struct ext2fs_node *dir, char *name,
+		      struct ext2fs_node **fnode, int *ftype)
+{
+	struct ext4_dcache_entry *entry;
+	struct ext2fs_node *node;
+	int ino = 0;
+	int type;
+	int ret;
+
+	if (!dir->inode_read) {
+		if (!ext4fs_read_inode(dir->data, dir->ino, &dir->inode))
+			return 0;
+		dir->inode_read = 1;
+	}
+
+	node = zalloc(sizeof(struct ext2fs_node));
+	if (!node)
+		return 0;
+	node->data = dir->data;
+
+	dir_stats.lookups++;
+	dir_stats.last_blocks = 0;
+	entry = ext4fs_dcache_find(dir->ino, name);
+	if (entry) {
+		dir_stats.hits++;
+		node->ino = entry->ino;
+		node->inode = entry->inode;
+		node->inode_read = 1;
+		*fnode = node;
+		*ftype = entry->type;
+		return 1;
+	}
+
+	/* '.' and '..' are only in the first block, outside the index */
+	ret = -EAGAIN;
+	if ((le32_to_cpu(dir->inode.flags) & EXT4_INDEX_FL) &&
+	    (le32_to_cpu(dir->data->sblock.feature_compatibility) &
+	     EXT4_FEATURE_COMPAT_DIR_INDEX) &&
+	    strcmp(name, ".") && strcmp(name, "..")) {
+		ret = ext4fs_dir_htree(dir, name, &ino);
+		if (ret >= 0)
+			dir_stats.htree++;
+	}
+	if (ret < 0)
+		ret = ext4fs_dir_scan(dir, name, &ino);
+	debug("ext4 lookup %s: %d, %u directory blocks\n", name, ret,
+	      dir_stats.last_blocks);
+	if (ret != 1 || !ext4fs_read_inode(dir->data, ino, &node->inode)) {
+		free(node);
+		return 0;
+	}
+	node->ino = ino;
+	node->inode_read = 1;
+
+	switch (le16_to_cpu(node->inode.mode) & FILETYPE_INO_MASK) {
+	case FILETYPE_INO_DIRECTORY:
+		type = FILETYPE_DIRECTORY;
+		break;
+	case FILETYPE_INO_SYMLINK:
+		type = FILETYPE_SYMLINK;
+		break;
+	case FILETYPE_INO_REG:
+		type = FILETYPE_REG;
+		break;
+	default:
+		type = FILETYPE_UNKNOWN;
+		break;
+	}
+	ext4fs_dcache_add(dir->ino, name, node, type);
+
+	*fnode = node;
+	*ftype = type;
+
+	return 1;
+}
+
+void ext4fs_dir_stats(struct ext4_dir_stats *stats)
+{
+	*stats = dir_stats;
+}
@@ -978,6 +978,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	}
 	ext4fs_update();
 	ext4fs_deinit();
+	ext4fs_dcache_invalidate();
 
 	fs->first_pass_bbmap = 0;
 	fs->curr_blkno = 0;
@@ -991,6 +992,7 @@ int ext4fs_write(const char *fname, unsigned char *buffer,
 	return 0;
 fail:
 	ext4fs_deinit();
+	ext4fs_dcache_invalidate();
 	free(inode_buffer);
 	free(g_parent_inode);
 	free(temp_ptr);
@@ -41,6 +41,176 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/* Extents longer than this are unwritten and read back as zeroes */
+#define EXT4_EXT_INIT_MAX_LEN	(1 << 15)
+
+/* Deepest extent tree we are prepared to walk */
+#define EXT4_EXT_MAX_DEPTH	5
+
+/* Largest single read, which must fit in the int length of ext4fs_devread() */
+#define EXT4_EXT_READ_MAX	(1 << 30)
+
+/**
+ * struct ext4fs_extent_read - state for reading a file by extents
+ *
+ * @pos:	File offset of the start of @buf
+ * @end:	File offset of the end of the read
+ * @done:	File offset up to which @buf has been filled
+ * @buf:	Destination buffer
+ */
+struct ext4fs_extent_read {
+	loff_t pos;
+	loff_t end;
+	loff_t done;
+	char *buf;
+};
+
+/* Copy the part of a leaf extent which lies in the read into the buffer */
+static int ext4fs_read_extent(struct ext4fs_extent_read *rd,
+			      struct ext4_extent *extent)
+{
+	int log2_blocksize = LOG2_BLOCK_SIZE(ext4fs_root);
+	int log2blksz = get_fs()->dev_desc->log2blksz;
+	int log2_fs_blocksize = log2_blocksize - log2blksz;
+	unsigned int len = le16_to_cpu(extent->ee_len);
+	bool unwritten = false;
+	loff_t start, from, to, pos, off, count;
+	uint64_t blknr;
+
+	if (len > EXT4_EXT_INIT_MAX_LEN) {
+		len -= EXT4_EXT_INIT_MAX_LEN;
+		unwritten = true;
+	}
+
+	start = (loff_t)le32_to_cpu(extent->ee_block) << log2_blocksize;
+	from = max(start, rd->done);
+	to = min(start + ((loff_t)len << log2_blocksize), rd->end);
+	if (from >= to)
+		return 0;
+
+	/* Sparse file: fill the hole before this extent */
+	if (from > rd->done)
+		memset(rd->buf + (rd->done - rd->pos), 0, from - rd->done);
+
+	if (unwritten) {
+		memset(rd->buf + (from - rd->pos), 0, to - from);
+	} else {
+		blknr = le16_to_cpu(extent->ee_start_hi);
+		blknr = (blknr << 32) + le32_to_cpu(extent->ee_start_lo);
+		/*
+		 * An extent can span more than 2GiB with large blocks, so
+		 * give ext4fs_devread() the sector and split long reads
+		 */
+		for (pos = from; pos < to; pos += count) {
+			off = pos - start;
+			count = min(to - pos, (loff_t)EXT4_EXT_READ_MAX);
+			if (!ext4fs_devread(((lbaint_t)blknr <<
+					     log2_fs_blocksize) +
+					    (lbaint_t)(off >> log2blksz),
+					    off & ((1 << log2blksz) - 1), count,
+					    rd->buf + (pos - rd->pos)))
+				return -EIO;
+		}
+	}
+	rd->done = to;
+
+	return 0;
+}
+
+/*
+ * Walk the extent tree below @ext_block, reading each leaf extent which
+ * overlaps the read. Index entries for subtrees lying wholly outside the
+ * read are skipped without reading them.
+ */
+static int ext4fs_read_extent_tree(struct ext4fs_extent_read *rd,
+				   struct ext4_extent_header *ext_block,
+				   int level)
+{
+	int log2_blocksize = LOG2_BLOCK_SIZE(ext4fs_root);
+	int log2_fs_blocksize = log2_blocksize - get_fs()->dev_desc->log2blksz;
+	int entries = le16_to_cpu(ext_block->eh_entries);
+	struct ext4_extent_idx *index;
+	struct ext4_extent *extent;
+	uint64_t block;
+	char *buf;
+	int i, ret = 0;
+
+	if (le16_to_cpu(ext_block->eh_magic) != EXT4_EXT_MAGIC ||
+	    level > EXT4_EXT_MAX_DEPTH)
+		return -EINVAL;
+
+	if (!ext_block->eh_depth) {
+		extent = (struct ext4_extent *)(ext_block + 1);
+		for (i = 0; i < entries && !ret; i++) {
+			if (((loff_t)le32_to_cpu(extent[i].ee_block) <<
+			     log2_blocksize) >= rd->end)
+				break;
+			ret = ext4fs_read_extent(rd, &extent[i]);
+		}
+		return ret;
+	}
+
+	buf = malloc(EXT2_BLOCK_SIZE(ext4fs_root));
+	if (!buf)
+		return -ENOMEM;
+
+	index = (struct ext4_extent_idx *)(ext_block + 1);
+	for (i = 0; i < entries && !ret; i++) {
+		if (((loff_t)le32_to_cpu(index[i].ei_block) <<
+		     log2_blocksize) >= rd->end)
+			break;
+		if (i + 1 < entries &&
+		    ((loff_t)le32_to_cpu(index[i + 1].ei_block) <<
+		     log2_blocksize) <= rd->done)
+			continue;
+
+		block = le16_to_cpu(index[i].ei_leaf_hi);
+		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)block << log2_fs_blocksize, 0,
+				    EXT2_BLOCK_SIZE(ext4fs_root), buf)) {
+			ret = -EIO;
+			break;
+		}
+		ret = ext4fs_read_extent_tree(rd,
+				(struct ext4_extent_header *)buf, level + 1);
+	}
+	free(buf);
+
+	return ret;
+}
+
+/*
+ * Read a file which uses extents. The extent tree is walked once and each
+ * physically contiguous extent is read with a single ext4fs_devread()
+ * straight into the destination buffer.
+ */
+static int ext4fs_read_file_extents(struct ext2fs_node *node, loff_t pos,
+				    loff_t len, char *buf, loff_t *actread)
+{
+	struct ext4fs_extent_read rd;
+	int ret;
+
+	rd.pos = pos;
+	rd.end = pos + len;
+	rd.done = pos;
+	rd.buf = buf;
+
+	ret = ext4fs_read_extent_tree(&rd, (struct ext4_extent_header *)
+				      node->inode.b.blocks.dir_blocks, 0);
+	if (ret) {
+		if (ret == -EINVAL)
+			printf("invalid extent block\n");
+		return -1;
+	}
+
+	/* Sparse file: fill any hole at the end */
+	if (rd.done < rd.end)
+		memset(buf + (rd.done - pos), 0, rd.end - rd.done);
+
+	*actread = len;
+	return 0;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -68,6 +238,9 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	if (len + pos > filesize)
 		len = (filesize - pos);
 
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL)
+		return ext4fs_read_file_extents(node, pos, len, buf, actread);
+
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
@@ -41,6 +41,9 @@ static void downcase(char *str)
 static struct blk_desc *cur_dev;
 static disk_partition_t cur_part_info;
 
+static void fat_volume_invalidate(void);
+static void fat_volume_check(const void *bootsect);
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -70,22 +73,26 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 	/* Make sure it has a valid FAT header */
 	if (disk_read(0, 1, buffer) != 1) {
 		cur_dev = NULL;
+		fat_volume_invalidate();
 		return -1;
 	}
 
 	/* Check if it's actually a DOS volume */
 	if (memcmp(buffer + DOS_BOOT_MAGIC_OFFSET, "\x55\xAA", 2)) {
 		cur_dev = NULL;
+		fat_volume_invalidate();
 		return -1;
 	}
 
 	/* Check for FAT12/FAT16/FAT32 filesystem */
-	if (!memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3))
-		return 0;
-	if (!memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5))
+	if (!memcmp(buffer + DOS_FS_TYPE_OFFSET, "FAT", 3) ||
+	    !memcmp(buffer + DOS_FS32_TYPE_OFFSET, "FAT32", 5)) {
+		fat_volume_check(buffer);
 		return 0;
+	}
 
 	cur_dev = NULL;
+	fat_volume_invalidate();
 	return -1;
 }
 
@@ -319,6 +326,109 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/*
+ * Cluster chains are decoded into runs of physically contiguous clusters so
+ * that each run can be read with a single disk_read(). The chains of
+ * recently read files are kept until the volume is changed or written.
+ */
+#define FAT_CHAIN_CACHE_SIZE	4
+
+struct fat_run {
+	__u32 clust;		/* First cluster of the run */
+	__u32 count;		/* Number of clusters in the run */
+};
+
+struct fat_chain {
+	__u32 start;		/* First cluster of the chain, 0 if unused */
+	__u32 nclust;		/* Number of clusters decoded */
+	int nruns;
+	int maxruns;
+	struct fat_run *runs;
+};
+
+static struct fat_chain fat_chain_cache[FAT_CHAIN_CACHE_SIZE];
+static int fat_chain_victim;
+
+static void fat_chain_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < FAT_CHAIN_CACHE_SIZE; i++) {
+		free(fat_chain_cache[i].runs);
+		memset(&fat_chain_cache[i], '\0', sizeof(struct fat_chain));
+	}
+}
+
+/*
+ * Get the run list for the first 'nclust' clusters of the chain starting at
+ * 'start'. The list is shorter if the chain ends early.
+ * Return NULL if out of memory.
+ */
+static struct fat_chain *get_chain(fsdata *mydata, __u32 start, __u32 nclust)
+{
+	struct fat_chain *chain = NULL;
+	struct fat_run *run;
+	__u32 clust = start;
+	int i;
+
+	for (i = 0; i < FAT_CHAIN_CACHE_SIZE; i++) {
+		if (fat_chain_cache[i].start != start)
+			continue;
+		if (fat_chain_cache[i].nclust >= nclust)
+			return &fat_chain_cache[i];
+		chain = &fat_chain_cache[i];
+	}
+
+	if (!chain) {
+		chain = &fat_chain_cache[fat_chain_victim];
+		fat_chain_victim = (fat_chain_victim + 1) %
+				   FAT_CHAIN_CACHE_SIZE;
+	}
+	chain->start = 0;
+	chain->nclust = 0;
+	chain->nruns = 0;
+
+	while (chain->nclust < nclust) {
+		run = chain->nruns ? &chain->runs[chain->nruns - 1] : NULL;
+		if (run && run->clust + run->count == clust) {
+			run->count++;
+		} else {
+			if (chain->nruns == chain->maxruns) {
+				int maxruns = chain->maxruns ?
+					      chain->maxruns * 2 : 16;
+
+				run = realloc(chain->runs,
+					      maxruns * sizeof(*run));
+				if (!run) {
+					free(chain->runs);
+					chain->runs = NULL;
+					chain->maxruns = 0;
+					return NULL;
+				}
+				chain->runs = run;
+				chain->maxruns = maxruns;
+			}
+			run = &chain->runs[chain->nruns++];
+			run->clust = clust;
+			run->count = 1;
+		}
+		if (++chain->nclust == nclust)
+			break;
+
+		clust = get_fatent(mydata, clust);
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			debug("Invalid FAT entry\n");
+			break;
+		}
+	}
+	chain->start = start;
+	debug("FAT chain 0x%x: %u clusters in %d runs\n", start,
+	      chain->nclust, chain->nruns);
+
+	return chain;
+}
+
 /*
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
@@ -332,9 +442,13 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_chain *chain;
+	struct fat_run *run;
+	loff_t runpos, runend;
 	loff_t actsize;
+	__u32 offset, skip;
+	__u32 nclust;
+	int i;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -349,92 +463,146 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	/* Rounding up must not overflow for files of nearly 4GiB */
+	nclust = (__u32)filesize / bytesperclust +
+		 !!((__u32)filesize % bytesperclust);
+	chain = get_chain(mydata, START(dentptr), nclust);
+	if (!chain) {
+		printf("Error: allocating cluster chain\n");
+		return -1;
+	}
 
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
+	runpos = 0;
+	for (i = 0, run = chain->runs; i < chain->nruns && pos < filesize;
+	     i++, run++, runpos = runend) {
+		runend = runpos + (loff_t)run->count * bytesperclust;
+		if (runend > filesize)
+			runend = filesize;
+
+		while (pos < runend) {
+			/* File sizes are 32-bit so this cannot overflow */
+			offset = pos - runpos;
+			skip = offset % bytesperclust;
+
+			if (skip) {
+				/* Read a partial first cluster via a buffer */
+				actsize = min(runend - (pos - skip),
+					      (loff_t)bytesperclust);
+				if (get_cluster(mydata, run->clust +
+						offset / bytesperclust,
+						get_contents_vfatname_block,
+						(int)actsize) != 0) {
+					printf("Error reading cluster\n");
+					return -1;
+				}
+				actsize -= skip;
+				memcpy(buffer, get_contents_vfatname_block + skip,
+				       actsize);
+			} else {
+				/* Read the rest of the run in one go */
+				actsize = runend - pos;
+				if (get_cluster(mydata, run->clust +
+						offset / bytesperclust,
+						buffer, actsize) != 0) {
+					printf("Error reading cluster\n");
+					return -1;
+				}
+			}
+			*gotsize += actsize;
+			buffer += actsize;
+			pos += actsize;
 		}
-		actsize += bytesperclust;
 	}
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
+	return 0;
+}
 
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		actsize = min(filesize, (loff_t)bytesperclust);
-		if (get_cluster(mydata, curclust, get_contents_vfatname_block,
-				(int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, get_contents_vfatname_block + pos, actsize);
-		*gotsize += actsize;
-		if (!filesize)
-			return 0;
-		buffer += actsize;
+/*
+ * Mounted volume state. The boot sector is parsed and the FAT buffer
+ * allocated on first access, and the directory entries of files found by
+ * path are remembered, so that repeated accesses to the same volume do not
+ * repeat this work. Everything is dropped when a different volume (or a
+ * changed boot sector) is selected with fat_set_blk_dev(), or anything is
+ * written to the device, by the filesystem or otherwise (e.g. 'mmc write').
+ */
+#define FAT_DENTRY_CACHE_SIZE	16
+
+struct fat_dentry {
+	char *path;		/* Path from the root, or NULL */
+	dir_entry dent;		/* Directory entry for the path */
+};
+
+struct fat_volume {
+	int mounted;		/* 1 if the fields below are valid */
+	struct blk_desc *dev;	/* Device holding the volume */
+	lbaint_t part_start;	/* Start sector of the partition */
+	ulong change_seq;	/* Device's change_seq when mounted */
+	__u8 bootsect[DOS_BOOT_MAGIC_OFFSET];	/* Boot sector when mounted */
+	fsdata data;		/* Volume parameters and FAT buffer */
+	__u32 root_cluster;	/* First cluster of root directory (FAT32) */
+	int rootdir_size;	/* Root directory size in sectors (FAT12/16) */
+	struct fat_dentry dentries[FAT_DENTRY_CACHE_SIZE];
+	int dentry_victim;
+};
+
+static struct fat_volume fat_vol;
+
+static void fat_volume_invalidate(void)
+{
+	int i;
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
+	fat_chain_invalidate();
+	for (i = 0; i < FAT_DENTRY_CACHE_SIZE; i++) {
+		free(fat_vol.dentries[i].path);
+		fat_vol.dentries[i].path = NULL;
 	}
+	fat_vol.data.fatbufnum = -1;
+	fat_vol.mounted = 0;
+}
 
-	actsize = bytesperclust;
-	endclust = curclust;
+/*
+ * Keep the mounted state only if the same boot sector is selected again and
+ * the device has not been written since
+ */
+static void fat_volume_check(const void *bootsect)
+{
+	if (fat_vol.mounted &&
+	    (fat_vol.dev != cur_dev ||
+	     fat_vol.part_start != cur_part_info.start ||
+	     fat_vol.change_seq != cur_dev->change_seq ||
+	     memcmp(fat_vol.bootsect, bootsect, sizeof(fat_vol.bootsect))))
+		fat_volume_invalidate();
+
+	fat_vol.dev = cur_dev;
+	fat_vol.part_start = cur_part_info.start;
+	fat_vol.change_seq = cur_dev->change_seq;
+	memcpy(fat_vol.bootsect, bootsect, sizeof(fat_vol.bootsect));
+}
 
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
+static dir_entry *fat_dentry_find(const char *path)
+{
+	int i;
 
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
-		filesize -= actsize;
-		buffer += actsize;
+	for (i = 0; i < FAT_DENTRY_CACHE_SIZE; i++) {
+		if (fat_vol.dentries[i].path &&
+		    !strcasecmp(fat_vol.dentries[i].path, path))
+			return &fat_vol.dentries[i].dent;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return NULL;
+}
+
+static void fat_dentry_add(const char *path, const dir_entry *dent)
+{
+	struct fat_dentry *entry;
+
+	entry = &fat_vol.dentries[fat_vol.dentry_victim];
+	fat_vol.dentry_victim = (fat_vol.dentry_victim + 1) %
+				FAT_DENTRY_CACHE_SIZE;
+
+	free(entry->path);
+	entry->path = strdup(path);
+	entry->dent = *dent;
 }
 
 /*
@@ -808,39 +976,28 @@ exit:
 	return ret;
 }
 
-__u8 do_fat_read_at_block[MAX_CLUSTSIZE]
-	__aligned(ARCH_DMA_MINALIGN);
-
-int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
-		   loff_t maxsize, int dols, int dogetsize, loff_t *size)
+/*
+ * Parse the boot sector of the current volume, unless already mounted.
+ * Return 0 on success, -1 otherwise.
+ */
+static int fat_mount_volume(void)
 {
-	char fnamecopy[2048];
+	fsdata *mydata = &fat_vol.data;
 	boot_sector bs;
 	volume_info volinfo;
-	fsdata datablock;
-	fsdata *mydata = &datablock;
-	dir_entry *dentptr = NULL;
-	__u16 prevcksum = 0xffff;
-	char *subname = "";
-	__u32 cursect;
-	int idx, isdir = 0;
-	int files = 0, dirs = 0;
-	int ret = -1;
-	int firsttime;
-	__u32 root_cluster = 0;
-	__u32 read_blk;
-	int rootdir_size = 0;
-	int buffer_blk_cnt;
-	int do_read;
-	__u8 *dir_ptr;
+
+	if (fat_vol.mounted && cur_dev)
+		return 0;
 
 	if (read_bootsectandvi(&bs, &volinfo, &mydata->fatsize)) {
 		debug("Error: reading boot sector\n");
 		return -1;
 	}
 
+	fat_vol.root_cluster = 0;
+	fat_vol.rootdir_size = 0;
 	if (mydata->fatsize == 32) {
-		root_cluster = bs.root_cluster;
+		fat_vol.root_cluster = bs.root_cluster;
 		mydata->fatlength = bs.fat32_length;
 	} else {
 		mydata->fatlength = bs.fat_length;
@@ -848,8 +1005,7 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 
 	mydata->fat_sect = bs.reserved;
 
-	cursect = mydata->rootdir_sect
-		= mydata->fat_sect + mydata->fatlength * bs.fats;
+	mydata->rootdir_sect = mydata->fat_sect + mydata->fatlength * bs.fats;
 
 	mydata->sect_size = (bs.sector_size[1] << 8) + bs.sector_size[0];
 	mydata->clust_size = bs.cluster_size;
@@ -863,21 +1019,23 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 		mydata->data_begin = mydata->rootdir_sect -
 					(mydata->clust_size * 2);
 	} else {
-		rootdir_size = ((bs.dir_entries[1]  * (int)256 +
-				 bs.dir_entries[0]) *
-				 sizeof(dir_entry)) /
-				 mydata->sect_size;
+		fat_vol.rootdir_size = ((bs.dir_entries[1]  * (int)256 +
+					 bs.dir_entries[0]) *
+					 sizeof(dir_entry)) /
+					 mydata->sect_size;
 		mydata->data_begin = mydata->rootdir_sect +
-					rootdir_size -
+					fat_vol.rootdir_size -
 					(mydata->clust_size * 2);
 	}
 
 	mydata->fatbufnum = -1;
 	mydata->fat_dirty = 0;
-	mydata->fatbuf = memalign(ARCH_DMA_MINALIGN, FATBUFSIZE);
-	if (mydata->fatbuf == NULL) {
-		debug("Error: allocating memory\n");
-		return -1;
+	if (!mydata->fatbuf) {
+		mydata->fatbuf = memalign(ARCH_DMA_MINALIGN, FATBUFSIZE);
+		if (mydata->fatbuf == NULL) {
+			debug("Error: allocating memory\n");
+			return -1;
+		}
 	}
 
 	if (vfat_enabled)
@@ -887,12 +1045,47 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	       mydata->fatsize, mydata->fat_sect, mydata->fatlength);
 	debug("Rootdir begins at cluster: %d, sector: %d, offset: %x\n"
 	       "Data begins at: %d\n",
-	       root_cluster,
+	       fat_vol.root_cluster,
 	       mydata->rootdir_sect,
 	       mydata->rootdir_sect * mydata->sect_size, mydata->data_begin);
 	debug("Sector size: %d, cluster size: %d\n", mydata->sect_size,
 	      mydata->clust_size);
 
+	fat_vol.mounted = 1;
+
+	return 0;
+}
+
+__u8 do_fat_read_at_block[MAX_CLUSTSIZE]
+	__aligned(ARCH_DMA_MINALIGN);
+
+int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
+		   loff_t maxsize, int dols, int dogetsize, loff_t *size)
+{
+	char fnamecopy[2048];
+	fsdata *mydata = &fat_vol.data;
+	dir_entry *dentptr = NULL;
+	__u16 prevcksum = 0xffff;
+	char *subname = "";
+	__u32 cursect;
+	int idx, isdir = 0;
+	int files = 0, dirs = 0;
+	int ret = -1;
+	int firsttime;
+	__u32 root_cluster;
+	__u32 read_blk;
+	int rootdir_size;
+	int buffer_blk_cnt;
+	int do_read;
+	__u8 *dir_ptr;
+
+	if (fat_mount_volume())
+		return -1;
+
+	root_cluster = fat_vol.root_cluster;
+	rootdir_size = fat_vol.rootdir_size;
+	cursect = mydata->rootdir_sect;
+
 	/* "cwd" is always the root... */
 	while (ISDIRDELIM(*filename))
 		filename++;
@@ -901,6 +1094,13 @@ int do_fat_read_at(const char *filename, loff_t pos, void *buffer,
 	strcpy(fnamecopy, filename);
 	downcase(fnamecopy);
 
+	/* Files looked up before need no directory walk */
+	if (!dols) {
+		dentptr = fat_dentry_find(filename);
+		if (dentptr)
+			goto found;
+	}
+
 root_reparse:
 	if (*fnamecopy == '\0') {
 		if (!dols)
@@ -1219,6 +1419,9 @@ rootdir_done:
 			subname = nextname;
 	}
 
+	if (!dols)
+		fat_dentry_add(filename, dentptr);
+found:
 	if (dogetsize) {
 		*size = FAT2CPU32(dentptr->size);
 		ret = 0;
@@ -1228,7 +1431,6 @@ rootdir_done:
 	debug("Size: %u, got: %llu\n", FAT2CPU32(dentptr->size), *size);
 
 exit:
-	free(mydata->fatbuf);
 	return ret;
 }
 
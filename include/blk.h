@@ -8,6 +8,8 @@
 #ifndef BLK_H
 #define BLK_H
 
+#include <linux/list.h>
+
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
 #define LBAFlength "ll"
@@ -62,6 +64,12 @@ struct blk_desc {
 	char		vendor[40+1];	/* IDE model, SCSI Vendor */
 	char		product[20+1];	/* IDE Serial no, SCSI product */
 	char		revision[8+1];	/* firmware revision */
+	/*
+	 * Set by blk_mark_changed() on every write or erase, so that
+	 * filesystems which keep state between commands can tell when the
+	 * device may have changed under them (e.g. after 'mmc write' or ums)
+	 */
+	ulong		change_seq;
 #ifdef CONFIG_BLK
 	/*
 	 * For now we have a few functions which take struct blk_desc as a
@@ -136,8 +144,10 @@ void blkcache_invalidate(int iftype, int dev);
  *
  * @param blocks - maximum blocks per entry
  * @param entries - maximum entries in cache
+ * @param bytes - maximum number of bytes of cached data
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, unsigned entries,
+			unsigned long bytes);
 
 /*
  * statistics of the block cache
@@ -145,9 +155,12 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
+	unsigned evictions;
 	unsigned entries; /* current entry count */
+	unsigned long bytes; /* current size of cached data */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned long max_bytes;
 };
 
 /**
@@ -174,8 +187,21 @@ static inline void blkcache_invalidate(int iftype, int dev) {}
 
 #endif
 
+/**
+ * blk_mark_changed() - record that a block device's contents may have changed
+ *
+ * This gives the device a new change_seq, which no block device has had
+ * before. It is called on every write or erase and when a device is created,
+ * so a (device, change_seq) pair names the contents of a device even if a
+ * new device is later created at the same address.
+ *
+ * @block_dev:	Block device which has changed
+ */
+void blk_mark_changed(struct blk_desc *block_dev);
+
 #ifdef CONFIG_BLK
 struct udevice;
+struct blk_request;
 
 /* Operations on block devices */
 struct blk_ops {
@@ -235,10 +261,217 @@ struct blk_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
+
+	/**
+	 * submit() - start an asynchronous request
+	 *
+	 * The driver queues the request and returns at once. It must call
+	 * blk_request_complete() when the request finishes, normally from
+	 * its poll() method. Drivers without this method are handled by a
+	 * synchronous fallback in the uclass.
+	 *
+	 * @dev:	Device to access
+	 * @req:	Request to start (req->dev is @dev)
+	 * @return 0 if the request was queued, -ve on error
+	 */
+	int (*submit)(struct udevice *dev, struct blk_request *req);
+
+	/**
+	 * poll() - make progress on outstanding asynchronous requests
+	 *
+	 * @dev:	Device to poll
+	 * @return number of requests still outstanding, or -ve on error
+	 */
+	int (*poll)(struct udevice *dev);
 };
 
 #define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
 
+/**
+ * struct blk_readahead_stats - read-ahead counters for a block device
+ *
+ * @reads:	Number of reads requested through blk_dread()
+ * @hits:	Number of reads satisfied entirely from the read-ahead window
+ * @cmds:	Number of reads issued to the driver
+ * @blocks:	Number of blocks read from the driver
+ * @window:	Current read-ahead window in blocks (0 if not sequential)
+ */
+struct blk_readahead_stats {
+	ulong reads;
+	ulong hits;
+	ulong cmds;
+	ulong blocks;
+	ulong window;
+};
+
+/**
+ * struct blk_readahead - read-ahead state for a block device
+ *
+ * This is the uclass-private data of each block device when
+ * CONFIG_BLOCK_READAHEAD is enabled.
+ *
+ * @next:	Block which continues the current sequential stream
+ * @window:	Size of the next read-ahead in blocks, doubled on each
+ *		sequential refill up to the configured maximum
+ * @buf_start:	First block held in @buf
+ * @buf_cnt:	Number of valid blocks in @buf
+ * @buf_size:	Size of @buf in bytes
+ * @buf:	Staging buffer for read-ahead data
+ * @stats:	Counters reported by the 'blk readahead' command
+ */
+struct blk_readahead {
+	lbaint_t next;
+	lbaint_t window;
+	lbaint_t buf_start;
+	lbaint_t buf_cnt;
+	ulong buf_size;
+	char *buf;
+	struct blk_readahead_stats stats;
+};
+
+#ifdef CONFIG_BLOCK_READAHEAD
+/**
+ * blk_readahead_read() - read from a block device using read-ahead
+ *
+ * Sequential streams of small reads are detected and satisfied from a
+ * staging window which is filled with a single large read. Other reads are
+ * passed straight to the driver.
+ *
+ * @dev:	Block device to read from
+ * @start:	Start block number to read (0=first)
+ * @blkcnt:	Number of blocks to read
+ * @buffer:	Destination buffer for data read
+ * @return number of blocks read, or -ve error number
+ */
+ulong blk_readahead_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+			 void *buffer);
+
+/**
+ * blk_readahead_invalidate() - discard read-ahead data for a device
+ *
+ * This must be called when the device contents may change, e.g. on write.
+ *
+ * @dev:	Block device
+ */
+void blk_readahead_invalidate(struct udevice *dev);
+
+/**
+ * blk_readahead_release() - free the read-ahead buffer of a device
+ *
+ * @dev:	Block device
+ */
+void blk_readahead_release(struct udevice *dev);
+
+/**
+ * blk_readahead_configure() - set the maximum read-ahead window
+ *
+ * @bytes:	Maximum window in bytes, or 0 to disable read-ahead
+ */
+void blk_readahead_configure(ulong bytes);
+
+/**
+ * blk_readahead_get_stats() - get the read-ahead counters for a device
+ *
+ * @dev:	Block device
+ * @stats:	Returns the counters
+ * @return 0 if OK, -ENODEV if the device is not active
+ */
+int blk_readahead_get_stats(struct udevice *dev,
+			    struct blk_readahead_stats *stats);
+#else
+static inline void blk_readahead_invalidate(struct udevice *dev) {}
+static inline void blk_readahead_release(struct udevice *dev) {}
+#endif
+
+enum blk_request_op {
+	BLK_REQ_READ,
+	BLK_REQ_WRITE,
+};
+
+/**
+ * struct blk_request - an asynchronous block device request
+ *
+ * The caller fills in the fields up to @priv, then calls blk_submit(). The
+ * request must stay valid until @callback has been called or blk_wait()
+ * has returned.
+ *
+ * @dev:	Block device to access
+ * @op:	Operation to perform
+ * @start:	Start block number (0=first)
+ * @blkcnt:	Number of blocks to transfer
+ * @buffer:	Data buffer
+ * @callback:	Called from blk_poll() when the request completes, or NULL
+ * @priv:	Private data for the caller
+ * @sibling:	Entry in the queue of the driver or uclass
+ * @done:	Number of blocks transferred so far
+ * @result:	Number of blocks transferred, or -ve error, once complete
+ * @complete:	true once the request has completed
+ */
+struct blk_request {
+	struct udevice *dev;
+	enum blk_request_op op;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	void *buffer;
+	void (*callback)(struct blk_request *req);
+	void *priv;
+
+	struct list_head sibling;
+	lbaint_t done;
+	long result;
+	bool complete;
+};
+
+#ifdef CONFIG_BLK_ASYNC
+/**
+ * blk_submit() - start an asynchronous block device request
+ *
+ * Devices whose driver has no submit() method have the request carried out
+ * a chunk at a time by blk_poll(), so the caller can do other work between
+ * the chunks.
+ *
+ * @req:	Request to start
+ * @return 0 if the request was queued, -ve on error
+ */
+int blk_submit(struct blk_request *req);
+
+/**
+ * blk_poll() - make progress on outstanding requests for a device
+ *
+ * @dev:	Block device to poll, or NULL for all block devices
+ * @return number of requests still outstanding, or -ve on error
+ */
+int blk_poll(struct udevice *dev);
+
+/**
+ * blk_wait() - wait for an asynchronous request to complete
+ *
+ * @req:	Request to wait for
+ * @return number of blocks transferred, or -ve on error
+ */
+long blk_wait(struct blk_request *req);
+
+/**
+ * blk_request_complete() - mark a request as complete
+ *
+ * This is called by drivers when a request finishes and calls the
+ * request's callback, if any.
+ *
+ * @req:	Request which has completed
+ * @result:	Number of blocks transferred, or -ve error
+ */
+void blk_request_complete(struct blk_request *req, long result);
+
+/**
+ * blk_async_cancel() - fail all fallback requests queued for a device
+ *
+ * @dev:	Block device being removed
+ */
+void blk_async_cancel(struct udevice *dev);
+#else
+static inline void blk_async_cancel(struct udevice *dev) {}
+#endif
+
 /*
  * These functions should take struct udevice instead of struct blk_desc,
  * but this is convenient for migration to driver model. Add a 'd' prefix
@@ -397,6 +630,7 @@ static inline ulong blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt, const void *buffer)
 {
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_mark_changed(block_dev);
 	return block_dev->block_write(block_dev, start, blkcnt, buffer);
 }
 
@@ -404,6 +638,7 @@ static inline ulong blk_derase(struct blk_desc *block_dev, lbaint_t start,
 			       lbaint_t blkcnt)
 {
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
+	blk_mark_changed(block_dev);
 	return block_dev->block_erase(block_dev, start, blkcnt);
 }
 
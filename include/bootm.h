@@ -56,6 +56,17 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 
 void arch_preboot_os(void);
 
+/**
+ * bootm_init_lmb() - set up the memory regions used by bootm
+ *
+ * This adds the memory given by the bootm_low and bootm_size environment
+ * variables and reserves the areas which the architecture and board need to
+ * keep, such as U-Boot itself.
+ *
+ * @lmb:	LMB to set up; free it with lmb_uninit() when done
+ */
+void bootm_init_lmb(struct lmb *lmb);
+
 /**
  * bootm_decomp_image() - decompress the operating system
  *
@@ -73,4 +84,109 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		       void *load_buf, void *image_buf, ulong image_len,
 		       uint unc_len, ulong *load_end);
 
+/**
+ * struct bootm_stream - state for decompressing an image piecewise
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @dst:	Place to decompress to
+ * @dst_len:	Available space for decompression
+ * @out_len:	Number of bytes written so far (IH_COMP_NONE only)
+ * @priv:	State of the decompressor
+ */
+struct bootm_stream {
+	int comp;
+	void *dst;
+	ulong dst_len;
+	ulong out_len;
+	void *priv;
+};
+
+/**
+ * bootm_stream_init() - prepare to decompress an image piecewise
+ *
+ * Only IH_COMP_NONE, IH_COMP_GZIP and IH_COMP_LZ4 are supported.
+ *
+ * @bs:		Stream state to set up
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @dst:	Place to decompress to
+ * @dst_len:	Available space for decompression
+ * @return 0 if OK, -ENOMEM if out of memory, BOOTM_ERR_UNIMPLEMENTED if
+ *	the algorithm cannot be used piecewise
+ */
+int bootm_stream_init(struct bootm_stream *bs, int comp, void *dst,
+		      ulong dst_len);
+
+/**
+ * bootm_stream_feed() - decompress the next piece of an image
+ *
+ * @bs:		Stream state
+ * @src:	Next piece of the compressed image
+ * @len:	Size of the piece in bytes
+ * @return 1 if the end of the compressed data was reached, 0 if more data
+ *	is needed, -ve on error
+ */
+int bootm_stream_feed(struct bootm_stream *bs, const void *src, ulong len);
+
+/**
+ * bootm_stream_end() - finish decompressing an image
+ *
+ * This frees the decompressor state.
+ *
+ * @bs:		Stream state
+ * @return number of bytes written to the destination
+ */
+ulong bootm_stream_end(struct bootm_stream *bs);
+
+/**
+ * bootm_chunk_check() - check whether an image is made up of chunks
+ *
+ * @src:	Start of the compressed image
+ * @len:	Size of the compressed image in bytes
+ * @return true if the image starts with a struct image_chunk_header
+ */
+bool bootm_chunk_check(const void *src, ulong len);
+
+/**
+ * bootm_chunk_decomp() - decompress a chunked image
+ *
+ * The chunks are decompressed in parallel on as many CPUs as cpu_run()
+ * supports. Only IH_COMP_GZIP and IH_COMP_ZSTD are supported.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @dst:	Place to decompress to
+ * @dst_len:	Available space for decompression
+ * @src:	Start of the chunked image
+ * @src_len:	Size of the chunked image in bytes
+ * @lenp:	Returns the number of bytes decompressed
+ * @return 0 if OK, -ENOBUFS if the output does not fit, -EPROTONOSUPPORT
+ *	if the algorithm is not supported, other -ve on error
+ */
+int bootm_chunk_decomp(int comp, void *dst, ulong dst_len, const void *src,
+		       ulong src_len, ulong *lenp);
+
+#ifndef USE_HOSTCC
+struct blk_desc;
+
+/**
+ * bootm_stream_load() - load an image from a block device, decompressing it
+ *
+ * The image is read into a ring of buffers using asynchronous block
+ * requests. Each buffer is decompressed as soon as it arrives, while the
+ * following buffers are still being read, rather than decompressing only
+ * after the whole image has been loaded. Time spent waiting for the device
+ * and decompressing is accumulated in bootstage records.
+ *
+ * @desc:	Block device to read from
+ * @start:	First block of the compressed image
+ * @image_len:	Size of the compressed image in bytes
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load_buf:	Place to decompress to
+ * @unc_len:	Available space for decompression
+ * @lenp:	Returns the number of bytes decompressed
+ * @return 0 if OK, -ve on error
+ */
+int bootm_stream_load(struct blk_desc *desc, lbaint_t start, ulong image_len,
+		      int comp, void *load_buf, ulong unc_len, ulong *lenp);
+#endif
+
 #endif
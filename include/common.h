@@ -779,7 +779,38 @@ ulong	ticks2usec    (unsigned long ticks);
 int	init_timebase (void);
 
 /* lib/gunzip.c */
+/**
+ * gzip_parse_header() - find the start of the deflate data in a gzip stream
+ *
+ * @src:	Start of the gzip stream
+ * @len:	Number of bytes available at @src (at least 10)
+ * @return length of the gzip header, 0 if more data is needed to find the
+ *	end of the header, or -1 if the data is not gzipped
+ */
+int gzip_parse_header(const unsigned char *src, unsigned long len);
 int gunzip(void *, int, unsigned char *, unsigned long *);
+
+/* Workspace needed by gunzip_ws(): the inflate state and a 32KB window */
+#define GUNZIP_WS_SIZE		(48 << 10)
+
+/**
+ * gunzip_ws() - decompress gzip data using a given workspace
+ *
+ * This is the same as gunzip() but does not allocate memory, print errors or
+ * reset the watchdog, so it can be used where malloc(), the console and
+ * drivers are not available, such as on a secondary CPU.
+ *
+ * @dst:	Output buffer
+ * @dstlen:	Size of the output buffer in bytes
+ * @src:	Compressed data
+ * @lenp:	On entry, size of the compressed data. On exit, the number
+ *		of bytes written to @dst
+ * @ws:		Workspace, aligned to 16 bytes
+ * @ws_size:	Size of the workspace, at least GUNZIP_WS_SIZE
+ * @return 0 if OK, -1 on error
+ */
+int gunzip_ws(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	      void *ws, unsigned long ws_size);
 int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 						int stoponerr, int offset);
 
@@ -929,6 +960,41 @@ int cpu_disable(int nr);
 int cpu_release(int nr, int argc, char * const argv[]);
 #endif
 
+/**
+ * cpu_run_count() - get the number of CPUs that can run work for U-Boot
+ *
+ * @return number of CPUs, including the one running U-Boot, so 1 if
+ *	cpu_run() is not supported
+ */
+int cpu_run_count(void);
+
+/**
+ * cpu_run() - start running a function on a secondary CPU
+ *
+ * The function runs with the same memory map and global data as the boot
+ * CPU, but must not use malloc() or drivers, which are not safe to call
+ * from more than one CPU at once. Use cpu_run_wait() to wait for it to
+ * return.
+ *
+ * @nr:		CPU to use, from 1 to cpu_run_count() - 1
+ * @func:	Function to run
+ * @arg:	Argument to pass to @func
+ * @return 0 if OK, -ENOSYS if not supported, -EBUSY if the CPU did not
+ *	finish the last function it was given, other -ve on error
+ */
+int cpu_run(int nr, void (*func)(void *arg), void *arg);
+
+/**
+ * cpu_run_wait() - wait for a function started by cpu_run() to finish
+ *
+ * If this fails the CPU may still be running the function, so the caller
+ * must not free or reuse anything the function uses.
+ *
+ * @nr:		CPU to wait for
+ * @return 0 if OK, -ve if the CPU did not finish
+ */
+int cpu_run_wait(int nr);
+
 #else	/* __ASSEMBLY__ */
 
 /* Drop a C type modifier (like in 3UL) for constants used in assembly. */
@@ -343,7 +343,6 @@
 #define CONFIG_CMD_MTDPARTS
 #define CONFIG_MTD_DEVICE	/* needed for mtdparts command */
 #define CONFIG_MTD_PARTITIONS	/* mtdparts and UBI support */
-#define CONFIG_RBTREE
 #define MTDIDS_DEFAULT		"nand0=NAND"
 #define MTDPARTS_DEFAULT	"mtdparts=NAND:1m(u-boot),"	\
 					"-(ubi)"
@@ -177,7 +177,6 @@
 #define CONFIG_CMD_NAND_TORTURE
 
 /* UBI stuff */
-#define CONFIG_RBTREE
 #define CONFIG_LZO
 #define CONFIG_CMD_UBIFS	/* increases size by almost 60 KB */
 
@@ -90,7 +90,6 @@
  */
 #define CONFIG_CMD_JFFS2
 #define CONFIG_CMD_UBIFS
-#define CONFIG_RBTREE
 #define CONFIG_MTD_DEVICE
 #define CONFIG_MTD_PARTITIONS
 #define CONFIG_CMD_MTDPARTS
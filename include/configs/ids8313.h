@@ -534,7 +534,6 @@
 /* UBI Support */
 #define CONFIG_CMD_NAND_TRIMFFS
 #define CONFIG_CMD_UBIFS
-#define CONFIG_RBTREE
 #define CONFIG_LZO
 #define CONFIG_MTD_PARTITIONS
 
@@ -132,7 +132,6 @@
 #ifdef CONFIG_SYS_MVFS
 #define CONFIG_CMD_JFFS2
 #define CONFIG_CMD_UBIFS
-#define CONFIG_RBTREE
 #define CONFIG_MTD_DEVICE               /* needed for mtdparts commands */
 #define CONFIG_MTD_PARTITIONS
 #define CONFIG_CMD_MTDPARTS
@@ -194,7 +194,6 @@
 #define CONFIG_MTD_PARTITIONS
 
 #ifdef UBIFS_SUPPORT
-#define CONFIG_RBTREE
 #define CONFIG_LZO
 #endif
 
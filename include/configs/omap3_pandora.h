@@ -64,7 +64,6 @@
 #ifdef CONFIG_NAND
 #define CONFIG_CMD_UBIFS	/* Read-only UBI volume operations */
 
-#define CONFIG_RBTREE		/* required by CONFIG_CMD_UBI */
 #define CONFIG_LZO		/* required by CONFIG_CMD_UBIFS */
 
 #define CONFIG_MTD_PARTITIONS	/* required for UBI partition support */
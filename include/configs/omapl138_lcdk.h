@@ -307,7 +307,6 @@
 #define CONFIG_MTD_DEVICE
 #define CONFIG_MTD_PARTITIONS
 #define CONFIG_LZO
-#define CONFIG_RBTREE
 #define CONFIG_CMD_UBIFS
 #endif
 
@@ -175,7 +175,6 @@
 		"fi\0"							\
 
 #define CONFIG_CMD_UBIFS
-#define CONFIG_RBTREE
 #define CONFIG_LZO
 #define MTDPARTS_DEFAULT			\
 	"mtdparts=ff705000.spi.0:"		\
@@ -0,0 +1,125 @@
+/*
+ * Device tree bind table, generated when U-Boot is built
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _DM_BIND_TABLE_H
+#define _DM_BIND_TABLE_H
+
+/* The node has no "status" property, or it is "okay" */
+#define DM_BIND_ENABLED		(1 << 0)
+
+/* The node has a "u-boot,dm-pre-reloc" property */
+#define DM_BIND_PRE_RELOC	(1 << 1)
+
+/**
+ * struct dm_bind_node - what driver model needs to bind a node
+ *
+ * @offset:	Offset of the node in the device tree
+ * @child:	Index of the first subnode in the table, or -1 if none
+ * @sibling:	Index of the next node with the same parent, or -1 if none
+ * @flags:	DM_BIND_...
+ * @compat_len:	Length of @compat in bytes, or 0 if there is none
+ * @compat:	Value of the "compatible" property, or NULL if none
+ */
+struct dm_bind_node {
+	int offset;
+	int child;
+	int sibling;
+	uint flags;
+	int compat_len;
+	const char *compat;
+};
+
+/**
+ * struct dm_bind_alias - an alias which fdtdec_get_alias_seq() matches
+ *
+ * @offset:	Offset of the node which the alias refers to
+ * @name:	Alias name, e.g. "i2c0"
+ * @seq:	Number at the end of the alias name
+ */
+struct dm_bind_alias {
+	int offset;
+	const char *name;
+	int seq;
+};
+
+/**
+ * struct dm_bind_table - nodes and aliases of a device tree
+ *
+ * The table is only used with the device tree it was generated from, which
+ * is checked from its size and CRC32.
+ *
+ * @fdt_size:		Total size of the device tree
+ * @fdt_crc32:		CRC32 of the device tree
+ * @node_count:		Number of nodes
+ * @nodes:		Nodes, in order of offset. The root is first.
+ * @alias_count:	Number of aliases
+ * @aliases:		Aliases, in order of offset. Aliases for the same node
+ *			are in the order they appear in the /aliases node.
+ */
+struct dm_bind_table {
+	u32 fdt_size;
+	u32 fdt_crc32;
+	int node_count;
+	const struct dm_bind_node *nodes;
+	int alias_count;
+	const struct dm_bind_alias *aliases;
+};
+
+/* Generated by dtoc from the U-Boot device tree, in dts/dt-bind.c */
+extern const struct dm_bind_table dm_bind_table;
+
+/**
+ * dm_bind_table_init() - start using a bind table
+ *
+ * This checks that @table was generated from the control device tree
+ * (gd->fdt_blob). If so, driver model binds devices from the table
+ * instead of reading the device tree.
+ *
+ * @table:	Table to use, or NULL to stop using one
+ * @return 0 if OK, -ENOENT if @table is NULL, -EINVAL if it does not match
+ */
+int dm_bind_table_init(const struct dm_bind_table *table);
+
+/**
+ * dm_bind_table_node() - get a node in the bind table by its index
+ *
+ * @idx:	Index of the node, e.g. from the @child of another node
+ * @return the node, or NULL if @idx is -1
+ */
+const struct dm_bind_node *dm_bind_table_node(int idx);
+
+/**
+ * dm_bind_table_alias_seq() - find the sequence number of a node
+ *
+ * This is the same as fdtdec_get_alias_seq() for the device tree which is
+ * in use with the bind table.
+ *
+ * @base:	Base name for the alias, e.g. "i2c"
+ * @offset:	Offset of the node
+ * @seqp:	Returns the sequence number if found
+ * @return 0 if found, -ENOENT if not
+ */
+int dm_bind_table_alias_seq(const char *base, int offset, int *seqp);
+
+#if CONFIG_IS_ENABLED(OF_BIND_TABLE)
+/**
+ * dm_bind_table_find() - find a node in the bind table
+ *
+ * @blob:	Device tree
+ * @offset:	Offset of a node in @blob
+ * @return the node, or NULL if the table is not in use for @blob, or does
+ * not have a node at @offset
+ */
+const struct dm_bind_node *dm_bind_table_find(const void *blob, int offset);
+#else
+static inline const struct dm_bind_node *dm_bind_table_find(const void *blob,
+							     int offset)
+{
+	return NULL;
+}
+#endif
+
+#endif
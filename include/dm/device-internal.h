@@ -89,6 +89,49 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_start() - Start probing a device
+ *
+ * This is the same as device_probe() except that it returns as soon as the
+ * driver's probe() method returns. If the driver has a probe_poll() method
+ * the device is left with DM_FLAG_PROBE_PENDING set and must be finished
+ * with device_probe_poll(). Its parents are probed fully first.
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if probed, -EINPROGRESS if the probe is pending, other -ve on
+ * error
+ */
+int device_probe_start(struct udevice *dev);
+
+/**
+ * device_probe_poll() - Make progress on a pending probe
+ *
+ * @dev: Pointer to device whose probe was started by device_probe_start()
+ * @return 0 if the device is now probed, -EAGAIN if the probe is still
+ * pending, other -ve on error, in which case the device is not active
+ */
+int device_probe_poll(struct udevice *dev);
+
+/**
+ * device_probe_timed_out() - Check whether a pending probe took too long
+ *
+ * @start: Value of get_timer(0) when the probe was started
+ * @return true if more than CONFIG_DM_PROBE_TIMEOUT milliseconds have
+ * passed, false if not or if there is no limit
+ */
+bool device_probe_timed_out(ulong start);
+
+/**
+ * device_probe_cancel() - Give up on a pending probe
+ *
+ * The driver's remove() method is called, so that it can stop the work
+ * which its probe() method started, and the device is left inactive.
+ *
+ * @dev: Pointer to device whose probe was started by device_probe_start()
+ * @return -ETIMEDOUT, or as device_probe_poll() if the probe is not pending
+ */
+int device_probe_cancel(struct udevice *dev);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
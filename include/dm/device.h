@@ -11,6 +11,8 @@
 #ifndef _DM_DEVICE_H
 #define _DM_DEVICE_H
 
+#include <dm/ofnode.h>
+#include <dm/uclass.h>
 #include <dm/uclass-id.h>
 #include <fdtdec.h>
 #include <linker_lists.h>
@@ -46,6 +48,9 @@ struct driver_info;
 
 #define DM_FLAG_OF_PLATDATA		(1 << 8)
 
+/* Device has been probed but its driver's probe_poll() has not finished */
+#define DM_FLAG_PROBE_PENDING		(1 << 9)
+
 /**
  * struct udevice - An instance of a driver
  *
@@ -69,6 +74,8 @@ struct driver_info;
  * @parent_platdata: The parent bus's configuration data for this device
  * @uclass_platdata: The uclass's configuration data for this device
  * @of_offset: Device tree node offset for this device (- for none)
+ * @node: Device tree node for this device. This is the same node as
+ *	@of_offset, but is a live node once the live tree is in use
  * @driver_data: Driver data word for the entry that matched this device with
  *		its driver
  * @parent: Parent of this device, or NULL for the top level device
@@ -83,6 +90,10 @@ struct driver_info;
  * @req_seq: Requested sequence number for this device (-1 = any)
  * @seq: Allocated sequence number for this device (-1 = none). This is set up
  * when the device is probed and will be unique within the device's uclass.
+ * Use uclass_set_seq() to change it, so that the uclass can find the device.
+ * @index_next: Next device in the same chain of each of the uclass's
+ * indexes (see struct uclass_index)
+ * @index_hash: Hash value of this device in each of the uclass's indexes
  * @devres_head: List of memory allocations associated with this device.
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
@@ -95,6 +106,7 @@ struct udevice {
 	void *parent_platdata;
 	void *uclass_platdata;
 	int of_offset;
+	ofnode node;
 	ulong driver_data;
 	struct udevice *parent;
 	void *priv;
@@ -107,6 +119,10 @@ struct udevice {
 	uint32_t flags;
 	int req_seq;
 	int seq;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct udevice *index_next[UCLASS_INDEX_COUNT];
+	uint index_hash[UCLASS_INDEX_COUNT];
+#endif
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
@@ -126,9 +142,19 @@ static inline int dev_of_offset(const struct udevice *dev)
 	return dev->of_offset;
 }
 
-static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
+/**
+ * dev_set_of_offset() - Set the device tree node of a device
+ *
+ * This also updates the uclass's indexes of its devices.
+ *
+ * @dev:	Device to update
+ * @of_offset:	Device tree offset of the node, or -1 for none
+ */
+void dev_set_of_offset(struct udevice *dev, int of_offset);
+
+static inline ofnode dev_ofnode(const struct udevice *dev)
 {
-	dev->of_offset = of_offset;
+	return dev->node;
 }
 
 /**
@@ -166,6 +192,13 @@ struct udevice_id {
  * for each.
  * @bind: Called to bind a device to its driver
  * @probe: Called to probe a device, i.e. activate it
+ * @probe_poll: Called after probe() until it returns a value other than
+ * -EAGAIN, for drivers which start slow work (such as link negotiation) in
+ * probe() and finish it later. It returns 0 when the device is ready, or
+ * -ve on error, in which case it must tidy up as probe() would on error.
+ * This lets dm_probe_devices() probe other devices in the meantime. If the
+ * device is not ready within CONFIG_DM_PROBE_TIMEOUT milliseconds, remove()
+ * is called to stop the work and the probe fails with -ETIMEDOUT.
  * @remove: Called to remove a device, i.e. de-activate it
  * @unbind: Called to unbind a device from its driver
  * @ofdata_to_platdata: Called before probe to decode device tree data
@@ -199,6 +232,7 @@ struct driver {
 	const struct udevice_id *of_match;
 	int (*bind)(struct udevice *dev);
 	int (*probe)(struct udevice *dev);
+	int (*probe_poll)(struct udevice *dev);
 	int (*remove)(struct udevice *dev);
 	int (*unbind)(struct udevice *dev);
 	int (*ofdata_to_platdata)(struct udevice *dev);
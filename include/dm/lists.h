@@ -12,6 +12,8 @@
 
 #include <dm/uclass-id.h>
 
+struct udevice_id;
+
 /**
  * lists_driver_lookup_name() - Return u_boot_driver corresponding to name
  *
@@ -23,6 +25,20 @@
  */
 struct driver *lists_driver_lookup_name(const char *name);
 
+/**
+ * lists_driver_lookup_compat() - Return the driver for a compatible string
+ *
+ * This finds the first driver in the linker list whose of_match table has
+ * the given compatible string. Once the full malloc() pool is ready, this
+ * uses an index of all compatible strings, which is built on first use.
+ *
+ * @compat:	Compatible string to look up
+ * @idp:	Returns the driver's of_match entry for the string
+ * @return pointer to driver, or NULL if not found
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp);
+
 /**
  * lists_uclass_lookup() - Return uclass_driver based on ID of the class
  * id:		ID of the class
@@ -44,6 +60,27 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
  */
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 
+/**
+ * lists_bind_fdt_compat() - bind a device tree node, given its compatible
+ *
+ * This is the part of lists_bind_fdt() which follows reading the
+ * "compatible" property. It binds the first driver which matches one of
+ * the strings and does not refuse to bind.
+ *
+ * @parent: parent device
+ * @name: name for the new device, normally the node name
+ * @compat_list: value of the "compatible" property
+ * @compat_length: length of @compat_list in bytes
+ * @offset: offset of the device tree node
+ * @devp: if non-NULL, returns a pointer to the bound device, or NULL if
+ * no driver was bound
+ * @return 0 if a device was bound or no driver matched, other -ve value on
+ * error
+ */
+int lists_bind_fdt_compat(struct udevice *parent, const char *name,
+			  const char *compat_list, int compat_length,
+			  int offset, struct udevice **devp);
+
 /**
  * lists_bind_fdt() - bind a device tree node
  *
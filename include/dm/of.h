@@ -0,0 +1,73 @@
+/*
+ * Live (unflattened) device tree
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _DM_OF_H
+#define _DM_OF_H
+
+#include <asm/global_data.h>
+
+/**
+ * struct property - a property of a node in the live tree
+ *
+ * The name and value point into the flat device tree, which must therefore
+ * stay where it is and not change while the live tree is in use.
+ *
+ * @name:	Property name
+ * @hash:	Hash of @name, compared before the name itself
+ * @length:	Length of the value in bytes
+ * @value:	Property value
+ * @next:	Next property of the same node, or NULL
+ */
+struct property {
+	const char *name;
+	uint hash;
+	int length;
+	const void *value;
+	struct property *next;
+};
+
+/**
+ * struct device_node - a node in the live tree
+ *
+ * @name:	Node name, including any unit address
+ * @offset:	Offset of the node in the flat device tree
+ * @properties:	First property of the node, or NULL
+ * @parent:	Parent node, or NULL for the root
+ * @child:	First child node, or NULL
+ * @sibling:	Next node with the same parent, or NULL
+ */
+struct device_node {
+	const char *name;
+	int offset;
+	struct property *properties;
+	struct device_node *parent;
+	struct device_node *child;
+	struct device_node *sibling;
+};
+
+#if CONFIG_IS_ENABLED(OF_LIVE)
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * of_live_active() - check whether the live tree is in use
+ *
+ * The live tree is built from the control device tree (gd->fdt_blob) after
+ * relocation. Before that, and in SPL, only the flat tree is used.
+ *
+ * @return true if the live tree is in use
+ */
+static inline bool of_live_active(void)
+{
+	return gd->of_root != NULL;
+}
+#else
+static inline bool of_live_active(void)
+{
+	return false;
+}
+#endif
+
+#endif
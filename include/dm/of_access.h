@@ -0,0 +1,97 @@
+/*
+ * Building and reading the live device tree
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _DM_OF_ACCESS_H
+#define _DM_OF_ACCESS_H
+
+#include <dm/of.h>
+
+/**
+ * of_live_init() - build the live tree from the control device tree
+ *
+ * This creates a node for each node in gd->fdt_blob, linked to its parent,
+ * children and siblings, with the properties of each node in a list. It
+ * uses a single allocation, which is never freed, since devices point to
+ * the nodes. For the same reason the tree is only built once. On success
+ * gd->of_root is set, so that of_live_active() returns true. On failure it
+ * is left unset, so that the flat tree is used.
+ *
+ * @return 0 if OK, -EBUSY if the live tree is already in use, -ENOMEM if
+ * out of memory, or another -ve error if the device tree is not valid
+ */
+int of_live_init(void);
+
+/**
+ * of_live_replace() - use a new control device tree with the live tree
+ *
+ * This builds a live tree from @blob and makes both the control device
+ * tree and the live tree point to the new ones. The old nodes are not
+ * freed, since devices bound before may still point to them, and they
+ * point into the old control device tree, which must therefore be left in
+ * place. On failure nothing is changed.
+ *
+ * @blob:	New control device tree
+ * @return 0 if OK, -ENOMEM if out of memory, or another -ve error if the
+ * device tree is not valid
+ */
+int of_live_replace(const void *blob);
+
+/**
+ * of_live_node() - find the live node for a flat tree offset
+ *
+ * @offset:	Offset of a node in gd->fdt_blob
+ * @return the node, or NULL if there is no node at @offset
+ */
+struct device_node *of_live_node(int offset);
+
+/**
+ * of_live_find() - find the live node for an offset in a given flat tree
+ *
+ * This is used to look up properties through the live tree where the
+ * caller has a flat tree and an offset. It only finds a node if the live
+ * tree was built from @blob.
+ *
+ * @blob:	Flat device tree
+ * @offset:	Offset of a node in @blob
+ * @return the node, or NULL if the live tree is not in use, was not built
+ * from @blob, or has no node at @offset
+ */
+#if CONFIG_IS_ENABLED(OF_LIVE)
+struct device_node *of_live_find(const void *blob, int offset);
+#else
+static inline struct device_node *of_live_find(const void *blob, int offset)
+{
+	return NULL;
+}
+#endif
+
+/**
+ * of_find_property() - find a property of a node
+ *
+ * @np:		Node to look in, or NULL
+ * @name:	Name of the property
+ * @lenp:	If non-NULL, returns the length of the property value in bytes,
+ *		or a -ve libfdt error (-FDT_ERR_NOTFOUND if there is no such
+ *		property, -FDT_ERR_BADOFFSET if @np is NULL), as fdt_getprop()
+ * @return the property, or NULL if not found
+ */
+const struct property *of_find_property(const struct device_node *np,
+					const char *name, int *lenp);
+
+/**
+ * of_get_property() - get the value of a property of a node
+ *
+ * This is the live-tree counterpart of fdt_getprop().
+ *
+ * @np:		Node to look in, or NULL
+ * @name:	Name of the property
+ * @lenp:	As for of_find_property()
+ * @return the property value, or NULL if not found
+ */
+const void *of_get_property(const struct device_node *np, const char *name,
+			    int *lenp);
+
+#endif
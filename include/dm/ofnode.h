@@ -0,0 +1,239 @@
+/*
+ * Device tree node handles, for either the live or the flat tree
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _DM_OFNODE_H
+#define _DM_OFNODE_H
+
+#include <dm/of.h>
+#include <dm/of_access.h>
+
+/**
+ * ofnode - a handle for a device tree node
+ *
+ * Once the live tree is in use (see of_live_active()) this holds a pointer
+ * to a live node. Before that, and in SPL, it holds the offset of a node in
+ * the flat tree, gd->fdt_blob. Code which uses the ofnode_...() functions
+ * does not need to care which.
+ *
+ * @np:		Live node, or NULL for none
+ * @of_offset:	Flat tree offset, or -1 for none
+ */
+typedef union ofnode_union {
+	const struct device_node *np;
+	long of_offset;
+} ofnode;
+
+/**
+ * ofnode_to_np() - get the live node for a handle
+ *
+ * This must only be used when the live tree is in use.
+ *
+ * @node:	Handle to convert
+ * @return the live node, or NULL for none
+ */
+static inline const struct device_node *ofnode_to_np(ofnode node)
+{
+	return node.np;
+}
+
+/**
+ * ofnode_to_offset() - get the flat tree offset for a handle
+ *
+ * @node:	Handle to convert
+ * @return offset of the node in gd->fdt_blob, or -1 for none
+ */
+static inline int ofnode_to_offset(ofnode node)
+{
+	if (of_live_active())
+		return node.np ? node.np->offset : -1;
+
+	return node.of_offset;
+}
+
+/**
+ * ofnode_valid() - check whether a handle refers to a node
+ *
+ * @node:	Handle to check
+ * @return true if @node refers to a node
+ */
+static inline bool ofnode_valid(ofnode node)
+{
+	if (of_live_active())
+		return node.np != NULL;
+
+	return node.of_offset >= 0;
+}
+
+/**
+ * offset_to_ofnode() - get a handle for a flat tree offset
+ *
+ * @of_offset:	Offset of a node in gd->fdt_blob, or -ve for none
+ * @return handle for that node
+ */
+static inline ofnode offset_to_ofnode(int of_offset)
+{
+	ofnode node;
+
+	if (of_live_active())
+		node.np = of_offset >= 0 ? of_live_node(of_offset) : NULL;
+	else
+		node.of_offset = of_offset;
+
+	return node;
+}
+
+/**
+ * np_to_ofnode() - get a handle for a live node
+ *
+ * @np:		Live node, or NULL for none
+ * @return handle for that node
+ */
+static inline ofnode np_to_ofnode(const struct device_node *np)
+{
+	ofnode node;
+
+	node.np = np;
+
+	return node;
+}
+
+/**
+ * ofnode_null() - get a handle which refers to no node
+ *
+ * @return null handle
+ */
+static inline ofnode ofnode_null(void)
+{
+	return offset_to_ofnode(-1);
+}
+
+/**
+ * ofnode_equal() - check whether two handles refer to the same node
+ *
+ * @a:		First handle
+ * @b:		Second handle
+ * @return true if they are the same
+ */
+static inline bool ofnode_equal(ofnode a, ofnode b)
+{
+	return a.of_offset == b.of_offset;
+}
+
+/**
+ * ofnode_read_prop() - read a property
+ *
+ * @node:	Node to read from
+ * @propname:	Name of the property
+ * @sizep:	If non-NULL, returns the size of the property in bytes, or a
+ *		-ve libfdt error if not found, as fdt_getprop()
+ * @return the property value, or NULL if not found
+ */
+const void *ofnode_read_prop(ofnode node, const char *propname, int *sizep);
+
+/**
+ * ofnode_read_u32() - read a 32-bit integer from a property
+ *
+ * @node:	Node to read from
+ * @propname:	Name of the property
+ * @outp:	Returns the value, in CPU byte order, if found
+ * @return 0 if OK, -EINVAL if the property is missing, -EOVERFLOW if it is
+ * too short
+ */
+int ofnode_read_u32(ofnode node, const char *propname, u32 *outp);
+
+/**
+ * ofnode_read_u32_default() - read a 32-bit integer from a property
+ *
+ * @node:	Node to read from
+ * @propname:	Name of the property
+ * @def:	Value to return if the property is missing or too short
+ * @return the value read, or @def
+ */
+u32 ofnode_read_u32_default(ofnode node, const char *propname, u32 def);
+
+/**
+ * ofnode_read_string() - read a string from a property
+ *
+ * @node:	Node to read from
+ * @propname:	Name of the property
+ * @return the string, or NULL if the property is missing or empty
+ */
+const char *ofnode_read_string(ofnode node, const char *propname);
+
+/**
+ * ofnode_read_bool() - check whether a boolean property is present
+ *
+ * @node:	Node to read from
+ * @propname:	Name of the property
+ * @return true if the property is present
+ */
+bool ofnode_read_bool(ofnode node, const char *propname);
+
+/**
+ * ofnode_get_name() - get the name of a node
+ *
+ * @node:	Node to check
+ * @return the node name, including any unit address ("" for the root), or
+ * NULL if @node is not valid
+ */
+const char *ofnode_get_name(ofnode node);
+
+/**
+ * ofnode_get_parent() - get the parent of a node
+ *
+ * @node:	Node to check
+ * @return the parent node, or a null handle for the root
+ */
+ofnode ofnode_get_parent(ofnode node);
+
+/**
+ * ofnode_first_subnode() - get the first subnode of a node
+ *
+ * @node:	Node to check
+ * @return the first subnode, or a null handle if there are none
+ */
+ofnode ofnode_first_subnode(ofnode node);
+
+/**
+ * ofnode_next_subnode() - get the next sibling of a node
+ *
+ * @node:	Node to check
+ * @return the next node with the same parent, or a null handle if none
+ */
+ofnode ofnode_next_subnode(ofnode node);
+
+/**
+ * ofnode_find_subnode() - find a subnode by name
+ *
+ * As with fdt_subnode_offset(), a name without a unit address matches a
+ * node with any unit address.
+ *
+ * @node:		Node to look in
+ * @subnode_name:	Name of the subnode
+ * @return the subnode, or a null handle if not found
+ */
+ofnode ofnode_find_subnode(ofnode node, const char *subnode_name);
+
+/**
+ * ofnode_is_available() - check the "status" property of a node
+ *
+ * @node:	Node to check
+ * @return true if the node has no status property, or it is "okay"
+ */
+bool ofnode_is_available(ofnode node);
+
+/**
+ * ofnode_for_each_subnode() - iterate over the subnodes of a node
+ *
+ * @subnode:	ofnode to use as the iterator
+ * @node:	Node whose subnodes are wanted
+ */
+#define ofnode_for_each_subnode(subnode, node) \
+	for (subnode = ofnode_first_subnode(node); \
+	     ofnode_valid(subnode); \
+	     subnode = ofnode_next_subnode(subnode))
+
+#endif
@@ -115,4 +115,31 @@ int dm_init(void);
  */
 int dm_uninit(void);
 
+/**
+ * dm_probe_devices() - Probe a list of devices, overlapping slow probes
+ *
+ * Each device is probed once the devices it depends on have been: its
+ * nearest ancestor in the list and those in the list which its device tree
+ * node refers to in properties such as "clocks". Devices whose driver has
+ * a probe_poll() method are polled in turn until they are ready, so other
+ * devices can be probed in the meantime.
+ *
+ * @devs: Devices to probe
+ * @count: Number of devices in @devs
+ * @return 0 if all the devices were probed, else the first error. The other
+ * devices are probed regardless.
+ */
+int dm_probe_devices(struct udevice *const devs[], int count);
+
+/**
+ * dm_probe_uclasses() - Probe all the devices in a list of uclasses
+ *
+ * This uses dm_probe_devices() to probe all the devices bound in each
+ * uclass.
+ *
+ * @names: Names of the uclasses separated by spaces, e.g. "eth usb"
+ * @return 0 if all the devices were probed, else the first error
+ */
+int dm_probe_uclasses(const char *names);
+
 #endif
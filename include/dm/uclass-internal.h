@@ -63,7 +63,9 @@ int uclass_find_next_device(struct udevice **devp);
 /**
  * uclass_find_device_by_name() - Find uclass device based on ID and name
  *
- * This searches for a device with the exactly given name.
+ * This searches for a device with the exactly given name. If there is
+ * none, the first device whose name starts with @name is returned. So a
+ * device named "mmc1" is found for "mmc1" even when "mmc10" comes first.
  *
  * The device is NOT probed, it is merely returned.
  *
@@ -138,6 +140,78 @@ int uclass_unbind_device(struct udevice *dev);
 static inline int uclass_unbind_device(struct udevice *dev) { return 0; }
 #endif
 
+/**
+ * uclass_set_seq() - Set the sequence number of a device
+ *
+ * This also updates the uclass's table of devices by sequence number.
+ *
+ * @dev:	Pointer to the device
+ * @seq:	Sequence number, or -1 for none
+ */
+void uclass_set_seq(struct udevice *dev, int seq);
+
+/**
+ * struct uclass_index_stats - how a uclass's indexes are used
+ *
+ * @count:	Number of devices in each index
+ * @buckets:	Number of buckets in each index
+ * @longest:	Length of the longest chain in each index
+ * @seq_size:	Number of entries in the table of devices by sequence number
+ * @lookups:	Number of lookups which used an index
+ * @walks:	Number of lookups which walked the list of devices
+ */
+struct uclass_index_stats {
+	uint count[UCLASS_INDEX_COUNT];
+	uint buckets[UCLASS_INDEX_COUNT];
+	uint longest[UCLASS_INDEX_COUNT];
+	int seq_size;
+	uint lookups;
+	uint walks;
+};
+
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+/**
+ * uclass_index_device() - Add a device to its uclass's indexes
+ *
+ * This is done when the device is bound, and again after its name or
+ * device tree node changes.
+ *
+ * @dev:	Pointer to the device
+ */
+void uclass_index_device(struct udevice *dev);
+
+/**
+ * uclass_unindex_device() - Remove a device from its uclass's indexes
+ *
+ * @dev:	Pointer to the device
+ * @return true if the device was in the indexes, false if not (e.g. it is
+ * not bound yet, or the uclass has no indexes)
+ */
+bool uclass_unindex_device(struct udevice *dev);
+
+/**
+ * uclass_get_index_stats() - Get information about a uclass's indexes
+ *
+ * @uc:		uclass to check
+ * @stats:	Returns the information
+ * @return 0 if OK, -ENOENT if the uclass has no indexes
+ */
+int uclass_get_index_stats(struct uclass *uc,
+			   struct uclass_index_stats *stats);
+#else
+static inline void uclass_index_device(struct udevice *dev) {}
+static inline bool uclass_unindex_device(struct udevice *dev)
+{
+	return false;
+}
+
+static inline int uclass_get_index_stats(struct uclass *uc,
+					 struct uclass_index_stats *stats)
+{
+	return -ENOENT;
+}
+#endif
+
 /**
  * uclass_pre_probe_device() - Deal with a device that is about to be probed
  *
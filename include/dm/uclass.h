@@ -14,6 +14,32 @@
 #include <linker_lists.h>
 #include <linux/list.h>
 
+/* Indexes which a uclass keeps of its devices */
+enum uclass_index_id {
+	UCLASS_INDEX_NAME,
+	UCLASS_INDEX_OF_OFFSET,
+	UCLASS_INDEX_PHANDLE,
+
+	UCLASS_INDEX_COUNT,
+};
+
+/**
+ * struct uclass_index - a hash table of the devices in a uclass
+ *
+ * Devices with the same hash are chained through their index_next[] entry
+ * for this index, in the order they were added. Devices with no device
+ * tree phandle are left out of the phandle index.
+ *
+ * @bucket: First device in each chain, or NULL if the table is not in use
+ * @mask: Number of buckets - 1 (the number of buckets is a power of two)
+ * @count: Number of devices in the table
+ */
+struct uclass_index {
+	struct udevice **bucket;
+	uint mask;
+	uint count;
+};
+
 /**
  * struct uclass - a U-Boot drive class, collecting together similar drivers
  *
@@ -30,12 +56,26 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @index: Hash tables of the devices in @dev_head, by name, device tree
+ * offset and phandle, used to find devices without walking the list
+ * @seq_dev: Probed devices by sequence number, NULL where there is none
+ * @seq_size: Number of entries in @seq_dev, or -1 if the uclass has no
+ * indexes (e.g. before relocation), in which case the list is walked
+ * @lookups: Number of lookups which used an index
+ * @walks: Number of lookups which walked @dev_head
  */
 struct uclass {
 	void *priv;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+	struct uclass_index index[UCLASS_INDEX_COUNT];
+	struct udevice **seq_dev;
+	int seq_size;
+	uint lookups;
+	uint walks;
+#endif
 };
 
 struct driver;
@@ -126,6 +166,14 @@ int uclass_get(enum uclass_id key, struct uclass **ucp);
  */
 const char *uclass_get_name(enum uclass_id id);
 
+/**
+ * uclass_get_by_name() - Look up a uclass by the name of its driver
+ *
+ * @name: Name of the uclass driver, e.g. "mmc"
+ * @returns the ID of the uclass, or UCLASS_INVALID if none
+ */
+enum uclass_id uclass_get_by_name(const char *name);
+
 /**
  * uclass_get_device() - Get a uclass device based on an ID and index
  *
@@ -142,6 +190,8 @@ int uclass_get_device(enum uclass_id id, int index, struct udevice **devp);
  * uclass_get_device_by_name() - Get a uclass device by its name
  *
  * This searches the devices in the uclass for one with the exactly given name.
+ * If there is none, the first device whose name starts with @name is used,
+ * as for uclass_find_device_by_name().
  *
  * The device is probed to activate it ready for use.
  *
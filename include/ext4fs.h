@@ -116,6 +116,15 @@ struct ext_filesystem {
 	struct blk_desc *dev_desc;
 };
 
+/* Directory lookup statistics */
+struct ext4_dir_stats {
+	unsigned long lookups;		/* path components looked up */
+	unsigned long hits;		/* lookups served by the dentry cache */
+	unsigned long htree;		/* lookups using the hash tree index */
+	unsigned long blocks;		/* directory blocks read */
+	unsigned int last_blocks;	/* blocks read by the last lookup */
+};
+
 extern struct ext2_data *ext4fs_root;
 extern struct ext2fs_node *ext4fs_file;
 
@@ -152,4 +161,6 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 		   loff_t *actread);
 int ext4_read_superblock(char *buffer);
 int ext4fs_uuid(char *uuid_str);
+void ext4fs_dcache_invalidate(void);
+void ext4fs_dir_stats(struct ext4_dir_stats *stats);
 #endif
@@ -448,6 +448,21 @@ int fdtdec_get_pci_vendev(const void *blob, int node,
 int fdtdec_get_pci_bar32(struct udevice *dev, struct fdt_pci_addr *addr,
 			 u32 *bar);
 
+/**
+ * Look up a property in a node. This is the same as fdt_getprop(), except
+ * that once the live tree is in use (see CONFIG_OF_LIVE), properties of the
+ * control FDT are found through that, which is faster.
+ *
+ * @param blob	FDT blob
+ * @param node	node to examine
+ * @param prop_name	name of property to find
+ * @param lenp	if non-NULL, returns the property length in bytes, or a -ve
+ *		libfdt error if it is not found
+ * @return pointer to the property value, or NULL if not found
+ */
+const void *fdtdec_getprop(const void *blob, int node, const char *prop_name,
+			   int *lenp);
+
 /**
  * Look up a 32-bit integer property in a node and return it. The property
  * must have at least 4 bytes of data. The value of the first cell is
@@ -292,6 +292,7 @@ enum {
 	IH_COMP_LZMA,			/* lzma  Compression Used	*/
 	IH_COMP_LZO,			/* lzo   Compression Used	*/
 	IH_COMP_LZ4,			/* lz4   Compression Used	*/
+	IH_COMP_ZSTD,			/* zstd  Compression Used	*/
 
 	IH_COMP_COUNT,
 };
@@ -321,6 +322,22 @@ typedef struct image_header {
 	uint8_t		ih_name[IH_NMLEN];	/* Image Name		*/
 } image_header_t;
 
+#define IH_CHUNK_MAGIC	0x55434b31	/* Chunked Image Magic ("UCK1")	*/
+
+/*
+ * Compressed image data made up of chunks which were compressed one by
+ * one, so that they can be decompressed in parallel. The data starts with
+ * this table, followed by the compressed chunks one after the other. Each
+ * chunk except the last decompresses to ch_size bytes. All fields are in
+ * network byte order.
+ */
+struct image_chunk_header {
+	__be32		ch_magic;	/* Chunked Image Magic Number	*/
+	__be32		ch_count;	/* Number of chunks		*/
+	__be32		ch_size;	/* Uncompressed Chunk Size	*/
+	__be32		ch_len[];	/* Compressed size of each chunk */
+};
+
 typedef struct image_info {
 	ulong		start, end;		/* start/end of blob */
 	ulong		image_start, image_len; /* start of image within blob, len of image */
@@ -876,6 +893,8 @@ int bootz_setup(ulong image, ulong *start, ulong *end);
 #define FIT_COMP_PROP		"compression"
 #define FIT_ENTRY_PROP		"entry"
 #define FIT_LOAD_PROP		"load"
+#define FIT_BUNDLE_PROP		"bundle"
+#define FIT_BUNDLE_OFFSET_PROP	"bundle-offset"
 
 /* configuration node */
 #define FIT_KERNEL_PROP		"kernel"
@@ -980,6 +999,83 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 			      const char *engine_id);
 
 int fit_image_verify(const void *fit, int noffset);
+
+/* Maximum number of hash nodes of an image which can be hashed as it loads */
+#define FIT_HASH_STREAM_MAX	4
+
+/**
+ * struct fit_hash_stream - state for hashing an image while it is loaded
+ *
+ * @fit:	FIT containing the image
+ * @image_noffset:	Offset of the image node
+ * @count:	Number of entries in @hash
+ * @hash:	Progressive hash state for each hash node, in node order.
+ *		Nodes whose algorithm cannot be used progressively are
+ *		hashed by fit_image_hash_finish() instead.
+ */
+struct fit_hash_stream {
+	const void *fit;
+	int image_noffset;
+	int count;
+	struct {
+		int noffset;
+		struct hash_algo *algo;
+		void *ctx;
+		int value_len;
+		uint8_t value[FIT_MAX_HASH_LEN];
+	} hash[FIT_HASH_STREAM_MAX];
+};
+
+/**
+ * fit_image_hash_start() - start hashing an image as it is loaded
+ *
+ * This allows the image's hashes to be calculated a chunk at a time, while
+ * each chunk is still in the cache, rather than in a second pass over the
+ * whole image once it has been loaded.
+ *
+ * @hs:		Stream state to set up
+ * @fit:	FIT containing the image
+ * @image_noffset:	Offset of the image node
+ */
+void fit_image_hash_start(struct fit_hash_stream *hs, const void *fit,
+			  int image_noffset);
+
+/**
+ * fit_image_hash_update() - add the next chunk of image data to the hashes
+ *
+ * @hs:		Stream state
+ * @data:	Next chunk of the image data
+ * @size:	Size of the chunk in bytes
+ */
+void fit_image_hash_update(struct fit_hash_stream *hs, const void *data,
+			   size_t size);
+
+/**
+ * fit_image_hash_finish() - verify an image hashed as it was loaded
+ *
+ * This checks each hash node of the image against the value calculated by
+ * fit_image_hash_update(), and otherwise behaves like fit_image_verify().
+ * The image data is only read again for signatures and for algorithms which
+ * cannot be used progressively.
+ *
+ * @hs:		Stream state
+ * @data:	Image data, which must be complete
+ * @size:	Size of the image data in bytes
+ * @return 1 if all hashes are valid, 0 otherwise (or on error)
+ */
+int fit_image_hash_finish(struct fit_hash_stream *hs, const void *data,
+			  size_t size);
+
+/**
+ * fit_image_hash_abort() - give up hashing an image as it is loaded
+ *
+ * This releases the hash state when loading fails before the image is
+ * complete, so fit_image_hash_finish() will not be called.
+ *
+ * @hs:		Stream state
+ */
+void fit_image_hash_abort(struct fit_hash_stream *hs);
+
 int fit_config_verify(const void *fit, int conf_noffset);
 int fit_all_image_verify(const void *fit);
 int fit_image_check_os(const void *fit, int noffset, uint8_t os);
@@ -3,6 +3,7 @@
 #ifdef __KERNEL__
 
 #include <asm/types.h>
+#include <linux/rbtree.h>
 /*
  * Logical memory blocks.
  *
@@ -11,17 +12,39 @@
  * SPDX-License-Identifier:	GPL-2.0+
  */
 
-#define MAX_LMB_REGIONS 8
-
+/**
+ * struct lmb_property - a region of memory
+ *
+ * @node:	Link in the tree of regions, which is sorted by @base
+ * @base:	Start address of the region
+ * @size:	Size of the region in bytes
+ * @count:	Number of reservations covering the region, for reserved regions
+ */
 struct lmb_property {
+	struct rb_node node;
 	phys_addr_t base;
 	phys_size_t size;
+	uint count;
 };
 
+/**
+ * struct lmb_region - a set of regions
+ *
+ * The regions never overlap, so the region overlapping an address range can
+ * be found with a single search of the tree. Memory regions are merged as
+ * they are added. Reserved regions are split where reservations overlap,
+ * and each part counts the reservations covering it.
+ *
+ * @root:	Tree of regions (struct lmb_property)
+ * @cnt:	Number of regions
+ * @max_cnt:	Highest value reached by @cnt
+ * @size:	Total size of the regions in bytes
+ */
 struct lmb_region {
+	struct rb_root root;
 	unsigned long cnt;
+	unsigned long max_cnt;
 	phys_size_t size;
-	struct lmb_property region[MAX_LMB_REGIONS+1];
 };
 
 struct lmb {
@@ -32,6 +55,7 @@ struct lmb {
 extern struct lmb lmb;
 
 extern void lmb_init(struct lmb *lmb);
+extern void lmb_uninit(struct lmb *lmb);
 extern long lmb_add(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 extern long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 extern phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align);
@@ -44,11 +68,14 @@ extern long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size);
 
 extern void lmb_dump_all(struct lmb *lmb);
 
-static inline phys_size_t
-lmb_size_bytes(struct lmb_region *type, unsigned long region_nr)
-{
-	return type->region[region_nr].size;
-}
+/**
+ * lmb_get_free() - find how much memory is not reserved
+ *
+ * @lmb:	LMB to check
+ * @largestp:	Returns the size of the largest free block
+ * @return total size of the free blocks
+ */
+phys_size_t lmb_get_free(struct lmb *lmb, phys_size_t *largestp);
 
 void board_lmb_reserve(struct lmb *lmb);
 void arch_lmb_reserve(struct lmb *lmb);
@@ -0,0 +1,159 @@
+/*
+ * Interface to the LZ4 frame decoder in lib/lz4_wrapper.c, which uses the
+ * block decoder from the LZ4 project (lib/lz4.c):
+ *
+ * LZ4 - Fast LZ compression algorithm
+ * Copyright (C) 2011-2015, Yann Collet.
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ *
+ * LZ4 source repository : https://github.com/Cyan4973/lz4
+ */
+
+#ifndef __LZ4_H
+#define __LZ4_H
+
+/**
+ * struct ulz4_stream - state for decompressing an LZ4 frame piecewise
+ *
+ * @state:	Part of the frame expected next
+ * @has_block_checksum:	Each block is followed by a 32-bit checksum
+ * @has_content_size:	The frame header includes the content size
+ * @block:	Raw header of the block being gathered
+ * @dst:	Start of the output buffer
+ * @out:	Next byte of output
+ * @end:	End of the output buffer
+ * @hdr:	Staging buffer for headers which span two pieces of input
+ * @buf:	Staging buffer for blocks which span two pieces of input
+ * @buf_size:	Size of @buf in bytes
+ * @have:	Number of bytes gathered in the staging buffer so far
+ */
+struct ulz4_stream {
+	int state;
+	bool has_block_checksum;
+	bool has_content_size;
+	u32 block;
+	u8 *dst;
+	u8 *out;
+	u8 *end;
+	u8 hdr[16];
+	u8 *buf;
+	size_t buf_size;
+	size_t have;
+};
+
+/**
+ * ulz4_stream_init() - prepare to decompress an LZ4 frame piecewise
+ *
+ * @s:		Stream state to set up
+ * @dst:	Output buffer
+ * @dstn:	Size of the output buffer in bytes
+ */
+void ulz4_stream_init(struct ulz4_stream *s, void *dst, size_t dstn);
+
+/**
+ * ulz4_stream_feed() - decompress the next piece of an LZ4 frame
+ *
+ * The frame may be split into pieces of any size. Blocks which lie within
+ * a single piece are decompressed straight from it, others are gathered in
+ * a staging buffer first.
+ *
+ * @s:		Stream state
+ * @src:	Next piece of input
+ * @srcn:	Size of the piece in bytes
+ * @return 1 if the end of the frame was reached, 0 if more input is
+ *	needed, or -ve error as for ulz4fn()
+ */
+int ulz4_stream_feed(struct ulz4_stream *s, const void *src, size_t srcn);
+
+/**
+ * ulz4_stream_end() - finish decompressing and free the stream's buffers
+ *
+ * @s:		Stream state
+ * @return number of bytes written to the output buffer
+ */
+size_t ulz4_stream_end(struct ulz4_stream *s);
+
+/**
+ * struct ulz4_index - block index of an LZ4 frame, for random access
+ *
+ * Since each block of a frame with independent blocks can be decompressed
+ * on its own, an index of where the blocks start is enough to decompress
+ * any part of the frame without touching the blocks before it. Every block
+ * except the last is expected to decompress to the frame's maximum block
+ * size, which is what the lz4 tool produces.
+ *
+ * @src:	Start of the frame
+ * @block_size:	Uncompressed size of each block except the last
+ * @count:	Number of blocks
+ * @offset:	Offset of each block's header from @src
+ * @buf:	Last block which was only partly needed, or NULL
+ * @buf_block:	Index of the block in @buf
+ * @buf_len:	Uncompressed size of the block in @buf
+ */
+struct ulz4_index {
+	const u8 *src;
+	size_t block_size;
+	uint count;
+	size_t *offset;
+	u8 *buf;
+	uint buf_block;
+	size_t buf_len;
+};
+
+/**
+ * ulz4_index_init() - build the block index of an LZ4 frame
+ *
+ * This only reads the block headers, so it is cheap even for large frames.
+ * The frame must stay in place until ulz4_index_free() is called.
+ *
+ * @idx:	Index to set up
+ * @src:	LZ4 frame
+ * @srcn:	Size of the frame in bytes
+ * @return 0 if OK, -EPROTONOSUPPORT if the frame is not a supported LZ4
+ *	frame, -EINVAL if it is truncated or corrupt, -ENOMEM if out of memory
+ */
+int ulz4_index_init(struct ulz4_index *idx, const void *src, size_t srcn);
+
+/**
+ * ulz4_index_read() - decompress part of an indexed LZ4 frame
+ *
+ * Only the blocks which overlap the requested range are decompressed.
+ * Reading fewer bytes than requested is not an error if the range extends
+ * past the end of the data.
+ *
+ * @idx:	Index of the frame, from ulz4_index_init()
+ * @offset:	Offset of the first byte to read, in the uncompressed data
+ * @dst:	Buffer to decompress into
+ * @dstn:	Number of bytes to read; updated to the number actually read
+ * @return 0 if OK, -EPROTO if the data is corrupt or a block other than
+ *	the last is not full, -ENOMEM if out of memory
+ */
+int ulz4_index_read(struct ulz4_index *idx, size_t offset, void *dst,
+		    size_t *dstn);
+
+/**
+ * ulz4_index_free() - free the memory used by an index
+ *
+ * @idx:	Index to free
+ */
+void ulz4_index_free(struct ulz4_index *idx);
+
+/**
+ * ulz4fn_range() - decompress part of an LZ4 frame
+ *
+ * This is a shortcut for building an index with ulz4_index_init(), reading
+ * one range with ulz4_index_read() and freeing the index again.
+ *
+ * @src:	LZ4 frame
+ * @srcn:	Size of the frame in bytes
+ * @offset:	Offset of the first byte to read, in the uncompressed data
+ * @dst:	Buffer to decompress into
+ * @dstn:	Number of bytes to read; updated to the number actually read
+ * @return 0 if OK, -ve on error as for ulz4_index_init() and
+ *	ulz4_index_read()
+ */
+int ulz4fn_range(const void *src, size_t srcn, size_t offset, void *dst,
+		 size_t *dstn);
+
+#endif
@@ -599,7 +599,7 @@ struct mallinfo {
   int smblks;   /* unused -- always zero */
   int hblks;    /* number of mmapped regions */
   int hblkhd;   /* total space in mmapped regions */
-  int usmblks;  /* unused -- always zero */
+  int usmblks;  /* maximum total space allocated from system */
   int fsmblks;  /* unused -- always zero */
   int uordblks; /* total allocated space */
   int fordblks; /* total non-inuse space */
@@ -0,0 +1,78 @@
+/*
+ * Heap usage by call site
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __MALLOC_TRACE_H
+#define __MALLOC_TRACE_H
+
+/**
+ * struct malloc_trace_site - heap usage of one call site
+ *
+ * Allocations made before the full malloc() pool is ready come from the
+ * pre-relocation pool, where free() does nothing. These are kept apart from
+ * those made later by the same caller. Allocations made before relocation
+ * are not recorded.
+ *
+ * @caller:	Address the allocation returns to, as linked (i.e. before
+ *		relocation), or 0 for all callers which did not fit in the table
+ * @early:	true if this records the pre-relocation pool
+ * @count:	Number of allocations made
+ * @live:	Bytes allocated and not yet freed
+ * @peak:	Highest value reached by @live
+ */
+struct malloc_trace_site {
+	ulong caller;
+	bool early;
+	uint count;
+	ulong live;
+	ulong peak;
+};
+
+/**
+ * struct malloc_trace_stats - heap usage over all call sites
+ *
+ * @live:	Bytes allocated from the full pool and not yet freed
+ * @peak:	Highest value reached by @live
+ * @early_peak:	Bytes used in the pre-relocation pool, including alignment
+ * @untracked:	Number of allocations from the full pool left out of @live,
+ *		because there was no room to record them until they are freed
+ */
+struct malloc_trace_stats {
+	ulong live;
+	ulong peak;
+	ulong early_peak;
+	uint untracked;
+};
+
+#if CONFIG_IS_ENABLED(MALLOC_TRACE)
+/**
+ * malloc_trace_alloc() - record an allocation
+ *
+ * @ptr:	Memory allocated, or NULL if the allocation failed
+ * @size:	Number of bytes requested
+ * @caller:	Return address of the allocation function
+ */
+void malloc_trace_alloc(void *ptr, size_t size, void *caller);
+
+/**
+ * malloc_trace_free() - record that memory is freed
+ *
+ * @ptr:	Memory freed, or NULL to do nothing
+ */
+void malloc_trace_free(void *ptr);
+
+/**
+ * malloc_trace_get_stats() - get the heap usage
+ *
+ * @stats:	Returns the totals over all call sites
+ * @sitesp:	Returns the table of call sites, in no particular order.
+ *		Unused entries have a @count of 0.
+ * @return number of entries in the table
+ */
+int malloc_trace_get_stats(struct malloc_trace_stats *stats,
+			   const struct malloc_trace_site **sitesp);
+#endif
+
+#endif
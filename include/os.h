@@ -92,6 +92,16 @@ int os_close(int fd);
  */
 int os_unlink(const char *pathname);
 
+/**
+ * Access to the OS mkstemp() system call
+ *
+ * \param fname Template for the filename, ending in "XXXXXX", which is
+ *	replaced with the name of the new file
+ * \return file descriptor of the new, empty file, open for reading and
+ *	writing, or -1 on error
+ */
+int os_mkstemp(char *fname);
+
 /**
  * Access to the OS exit() system call
  *
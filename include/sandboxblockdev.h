@@ -13,6 +13,9 @@ struct host_block_dev {
 #endif
 	char *filename;
 	int fd;
+#ifdef CONFIG_BLK_ASYNC
+	struct list_head queue;		/* outstanding asynchronous requests */
+#endif
 };
 
 int host_dev_bind(int dev, char *filename);
@@ -16,6 +16,7 @@
 #define _SEARCH_H_
 
 #include <stddef.h>
+#include <linux/rbtree.h>
 
 #define __set_errno(val) do { errno = val; } while (0)
 
@@ -39,8 +40,9 @@ typedef struct entry {
 	int flags;
 } ENTRY;
 
-/* Opaque type for internal use.  */
+/* Opaque types for internal use.  */
 struct _ENTRY;
+struct _HSLOT;
 
 /*
  * Family of hash table handling functions.  The functions also
@@ -48,11 +50,25 @@ struct _ENTRY;
  * functions all work on a single internal hash table.
  */
 
-/* Data type for reentrant functions.  */
+/*
+ * Data type for reentrant functions.
+ *
+ * The table grows as entries are added. While it does, the slots of the
+ * previous table are moved across a few at a time, and searches look in
+ * both.
+ */
 struct hsearch_data {
-	struct _ENTRY *table;
+	struct _HSLOT *table;
 	unsigned int size;
 	unsigned int filled;
+	struct _HSLOT *old_table;	/* table being emptied, or NULL */
+	unsigned int old_size;
+	unsigned int old_next;		/* next slot of old_table to move */
+	struct rb_root sorted;		/* all entries, sorted by key */
+	unsigned long lookups;		/* number of searches */
+	unsigned long probes;		/* number of slots looked at */
+	unsigned int max_probes;	/* most slots looked at by one search */
+	unsigned int grows;		/* number of times the table grew */
 /*
  * Callback function which will check whether the given change for variable
  * "__item" to "newval" may be applied or not, and possibly apply such change.
@@ -64,7 +80,10 @@ struct hsearch_data {
 		int flag);
 };
 
-/* Create a new hash table which will contain at most "__nel" elements.  */
+/*
+ * Create a new hash table with room for "__nel" elements. The table grows
+ * if more are added.
+ */
 extern int hcreate_r(size_t __nel, struct hsearch_data *__htab);
 
 /* Destroy current internal hash table.  */
@@ -103,9 +122,28 @@ extern int himport_r(struct hsearch_data *__htab,
 		     int __flag, int __crlf_is_lf, int nvars,
 		     char * const vars[]);
 
-/* Walk the whole table calling the callback on each element */
+/* Walk the whole table calling the callback on each element, by key */
 extern int hwalk_r(struct hsearch_data *__htab, int (*callback)(ENTRY *));
 
+/* Find the entry following "__key" by key, or the first if it is NULL */
+extern ENTRY *hnext_r(struct hsearch_data *__htab, const char *__key);
+
+/* Statistics about a hash table, see hstats_r() */
+struct hsearch_stats {
+	unsigned int size;		/* slots in the table */
+	unsigned int filled;		/* entries in the table */
+	unsigned int old_left;		/* slots of the old table not moved */
+	unsigned long lookups;		/* number of searches */
+	unsigned long probes;		/* number of slots looked at */
+	unsigned int max_probes;	/* most slots looked at by one search */
+	unsigned int grows;		/* number of times the table grew */
+	unsigned long mem;		/* bytes of memory used, incl. strings */
+};
+
+/* Get statistics about the table, for tuning */
+extern void hstats_r(struct hsearch_data *__htab,
+		     struct hsearch_stats *__stats);
+
 /* Flags for himport_r(), hexport_r(), hdelete_r(), and hsearch_r() */
 #define H_NOCLEAR	(1 << 0) /* do not clear hash table before importing */
 #define H_FORCE		(1 << 1) /* overwrite read-only/write-once variables */
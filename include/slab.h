@@ -0,0 +1,101 @@
+/*
+ * Size-class allocator for small driver-model objects
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __SLAB_H
+#define __SLAB_H
+
+#include <malloc.h>
+
+/* Size classes run from SLAB_MIN_SIZE to SLAB_MAX_SIZE, in powers of two */
+#define SLAB_MIN_SIZE		16
+#define SLAB_MAX_SIZE		512
+#define SLAB_CLASS_COUNT	6
+#define SLAB_PAGE_SIZE		2048
+
+/**
+ * struct slab_class_stats - usage of one size class
+ *
+ * @size:	Size of each object in bytes
+ * @pages:	Number of arena pages holding objects of this size
+ * @used:	Number of objects in use
+ * @peak:	Highest value reached by @used
+ */
+struct slab_class_stats {
+	uint size;
+	uint pages;
+	uint used;
+	uint peak;
+};
+
+/**
+ * struct slab_stats - usage of the slab allocator
+ *
+ * @arena_size:	Size of the arena in bytes, 0 if it is not set up yet
+ * @pages:	Number of pages in the arena
+ * @pages_used:	Number of pages given to a size class
+ * @pages_peak:	Highest value reached by @pages_used
+ * @inuse:	Bytes in objects handed out, counting whole objects
+ * @fallbacks:	Number of allocations passed to malloc() because they were
+ *		too large or the arena was full
+ * @cls:	Usage of each size class
+ */
+struct slab_stats {
+	ulong arena_size;
+	uint pages;
+	uint pages_used;
+	uint pages_peak;
+	ulong inuse;
+	ulong fallbacks;
+	struct slab_class_stats cls[SLAB_CLASS_COUNT];
+};
+
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/**
+ * slab_zalloc() - allocate a zeroed object
+ *
+ * Objects of up to SLAB_MAX_SIZE bytes come from a per-size free list in a
+ * fixed arena. Larger objects, and any allocation made before the full
+ * malloc() pool is ready or once the arena is full, use calloc() instead.
+ *
+ * @size:	Size of the object in bytes
+ * @return pointer to the object, or NULL if out of memory
+ */
+void *slab_zalloc(size_t size);
+
+/**
+ * slab_free() - free an object allocated with slab_zalloc()
+ *
+ * Pointers from outside the arena are passed to free(), so this can be
+ * used for any memory allocated with malloc() as well.
+ *
+ * @ptr:	Object to free, or NULL to do nothing
+ */
+void slab_free(void *ptr);
+
+/**
+ * slab_get_stats() - get the usage of the slab allocator
+ *
+ * @stats:	Returns the current usage
+ */
+void slab_get_stats(struct slab_stats *stats);
+#else
+static inline void *slab_zalloc(size_t size)
+{
+	return calloc(1, size);
+}
+
+static inline void slab_free(void *ptr)
+{
+	free(ptr);
+}
+
+static inline void slab_get_stats(struct slab_stats *stats)
+{
+	memset(stats, '\0', sizeof(*stats));
+}
+#endif
+
+#endif
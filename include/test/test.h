@@ -14,11 +14,13 @@
  *
  * @fail_count: Number of tests that failed
  * @start: Store the starting mallinfo when doing leak test
+ * @start_slab: Store the bytes used in the slab allocator when doing leak test
  * @priv: A pointer to some other info some suites want to track
  */
 struct unit_test_state {
 	int fail_count;
 	struct mallinfo start;
+	ulong start_slab;
 	void *priv;
 };
 
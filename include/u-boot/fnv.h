@@ -0,0 +1,31 @@
+/*
+ * FNV-1a string hash
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _UBOOT_FNV_H
+#define _UBOOT_FNV_H
+
+/**
+ * fnv1a_str() - Hash a string for a hash table
+ *
+ * This is FNV-1a, with the high bits folded into the low ones so that a
+ * table index can be taken from the low bits.
+ *
+ * @str:	Nul-terminated string to hash
+ * @return hash value
+ */
+static inline unsigned int fnv1a_str(const char *str)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619;
+	}
+
+	return hash ^ (hash >> 15);
+}
+
+#endif /* _UBOOT_FNV_H */
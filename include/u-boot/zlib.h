@@ -434,6 +434,7 @@ typedef struct z_stream_s {
 	cb_func	outcb;	/* called regularly just before blocks of output */
 	uLong	adler;	/* adler32 value of the uncompressed data */
 	uLong	reserved;	/* reserved for future use */
+	int	no_watchdog;	/* do not reset the watchdog while inflating */
 } z_stream;
 
 typedef z_stream FAR *z_streamp;
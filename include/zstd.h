@@ -0,0 +1,53 @@
+/*
+ * Zstandard decompression
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ZSTD_H
+#define __ZSTD_H
+
+/**
+ * zstd_decompress() - decompress zstd frames held in memory
+ *
+ * All frames in the input are decompressed one after the other, and
+ * skippable frames are ignored. Content checksums are verified when
+ * present. Frames which need a dictionary are not supported.
+ *
+ * @src:	Compressed data
+ * @srcn:	Size of the compressed data in bytes
+ * @dst:	Output buffer
+ * @dstn:	On entry, size of the output buffer in bytes. On exit, the
+ *		number of bytes written to it
+ * @return 0 if OK, -ENOBUFS if the output buffer is too small, -EINVAL if
+ *	the data is corrupt, -EPROTONOSUPPORT if it is not in zstd format or
+ *	needs a dictionary, -ENOMEM if out of memory
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/**
+ * zstd_ws_size() - get the size of the workspace for zstd_decompress_ws()
+ *
+ * @return size in bytes
+ */
+size_t zstd_ws_size(void);
+
+/**
+ * zstd_decompress_ws() - decompress zstd frames using a given workspace
+ *
+ * This is the same as zstd_decompress() but does not allocate memory, so
+ * it can be used where malloc() is not available, such as on a secondary
+ * CPU.
+ *
+ * @src:	Compressed data
+ * @srcn:	Size of the compressed data in bytes
+ * @dst:	Output buffer
+ * @dstn:	On entry, size of the output buffer in bytes. On exit, the
+ *		number of bytes written to it
+ * @ws:		Workspace of zstd_ws_size() bytes, aligned to 8 bytes
+ * @return 0 if OK, or an error as for zstd_decompress()
+ */
+int zstd_decompress_ws(const void *src, size_t srcn, void *dst, size_t *dstn,
+		       void *ws);
+
+#endif
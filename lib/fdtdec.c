@@ -12,6 +12,8 @@
 #include <fdt_support.h>
 #include <fdtdec.h>
 #include <asm/sections.h>
+#include <dm/bind_table.h>
+#include <dm/of_access.h>
 #include <linux/ctype.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -96,7 +98,7 @@ fdt_addr_t fdtdec_get_addr_size_fixed(const void *blob, int node,
 		return FDT_ADDR_T_NONE;
 	}
 
-	prop = fdt_getprop(blob, node, prop_name, &len);
+	prop = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!prop) {
 		debug("(not found)\n");
 		return FDT_ADDR_T_NONE;
@@ -130,6 +132,38 @@ fdt_addr_t fdtdec_get_addr_size_fixed(const void *blob, int node,
 	return addr;
 }
 
+/*
+ * Get the parent of a node. With the live tree this follows a pointer,
+ * while fdt_parent_offset() has to walk the flat tree from the start.
+ */
+static int fdtdec_parent_offset(const void *blob, int node)
+{
+	const struct device_node *np = of_live_find(blob, node);
+
+	if (np)
+		return np->parent ? np->parent->offset : -FDT_ERR_NOTFOUND;
+	return fdt_parent_offset(blob, node);
+}
+
+/* The same as fdt_address_cells() and fdt_size_cells(), for @prop_name */
+static int fdtdec_get_cells(const void *blob, int node, const char *prop_name,
+			    int min)
+{
+	const fdt32_t *cell;
+	int val, len;
+
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
+	if (!cell)
+		return 2;
+	if (len != sizeof(*cell))
+		return -FDT_ERR_BADNCELLS;
+	val = fdt32_to_cpu(*cell);
+	if (val < min || val > FDT_MAX_NCELLS)
+		return -FDT_ERR_BADNCELLS;
+
+	return val;
+}
+
 fdt_addr_t fdtdec_get_addr_size_auto_parent(const void *blob, int parent,
 		int node, const char *prop_name, int index, fdt_size_t *sizep,
 		bool translate)
@@ -138,13 +172,13 @@ fdt_addr_t fdtdec_get_addr_size_auto_parent(const void *blob, int parent,
 
 	debug("%s: ", __func__);
 
-	na = fdt_address_cells(blob, parent);
+	na = fdtdec_get_cells(blob, parent, "#address-cells", 1);
 	if (na < 1) {
 		debug("(bad #address-cells)\n");
 		return FDT_ADDR_T_NONE;
 	}
 
-	ns = fdt_size_cells(blob, parent);
+	ns = fdtdec_get_cells(blob, parent, "#size-cells", 0);
 	if (ns < 0) {
 		debug("(bad #size-cells)\n");
 		return FDT_ADDR_T_NONE;
@@ -164,7 +198,7 @@ fdt_addr_t fdtdec_get_addr_size_auto_noparent(const void *blob, int node,
 
 	debug("%s: ", __func__);
 
-	parent = fdt_parent_offset(blob, node);
+	parent = fdtdec_parent_offset(blob, node);
 	if (parent < 0) {
 		debug("(no parent found)\n");
 		return FDT_ADDR_T_NONE;
@@ -206,7 +240,7 @@ int fdtdec_get_pci_addr(const void *blob, int node, enum fdt_pci_space type,
 	 * #size-cells. They need to be 3 and 2 accordingly. However,
 	 * for simplicity we skip the check here.
 	 */
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!cell)
 		goto fail;
 
@@ -250,7 +284,7 @@ int fdtdec_get_pci_vendev(const void *blob, int node, u16 *vendor, u16 *device)
 	const char *list, *end;
 	int len;
 
-	list = fdt_getprop(blob, node, "compatible", &len);
+	list = fdtdec_getprop(blob, node, "compatible", &len);
 	if (!list)
 		return -ENOENT;
 
@@ -306,7 +340,7 @@ uint64_t fdtdec_get_uint64(const void *blob, int node, const char *prop_name,
 	const uint64_t *cell64;
 	int length;
 
-	cell64 = fdt_getprop(blob, node, prop_name, &length);
+	cell64 = fdtdec_getprop(blob, node, prop_name, &length);
 	if (!cell64 || length < sizeof(*cell64))
 		return default_val;
 
@@ -324,7 +358,7 @@ int fdtdec_get_is_enabled(const void *blob, int node)
 	 *
 	 * http://www.mail-archive.com/u-boot@lists.denx.de/msg71598.html
 	 */
-	cell = fdt_getprop(blob, node, "status", NULL);
+	cell = fdtdec_getprop(blob, node, "status", NULL);
 	if (cell)
 		return 0 == strcmp(cell, "okay");
 	return 1;
@@ -517,6 +551,10 @@ int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 	int prop_offset;
 	int aliases;
 
+	/* The bind table has the aliases for each node */
+	if (dm_bind_table_find(blob, offset))
+		return dm_bind_table_alias_seq(base, offset, seqp);
+
 	find_name = fdt_get_name(blob, offset, &find_namelen);
 	debug("Looking for '%s' at %d, name %s\n", base, offset, find_name);
 
@@ -557,7 +595,7 @@ const char *fdtdec_get_chosen_prop(const void *blob, const char *name)
 	if (!blob)
 		return NULL;
 	chosen_node = fdt_path_offset(blob, "/chosen");
-	return fdt_getprop(blob, chosen_node, name, NULL);
+	return fdtdec_getprop(blob, chosen_node, name, NULL);
 }
 
 int fdtdec_get_chosen_node(const void *blob, const char *name)
@@ -614,7 +652,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	int lookup;
 
 	debug("%s: %s\n", __func__, prop_name);
-	phandle = fdt_getprop(blob, node, prop_name, NULL);
+	phandle = fdtdec_getprop(blob, node, prop_name, NULL);
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
@@ -640,7 +678,7 @@ static const void *get_prop_check_min_len(const void *blob, int node,
 	int len;
 
 	debug("%s: %s\n", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!cell)
 		*err = -FDT_ERR_NOTFOUND;
 	else if (len < min_len)
@@ -674,7 +712,7 @@ int fdtdec_get_int_array_count(const void *blob, int node,
 	int i;
 
 	debug("%s: %s\n", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!cell)
 		return -FDT_ERR_NOTFOUND;
 	elems = len / sizeof(u32);
@@ -703,7 +741,7 @@ int fdtdec_get_bool(const void *blob, int node, const char *prop_name)
 	int len;
 
 	debug("%s: %s\n", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	return cell != NULL;
 }
 
@@ -720,7 +758,7 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 	int phandle;
 
 	/* Retrieve the phandle list property */
-	list = fdt_getprop(blob, src_node, list_name, &size);
+	list = fdtdec_getprop(blob, src_node, list_name, &size);
 	if (!list)
 		return -ENOENT;
 	list_end = list + size / sizeof(*list);
@@ -903,7 +941,7 @@ char *fdtdec_get_config_string(const void *blob, const char *prop_name)
 	if (nodeoffset < 0)
 		return NULL;
 
-	nodep = fdt_getprop(blob, nodeoffset, prop_name, &len);
+	nodep = fdtdec_getprop(blob, nodeoffset, prop_name, &len);
 	if (!nodep)
 		return NULL;
 
@@ -918,7 +956,7 @@ int fdtdec_decode_region(const void *blob, int node, const char *prop_name,
 
 	debug("%s: %s: %s\n", __func__, fdt_get_name(blob, node, NULL),
 	      prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (!cell || (len < sizeof(fdt_addr_t) * 2)) {
 		debug("cell=%p, len=%d\n", cell, len);
 		return -1;
@@ -954,10 +992,10 @@ int fdtdec_read_fmap_entry(const void *blob, int node, const char *name,
 	entry->offset = reg[0];
 	entry->length = reg[1];
 	entry->used = fdtdec_get_int(blob, node, "used", entry->length);
-	prop = fdt_getprop(blob, node, "compress", NULL);
+	prop = fdtdec_getprop(blob, node, "compress", NULL);
 	entry->compress_algo = prop && !strcmp(prop, "lzo") ?
 		FMAP_COMPRESS_LZO : FMAP_COMPRESS_NONE;
-	prop = fdt_getprop(blob, node, "hash", &entry->hash_size);
+	prop = fdtdec_getprop(blob, node, "hash", &entry->hash_size);
 	entry->hash_algo = prop ? FMAP_HASH_SHA256 : FMAP_HASH_NONE;
 	entry->hash = (uint8_t *)prop;
 
@@ -981,14 +1019,14 @@ int fdt_get_resource(const void *fdt, int node, const char *property,
 	int na, ns, len, parent;
 	unsigned int i = 0;
 
-	parent = fdt_parent_offset(fdt, node);
+	parent = fdtdec_parent_offset(fdt, node);
 	if (parent < 0)
 		return parent;
 
-	na = fdt_address_cells(fdt, parent);
-	ns = fdt_size_cells(fdt, parent);
+	na = fdtdec_get_cells(fdt, parent, "#address-cells", 1);
+	ns = fdtdec_get_cells(fdt, parent, "#size-cells", 0);
 
-	ptr = fdt_getprop(fdt, node, property, &len);
+	ptr = fdtdec_getprop(fdt, node, property, &len);
 	if (!ptr)
 		return len;
 
@@ -1043,7 +1081,7 @@ int fdtdec_decode_memory_region(const void *blob, int config_node,
 
 	snprintf(prop_name, sizeof(prop_name), "%s-memory%s", mem_type,
 		 suffix);
-	mem = fdt_getprop(blob, config_node, prop_name, NULL);
+	mem = fdtdec_getprop(blob, config_node, prop_name, NULL);
 	if (!mem) {
 		debug("%s: No memory type for '%s', using /memory\n", __func__,
 		      prop_name);
@@ -1088,7 +1126,7 @@ static int decode_timing_property(const void *blob, int node, const char *name,
 	int length, ret = 0;
 	const u32 *prop;
 
-	prop = fdt_getprop(blob, node, name, &length);
+	prop = fdtdec_getprop(blob, node, name, &length);
 	if (!prop) {
 		debug("%s: could not find property %s\n",
 		      fdt_get_name(blob, node, NULL), name);
@@ -12,11 +12,25 @@
 #include <common.h>
 #include <libfdt.h>
 #include <fdtdec.h>
+#include <dm/of_access.h>
 #else
 #include "libfdt.h"
 #include "fdt_support.h"
 
 #define debug(...)
+#define fdtdec_getprop fdt_getprop
+#endif
+
+#ifndef USE_HOSTCC
+const void *fdtdec_getprop(const void *blob, int node, const char *prop_name,
+			   int *lenp)
+{
+	const struct device_node *np = of_live_find(blob, node);
+
+	if (np)
+		return of_get_property(np, prop_name, lenp);
+	return fdt_getprop(blob, node, prop_name, lenp);
+}
 #endif
 
 int fdtdec_get_int(const void *blob, int node, const char *prop_name,
@@ -26,7 +40,7 @@ int fdtdec_get_int(const void *blob, int node, const char *prop_name,
 	int len;
 
 	debug("%s: %s: ", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (cell && len >= sizeof(int)) {
 		int val = fdt32_to_cpu(cell[0]);
 
@@ -44,7 +58,7 @@ unsigned int fdtdec_get_uint(const void *blob, int node, const char *prop_name,
 	int len;
 
 	debug("%s: %s: ", __func__, prop_name);
-	cell = fdt_getprop(blob, node, prop_name, &len);
+	cell = fdtdec_getprop(blob, node, prop_name, &len);
 	if (cell && len >= sizeof(unsigned int)) {
 		unsigned int val = fdt32_to_cpu(cell[0]);
 
@@ -42,33 +42,102 @@ void gzfree(void *x, void *addr, unsigned nb)
 	free (addr);
 }
 
-int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+/* Memory for the decompressor given by the caller, for gunzip_ws() */
+struct gzip_ws {
+	char *ptr;
+	char *end;
+};
+
+static void *gzalloc_ws(void *x, unsigned items, unsigned size)
+{
+	struct gzip_ws *ws = x;
+	void *p = ws->ptr;
+
+	size *= items;
+	size = (size + ZALLOC_ALIGNMENT - 1) & ~(ZALLOC_ALIGNMENT - 1);
+	if (size > ws->end - ws->ptr)
+		return NULL;
+	ws->ptr += size;
+
+	return p;
+}
+
+static void gzfree_ws(void *x, void *addr, unsigned nb)
+{
+}
+
+int gzip_parse_header(const unsigned char *src, unsigned long len)
 {
 	int i, flags;
 
 	/* skip header */
 	i = 10;
 	flags = src[3];
-	if (src[2] != DEFLATED || (flags & RESERVED) != 0) {
-		puts ("Error: Bad gzipped data\n");
-		return (-1);
-	}
-	if ((flags & EXTRA_FIELD) != 0)
+	if (src[2] != DEFLATED || (flags & RESERVED) != 0)
+		return -1;
+	if ((flags & EXTRA_FIELD) != 0) {
+		if (len < 12)
+			return 0;
 		i = 12 + src[10] + (src[11] << 8);
-	if ((flags & ORIG_NAME) != 0)
-		while (src[i++] != 0)
-			;
-	if ((flags & COMMENT) != 0)
-		while (src[i++] != 0)
-			;
+	}
+	if ((flags & ORIG_NAME) != 0) {
+		do {
+			if (i >= len)
+				return 0;
+		} while (src[i++] != 0);
+	}
+	if ((flags & COMMENT) != 0) {
+		do {
+			if (i >= len)
+				return 0;
+		} while (src[i++] != 0);
+	}
 	if ((flags & HEAD_CRC) != 0)
 		i += 2;
-	if (i >= *lenp) {
-		puts ("Error: gunzip out of data in header\n");
+	if (i >= len)
+		return 0;
+
+	return i;
+}
+
+static int __zunzip(void *dst, int dstlen, unsigned char *src,
+		    unsigned long *lenp, int stoponerr, int offset,
+		    struct gzip_ws *ws);
+
+static int __gunzip(void *dst, int dstlen, unsigned char *src,
+		    unsigned long *lenp, struct gzip_ws *ws)
+{
+	int i;
+
+	i = gzip_parse_header(src, *lenp);
+	if (i < 0) {
+		if (!ws)
+			puts("Error: Bad gzipped data\n");
+		return (-1);
+	}
+	if (!i) {
+		if (!ws)
+			puts("Error: gunzip out of data in header\n");
 		return (-1);
 	}
 
-	return zunzip(dst, dstlen, src, lenp, 1, i);
+	return __zunzip(dst, dstlen, src, lenp, 1, i, ws);
+}
+
+int gunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp)
+{
+	return __gunzip(dst, dstlen, src, lenp, NULL);
+}
+
+int gunzip_ws(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+	      void *ws, unsigned long ws_size)
+{
+	struct gzip_ws gws = {
+		.ptr = ws,
+		.end = ws + ws_size,
+	};
+
+	return __gunzip(dst, dstlen, src, lenp, &gws);
 }
 
 #ifdef CONFIG_CMD_UNZIP
@@ -185,6 +254,7 @@ int gzwrite(unsigned char *src, int len,
 
 	s.zalloc = gzalloc;
 	s.zfree = gzfree;
+	s.no_watchdog = 0;
 
 	r = inflateInit2(&s, -MAX_WBITS);
 	if (r != Z_OK) {
@@ -264,19 +334,24 @@ out:
 /*
  * Uncompress blocks compressed with zlib without headers
  */
-int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
-						int stoponerr, int offset)
+static int __zunzip(void *dst, int dstlen, unsigned char *src,
+		    unsigned long *lenp, int stoponerr, int offset,
+		    struct gzip_ws *ws)
 {
 	z_stream s;
 	int err = 0;
 	int r;
 
-	s.zalloc = gzalloc;
-	s.zfree = gzfree;
+	s.zalloc = ws ? gzalloc_ws : gzalloc;
+	s.zfree = ws ? gzfree_ws : gzfree;
+	s.opaque = ws;
+	/* Callers giving a workspace may not use the console or watchdog */
+	s.no_watchdog = !!ws;
 
 	r = inflateInit2(&s, -MAX_WBITS);
 	if (r != Z_OK) {
-		printf("Error: inflateInit2() returned %d\n", r);
+		if (!ws)
+			printf("Error: inflateInit2() returned %d\n", r);
 		return -1;
 	}
 	s.next_in = src + offset;
@@ -287,7 +362,8 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 		r = inflate(&s, Z_FINISH);
 		if (stoponerr == 1 && r != Z_STREAM_END &&
 		    (s.avail_in == 0 || s.avail_out == 0 || r != Z_BUF_ERROR)) {
-			printf("Error: inflate() returned %d\n", r);
+			if (!ws)
+				printf("Error: inflate() returned %d\n", r);
 			err = -1;
 			break;
 		}
@@ -297,3 +373,9 @@ int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
 
 	return err;
 }
+
+int zunzip(void *dst, int dstlen, unsigned char *src, unsigned long *lenp,
+						int stoponerr, int offset)
+{
+	return __zunzip(dst, dstlen, src, lenp, stoponerr, offset, NULL);
+}
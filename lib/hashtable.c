@@ -45,6 +45,7 @@
 #include <env_flags.h>
 #include <search.h>
 #include <slre.h>
+#include <u-boot/fnv.h>
 
 /*
  * [Aho,Sethi,Ullman] Compilers: Principles, Techniques and Tools, 1986
@@ -57,48 +58,58 @@
  * which describes the current status.
  */
 
+/*
+ * The table is an array of slots, each holding the hash value of a key and
+ * a pointer to its entry. It uses open addressing with linear probing, and
+ * its size is a power of two. The entries are allocated one by one and
+ * never move, so that the ENTRY pointers returned stay valid while the
+ * table changes. They are also kept in a red-black tree sorted by key, so
+ * that they can be exported in order.
+ *
+ * Once the table is three quarters full, one of twice the size is
+ * allocated. Rather than moving every slot at once, each later change to
+ * the table moves a few slots from the old one, until it is empty and can
+ * be freed. Until then, a search which fails in the new table also looks in
+ * the old one.
+ */
+
 typedef struct _ENTRY {
-	int used;
+	struct rb_node node;
 	ENTRY entry;
 } _ENTRY;
 
+struct _HSLOT {
+	unsigned int hval;
+	_ENTRY *ep;
+};
 
-static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
-	int idx);
+/* Marks a slot in the old table whose entry was moved or deleted */
+#define HSLOT_GONE	((_ENTRY *)-1)
 
-/*
- * hcreate()
- */
+/* Smallest table created */
+#define HTAB_MIN_SIZE	16
 
-/*
- * For the used double hash method the table size has to be a prime. To
- * correct the user given table size we need a prime test.  This trivial
- * algorithm is adequate because
- * a)  the code is (most probably) called a few times per program run and
- * b)  the number is small because the table must fit in the core
- * */
-static int isprime(unsigned int number)
-{
-	/* no even number will be passed */
-	unsigned int div = 3;
+/* Number of slots of the old table moved by each change to the table */
+#define HTAB_MOVE_SLOTS	8
 
-	while (div * div < number && number % div != 0)
-		div += 2;
+static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep);
 
-	return number % div != 0;
-}
+/*
+ * hcreate()
+ */
 
 /*
  * Before using the hash table we must allocate memory for it.
- * Test for an existing table are done. We allocate one element
- * more as the found prime number says. This is done for more effective
- * indexing as explained in the comment for the hsearch function.
- * The contents of the table is zeroed, especially the field used
- * becomes zero.
+ * Test for an existing table are done. The table is made large enough
+ * to hold @nel entries while a quarter of it stays empty, to keep
+ * searches short. The contents of the table is zeroed, so that all
+ * slots are empty.
  */
 
 int hcreate_r(size_t nel, struct hsearch_data *htab)
 {
+	unsigned int size = HTAB_MIN_SIZE;
+
 	/* Test for correct arguments.  */
 	if (htab == NULL) {
 		__set_errno(EINVAL);
@@ -109,19 +120,25 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 	if (htab->table != NULL)
 		return 0;
 
-	/* Change nel to the first prime number not smaller as nel. */
-	nel |= 1;		/* make odd */
-	while (!isprime(nel))
-		nel += 2;
-
-	htab->size = nel;
-	htab->filled = 0;
+	while (size - size / 4 < nel)
+		size <<= 1;
 
 	/* allocate memory and zero out */
-	htab->table = (_ENTRY *) calloc(htab->size + 1, sizeof(_ENTRY));
+	htab->table = calloc(size, sizeof(struct _HSLOT));
 	if (htab->table == NULL)
 		return 0;
 
+	htab->size = size;
+	htab->filled = 0;
+	htab->old_table = NULL;
+	htab->old_size = 0;
+	htab->old_next = 0;
+	htab->sorted = RB_ROOT;
+	htab->lookups = 0;
+	htab->probes = 0;
+	htab->max_probes = 0;
+	htab->grows = 0;
+
 	/* everything went alright */
 	return 1;
 }
@@ -138,7 +155,7 @@ int hcreate_r(size_t nel, struct hsearch_data *htab)
 
 void hdestroy_r(struct hsearch_data *htab)
 {
-	int i;
+	_ENTRY *ep, *next;
 
 	/* Test for correct arguments.  */
 	if (htab == NULL) {
@@ -147,18 +164,190 @@ void hdestroy_r(struct hsearch_data *htab)
 	}
 
 	/* free used memory */
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			ENTRY *ep = &htab->table[i].entry;
-
-			free((void *)ep->key);
-			free(ep->data);
-		}
+	rbtree_postorder_for_each_entry_safe(ep, next, &htab->sorted, node) {
+		free((void *)ep->entry.key);
+		free(ep->entry.data);
+		free(ep);
 	}
 	free(htab->table);
+	free(htab->old_table);
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
+	htab->old_table = NULL;
+	htab->old_size = 0;
+	htab->filled = 0;
+	htab->sorted = RB_ROOT;
+}
+
+/*
+ * Put an entry in the first empty slot for its hash value. There must be
+ * one.
+ */
+static struct _HSLOT *hslot_put(struct _HSLOT *table, unsigned int size,
+				unsigned int hval, _ENTRY *ep)
+{
+	unsigned int mask = size - 1;
+	unsigned int idx;
+
+	for (idx = hval & mask; table[idx].ep; idx = (idx + 1) & mask)
+		;
+	table[idx].hval = hval;
+	table[idx].ep = ep;
+
+	return &table[idx];
+}
+
+/* Find the slot holding @key in one table, or return NULL */
+static struct _HSLOT *hslot_find(struct _HSLOT *table, unsigned int size,
+				 const char *key, unsigned int hval,
+				 unsigned int *probesp)
+{
+	unsigned int mask = size - 1;
+	unsigned int idx;
+
+	for (idx = hval & mask; table[idx].ep; idx = (idx + 1) & mask) {
+		struct _HSLOT *slot = &table[idx];
+
+		++*probesp;
+		/* Compare the hash values first to avoid most strcmp() calls */
+		if (slot->hval == hval && slot->ep != HSLOT_GONE &&
+		    !strcmp(key, slot->ep->entry.key))
+			return slot;
+	}
+	++*probesp;
+
+	return NULL;
+}
+
+/* Find the slot holding @key in either table, or return NULL */
+static struct _HSLOT *htab_find(struct hsearch_data *htab, const char *key,
+				unsigned int hval)
+{
+	struct _HSLOT *slot;
+	unsigned int probes = 0;
+
+	slot = hslot_find(htab->table, htab->size, key, hval, &probes);
+	if (!slot && htab->old_table)
+		slot = hslot_find(htab->old_table, htab->old_size, key, hval,
+				  &probes);
+
+	htab->lookups++;
+	htab->probes += probes;
+	if (probes > htab->max_probes)
+		htab->max_probes = probes;
+
+	return slot;
+}
+
+/*
+ * Empty a slot of the current table. Any later slots in the same run which
+ * could no longer be found are moved back into the gap, so that no marker
+ * is needed. Slots of the old table are just marked as gone.
+ */
+static void htab_remove(struct hsearch_data *htab, struct _HSLOT *slot)
+{
+	struct _HSLOT *table = htab->table;
+	unsigned int mask = htab->size - 1;
+	unsigned int i, j, k;
+
+	if (slot < table || slot >= table + htab->size) {
+		slot->ep = HSLOT_GONE;
+		return;
+	}
+
+	for (i = j = slot - table;;) {
+		j = (j + 1) & mask;
+		if (!table[j].ep)
+			break;
+		/* Leave slots whose first choice is cyclically in (i, j] */
+		k = table[j].hval & mask;
+		if (i <= j ? i < k && k <= j : i < k || k <= j)
+			continue;
+		table[i] = table[j];
+		i = j;
+	}
+	table[i].ep = NULL;
+}
+
+/* Move up to @count slots from the old table, freeing it once empty */
+static void htab_move(struct hsearch_data *htab, unsigned int count)
+{
+	while (htab->old_table && count--) {
+		struct _HSLOT *slot = &htab->old_table[htab->old_next];
+
+		if (slot->ep && slot->ep != HSLOT_GONE) {
+			hslot_put(htab->table, htab->size, slot->hval,
+				  slot->ep);
+			slot->ep = HSLOT_GONE;
+		}
+		if (++htab->old_next == htab->old_size) {
+			free(htab->old_table);
+			htab->old_table = NULL;
+			htab->old_size = 0;
+		}
+	}
+}
+
+/* Start moving to a table of twice the size */
+static int htab_grow(struct hsearch_data *htab)
+{
+	struct _HSLOT *table;
+
+	/* Finish with the last old table first; it is mostly moved by now */
+	htab_move(htab, htab->old_size);
+
+	table = calloc(htab->size * 2, sizeof(struct _HSLOT));
+	if (table == NULL)
+		return -ENOMEM;
+
+	debug("Grow Hash Table: %p N=%d\n", htab, htab->size * 2);
+	htab->old_table = htab->table;
+	htab->old_size = htab->size;
+	htab->old_next = 0;
+	htab->table = table;
+	htab->size *= 2;
+	htab->grows++;
+
+	return 0;
+}
+
+/*
+ * Slots are numbered from 1, through those of the current table and then
+ * those of the old one.
+ */
+static int htab_index(struct hsearch_data *htab, struct _HSLOT *slot)
+{
+	if (slot >= htab->table && slot < htab->table + htab->size)
+		return slot - htab->table + 1;
+
+	return htab->size + (slot - htab->old_table) + 1;
+}
+
+static struct _HSLOT *htab_slot(struct hsearch_data *htab, unsigned int idx)
+{
+	if (idx <= htab->size)
+		return &htab->table[idx - 1];
+
+	return &htab->old_table[idx - htab->size - 1];
+}
+
+/* Add an entry to the tree of entries sorted by key */
+static void htab_sort_add(struct hsearch_data *htab, _ENTRY *new)
+{
+	struct rb_node **link = &htab->sorted.rb_node, *parent = NULL;
+
+	while (*link) {
+		_ENTRY *ep = rb_entry(*link, _ENTRY, node);
+
+		parent = *link;
+		if (strcmp(new->entry.key, ep->entry.key) < 0)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+	rb_link_node(&new->node, parent, link);
+	rb_insert_color(&new->node, &htab->sorted);
 }
 
 /*
@@ -166,19 +355,13 @@ void hdestroy_r(struct hsearch_data *htab)
  */
 
 /*
- * This is the search function. It uses double hashing with open addressing.
- * The argument item.key has to be a pointer to an zero terminated, most
- * probably strings of chars. The function for generating a number of the
- * strings is simple but fast. It can be replaced by a more complex function
- * like ajw (see [Aho,Sethi,Ullman]) if the needs are shown.
+ * This is the search function. It hashes the key with fnv1a_str() and looks
+ * for it in the table as described above.
  *
- * We use an trick to speed up the lookup. The table is created by hcreate
- * with one more element available. This enables us to use the index zero
- * special. This index will never be used because we store the first hash
- * index in the field used where zero means not used. Every other value
- * means used. The used field can be used as a first fast comparison for
- * equality of the stored and the parameter value. This helps to prevent
- * unnecessary expensive calls of strcmp.
+ * The hash value of each key is kept in its slot. This is used as a first
+ * fast comparison for equality of the stored and the parameter value,
+ * which helps to prevent unnecessary expensive calls of strcmp, and means
+ * that keys need not be hashed again when the table grows.
  *
  * This implementation differs from the standard library version of
  * this function in a number of ways:
@@ -192,10 +375,10 @@ void hdestroy_r(struct hsearch_data *htab)
  * - The standard implementation does not provide a way to update an
  *   existing entry.  This version will create a new entry or update an
  *   existing one when both "action == ENTER" and "item.data != NULL".
- * - Instead of returning 1 on success, we return the index into the
- *   internal hash table, which is also guaranteed to be positive.
- *   This allows us direct access to the found hash table slot for
- *   example for functions like hdelete().
+ * - Instead of returning 1 on success, we return the index of the slot
+ *   found in the internal hash table, which is also guaranteed to be
+ *   positive. This allows hmatch_r() to carry on from it. A new entry
+ *   returns 1.
  */
 
 int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
@@ -204,11 +387,13 @@ int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
 	unsigned int idx;
 	size_t key_len = strlen(match);
 
-	for (idx = last_idx + 1; idx < htab->size; ++idx) {
-		if (htab->table[idx].used <= 0)
+	for (idx = last_idx + 1; idx <= htab->size + htab->old_size; ++idx) {
+		_ENTRY *ep = htab_slot(htab, idx)->ep;
+
+		if (!ep || ep == HSLOT_GONE)
 			continue;
-		if (!strncmp(match, htab->table[idx].entry.key, key_len)) {
-			*retval = &htab->table[idx].entry;
+		if (!strncmp(match, ep->entry.key, key_len)) {
+			*retval = &ep->entry;
 			return idx;
 		}
 	}
@@ -219,139 +404,78 @@ int hmatch_r(const char *match, int last_idx, ENTRY ** retval,
 }
 
 /*
- * Compare an existing entry with the desired key, and overwrite if the action
- * is ENTER.  This is simply a helper function for hsearch_r().
+ * Overwrite an existing entry if the action is ENTER.  This is simply a
+ * helper function for hsearch_r().
  */
-static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
+static inline int _overwrite_entry(ENTRY item, ACTION action,
 	ENTRY **retval, struct hsearch_data *htab, int flag,
-	unsigned int hval, unsigned int idx)
+	ENTRY *ep, int idx)
 {
-	if (htab->table[idx].used == hval
-	    && strcmp(item.key, htab->table[idx].entry.key) == 0) {
-		/* Overwrite existing value? */
-		if ((action == ENTER) && (item.data != NULL)) {
-			/* check for permission */
-			if (htab->change_ok != NULL && htab->change_ok(
-			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
-				debug("change_ok() rejected setting variable "
-					"%s, skipping it!\n", item.key);
-				__set_errno(EPERM);
-				*retval = NULL;
-				return 0;
-			}
+	/* Overwrite existing value? */
+	if ((action == ENTER) && (item.data != NULL)) {
+		/* check for permission */
+		if (htab->change_ok != NULL && htab->change_ok(
+		    ep, item.data, env_op_overwrite, flag)) {
+			debug("change_ok() rejected setting variable "
+				"%s, skipping it!\n", item.key);
+			__set_errno(EPERM);
+			*retval = NULL;
+			return 0;
+		}
 
-			/* If there is a callback, call it */
-			if (htab->table[idx].entry.callback &&
-			    htab->table[idx].entry.callback(item.key,
-			    item.data, env_op_overwrite, flag)) {
-				debug("callback() rejected setting variable "
-					"%s, skipping it!\n", item.key);
-				__set_errno(EINVAL);
-				*retval = NULL;
-				return 0;
-			}
+		/* If there is a callback, call it */
+		if (ep->callback && ep->callback(item.key,
+		    item.data, env_op_overwrite, flag)) {
+			debug("callback() rejected setting variable "
+				"%s, skipping it!\n", item.key);
+			__set_errno(EINVAL);
+			*retval = NULL;
+			return 0;
+		}
 
-			free(htab->table[idx].entry.data);
-			htab->table[idx].entry.data = strdup(item.data);
-			if (!htab->table[idx].entry.data) {
-				__set_errno(ENOMEM);
-				*retval = NULL;
-				return 0;
-			}
+		free(ep->data);
+		ep->data = strdup(item.data);
+		if (!ep->data) {
+			__set_errno(ENOMEM);
+			*retval = NULL;
+			return 0;
 		}
-		/* return found entry */
-		*retval = &htab->table[idx].entry;
-		return idx;
 	}
-	/* keep searching */
-	return -1;
+	/* return found entry */
+	*retval = ep;
+	return idx;
 }
 
 int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 	      struct hsearch_data *htab, int flag)
 {
-	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
-	unsigned int idx;
-	unsigned int first_deleted = 0;
-	int ret;
+	unsigned int hval = fnv1a_str(item.key);
+	struct _HSLOT *slot;
+	_ENTRY *ep;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
+	if (htab->table == NULL) {
+		__set_errno(ESRCH);
+		*retval = NULL;
+		return 0;
 	}
 
-	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
-	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
-
-	/* The first index tried. */
-	idx = hval;
-
-	if (htab->table[idx].used) {
-		/*
-		 * Further action might be required according to the
-		 * action value.
-		 */
-		unsigned hval2;
-
-		if (htab->table[idx].used == -1
-		    && !first_deleted)
-			first_deleted = idx;
+	slot = htab_find(htab, item.key, hval);
+	if (slot)
+		return _overwrite_entry(item, action, retval, htab, flag,
+					&slot->ep->entry,
+					htab_index(htab, slot));
 
-		ret = _compare_and_overwrite_entry(item, action, retval, htab,
-			flag, hval, idx);
-		if (ret != -1)
-			return ret;
-
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
-
-		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
-
-			/*
-			 * If we visited all entries leave the loop
-			 * unsuccessfully.
-			 */
-			if (idx == hval)
-				break;
-
-			/* If entry is found use it. */
-			ret = _compare_and_overwrite_entry(item, action, retval,
-				htab, flag, hval, idx);
-			if (ret != -1)
-				return ret;
-		}
-		while (htab->table[idx].used);
-	}
-
-	/* An empty bucket has been found. */
+	/* The key is not in the table. */
 	if (action == ENTER) {
+		htab_move(htab, HTAB_MOVE_SLOTS);
+
 		/*
-		 * If table is full and another entry should be
-		 * entered return with error.
+		 * Grow the table once it is three quarters full. If that
+		 * fails, carry on while there is an empty slot left to end
+		 * searches.
 		 */
-		if (htab->filled == htab->size) {
+		if (htab->filled >= htab->size - htab->size / 4 &&
+		    htab_grow(htab) && htab->filled >= htab->size - 1) {
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
@@ -361,51 +485,57 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		 * Create new entry;
 		 * create copies of item.key and item.data
 		 */
-		if (first_deleted)
-			idx = first_deleted;
-
-		htab->table[idx].used = hval;
-		htab->table[idx].entry.key = strdup(item.key);
-		htab->table[idx].entry.data = strdup(item.data);
-		if (!htab->table[idx].entry.key ||
-		    !htab->table[idx].entry.data) {
+		ep = calloc(1, sizeof(_ENTRY));
+		if (ep == NULL) {
+			__set_errno(ENOMEM);
+			*retval = NULL;
+			return 0;
+		}
+		ep->entry.key = strdup(item.key);
+		ep->entry.data = strdup(item.data);
+		if (!ep->entry.key || !ep->entry.data) {
+			free((void *)ep->entry.key);
+			free(ep->entry.data);
+			free(ep);
 			__set_errno(ENOMEM);
 			*retval = NULL;
 			return 0;
 		}
 
+		hslot_put(htab->table, htab->size, hval, ep);
+		htab_sort_add(htab, ep);
 		++htab->filled;
 
 		/* This is a new entry, so look up a possible callback */
-		env_callback_init(&htab->table[idx].entry);
+		env_callback_init(&ep->entry);
 		/* Also look for flags */
-		env_flags_init(&htab->table[idx].entry);
+		env_flags_init(&ep->entry);
 
 		/* check for permission */
 		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
+		    &ep->entry, item.data, env_op_create, flag)) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, &ep->entry);
 			__set_errno(EPERM);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* If there is a callback, call it */
-		if (htab->table[idx].entry.callback &&
-		    htab->table[idx].entry.callback(item.key, item.data,
+		if (ep->entry.callback &&
+		    ep->entry.callback(item.key, item.data,
 		    env_op_create, flag)) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
-			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
+			_hdelete(item.key, htab, &ep->entry);
 			__set_errno(EINVAL);
 			*retval = NULL;
 			return 0;
 		}
 
 		/* return new entry */
-		*retval = &htab->table[idx].entry;
+		*retval = &ep->entry;
 		return 1;
 	}
 
@@ -425,18 +555,24 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
  * do that.
  */
 
-static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
-	int idx)
+static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep)
 {
+	_ENTRY *e = container_of(ep, _ENTRY, entry);
+	struct _HSLOT *slot;
+
 	/* free used ENTRY */
 	debug("hdelete: DELETING key \"%s\"\n", key);
+
+	/* Look up the slot again, since a callback may have moved it */
+	slot = htab_find(htab, ep->key, fnv1a_str(ep->key));
+	htab_remove(htab, slot);
+	rb_erase(&e->node, &htab->sorted);
 	free((void *)ep->key);
 	free(ep->data);
-	ep->callback = NULL;
-	ep->flags = 0;
-	htab->table[idx].used = -1;
+	free(e);
 
 	--htab->filled;
+	htab_move(htab, HTAB_MOVE_SLOTS);
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
@@ -464,15 +600,15 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (htab->table[idx].entry.callback &&
-	    htab->table[idx].entry.callback(key, NULL, env_op_delete, flag)) {
+	if (ep->callback &&
+	    ep->callback(key, NULL, env_op_delete, flag)) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EINVAL);
 		return 0;
 	}
 
-	_hdelete(key, htab, ep, idx);
+	_hdelete(key, htab, ep);
 
 	return 1;
 }
@@ -520,14 +656,6 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
  *		bytes in the string will be '\0'-padded.
  */
 
-static int cmpkey(const void *p1, const void *p2)
-{
-	ENTRY *e1 = *(ENTRY **) p1;
-	ENTRY *e2 = *(ENTRY **) p2;
-
-	return (strcmp(e1->key, e2->key));
-}
-
 static int match_string(int flag, const char *str, const char *pat, void *priv)
 {
 	switch (flag & H_MATCH_METHOD) {
@@ -587,14 +715,25 @@ static int match_entry(ENTRY *ep, int flag,
 	return 0;
 }
 
+/* Check whether an entry is to be exported */
+static int export_entry(ENTRY *ep, int flag, int argc, char * const argv[])
+{
+	if ((argc > 0) && !match_entry(ep, flag, argc, argv))
+		return 0;
+
+	if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
+		return 0;
+
+	return 1;
+}
+
 ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 		 char **resp, size_t size,
 		 int argc, char * const argv[])
 {
-	ENTRY *list[htab->size];
+	struct rb_node *node;
 	char *res, *p;
 	size_t totlen;
-	int i, n;
 
 	/* Test for correct arguments.  */
 	if ((resp == NULL) || (htab == NULL)) {
@@ -606,54 +745,34 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	      htab, htab->size, htab->filled, (ulong)size);
 	/*
 	 * Pass 1:
-	 * search used entries,
-	 * save addresses and compute total length
+	 * compute total length of the entries to export, which are
+	 * already sorted by key
 	 */
-	for (i = 1, n = 0, totlen = 0; i <= htab->size; ++i) {
-
-		if (htab->table[i].used > 0) {
-			ENTRY *ep = &htab->table[i].entry;
-			int found = match_entry(ep, flag, argc, argv);
-
-			if ((argc > 0) && (found == 0))
-				continue;
-
-			if ((flag & H_HIDE_DOT) && ep->key[0] == '.')
-				continue;
+	totlen = 0;
+	for (node = rb_first(&htab->sorted); node; node = rb_next(node)) {
+		ENTRY *ep = &rb_entry(node, _ENTRY, node)->entry;
 
-			list[n++] = ep;
+		if (!export_entry(ep, flag, argc, argv))
+			continue;
 
-			totlen += strlen(ep->key) + 2;
+		totlen += strlen(ep->key) + 2;
 
-			if (sep == '\0') {
-				totlen += strlen(ep->data);
-			} else {	/* check if escapes are needed */
-				char *s = ep->data;
+		if (sep == '\0') {
+			totlen += strlen(ep->data);
+		} else {	/* check if escapes are needed */
+			char *s = ep->data;
 
-				while (*s) {
+			while (*s) {
+				++totlen;
+				/* add room for needed escape chars */
+				if ((*s == sep) || (*s == '\\'))
 					++totlen;
-					/* add room for needed escape chars */
-					if ((*s == sep) || (*s == '\\'))
-						++totlen;
-					++s;
-				}
+				++s;
 			}
-			totlen += 2;	/* for '=' and 'sep' char */
 		}
+		totlen += 2;	/* for '=' and 'sep' char */
 	}
 
-#ifdef DEBUG
-	/* Pass 1a: print unsorted list */
-	printf("Unsorted: n=%d\n", n);
-	for (i = 0; i < n; ++i) {
-		printf("\t%3d: %p ==> %-10s => %s\n",
-		       i, list[i], list[i]->key, list[i]->data);
-	}
-#endif
-
-	/* Sort list by keys */
-	qsort(list, n, sizeof(ENTRY *), cmpkey);
-
 	/* Check if the user supplied buffer size is sufficient */
 	if (size) {
 		if (size < totlen + 1) {	/* provided buffer too small */
@@ -683,15 +802,20 @@ ssize_t hexport_r(struct hsearch_data *htab, const char sep, int flag,
 	 * Pass 2:
 	 * export sorted list of result data
 	 */
-	for (i = 0, p = res; i < n; ++i) {
+	p = res;
+	for (node = rb_first(&htab->sorted); node; node = rb_next(node)) {
+		ENTRY *ep = &rb_entry(node, _ENTRY, node)->entry;
 		const char *s;
 
-		s = list[i]->key;
+		if (!export_entry(ep, flag, argc, argv))
+			continue;
+
+		s = ep->key;
 		while (*s)
 			*p++ = *s++;
 		*p++ = '=';
 
-		s = list[i]->data;
+		s = ep->data;
 
 		while (*s) {
 			if ((*s == sep) || (*s == '\\'))
@@ -739,6 +863,31 @@ static int drop_var_from_set(const char *name, int nvars, char * vars[])
 	return res;
 }
 
+/*
+ * Count the "name=value" pairs in linearized data, to size the hash table.
+ * With a NUL separator the data ends with an empty entry; otherwise it ends
+ * with a NUL character, if there is one.
+ */
+static int himport_count(const char *env, size_t size, const char sep)
+{
+	int count = 0;
+	int start = 1;
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		if (!env[i] && (start || sep))
+			break;
+		if (env[i] == sep) {
+			start = 1;
+		} else if (start) {
+			count++;
+			start = 0;
+		}
+	}
+
+	return count;
+}
+
 /*
  * Import linearized data into hash table.
  *
@@ -811,28 +960,20 @@ int himport_r(struct hsearch_data *htab,
 	}
 
 	/*
-	 * Create new hash table (if needed).  The computation of the hash
-	 * table size is based on heuristics: in a sample of some 70+
-	 * existing systems we found an average size of 39+ bytes per entry
-	 * in the environment (for the whole key=value pair). Assuming a
-	 * size of 8 per entry (= safety factor of ~5) should provide enough
-	 * safety margin for any existing environment definitions and still
-	 * allow for more than enough dynamic additions. Note that the
-	 * "size" argument is supposed to give the maximum environment size
-	 * (CONFIG_ENV_SIZE).  This heuristics will result in
-	 * unreasonably large numbers (and thus memory footprint) for
-	 * big flash environments (>8,000 entries for 64 KB
-	 * environment size), so we clip it to a reasonable value.
-	 * On the other hand we need to add some more entries for free
-	 * space when importing very small buffers. Both boundaries can
-	 * be overwritten in the board config file if needed.
+	 * Create new hash table (if needed). It is sized for the entries
+	 * being imported, plus some free space for later additions. Since
+	 * the table grows when it has to, the size is only a starting
+	 * point. Both boundaries can be overwritten in the board config
+	 * file if needed: CONFIG_ENV_MAX_ENTRIES limits the free space
+	 * added to a large environment.
 	 */
 
 	if (!htab->table) {
-		int nent = CONFIG_ENV_MIN_ENTRIES + size / 8;
+		int count = himport_count(env, size, sep);
+		int nent = count + CONFIG_ENV_MIN_ENTRIES;
 
 		if (nent > CONFIG_ENV_MAX_ENTRIES)
-			nent = CONFIG_ENV_MAX_ENTRIES;
+			nent = max(count, CONFIG_ENV_MAX_ENTRIES);
 
 		debug("Create Hash Table: N=%d\n", nent);
 
@@ -961,21 +1102,85 @@ int himport_r(struct hsearch_data *htab,
  */
 
 /*
- * Walk all of the entries in the hash, calling the callback for each one.
- * this allows some generic operation to be performed on each element.
+ * Walk all of the entries in the hash, calling the callback for each one
+ * in order of key.
+ * This allows some generic operation to be performed on each element.
  */
 int hwalk_r(struct hsearch_data *htab, int (*callback)(ENTRY *))
 {
-	int i;
+	struct rb_node *node, *next;
 	int retval;
 
-	for (i = 1; i <= htab->size; ++i) {
-		if (htab->table[i].used > 0) {
-			retval = callback(&htab->table[i].entry);
-			if (retval)
-				return retval;
-		}
+	for (node = rb_first(&htab->sorted); node; node = next) {
+		next = rb_next(node);
+		retval = callback(&rb_entry(node, _ENTRY, node)->entry);
+		if (retval)
+			return retval;
 	}
 
 	return 0;
 }
+
+/*
+ * hnext_r()
+ */
+
+/*
+ * Find the entry with the lowest key after "key", or the first entry if
+ * "key" is NULL. The key need not be in the table, so a caller can step
+ * through the entries in order while others are added and deleted.
+ */
+ENTRY *hnext_r(struct hsearch_data *htab, const char *key)
+{
+	struct rb_node *node = htab->sorted.rb_node;
+	_ENTRY *next = NULL;
+
+	if (!key) {
+		node = rb_first(&htab->sorted);
+		return node ? &rb_entry(node, _ENTRY, node)->entry : NULL;
+	}
+
+	while (node) {
+		_ENTRY *ep = rb_entry(node, _ENTRY, node);
+
+		if (strcmp(key, ep->entry.key) < 0) {
+			next = ep;
+			node = node->rb_left;
+		} else {
+			node = node->rb_right;
+		}
+	}
+
+	return next ? &next->entry : NULL;
+}
+
+/*
+ * hstats_r()
+ */
+
+/*
+ * Report the size and use of the table, and how long searches took, so
+ * that the starting size can be tuned.
+ */
+void hstats_r(struct hsearch_data *htab, struct hsearch_stats *stats)
+{
+	struct rb_node *node;
+
+	memset(stats, '\0', sizeof(*stats));
+	stats->size = htab->size;
+	stats->filled = htab->filled;
+	if (htab->old_table)
+		stats->old_left = htab->old_size - htab->old_next;
+	stats->lookups = htab->lookups;
+	stats->probes = htab->probes;
+	stats->max_probes = htab->max_probes;
+	stats->grows = htab->grows;
+
+	stats->mem = (htab->size + htab->old_size) * sizeof(struct _HSLOT);
+	for (node = rb_first(&htab->sorted); node; node = rb_next(node)) {
+		ENTRY *ep = &rb_entry(node, _ENTRY, node)->entry;
+
+		stats->mem += sizeof(_ENTRY) + strlen(ep->key) +
+			strlen(ep->data) + 2;
+	}
+}
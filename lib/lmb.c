@@ -9,165 +9,225 @@
 
 #include <common.h>
 #include <lmb.h>
+#include <malloc.h>
 
 #define LMB_ALLOC_ANYWHERE	0
 
-void lmb_dump_all(struct lmb *lmb)
-{
-#ifdef DEBUG
-	unsigned long i;
-
-	debug("lmb_dump_all:\n");
-	debug("    memory.cnt		   = 0x%lx\n", lmb->memory.cnt);
-	debug("    memory.size		   = 0x%llx\n",
-	      (unsigned long long)lmb->memory.size);
-	for (i=0; i < lmb->memory.cnt ;i++) {
-		debug("    memory.reg[0x%lx].base   = 0x%llx\n", i,
-			(long long unsigned)lmb->memory.region[i].base);
-		debug("		   .size   = 0x%llx\n",
-			(long long unsigned)lmb->memory.region[i].size);
-	}
+/*
+ * Each set of regions is a red-black tree sorted by base address, with no
+ * limit on the number of regions. The regions in a set never overlap, so
+ * whether an address range overlaps a region can be found from the last
+ * region starting at or below it, with one search of the tree.
+ *
+ * Memory regions which overlap or touch are merged as they are added.
+ * Reserved regions instead count the reservations which cover them, and
+ * are split where reservations start and end, so that freeing one of two
+ * overlapping reservations leaves the other in place. Touching reserved
+ * regions are merged when their counts are the same.
+ */
 
-	debug("\n    reserved.cnt	   = 0x%lx\n",
-		lmb->reserved.cnt);
-	debug("    reserved.size	   = 0x%llx\n",
-		(long long unsigned)lmb->reserved.size);
-	for (i=0; i < lmb->reserved.cnt ;i++) {
-		debug("    reserved.reg[0x%lx].base = 0x%llx\n", i,
-			(long long unsigned)lmb->reserved.region[i].base);
-		debug("		     .size = 0x%llx\n",
-			(long long unsigned)lmb->reserved.region[i].size);
-	}
-#endif /* DEBUG */
+static inline phys_addr_t lmb_last(struct lmb_property *rgn)
+{
+	return rgn->base + rgn->size - 1;
 }
 
-static long lmb_addrs_overlap(phys_addr_t base1,
-		phys_size_t size1, phys_addr_t base2, phys_size_t size2)
+/* Check if a range ending at @last touches a later one starting at @base */
+static bool lmb_touches(phys_addr_t last, phys_addr_t base)
 {
-	return ((base1 < (base2+size2)) && (base2 < (base1+size1)));
+	return last == (phys_addr_t)-1 || last + 1 >= base;
 }
 
-static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
-		phys_addr_t base2, phys_size_t size2)
+/* Check if a range ending at @last is followed directly by one at @base */
+static bool lmb_adjacent(phys_addr_t last, phys_addr_t base)
 {
-	if (base2 == base1 + size1)
-		return 1;
-	else if (base1 == base2 + size2)
-		return -1;
+	return last != (phys_addr_t)-1 && last + 1 == base;
+}
 
-	return 0;
+static struct lmb_property *lmb_first(struct lmb_region *rgn)
+{
+	return rb_entry_safe(rb_first(&rgn->root), struct lmb_property, node);
 }
 
-static long lmb_regions_adjacent(struct lmb_region *rgn,
-		unsigned long r1, unsigned long r2)
+static struct lmb_property *lmb_next(struct lmb_property *rgn)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	return rb_entry_safe(rb_next(&rgn->node), struct lmb_property, node);
+}
 
-	return lmb_addrs_adjacent(base1, size1, base2, size2);
+static struct lmb_property *lmb_prev(struct lmb_property *rgn)
+{
+	return rb_entry_safe(rb_prev(&rgn->node), struct lmb_property, node);
 }
 
-static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
+/* Find the last region starting at or below @addr */
+static struct lmb_property *lmb_lower(struct lmb_region *rgn, phys_addr_t addr)
 {
-	unsigned long i;
+	struct rb_node *node = rgn->root.rb_node;
+	struct lmb_property *found = NULL;
+
+	while (node) {
+		struct lmb_property *r = rb_entry(node, struct lmb_property,
+						  node);
 
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
+		if (r->base <= addr) {
+			found = r;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
+		}
 	}
-	rgn->cnt--;
+
+	return found;
 }
 
-/* Assumption: base addr of region 1 < base addr of region 2 */
-static void lmb_coalesce_regions(struct lmb_region *rgn,
-		unsigned long r1, unsigned long r2)
+/* Find the region holding @addr, or NULL if there is none */
+static struct lmb_property *lmb_find(struct lmb_region *rgn, phys_addr_t addr)
 {
-	rgn->region[r1].size += rgn->region[r2].size;
-	lmb_remove_region(rgn, r2);
+	struct lmb_property *r = lmb_lower(rgn, addr);
+
+	return r && addr <= lmb_last(r) ? r : NULL;
 }
 
-void lmb_init(struct lmb *lmb)
+/* Find the lowest region overlapping a range, or NULL if there is none */
+static struct lmb_property *lmb_overlaps_region(struct lmb_region *rgn,
+						phys_addr_t base,
+						phys_size_t size)
 {
-	/* Create a dummy zero size LMB which will get coalesced away later.
-	 * This simplifies the lmb_add() code below...
-	 */
-	lmb->memory.region[0].base = 0;
-	lmb->memory.region[0].size = 0;
-	lmb->memory.cnt = 1;
-	lmb->memory.size = 0;
+	struct lmb_property *r;
 
-	/* Ditto. */
-	lmb->reserved.region[0].base = 0;
-	lmb->reserved.region[0].size = 0;
-	lmb->reserved.cnt = 1;
-	lmb->reserved.size = 0;
+	r = lmb_lower(rgn, base);
+	if (r && lmb_last(r) >= base)
+		return r;
+	r = r ? lmb_next(r) : lmb_first(rgn);
+	if (r && r->base <= base + size - 1)
+		return r;
+
+	return NULL;
 }
 
-/* This routine called with relocation disabled. */
-static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t size)
+static void lmb_link_region(struct lmb_region *rgn, struct lmb_property *new)
 {
-	unsigned long coalesced = 0;
-	long adjacent, i;
-
-	if ((rgn->cnt == 1) && (rgn->region[0].size == 0)) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		return 0;
+	struct rb_node **link = &rgn->root.rb_node, *parent = NULL;
+
+	while (*link) {
+		parent = *link;
+		if (new->base < rb_entry(parent, struct lmb_property,
+					 node)->base)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
 	}
+	rb_link_node(&new->node, parent, link);
+	rb_insert_color(&new->node, &rgn->root);
 
-	/* First try and coalesce this LMB with another. */
-	for (i=0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
+	rgn->size += new->size;
+	if (++rgn->cnt > rgn->max_cnt)
+		rgn->max_cnt = rgn->cnt;
+}
 
-		if ((rgnbase == base) && (rgnsize == size))
-			/* Already have this region, so we're done */
-			return 0;
+static int lmb_insert_region(struct lmb_region *rgn, phys_addr_t base,
+			     phys_size_t size, uint count)
+{
+	struct lmb_property *new;
 
-		adjacent = lmb_addrs_adjacent(base,size,rgnbase,rgnsize);
-		if ( adjacent > 0 ) {
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		}
-		else if ( adjacent < 0 ) {
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		}
-	}
+	new = malloc(sizeof(*new));
+	if (!new)
+		return -1;
+	new->base = base;
+	new->size = size;
+	new->count = count;
+	lmb_link_region(rgn, new);
 
-	if ((i < rgn->cnt-1) && lmb_regions_adjacent(rgn, i, i+1) ) {
-		lmb_coalesce_regions(rgn, i, i+1);
-		coalesced++;
-	}
+	return 0;
+}
 
-	if (coalesced)
-		return coalesced;
-	if (rgn->cnt >= MAX_LMB_REGIONS)
-		return -1;
+static void lmb_remove_region(struct lmb_region *rgn, struct lmb_property *r)
+{
+	rb_erase(&r->node, &rgn->root);
+	rgn->size -= r->size;
+	rgn->cnt--;
+	free(r);
+}
 
-	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i+1].base = rgn->region[i].base;
-			rgn->region[i+1].size = rgn->region[i].size;
-		} else {
-			rgn->region[i+1].base = base;
-			rgn->region[i+1].size = size;
-			break;
-		}
+static void lmb_dump_region(struct lmb_region *rgn, const char *name)
+{
+	struct lmb_property *r;
+	int i;
+
+	printf(" %s.cnt  = 0x%lx (peak 0x%lx)\n", name, rgn->cnt,
+	       rgn->max_cnt);
+	printf(" %s.size = 0x%llx\n", name, (unsigned long long)rgn->size);
+	for (r = lmb_first(rgn), i = 0; r; r = lmb_next(r), i++) {
+		printf(" %s[%d]\t[0x%llx-0x%llx], 0x%08llx bytes\n", name, i,
+		       (unsigned long long)r->base,
+		       (unsigned long long)lmb_last(r),
+		       (unsigned long long)r->size);
 	}
+}
+
+void lmb_dump_all(struct lmb *lmb)
+{
+	printf("lmb_dump_all:\n");
+	lmb_dump_region(&lmb->memory, "memory");
+	lmb_dump_region(&lmb->reserved, "reserved");
+}
+
+void lmb_init(struct lmb *lmb)
+{
+	memset(lmb, '\0', sizeof(*lmb));
+	lmb->memory.root = RB_ROOT;
+	lmb->reserved.root = RB_ROOT;
+}
+
+static void lmb_free_regions(struct lmb_region *rgn)
+{
+	struct lmb_property *r, *n;
+
+	rbtree_postorder_for_each_entry_safe(r, n, &rgn->root, node)
+		free(r);
+	rgn->root = RB_ROOT;
+	rgn->cnt = 0;
+	rgn->size = 0;
+}
+
+void lmb_uninit(struct lmb *lmb)
+{
+	lmb_free_regions(&lmb->memory);
+	lmb_free_regions(&lmb->reserved);
+}
+
+/* Add a range to a set of regions, merging those it overlaps or touches */
+static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t size)
+{
+	phys_addr_t last = base + size - 1;
+	phys_addr_t new_base, new_last;
+	struct lmb_property *r, *next;
+
+	if (!size)
+		return 0;
 
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
+	/* Find the first region which overlaps or touches the new one */
+	r = lmb_lower(rgn, base);
+	if (!r || !lmb_touches(lmb_last(r), base)) {
+		r = r ? lmb_next(r) : lmb_first(rgn);
+		if (!r || !lmb_touches(last, r->base))
+			return lmb_insert_region(rgn, base, size, 1);
 	}
 
-	rgn->cnt++;
+	/*
+	 * Merge the new region and any later ones it reaches into @r. Since
+	 * the region before @r does not touch the new one, lowering the base
+	 * of @r keeps the tree in order.
+	 */
+	new_base = min(r->base, base);
+	new_last = max(lmb_last(r), last);
+	while ((next = lmb_next(r)) && lmb_touches(new_last, next->base)) {
+		new_last = max(new_last, lmb_last(next));
+		lmb_remove_region(rgn, next);
+	}
+	rgn->size -= r->size;
+	r->base = new_base;
+	r->size = new_last - new_base + 1;
+	rgn->size += r->size;
 
 	return 0;
 }
@@ -180,76 +240,181 @@ long lmb_add(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	return lmb_add_region(_rgn, base, size);
 }
 
-long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
+/*
+ * Allocate the regions needed to split the reserved regions holding each
+ * end of a range, so that splitting cannot fail once anything has changed
+ */
+static int lmb_get_spares(struct lmb_region *rgn, phys_addr_t base,
+			  phys_addr_t last, struct lmb_property *spare[2])
 {
-	struct lmb_region *rgn = &(lmb->reserved);
-	phys_addr_t rgnbegin, rgnend;
-	phys_addr_t end = base + size;
-	int i;
-
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
+	struct lmb_property *r;
+
+	spare[0] = NULL;
+	spare[1] = NULL;
+	r = lmb_find(rgn, base);
+	if (r && r->base < base) {
+		spare[0] = malloc(sizeof(*spare[0]));
+		if (!spare[0])
+			return -1;
+	}
+	r = lmb_find(rgn, last);
+	if (r && lmb_last(r) > last) {
+		spare[1] = malloc(sizeof(*spare[1]));
+		if (!spare[1]) {
+			free(spare[0]);
+			return -1;
+		}
+	}
 
-	/* Find the region where (base, size) belongs to */
-	for (i=0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size;
+	return 0;
+}
 
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+/* Split region @r at @addr, using @new for the part from @addr on */
+static void lmb_split_region(struct lmb_region *rgn, struct lmb_property *r,
+			     phys_addr_t addr, struct lmb_property *new)
+{
+	new->base = addr;
+	new->size = lmb_last(r) - addr + 1;
+	new->count = r->count;
+	r->size -= new->size;
+	rgn->size -= new->size;
+	lmb_link_region(rgn, new);
+}
 
-	/* Didn't find the region */
-	if (i == rgn->cnt)
-		return -1;
+/* Split the regions holding each end of a range, using the spares */
+static void lmb_split_range(struct lmb_region *rgn, phys_addr_t base,
+			    phys_addr_t last, struct lmb_property *spare[2])
+{
+	struct lmb_property *r;
 
-	/* Check to see if we are removing entire region */
-	if ((rgnbegin == base) && (rgnend == end)) {
-		lmb_remove_region(rgn, i);
-		return 0;
+	r = lmb_find(rgn, base);
+	if (r && r->base < base) {
+		lmb_split_region(rgn, r, base, spare[0]);
+		spare[0] = NULL;
+	}
+	r = lmb_find(rgn, last);
+	if (r && lmb_last(r) > last) {
+		lmb_split_region(rgn, r, last + 1, spare[1]);
+		spare[1] = NULL;
 	}
+	free(spare[0]);
+	free(spare[1]);
+}
 
-	/* Check to see if region is matching at the front */
-	if (rgnbegin == base) {
-		rgn->region[i].base = end;
-		rgn->region[i].size -= size;
-		return 0;
+/* Merge touching regions with the same count, in and around a range */
+static void lmb_merge_range(struct lmb_region *rgn, phys_addr_t base,
+			    phys_addr_t last)
+{
+	struct lmb_property *r, *next;
+
+	r = lmb_lower(rgn, base ? base - 1 : 0);
+	if (!r)
+		r = lmb_first(rgn);
+	while (r && r->base <= last) {
+		next = lmb_next(r);
+		if (next && lmb_adjacent(lmb_last(r), next->base) &&
+		    next->count == r->count) {
+			r->size += next->size;
+			rgn->size += next->size;
+			lmb_remove_region(rgn, next);
+			continue;
+		}
+		r = next;
 	}
+}
 
-	/* Check to see if the region is matching at the end */
-	if (rgnend == end) {
-		rgn->region[i].size -= size;
-		return 0;
+/* Check that every address in a range is in a region */
+static bool lmb_covers(struct lmb_region *rgn, phys_addr_t base,
+		       phys_addr_t last)
+{
+	struct lmb_property *r;
+	phys_addr_t pos = base;
+
+	for (r = lmb_find(rgn, base); r; r = lmb_next(r)) {
+		if (r->base > pos)
+			return false;
+		if (lmb_last(r) >= last)
+			return true;
+		pos = lmb_last(r) + 1;
 	}
 
-	/*
-	 * We need to split the entry -  adjust the current one to the
-	 * beginging of the hole and add the region after hole.
-	 */
-	rgn->region[i].size = base - rgn->region[i].base;
-	return lmb_add_region(rgn, end, rgnend - end);
+	return false;
 }
 
-long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
+long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 {
-	struct lmb_region *_rgn = &(lmb->reserved);
+	struct lmb_region *rgn = &(lmb->reserved);
+	phys_addr_t last = base + size - 1;
+	struct lmb_property *spare[2];
+	struct lmb_property *r, *next;
 
-	return lmb_add_region(_rgn, base, size);
+	if (!size)
+		return 0;
+	if (!lmb_covers(rgn, base, last) ||
+	    lmb_get_spares(rgn, base, last, spare))
+		return -1;
+
+	/* Drop one reservation from each part of the range */
+	lmb_split_range(rgn, base, last, spare);
+	for (r = lmb_find(rgn, base); r && r->base <= last; r = next) {
+		next = lmb_next(r);
+		if (!--r->count)
+			lmb_remove_region(rgn, r);
+	}
+	lmb_merge_range(rgn, base, last);
+
+	return 0;
 }
 
-static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
-				phys_size_t size)
+long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 {
-	unsigned long i;
+	struct lmb_region *rgn = &(lmb->reserved);
+	phys_addr_t last = base + size - 1;
+	struct lmb_property *spare[2];
+	struct lmb_property *r, *next;
+	phys_addr_t pos = base;
+
+	if (!size)
+		return 0;
+	if (lmb_get_spares(rgn, base, last, spare))
+		return -1;
 
-	for (i=0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if ( lmb_addrs_overlap(base,size,rgnbase,rgnsize) ) {
+	/*
+	 * Fill the gaps in the range with regions which no reservation
+	 * covers yet, so that they are counted with the rest below
+	 */
+	for (r = lmb_overlaps_region(rgn, base, size); ; r = lmb_next(r)) {
+		if (!r || r->base > last) {
+			if (lmb_insert_region(rgn, pos, last - pos + 1, 0))
+				goto err;
 			break;
 		}
+		if (r->base > pos &&
+		    lmb_insert_region(rgn, pos, r->base - pos, 0))
+			goto err;
+		if (lmb_last(r) >= last)
+			break;
+		pos = lmb_last(r) + 1;
 	}
 
-	return (i < rgn->cnt) ? i : -1;
+	/* Add one reservation to each part of the range */
+	lmb_split_range(rgn, base, last, spare);
+	for (r = lmb_find(rgn, base); r && r->base <= last; r = lmb_next(r))
+		r->count++;
+	lmb_merge_range(rgn, base, last);
+
+	return 0;
+
+err:
+	for (r = lmb_find(rgn, base); r && r->base <= last; r = next) {
+		next = lmb_next(r);
+		if (!r->count)
+			lmb_remove_region(rgn, r);
+	}
+	free(spare[0]);
+	free(spare[1]);
+
+	return -1;
 }
 
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
@@ -282,13 +447,16 @@ static phys_addr_t lmb_align_up(phys_addr_t addr, ulong size)
 
 phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phys_addr_t max_addr)
 {
-	long i, j;
+	struct lmb_property *mem, *res;
 	phys_addr_t base = 0;
-	phys_addr_t res_base;
 
-	for (i = lmb->memory.cnt-1; i >= 0; i--) {
-		phys_addr_t lmbbase = lmb->memory.region[i].base;
-		phys_size_t lmbsize = lmb->memory.region[i].size;
+	if (!size)
+		return 0;
+
+	for (mem = lmb_lower(&lmb->memory, (phys_addr_t)-1); mem;
+	     mem = lmb_prev(mem)) {
+		phys_addr_t lmbbase = mem->base;
+		phys_size_t lmbsize = mem->size;
 
 		if (lmbsize < size)
 			continue;
@@ -299,24 +467,26 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 			if (base < lmbbase)
 				base = -1;
 			base = min(base, max_addr);
+			/* Don't wrap around below address 0 */
+			if (base - lmbbase < size)
+				continue;
 			base = lmb_align_down(base - size, align);
 		} else
 			continue;
 
+		/* Skip down past each reserved region in the way */
 		while (base && lmbbase <= base) {
-			j = lmb_overlaps_region(&lmb->reserved, base, size);
-			if (j < 0) {
+			res = lmb_overlaps_region(&lmb->reserved, base, size);
+			if (!res) {
 				/* This area isn't reserved, take it */
-				if (lmb_add_region(&lmb->reserved, base,
-							lmb_align_up(size,
-								align)) < 0)
+				if (lmb_reserve(lmb, base,
+						lmb_align_up(size, align)) < 0)
 					return 0;
 				return base;
 			}
-			res_base = lmb->reserved.region[j].base;
-			if (res_base < size)
+			if (res->base < size)
 				break;
-			base = lmb_align_down(res_base - size, align);
+			base = lmb_align_down(res->base - size, align);
 		}
 	}
 	return 0;
@@ -324,15 +494,44 @@ phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phy
 
 int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
+	struct lmb_property *r = lmb_lower(&lmb->reserved, addr);
+
+	return r && addr <= lmb_last(r);
+}
 
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return 1;
+phys_size_t lmb_get_free(struct lmb *lmb, phys_size_t *largestp)
+{
+	struct lmb_property *mem, *res;
+	phys_size_t total = 0, largest = 0;
+
+	for (mem = lmb_first(&lmb->memory); mem; mem = lmb_next(mem)) {
+		phys_addr_t pos = mem->base;
+		phys_addr_t last = lmb_last(mem);
+		phys_size_t gap;
+
+		/* Add up the gaps between reserved regions in this block */
+		res = lmb_overlaps_region(&lmb->reserved, mem->base,
+					  mem->size);
+		for (; res && res->base <= last; res = lmb_next(res)) {
+			if (res->base > pos) {
+				gap = res->base - pos;
+				total += gap;
+				largest = max(largest, gap);
+			}
+			if (lmb_last(res) >= last)
+				break;
+			pos = lmb_last(res) + 1;
+		}
+		if (!res || res->base > last || lmb_last(res) < last) {
+			gap = last - pos + 1;
+			total += gap;
+			largest = max(largest, gap);
+		}
 	}
-	return 0;
+	if (largestp)
+		*largestp = largest;
+
+	return total;
 }
 
 __weak void board_lmb_reserve(struct lmb *lmb)
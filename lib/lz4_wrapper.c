@@ -6,6 +6,8 @@
 
 #include <common.h>
 #include <compiler.h>
+#include <lz4.h>
+#include <malloc.h>
 #include <linux/kernel.h>
 #include <linux/types.h>
 
@@ -137,3 +139,333 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 	*dstn = out - dst;
 	return ret;
 }
+
+enum {
+	ULZ4_FRAME_HEADER,	/* magic, flags and block descriptor */
+	ULZ4_FRAME_HEADER_REST,	/* optional content size, header checksum */
+	ULZ4_BLOCK_HEADER,
+	ULZ4_BLOCK,		/* block data and optional checksum */
+	ULZ4_DONE,
+};
+
+void ulz4_stream_init(struct ulz4_stream *s, void *dst, size_t dstn)
+{
+	memset(s, '\0', sizeof(*s));
+	s->state = ULZ4_FRAME_HEADER;
+	s->dst = dst;
+	s->out = dst;
+	s->end = dst + dstn;
+}
+
+/*
+ * Return a pointer to the next @need bytes of input, or NULL if they are
+ * not all available yet. Input is used in place where possible, otherwise
+ * gathered in @buf (or the stream's block buffer if @buf is NULL).
+ */
+static const u8 *ulz4_stream_gather(struct ulz4_stream *s, u8 *buf,
+				    const u8 **in, size_t *len, size_t need)
+{
+	const u8 *p;
+	size_t n;
+
+	if (!s->have && *len >= need) {
+		p = *in;
+		*in += need;
+		*len -= need;
+		return p;
+	}
+
+	if (!buf) {
+		if (s->buf_size < need) {
+			buf = realloc(s->buf, need);
+			if (!buf)
+				return NULL;
+			s->buf = buf;
+			s->buf_size = need;
+		}
+		buf = s->buf;
+	}
+
+	n = min(need - s->have, *len);
+	memcpy(buf + s->have, *in, n);
+	s->have += n;
+	*in += n;
+	*len -= n;
+	if (s->have < need)
+		return NULL;
+	s->have = 0;
+
+	return buf;
+}
+
+/*
+ * Decompress one block with raw header @raw from @in into @out, which has
+ * room for @outn bytes. Returns the number of bytes written or -ve error.
+ */
+static int ulz4_block(u32 raw, const u8 *in, u8 *out, size_t outn)
+{
+	struct lz4_block_header b;
+	size_t size;
+	int ret;
+
+	b.raw = raw;
+	if (b.not_compressed) {
+		size = min((size_t)b.size, outn);
+		memcpy(out, in, size);
+		if (size < b.size)
+			return -ENOBUFS;	/* output overrun */
+		return size;
+	}
+
+	/* constant folding essential, do not touch params! */
+	ret = LZ4_decompress_generic((const char *)in, (char *)out, b.size,
+			outn, endOnInputSize, full, 0, noDict, out, NULL, 0);
+	if (ret < 0)
+		return -EPROTO;		/* decompression error */
+
+	return ret;
+}
+
+static int ulz4_stream_block(struct ulz4_stream *s, const u8 *in)
+{
+	int ret;
+
+	ret = ulz4_block(s->block, in, s->out, s->end - s->out);
+	if (ret < 0)
+		return ret;
+	s->out += ret;
+
+	return 0;
+}
+
+int ulz4_stream_feed(struct ulz4_stream *s, const void *src, size_t srcn)
+{
+	const struct lz4_frame_header *h;
+	struct lz4_block_header b;
+	const u8 *in = src;
+	const u8 *p;
+	size_t need;
+	int ret;
+
+	while (s->state != ULZ4_DONE) {
+		switch (s->state) {
+		case ULZ4_FRAME_HEADER:
+			h = (const void *)ulz4_stream_gather(s, s->hdr, &in,
+							     &srcn, sizeof(*h));
+			if (!h)
+				return 0;
+			if (le32_to_cpu(h->magic) != LZ4F_MAGIC ||
+			    h->version != 1)
+				return -EPROTONOSUPPORT; /* unknown format */
+			if (h->reserved0 || h->reserved1 || h->reserved2)
+				return -EINVAL;	/* reserved must be zero */
+			if (!h->independent_blocks)
+				return -EPROTONOSUPPORT;
+			s->has_block_checksum = h->has_block_checksum;
+			s->has_content_size = h->has_content_size;
+			s->state = ULZ4_FRAME_HEADER_REST;
+			break;
+		case ULZ4_FRAME_HEADER_REST:
+			need = sizeof(u8);
+			if (s->has_content_size)
+				need += sizeof(u64);
+			if (!ulz4_stream_gather(s, s->hdr, &in, &srcn, need))
+				return 0;
+			s->state = ULZ4_BLOCK_HEADER;
+			break;
+		case ULZ4_BLOCK_HEADER:
+			p = ulz4_stream_gather(s, s->hdr, &in, &srcn,
+					       sizeof(b));
+			if (!p)
+				return 0;
+			b.raw = le32_to_cpu(*(u32 *)p);
+			s->block = b.raw;
+			s->state = b.size ? ULZ4_BLOCK : ULZ4_DONE;
+			break;
+		case ULZ4_BLOCK:
+			b.raw = s->block;
+			need = b.size;
+			if (s->has_block_checksum)
+				need += sizeof(u32);
+			p = ulz4_stream_gather(s, NULL, &in, &srcn, need);
+			if (!p)
+				return s->buf_size < need ? -ENOMEM : 0;
+			ret = ulz4_stream_block(s, p);
+			if (ret)
+				return ret;
+			s->state = ULZ4_BLOCK_HEADER;
+			break;
+		}
+	}
+
+	return 1;
+}
+
+size_t ulz4_stream_end(struct ulz4_stream *s)
+{
+	free(s->buf);
+	s->buf = NULL;
+	s->buf_size = 0;
+
+	return s->out - s->dst;
+}
+
+/*
+ * Record the offset of each block of the frame in @offset, if not NULL.
+ * Returns the number of blocks, or -ve error.
+ */
+static int ulz4_index_walk(const u8 *src, size_t srcn, size_t pos,
+			   bool has_block_checksum, size_t block_size,
+			   size_t *offset)
+{
+	struct lz4_block_header b;
+	int count;
+
+	for (count = 0;; count++) {
+		if (pos + sizeof(b) > srcn)
+			return -EINVAL;		/* input overrun */
+		b.raw = le32_to_cpu(*(u32 *)(src + pos));
+		if (!b.size)
+			return count;
+		if (b.size > block_size || count == INT_MAX)
+			return -EINVAL;
+		if (offset)
+			offset[count] = pos;
+		pos += sizeof(b) + b.size;
+		if (has_block_checksum)
+			pos += sizeof(u32);
+		if (pos > srcn)
+			return -EINVAL;		/* input overrun */
+	}
+}
+
+int ulz4_index_init(struct ulz4_index *idx, const void *src, size_t srcn)
+{
+	const struct lz4_frame_header *h = src;
+	size_t pos;
+	int count;
+
+	memset(idx, '\0', sizeof(*idx));
+	if (srcn < sizeof(*h) + sizeof(u8))
+		return -EINVAL;
+	if (le32_to_cpu(h->magic) != LZ4F_MAGIC || h->version != 1)
+		return -EPROTONOSUPPORT;	/* unknown format */
+	if (h->reserved0 || h->reserved1 || h->reserved2)
+		return -EINVAL;	/* reserved must be zero */
+	if (!h->independent_blocks || h->max_block_size < 4)
+		return -EPROTONOSUPPORT;
+
+	/* 4 means 64KB, going up by a factor of four each time */
+	idx->block_size = 1 << (2 * h->max_block_size + 8);
+	idx->src = src;
+	pos = sizeof(*h) + sizeof(u8);
+	if (h->has_content_size)
+		pos += sizeof(u64);
+
+	count = ulz4_index_walk(src, srcn, pos, h->has_block_checksum,
+				idx->block_size, NULL);
+	if (count < 0)
+		return count;
+	idx->offset = malloc(max(count, 1) * sizeof(*idx->offset));
+	if (!idx->offset)
+		return -ENOMEM;
+	ulz4_index_walk(src, srcn, pos, h->has_block_checksum,
+			idx->block_size, idx->offset);
+	idx->count = count;
+
+	return 0;
+}
+
+/* Decompress block @i, checking that all but the last block are full */
+static int ulz4_index_block(struct ulz4_index *idx, uint i, u8 *out,
+			    size_t outn)
+{
+	const u8 *in = idx->src + idx->offset[i];
+	int ret;
+
+	ret = ulz4_block(le32_to_cpu(*(u32 *)in), in + sizeof(u32), out, outn);
+	if (ret >= 0 && i != idx->count - 1 &&
+	    (size_t)ret != idx->block_size)
+		ret = -EPROTO;
+
+	return ret;
+}
+
+int ulz4_index_read(struct ulz4_index *idx, size_t offset, void *dst,
+		    size_t *dstn)
+{
+	size_t len = *dstn;
+	size_t done, skip, n;
+	u8 *out = dst;
+	uint i;
+	int ret;
+
+	*dstn = 0;
+	for (done = 0; done < len; done += n) {
+		i = (offset + done) / idx->block_size;
+		skip = (offset + done) % idx->block_size;
+		if (i >= idx->count)
+			break;
+
+		/* Whole blocks go straight to the output */
+		if (!skip && len - done >= idx->block_size) {
+			ret = ulz4_index_block(idx, i, out + done,
+					       idx->block_size);
+			if (ret < 0)
+				return ret;
+			n = ret;
+			if (!n)
+				break;
+			continue;
+		}
+
+		/* Otherwise keep the block, as the next read may want more */
+		if (!idx->buf || idx->buf_block != i) {
+			if (!idx->buf) {
+				idx->buf = malloc(idx->block_size);
+				if (!idx->buf)
+					return -ENOMEM;
+			}
+			ret = ulz4_index_block(idx, i, idx->buf,
+					       idx->block_size);
+			if (ret < 0) {
+				idx->buf_block = idx->count;
+				return ret;
+			}
+			idx->buf_block = i;
+			idx->buf_len = ret;
+		}
+		if (skip >= idx->buf_len)
+			break;
+		n = min(idx->buf_len - skip, len - done);
+		memcpy(out + done, idx->buf + skip, n);
+	}
+	*dstn = done;
+
+	return 0;
+}
+
+void ulz4_index_free(struct ulz4_index *idx)
+{
+	free(idx->offset);
+	free(idx->buf);
+	idx->offset = NULL;
+	idx->buf = NULL;
+}
+
+int ulz4fn_range(const void *src, size_t srcn, size_t offset, void *dst,
+		 size_t *dstn)
+{
+	struct ulz4_index idx;
+	int ret;
+
+	ret = ulz4_index_init(&idx, src, srcn);
+	if (ret) {
+		*dstn = 0;
+		return ret;
+	}
+	ret = ulz4_index_read(&idx, offset, dst, dstn);
+	ulz4_index_free(&idx);
+
+	return ret;
+}
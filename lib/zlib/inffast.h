@@ -8,4 +8,11 @@
    subject to change. Applications should only use zlib.h.
  */
 
+/*
+ * inflate_fast() reads eight bytes of input at a time and may write up to
+ * seven bytes beyond the end of a match, so it needs this much of each
+ */
+#define INFLATE_FAST_MIN_INPUT	8
+#define INFLATE_FAST_MIN_OUTPUT	(258 + 7)
+
 void inflate_fast OF((z_streamp strm, unsigned start));
@@ -2,6 +2,14 @@
  * Copyright (C) 1995-2005 Mark Adler
  * For conditions of distribution and use, see copyright notice in zlib.h
  */
+
+/* Streams may be used where the watchdog must not be touched */
+#define INFLATE_WATCHDOG_RESET(strm) \
+	do { \
+		if (!(strm)->no_watchdog) \
+			WATCHDOG_RESET(); \
+	} while (0)
+
 local void fixedtables OF((struct inflate_state FAR *state));
 local int updatewindow OF((z_streamp strm, unsigned out));
 
@@ -25,7 +33,7 @@ int ZEXPORT inflateReset(z_streamp strm)
     state->hold = 0;
     state->bits = 0;
     state->lencode = state->distcode = state->next = state->codes;
-    WATCHDOG_RESET();
+    INFLATE_WATCHDOG_RESET(strm);
     Tracev((stderr, "inflate: reset\n"));
     return Z_OK;
 }
@@ -543,7 +551,7 @@ int ZEXPORT inflate(z_streamp strm, int flush)
             strm->adler = state->check = adler32(0L, Z_NULL, 0);
             state->mode = TYPE;
         case TYPE:
-	    WATCHDOG_RESET();
+	    INFLATE_WATCHDOG_RESET(strm);
             if (flush == Z_BLOCK) goto inf_leave;
         case TYPEDO:
             if (state->last) {
@@ -721,8 +729,9 @@ int ZEXPORT inflate(z_streamp strm, int flush)
             Tracev((stderr, "inflate:       codes ok\n"));
             state->mode = LEN;
         case LEN:
-	    WATCHDOG_RESET();
-            if (have >= 6 && left >= 258) {
+	    INFLATE_WATCHDOG_RESET(strm);
+            if (have >= INFLATE_FAST_MIN_INPUT &&
+                left >= INFLATE_FAST_MIN_OUTPUT) {
                 RESTORE();
                 inflate_fast(strm, out);
                 LOAD();
@@ -933,7 +942,7 @@ int ZEXPORT inflateEnd(z_streamp strm)
         return Z_STREAM_ERROR;
     state = (struct inflate_state FAR *)strm->state;
     if (state->window != Z_NULL) {
-	WATCHDOG_RESET();
+	INFLATE_WATCHDOG_RESET(strm);
 	ZFREE(strm, state->window);
     }
     ZFREE(strm, strm->state);
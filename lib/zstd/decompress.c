@@ -0,0 +1,637 @@
+/*
+ * Zstandard decompression - frames, blocks and sequences
+ *
+ * This decodes zstd frames (RFC 8878) held entirely in memory into a flat
+ * output buffer. Since the whole output is available, matches refer to it
+ * directly and no separate window is needed. Dictionaries are not
+ * supported.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <zstd.h>
+#include <linux/string.h>
+#include "zstd_internal.h"
+
+#define ZSTD_MAGIC		0xfd2fb528
+#define ZSTD_SKIPPABLE_MAGIC	0x184d2a50
+#define ZSTD_SKIPPABLE_MASK	0xfffffff0
+
+enum {
+	ZSTD_BLOCK_RAW,
+	ZSTD_BLOCK_RLE,
+	ZSTD_BLOCK_COMPRESSED,
+};
+
+enum {
+	ZSTD_LIT_RAW,
+	ZSTD_LIT_RLE,
+	ZSTD_LIT_COMPRESSED,
+	ZSTD_LIT_TREELESS,
+};
+
+enum {
+	ZSTD_MODE_PREDEFINED,
+	ZSTD_MODE_RLE,
+	ZSTD_MODE_FSE,
+	ZSTD_MODE_REPEAT,
+};
+
+/* The three codes making up a sequence, in the order of their tables */
+enum {
+	ZSTD_LL,
+	ZSTD_OF,
+	ZSTD_ML,
+	ZSTD_SEQ_TABLES,
+};
+
+static const s16 zstd_ll_default[] = {
+	4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+	-1, -1, -1, -1
+};
+
+static const s16 zstd_of_default[] = {
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+static const s16 zstd_ml_default[] = {
+	1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+	-1, -1, -1, -1, -1
+};
+
+/**
+ * struct zstd_seq_info - how each kind of sequence code is coded
+ *
+ * @norm:	Predefined distribution
+ * @count:	Number of symbols in @norm
+ * @log:	Log2 of the predefined table size
+ * @max_symbol:	Largest valid code
+ * @max_log:	Log2 of the largest table allowed
+ */
+static const struct zstd_seq_info {
+	const s16 *norm;
+	u8 count;
+	u8 log;
+	u8 max_symbol;
+	u8 max_log;
+} zstd_seq_info[ZSTD_SEQ_TABLES] = {
+	[ZSTD_LL] = { zstd_ll_default, ARRAY_SIZE(zstd_ll_default), 6, 35, 9 },
+	[ZSTD_OF] = { zstd_of_default, ARRAY_SIZE(zstd_of_default), 5, 31, 8 },
+	[ZSTD_ML] = { zstd_ml_default, ARRAY_SIZE(zstd_ml_default), 6, 52, 9 },
+};
+
+static const u32 zstd_ll_base[36] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048,
+	4096, 8192, 16384, 32768, 65536
+};
+
+static const u8 zstd_ll_bits[36] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+	13, 14, 15, 16
+};
+
+static const u32 zstd_ml_base[53] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+	19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+	35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+	4099, 8195, 16387, 32771, 65539
+};
+
+static const u8 zstd_ml_bits[53] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16
+};
+
+/**
+ * struct zstd_dctx - decompression state carried from block to block
+ *
+ * @huf:	Huffman table of the last block with one, for treeless literals
+ * @huf_valid:	true if @huf has been set up in this frame
+ * @seq:	Sequence tables of the last block, for repeat mode
+ * @seq_valid:	true if the corresponding table has been set up in this frame
+ * @rep:	The three most recent match offsets
+ * @lit:	Buffer for decoded literals
+ */
+struct zstd_dctx {
+	struct zstd_huf_table huf;
+	bool huf_valid;
+	struct zstd_fse_table seq[ZSTD_SEQ_TABLES];
+	bool seq_valid[ZSTD_SEQ_TABLES];
+	u32 rep[3];
+	u8 lit[ZSTD_BLOCK_MAX];
+};
+
+#define PRIME64_1	0x9e3779b185ebca87ULL
+#define PRIME64_2	0xc2b2ae3d27d4eb4fULL
+#define PRIME64_3	0x165667b19e3779f9ULL
+#define PRIME64_4	0x85ebca77c2b2ae63ULL
+#define PRIME64_5	0x27d4eb2f165667c5ULL
+
+static inline u64 rotl64(u64 val, int n)
+{
+	return val << n | val >> (64 - n);
+}
+
+static inline u64 xxh64_round(u64 acc, u64 input)
+{
+	return rotl64(acc + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+static inline u64 xxh64_merge(u64 acc, u64 val)
+{
+	return (acc ^ xxh64_round(0, val)) * PRIME64_1 + PRIME64_4;
+}
+
+/* XXH64 with a seed of 0, which frames use as their content checksum */
+static u64 zstd_xxh64(const u8 *p, size_t len)
+{
+	const u8 *end = p + len;
+	u64 h;
+
+	if (len >= 32) {
+		u64 v1 = PRIME64_1 + PRIME64_2;
+		u64 v2 = PRIME64_2;
+		u64 v3 = 0;
+		u64 v4 = -PRIME64_1;
+
+		for (; end - p >= 32; p += 32) {
+			v1 = xxh64_round(v1, get_unaligned_le64(p));
+			v2 = xxh64_round(v2, get_unaligned_le64(p + 8));
+			v3 = xxh64_round(v3, get_unaligned_le64(p + 16));
+			v4 = xxh64_round(v4, get_unaligned_le64(p + 24));
+		}
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) +
+			rotl64(v4, 18);
+		h = xxh64_merge(h, v1);
+		h = xxh64_merge(h, v2);
+		h = xxh64_merge(h, v3);
+		h = xxh64_merge(h, v4);
+	} else {
+		h = PRIME64_5;
+	}
+	h += len;
+
+	for (; end - p >= 8; p += 8) {
+		h ^= xxh64_round(0, get_unaligned_le64(p));
+		h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (end - p >= 4) {
+		h ^= get_unaligned_le32(p) * PRIME64_1;
+		h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= *p * PRIME64_5;
+		h = rotl64(h, 11) * PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+/*
+ * Decode the literals section of a compressed block, returning its size.
+ * The literals are left in place if they are stored raw.
+ */
+static int zstd_decode_literals(struct zstd_dctx *ctx, const u8 *src,
+				size_t len, const u8 **litp, size_t *countp)
+{
+	uint type, format, hdr_len, bits;
+	size_t count, size;
+	u64 hdr;
+	int i, ret;
+
+	if (!len)
+		return -EINVAL;
+	type = src[0] & 3;
+	format = src[0] >> 2 & 3;
+
+	if (type == ZSTD_LIT_RAW || type == ZSTD_LIT_RLE) {
+		switch (format) {
+		case 1:
+			hdr_len = 2;
+			break;
+		case 3:
+			hdr_len = 3;
+			break;
+		default:
+			hdr_len = 1;
+			break;
+		}
+		if (len < hdr_len)
+			return -EINVAL;
+		if (hdr_len == 1)
+			count = src[0] >> 3;
+		else if (hdr_len == 2)
+			count = (src[0] >> 4) + (src[1] << 4);
+		else
+			count = (src[0] >> 4) + (src[1] << 4) + (src[2] << 12);
+		if (count > ZSTD_BLOCK_MAX)
+			return -EINVAL;
+		*countp = count;
+
+		if (type == ZSTD_LIT_RAW) {
+			if (hdr_len + count > len)
+				return -EINVAL;
+			*litp = src + hdr_len;
+			return hdr_len + count;
+		}
+		if (hdr_len + 1 > len)
+			return -EINVAL;
+		memset(ctx->lit, src[hdr_len], count);
+		*litp = ctx->lit;
+		return hdr_len + 1;
+	}
+
+	/* Huffman-coded: both sizes are packed into the header */
+	hdr_len = format < 2 ? 3 : format + 2;
+	bits = format < 2 ? 10 : format == 2 ? 14 : 18;
+	if (len < hdr_len)
+		return -EINVAL;
+	for (i = hdr_len - 1, hdr = 0; i >= 0; i--)
+		hdr = hdr << 8 | src[i];
+	count = hdr >> 4 & ((1 << bits) - 1);
+	size = hdr >> (4 + bits) & ((1 << bits) - 1);
+	if (count > ZSTD_BLOCK_MAX || hdr_len + size > len)
+		return -EINVAL;
+	src += hdr_len;
+
+	if (type == ZSTD_LIT_COMPRESSED) {
+		ret = zstd_huf_read_table(&ctx->huf, src, size);
+		if (ret < 0)
+			return ret;
+		ctx->huf_valid = true;
+	} else if (!ctx->huf_valid) {
+		return -EINVAL;
+	} else {
+		ret = 0;
+	}
+	if (zstd_huf_decode(&ctx->huf, src + ret, size - ret, ctx->lit, count,
+			    format != 0))
+		return -EINVAL;
+	*litp = ctx->lit;
+	*countp = count;
+
+	return hdr_len + size;
+}
+
+/* Set up the table for one kind of sequence code, returning bytes used */
+static int zstd_seq_table(struct zstd_dctx *ctx, int which, uint mode,
+			  const u8 *src, size_t len)
+{
+	const struct zstd_seq_info *info = &zstd_seq_info[which];
+	struct zstd_fse_table *table = &ctx->seq[which];
+	int ret = 0;
+
+	switch (mode) {
+	case ZSTD_MODE_PREDEFINED:
+		zstd_fse_build(table, info->norm, info->count, info->log);
+		break;
+	case ZSTD_MODE_RLE:
+		if (!len || src[0] > info->max_symbol)
+			return -EINVAL;
+		zstd_fse_build_rle(table, src[0]);
+		ret = 1;
+		break;
+	case ZSTD_MODE_FSE:
+		ret = zstd_fse_read_table(table, src, len, info->max_symbol,
+					  info->max_log);
+		if (ret < 0)
+			return ret;
+		break;
+	case ZSTD_MODE_REPEAT:
+		if (!ctx->seq_valid[which])
+			return -EINVAL;
+		break;
+	}
+	ctx->seq_valid[which] = true;
+
+	return ret;
+}
+
+/* Work out the offset of a match, keeping the recent offsets up to date */
+static inline u32 zstd_offset(u32 *rep, u32 value, u32 lit_len)
+{
+	u32 offset;
+	uint idx;
+
+	if (value > 3) {
+		offset = value - 3;
+		idx = 3;
+	} else {
+		/* repeat codes are shifted by one after an empty literal run */
+		idx = value - 1 + !lit_len;
+		if (!idx)
+			return rep[0];
+		offset = idx < 3 ? rep[idx] : rep[0] - 1;
+	}
+	if (idx > 1)
+		rep[2] = rep[1];
+	rep[1] = rep[0];
+	rep[0] = offset;
+
+	return offset;
+}
+
+static int zstd_decode_sequences(struct zstd_dctx *ctx, const u8 *src,
+				 size_t len, const u8 *lit, size_t lit_count,
+				 const u8 *frame, u8 **outp, u8 *end)
+{
+	const u8 *lit_end = lit + lit_count;
+	const u8 *send = src + len;
+	struct zstd_fse_entry *ll_e, *of_e, *ml_e;
+	uint ll_state, of_state, ml_state;
+	struct zstd_bits b;
+	u8 *out = *outp;
+	uint count, seq, modes;
+	int i, ret;
+
+	if (!len)
+		return -EINVAL;
+	count = *src++;
+	if (count >= 128) {
+		if (count < 255) {
+			if (src >= send)
+				return -EINVAL;
+			count = ((count - 128) << 8) + *src++;
+		} else {
+			if (send - src < 2)
+				return -EINVAL;
+			count = get_unaligned_le16(src) + 0x7f00;
+			src += 2;
+		}
+	}
+
+	if (!count) {
+		/* nothing follows, not even the compression modes */
+		if (src != send)
+			return -EINVAL;
+	} else {
+		if (src >= send)
+			return -EINVAL;
+		modes = *src++;
+		if (modes & 3)
+			return -EINVAL;
+		for (i = 0; i < ZSTD_SEQ_TABLES; i++) {
+			ret = zstd_seq_table(ctx, i, modes >> (6 - i * 2) & 3,
+					     src, send - src);
+			if (ret < 0)
+				return ret;
+			src += ret;
+		}
+		if (zstd_bits_init(&b, src, send - src))
+			return -EINVAL;
+
+		ll_e = ctx->seq[ZSTD_LL].entry;
+		of_e = ctx->seq[ZSTD_OF].entry;
+		ml_e = ctx->seq[ZSTD_ML].entry;
+		ll_state = zstd_bits_read(&b, ctx->seq[ZSTD_LL].log);
+		of_state = zstd_bits_read(&b, ctx->seq[ZSTD_OF].log);
+		ml_state = zstd_bits_read(&b, ctx->seq[ZSTD_ML].log);
+	}
+
+	for (seq = 0; seq < count; seq++) {
+		u32 ll_code = ll_e[ll_state].symbol;
+		u32 of_code = of_e[of_state].symbol;
+		u32 ml_code = ml_e[ml_state].symbol;
+		u32 lit_len, match_len, offset;
+		const u8 *match;
+		size_t n;
+
+		/* at most 31 + 16 + 16 bits, then 9 + 9 + 8 for the states */
+		zstd_bits_reload(&b);
+		offset = (1U << of_code) + zstd_bits_read(&b, of_code);
+		zstd_bits_reload(&b);
+		match_len = zstd_ml_base[ml_code] +
+			zstd_bits_read(&b, zstd_ml_bits[ml_code]);
+		lit_len = zstd_ll_base[ll_code] +
+			zstd_bits_read(&b, zstd_ll_bits[ll_code]);
+		offset = zstd_offset(ctx->rep, offset, lit_len);
+
+		if (seq + 1 < count) {
+			zstd_bits_reload(&b);
+			ll_state = ll_e[ll_state].base +
+				zstd_bits_read(&b, ll_e[ll_state].bits);
+			ml_state = ml_e[ml_state].base +
+				zstd_bits_read(&b, ml_e[ml_state].bits);
+			of_state = of_e[of_state].base +
+				zstd_bits_read(&b, of_e[of_state].bits);
+		}
+
+		if (lit_len > lit_end - lit)
+			return -EINVAL;
+		if (lit_len + match_len > end - out)
+			return -ENOBUFS;
+		memcpy(out, lit, lit_len);
+		out += lit_len;
+		lit += lit_len;
+
+		if (!offset || offset > out - frame)
+			return -EINVAL;
+		match = out - offset;
+		if (offset >= match_len) {
+			memcpy(out, match, match_len);
+			out += match_len;
+			continue;
+		}
+		/* the match overlaps its copy: copy as much as is ready */
+		while (match_len) {
+			n = min((size_t)match_len, (size_t)(out - match));
+			memcpy(out, match, n);
+			out += n;
+			match_len -= n;
+		}
+	}
+	if (count && !zstd_bits_done(&b))
+		return -EINVAL;
+
+	/* the literals left over follow the last sequence */
+	if (lit_end - lit > end - out)
+		return -ENOBUFS;
+	memcpy(out, lit, lit_end - lit);
+	*outp = out + (lit_end - lit);
+
+	return 0;
+}
+
+static int zstd_decode_frame(struct zstd_dctx *ctx, const u8 **srcp,
+			     const u8 *send, u8 **outp, u8 *end)
+{
+	static const u8 dict_id_len[] = { 0, 1, 2, 4 };
+	const u8 *src = *srcp + 4;
+	u8 *frame = *outp, *out = *outp;
+	uint desc, fcs_len, hdr_len, type;
+	u64 content_size = 0;
+	u32 hdr, size;
+	bool last;
+	int i, ret;
+
+	if (src >= send)
+		return -EINVAL;
+	desc = *src++;
+	if (desc & 0x08)
+		return -EINVAL;		/* reserved bit */
+	fcs_len = desc >> 6 ? 1 << (desc >> 6) : (desc >> 5 & 1);
+	hdr_len = !(desc & 0x20) + dict_id_len[desc & 3] + fcs_len;
+	if (send - src < hdr_len)
+		return -EINVAL;
+
+	/* the window size does not matter since all output is kept */
+	if (!(desc & 0x20))
+		src++;
+	for (i = 0; i < dict_id_len[desc & 3]; i++) {
+		if (*src++)
+			return -EPROTONOSUPPORT;	/* needs a dictionary */
+	}
+	for (i = fcs_len - 1; i >= 0; i--)
+		content_size = content_size << 8 | src[i];
+	if (fcs_len == 2)
+		content_size += 256;
+	src += fcs_len;
+	if (fcs_len && content_size > end - out)
+		return -ENOBUFS;
+
+	ctx->huf_valid = false;
+	memset(ctx->seq_valid, '\0', sizeof(ctx->seq_valid));
+	ctx->rep[0] = 1;
+	ctx->rep[1] = 4;
+	ctx->rep[2] = 8;
+
+	do {
+		if (send - src < 3)
+			return -EINVAL;
+		hdr = src[0] | src[1] << 8 | src[2] << 16;
+		src += 3;
+		last = hdr & 1;
+		type = hdr >> 1 & 3;
+		size = hdr >> 3;
+
+		switch (type) {
+		case ZSTD_BLOCK_RAW:
+			if (size > send - src)
+				return -EINVAL;
+			if (size > end - out)
+				return -ENOBUFS;
+			memcpy(out, src, size);
+			src += size;
+			out += size;
+			break;
+		case ZSTD_BLOCK_RLE:
+			if (src >= send)
+				return -EINVAL;
+			if (size > end - out)
+				return -ENOBUFS;
+			memset(out, *src++, size);
+			out += size;
+			break;
+		case ZSTD_BLOCK_COMPRESSED: {
+			const u8 *lit;
+			size_t lit_count;
+
+			if (size > send - src || size > ZSTD_BLOCK_MAX)
+				return -EINVAL;
+			ret = zstd_decode_literals(ctx, src, size, &lit,
+						   &lit_count);
+			if (ret < 0)
+				return ret;
+			ret = zstd_decode_sequences(ctx, src + ret, size - ret,
+						    lit, lit_count, frame,
+						    &out, end);
+			if (ret)
+				return ret;
+			src += size;
+			break;
+		}
+		default:
+			return -EINVAL;
+		}
+	} while (!last);
+
+	if (fcs_len && out - frame != content_size)
+		return -EINVAL;
+	if (desc & 0x04) {
+		if (send - src < 4)
+			return -EINVAL;
+		if (get_unaligned_le32(src) != (u32)zstd_xxh64(frame,
+							       out - frame))
+			return -EINVAL;
+		src += 4;
+	}
+	*srcp = src;
+	*outp = out;
+
+	return 0;
+}
+
+size_t zstd_ws_size(void)
+{
+	return sizeof(struct zstd_dctx);
+}
+
+int zstd_decompress_ws(const void *src, size_t srcn, void *dst, size_t *dstn,
+		       void *ws)
+{
+	const u8 *in = src, *in_end = in + srcn;
+	u8 *out = dst, *out_end = out + *dstn;
+	struct zstd_dctx *ctx = ws;
+	u32 magic, size;
+	int ret = 0;
+
+	if (!srcn)
+		return -EINVAL;
+
+	while (!ret && in < in_end) {
+		if (in_end - in < 4) {
+			ret = -EINVAL;
+			break;
+		}
+		magic = get_unaligned_le32(in);
+		if (magic == ZSTD_MAGIC) {
+			ret = zstd_decode_frame(ctx, &in, in_end, &out,
+						out_end);
+		} else if ((magic & ZSTD_SKIPPABLE_MASK) ==
+			   ZSTD_SKIPPABLE_MAGIC) {
+			size = in_end - in < 8 ? 0 : get_unaligned_le32(in + 4);
+			if (in_end - in < 8 || size > in_end - in - 8)
+				ret = -EINVAL;
+			else
+				in += 8 + size;
+		} else {
+			ret = -EPROTONOSUPPORT;	/* unknown format */
+		}
+	}
+	*dstn = out - (u8 *)dst;
+
+	return ret;
+}
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	void *ws;
+	int ret;
+
+	if (!srcn)
+		return -EINVAL;
+	ws = malloc(zstd_ws_size());
+	if (!ws)
+		return -ENOMEM;
+	ret = zstd_decompress_ws(src, srcn, dst, dstn, ws);
+	free(ws);
+
+	return ret;
+}
@@ -0,0 +1,339 @@
+/*
+ * Zstandard decompression - FSE and Huffman entropy decoding
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <linux/string.h>
+#include "zstd_internal.h"
+
+int zstd_fse_build(struct zstd_fse_table *table, const s16 *norm, uint count,
+		   uint log)
+{
+	struct zstd_fse_entry *entry = table->entry;
+	uint size = 1 << log;
+	uint high = size - 1;
+	uint step = (size >> 1) + (size >> 3) + 3;
+	u16 next[ZSTD_FSE_MAX_SYMBOLS];
+	uint pos, sym, i;
+
+	/* 'less than one' symbols take one state each, at the top */
+	for (sym = 0; sym < count; sym++) {
+		if (norm[sym] == -1) {
+			entry[high--].symbol = sym;
+			next[sym] = 1;
+		} else {
+			next[sym] = norm[sym];
+		}
+	}
+
+	/* spread the others over the remaining states */
+	for (sym = 0, pos = 0; sym < count; sym++) {
+		if (norm[sym] <= 0)
+			continue;
+		for (i = 0; i < norm[sym]; i++) {
+			entry[pos].symbol = sym;
+			do {
+				pos = (pos + step) & (size - 1);
+			} while (pos > high);
+		}
+	}
+	if (pos)
+		return -EINVAL;
+
+	for (i = 0; i < size; i++) {
+		uint state = next[entry[i].symbol]++;
+		uint bits = log + 1 - fls(state);
+
+		entry[i].bits = bits;
+		entry[i].base = (state << bits) - size;
+	}
+	table->log = log;
+
+	return 0;
+}
+
+void zstd_fse_build_rle(struct zstd_fse_table *table, u8 symbol)
+{
+	table->log = 0;
+	table->entry[0].symbol = symbol;
+	table->entry[0].bits = 0;
+	table->entry[0].base = 0;
+}
+
+/* Read @n bits from a little-endian bitstream which is read forwards */
+static uint zstd_fwd_bits(const u8 *src, size_t len, size_t *posp, uint n)
+{
+	size_t byte = *posp / 8;
+	uint shift = *posp % 8;
+	u32 val = 0;
+	int i;
+
+	for (i = 0; i < 4 && byte + i < len; i++)
+		val |= (u32)src[byte + i] << (i * 8);
+	*posp += n;
+
+	return (val >> shift) & ((1 << n) - 1);
+}
+
+int zstd_fse_read_table(struct zstd_fse_table *table, const u8 *src,
+			size_t len, uint max_symbol, uint max_log)
+{
+	s16 norm[ZSTD_FSE_MAX_SYMBOLS];
+	int remaining, prob;
+	uint log, sym, bits, val, mask, threshold, repeat, i;
+	size_t pos = 0;
+
+	if (!len)
+		return -EINVAL;
+	log = zstd_fwd_bits(src, len, &pos, 4) + 5;
+	if (log > max_log)
+		return -EINVAL;
+
+	remaining = 1 << log;
+	sym = 0;
+	while (remaining > 0) {
+		if (sym > max_symbol)
+			return -EINVAL;
+
+		/* small values take one bit fewer than large ones */
+		bits = fls(remaining + 1);
+		mask = (1 << (bits - 1)) - 1;
+		threshold = (1 << bits) - 1 - (remaining + 1);
+		val = zstd_fwd_bits(src, len, &pos, bits);
+		if ((val & mask) < threshold) {
+			pos--;
+			val &= mask;
+		} else if (val > mask) {
+			val -= threshold;
+		}
+		prob = val - 1;
+		remaining -= prob < 0 ? -prob : prob;
+		norm[sym++] = prob;
+
+		/* a zero is followed by 2-bit counts of further zeroes */
+		if (!prob) {
+			do {
+				repeat = zstd_fwd_bits(src, len, &pos, 2);
+				if (sym + repeat > max_symbol + 1)
+					return -EINVAL;
+				for (i = 0; i < repeat; i++)
+					norm[sym++] = 0;
+			} while (repeat == 3);
+		}
+	}
+	if (remaining || pos > len * 8)
+		return -EINVAL;
+	if (zstd_fse_build(table, norm, sym, log))
+		return -EINVAL;
+
+	return DIV_ROUND_UP(pos, 8);
+}
+
+/* Decode the FSE-compressed weights of a Huffman tree description */
+static int zstd_huf_read_weights(u8 *weights, const u8 *src, size_t len)
+{
+	struct zstd_fse_table table;
+	struct zstd_fse_entry *entry = table.entry;
+	struct zstd_bits b;
+	uint state1, state2;
+	int count = 0;
+	int ret;
+
+	ret = zstd_fse_read_table(&table, src, len, ZSTD_HUF_MAX_BITS,
+				  ZSTD_HUF_WEIGHT_LOG);
+	if (ret < 0)
+		return ret;
+	if (zstd_bits_init(&b, src + ret, len - ret))
+		return -EINVAL;
+
+	/*
+	 * Two interleaved states share the stream, which ends once updating a
+	 * state needs more bits than are left; the other state then gives the
+	 * final weight.
+	 */
+	state1 = zstd_bits_read(&b, table.log);
+	state2 = zstd_bits_read(&b, table.log);
+	while (1) {
+		/* leave room for the last two and the implied weight */
+		if (count > ZSTD_HUF_MAX_SYMBOLS - 4)
+			return -EINVAL;
+		zstd_bits_reload(&b);
+		weights[count++] = entry[state1].symbol;
+		state1 = entry[state1].base +
+			zstd_bits_read(&b, entry[state1].bits);
+		if (zstd_bits_overflow(&b)) {
+			weights[count++] = entry[state2].symbol;
+			break;
+		}
+		weights[count++] = entry[state2].symbol;
+		state2 = entry[state2].base +
+			zstd_bits_read(&b, entry[state2].bits);
+		if (zstd_bits_overflow(&b)) {
+			weights[count++] = entry[state1].symbol;
+			break;
+		}
+	}
+
+	return count;
+}
+
+int zstd_huf_read_table(struct zstd_huf_table *table, const u8 *src,
+			size_t len)
+{
+	u8 weights[ZSTD_HUF_MAX_SYMBOLS];
+	u16 rank_count[ZSTD_HUF_MAX_BITS + 1];
+	u32 rank_pos[ZSTD_HUF_MAX_BITS + 1];
+	uint max_bits, count, left, used;
+	u32 total = 0;
+	int sym, i;
+
+	if (!len)
+		return -EINVAL;
+	if (src[0] >= 128) {
+		/* weights stored directly, two per byte */
+		count = src[0] - 127;
+		used = 1 + DIV_ROUND_UP(count, 2);
+		if (used > len)
+			return -EINVAL;
+		for (i = 0; i < count; i++) {
+			u8 byte = src[1 + i / 2];
+
+			weights[i] = i & 1 ? byte & 0xf : byte >> 4;
+		}
+	} else {
+		used = 1 + src[0];
+		if (used > len)
+			return -EINVAL;
+		i = zstd_huf_read_weights(weights, src + 1, src[0]);
+		if (i < 0)
+			return i;
+		count = i;
+	}
+
+	/* the weight of the last symbol makes the total a power of two */
+	for (i = 0; i < count; i++) {
+		if (weights[i] > ZSTD_HUF_MAX_BITS)
+			return -EINVAL;
+		if (weights[i])
+			total += 1 << (weights[i] - 1);
+	}
+	if (!total)
+		return -EINVAL;
+	max_bits = fls(total);
+	if (max_bits > ZSTD_HUF_MAX_BITS)
+		return -EINVAL;
+	left = (1 << max_bits) - total;
+	if (left & (left - 1))
+		return -EINVAL;
+	weights[count++] = fls(left);
+
+	/* codes are assigned in order of length, longest first */
+	memset(rank_count, '\0', sizeof(rank_count));
+	for (i = 0; i < count; i++) {
+		if (weights[i])
+			rank_count[max_bits + 1 - weights[i]]++;
+	}
+	rank_pos[max_bits] = 0;
+	for (i = max_bits; i > 0; i--)
+		rank_pos[i - 1] = rank_pos[i] +
+			rank_count[i] * (1 << (max_bits - i));
+	if (rank_pos[0] != 1 << max_bits)
+		return -EINVAL;
+
+	for (sym = 0; sym < count; sym++) {
+		uint bits, pos, n;
+
+		if (!weights[sym])
+			continue;
+		bits = max_bits + 1 - weights[sym];
+		pos = rank_pos[bits];
+		n = 1 << (max_bits - bits);
+		rank_pos[bits] += n;
+		for (i = 0; i < n; i++) {
+			table->entry[pos + i].symbol = sym;
+			table->entry[pos + i].bits = bits;
+		}
+	}
+	table->max_bits = max_bits;
+
+	return used;
+}
+
+static int zstd_huf_decode_stream(const struct zstd_huf_table *table,
+				  const u8 *src, size_t len, u8 *dst,
+				  size_t count)
+{
+	const struct zstd_huf_entry *entry = table->entry;
+	uint max_bits = table->max_bits;
+	const struct zstd_huf_entry *e;
+	struct zstd_bits b;
+	u8 *end = dst + count;
+
+	if (zstd_bits_init(&b, src, len))
+		return -EINVAL;
+
+	/* codes are at most 11 bits, so four fit in each reload */
+	while (end - dst >= 4) {
+		zstd_bits_reload(&b);
+		e = &entry[zstd_bits_peek(&b, max_bits)];
+		b.used += e->bits;
+		*dst++ = e->symbol;
+		e = &entry[zstd_bits_peek(&b, max_bits)];
+		b.used += e->bits;
+		*dst++ = e->symbol;
+		e = &entry[zstd_bits_peek(&b, max_bits)];
+		b.used += e->bits;
+		*dst++ = e->symbol;
+		e = &entry[zstd_bits_peek(&b, max_bits)];
+		b.used += e->bits;
+		*dst++ = e->symbol;
+	}
+	zstd_bits_reload(&b);
+	while (dst < end) {
+		e = &entry[zstd_bits_peek(&b, max_bits)];
+		b.used += e->bits;
+		*dst++ = e->symbol;
+	}
+	if (!zstd_bits_done(&b))
+		return -EINVAL;
+
+	return 0;
+}
+
+int zstd_huf_decode(const struct zstd_huf_table *table, const u8 *src,
+		    size_t len, u8 *dst, size_t count, bool four_streams)
+{
+	size_t size[4], seg;
+	int i, ret;
+
+	if (!four_streams)
+		return zstd_huf_decode_stream(table, src, len, dst, count);
+
+	/* a jump table gives the sizes of the first three streams */
+	if (len < 6)
+		return -EINVAL;
+	size[0] = get_unaligned_le16(src);
+	size[1] = get_unaligned_le16(src + 2);
+	size[2] = get_unaligned_le16(src + 4);
+	src += 6;
+	len -= 6;
+	if (size[0] + size[1] + size[2] > len)
+		return -EINVAL;
+	size[3] = len - size[0] - size[1] - size[2];
+
+	seg = DIV_ROUND_UP(count, 4);
+	if (seg * 3 > count)
+		return -EINVAL;
+	for (i = 0; i < 4; i++) {
+		ret = zstd_huf_decode_stream(table, src, size[i], dst,
+					     i < 3 ? seg : count - seg * 3);
+		if (ret)
+			return ret;
+		src += size[i];
+		dst += seg;
+	}
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * Zstandard decompression - definitions shared by the decoder's parts
+ *
+ * The format is described in RFC 8878.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ZSTD_INTERNAL_H
+#define __ZSTD_INTERNAL_H
+
+#include <asm/unaligned.h>
+#include <linux/bitops.h>
+#include <linux/types.h>
+
+/* Largest amount of data produced by one block */
+#define ZSTD_BLOCK_MAX		(128 * 1024)
+
+/* Limits on the Huffman codes used for literals */
+#define ZSTD_HUF_MAX_BITS	11
+#define ZSTD_HUF_MAX_SYMBOLS	256
+#define ZSTD_HUF_WEIGHT_LOG	6
+
+/* Limits on the FSE tables used for sequences and Huffman weights */
+#define ZSTD_FSE_MAX_LOG	9
+#define ZSTD_FSE_MAX_SYMBOLS	64
+
+/**
+ * struct zstd_bits - reader for a bitstream which is read backwards
+ *
+ * Entropy-coded data is written forwards and read from the end, starting
+ * with the highest bit of the last byte below the 1 bit which marks the end.
+ * Reads beyond the start of the stream return zeroes; this is needed by the
+ * format and lets corruption be detected once decoding is complete.
+ *
+ * @start:	First byte of the stream
+ * @ptr:	First byte of the 8-byte window held in @window
+ * @window:	Bits being read, the next bit being the highest unused one
+ * @used:	Number of bits of @window already consumed, from the top
+ */
+struct zstd_bits {
+	const u8 *start;
+	const u8 *ptr;
+	u64 window;
+	uint used;
+};
+
+static inline int zstd_bits_init(struct zstd_bits *b, const u8 *src,
+				 size_t len)
+{
+	u8 last;
+	int i;
+
+	if (!len)
+		return -EINVAL;
+	last = src[len - 1];
+	if (!last)
+		return -EINVAL;	/* end marker missing */
+
+	b->start = src;
+	if (len >= sizeof(u64)) {
+		b->ptr = src + len - sizeof(u64);
+		b->window = get_unaligned_le64(b->ptr);
+		b->used = 0;
+	} else {
+		/* treat the missing high bytes as already read */
+		b->ptr = src;
+		b->window = 0;
+		for (i = len - 1; i >= 0; i--)
+			b->window = b->window << 8 | src[i];
+		b->used = (sizeof(u64) - len) * 8;
+	}
+	/* skip the padding and the end marker */
+	b->used += 9 - fls(last);
+
+	return 0;
+}
+
+/* Move the window back so that at least 57 bits are available to read */
+static inline void zstd_bits_reload(struct zstd_bits *b)
+{
+	size_t bytes = b->used / 8;
+
+	if (bytes > b->ptr - b->start)
+		bytes = b->ptr - b->start;
+	if (!bytes)
+		return;
+	b->ptr -= bytes;
+	b->used -= bytes * 8;
+	b->window = get_unaligned_le64(b->ptr);
+}
+
+/* Return the next @n (1 to 57) bits without consuming them */
+static inline u64 zstd_bits_peek(struct zstd_bits *b, uint n)
+{
+	if (b->used >= 64)
+		return 0;
+
+	return (b->window << b->used) >> (64 - n);
+}
+
+static inline u64 zstd_bits_read(struct zstd_bits *b, uint n)
+{
+	u64 val;
+
+	if (!n)
+		return 0;
+	val = zstd_bits_peek(b, n);
+	b->used += n;
+
+	return val;
+}
+
+/* Check whether more bits have been read than the stream holds */
+static inline bool zstd_bits_overflow(struct zstd_bits *b)
+{
+	return b->ptr == b->start && b->used > 64;
+}
+
+/* Check whether the stream has been read exactly to its start */
+static inline bool zstd_bits_done(struct zstd_bits *b)
+{
+	return b->ptr == b->start && b->used == 64;
+}
+
+/**
+ * struct zstd_fse_entry - one state of an FSE decoding table
+ *
+ * @symbol:	Symbol decoded in this state
+ * @bits:	Number of bits to read to find the next state
+ * @base:	Value to add to those bits to give the next state
+ */
+struct zstd_fse_entry {
+	u8 symbol;
+	u8 bits;
+	u16 base;
+};
+
+struct zstd_fse_table {
+	uint log;
+	struct zstd_fse_entry entry[1 << ZSTD_FSE_MAX_LOG];
+};
+
+/**
+ * struct zstd_huf_entry - Huffman decoding table entry
+ *
+ * The table is indexed by the next max_bits bits of the stream
+ *
+ * @symbol:	Symbol whose code starts with these bits
+ * @bits:	Length of that code
+ */
+struct zstd_huf_entry {
+	u8 symbol;
+	u8 bits;
+};
+
+struct zstd_huf_table {
+	uint max_bits;
+	struct zstd_huf_entry entry[1 << ZSTD_HUF_MAX_BITS];
+};
+
+/**
+ * zstd_fse_build() - build an FSE decoding table from a distribution
+ *
+ * @table:	Table to build
+ * @norm:	Normalised count of each symbol, -1 meaning 'less than one'
+ * @count:	Number of symbols in @norm
+ * @log:	Log2 of the table size, which the counts add up to
+ * @return 0 if OK, -EINVAL if the distribution is invalid
+ */
+int zstd_fse_build(struct zstd_fse_table *table, const s16 *norm, uint count,
+		   uint log);
+
+/**
+ * zstd_fse_build_rle() - build an FSE table which only decodes one symbol
+ *
+ * @table:	Table to build
+ * @symbol:	Symbol to decode
+ */
+void zstd_fse_build_rle(struct zstd_fse_table *table, u8 symbol);
+
+/**
+ * zstd_fse_read_table() - read an FSE table description and build it
+ *
+ * @table:	Table to build
+ * @src:	Table description
+ * @len:	Number of bytes available at @src
+ * @max_symbol:	Largest symbol which the table may decode
+ * @max_log:	Largest table size allowed, as a log2
+ * @return number of bytes used, or -EINVAL if the description is invalid
+ */
+int zstd_fse_read_table(struct zstd_fse_table *table, const u8 *src,
+			size_t len, uint max_symbol, uint max_log);
+
+/**
+ * zstd_huf_read_table() - read a Huffman tree description and build it
+ *
+ * @table:	Table to build
+ * @src:	Tree description
+ * @len:	Number of bytes available at @src
+ * @return number of bytes used, or -EINVAL if the description is invalid
+ */
+int zstd_huf_read_table(struct zstd_huf_table *table, const u8 *src,
+			size_t len);
+
+/**
+ * zstd_huf_decode() - decode Huffman-coded literals
+ *
+ * @table:	Huffman table to use
+ * @src:	Compressed literals, excluding the tree description
+ * @len:	Number of bytes at @src
+ * @dst:	Output buffer
+ * @count:	Number of literals to decode
+ * @four_streams: true if the literals are split into four streams
+ * @return 0 if OK, -EINVAL if the data is corrupt
+ */
+int zstd_huf_decode(const struct zstd_huf_table *table, const u8 *src,
+		    size_t len, u8 *dst, size_t count, bool four_streams);
+
+#endif
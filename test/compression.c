@@ -12,6 +12,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -20,7 +21,11 @@
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
 
+#include <lz4.h>
 #include <linux/lzo.h>
+#include <linux/sizes.h>
+
+#include <zstd.h>
 
 static const char plain[] =
 	"I am a highly compressable bit of text.\n"
@@ -117,6 +122,62 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 /tmp/plain.txt -o /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
+/*
+ * The output of zstd_large_data(), piped through 'zstd -19' so that the
+ * frame has a window descriptor instead of a content size. It has two
+ * compressed blocks and a content checksum.
+ */
+static const char zstd_large_compressed[] =
+	"\x28\xb5\x2f\xfd\x04\x68\x1c\x0c\x00\x12\x8f\x2e\x1f\x10\x77\x73"
+	"\x3d\x3d\x6b\xc7\x76\x0f\xb9\x6b\x15\xb6\x07\x50\x01\x10\x2a\x02"
+	"\x40\xa1\xeb\x12\x3b\xc1\x0a\xb0\x2a\xf0\x06\x51\x9e\x0e\x67\xa3"
+	"\xc9\x60\x2e\x96\x0a\x65\x22\x89\x40\x1e\x8e\x06\x63\xa1\xa8\x12"
+	"\x88\x83\xa1\x40\x18\x08\x02\xcd\xda\xeb\xe6\x59\x75\xd2\xd6\xba"
+	"\x9d\x4f\x0f\xf2\xf5\x7a\xdf\xf6\xf1\xb6\xbd\x43\x2c\x42\xae\xb2"
+	"\xba\xc7\xdd\xaa\x29\x79\x78\x23\xf7\xdb\x8f\xe5\x6f\xe8\x20\xc6"
+	"\x9e\xdc\x7e\xdb\xc6\xec\xa7\xf1\x3c\xaf\xd1\x58\xd1\x78\x6e\xca"
+	"\x7d\x88\x99\xe6\xf9\xfa\xfd\x50\x92\x34\x55\xee\xde\xb2\x7c\x6d"
+	"\x85\xcd\x5d\xf4\x8c\x69\x9c\xef\x78\xa6\xf5\x1d\xe1\xfd\x35\x5d"
+	"\xb7\x78\x9e\x4b\x51\xbe\xa3\x6f\xbe\xb3\x65\x38\x9a\xef\xa2\x0a"
+	"\x74\x51\x7c\x9f\xd5\xdf\x78\x9d\xe5\xf5\xba\xd9\x6e\xb3\x62\xef"
+	"\x24\xd4\x22\xfc\x3b\x20\x6e\xa8\x71\xde\xa8\xa0\x20\xf5\x2a\x36"
+	"\x20\xb2\x92\xa6\x39\x02\x0b\x28\x86\x00\x41\x08\xfe\xff\x5f\x21"
+	"\xb0\x0c\xfd\x9f\xe6\x4a\xe4\x4f\xd3\x15\xc5\xa7\xe1\x8a\xee\xa7"
+	"\xe9\x4a\xf6\xa7\xed\x0a\xeb\xd3\x70\x65\xf3\xd3\xba\x62\xfa\x69"
+	"\x76\x25\xe7\xd3\xb8\x92\xfb\xd3\xbc\x32\xf9\x69\xb8\xa2\xf9\x34"
+	"\xb9\xd2\xfd\x69\x5f\xc1\xfe\x34\x5c\x59\x7c\x5a\xae\xd8\x7e\x9a"
+	"\xaf\xc4\xfd\x34\xae\x64\x7d\x9a\xae\x6c\x7e\x1a\x57\x64\x3f\x4d"
+	"\xae\xb4\x3e\x6d\x57\xb8\x3f\x8d\x2b\x93\x9f\x96\x2b\x96\x4f\xb3"
+	"\x2b\x79\x3f\xcd\x95\xd8\x9f\xa6\x2b\x8b\x4f\xc3\x15\xdd\x4f\xd3"
+	"\x95\xec\x4f\xdb\x15\xd6\xa7\xe1\xca\x1e\xfc\xf4\x1a\xa4\xae\xc0"
+	"\xf0\xdd\x74\x98\x7c\x99\x08\xc9\x81\x77\x1f\xb3\xd3\xae\x4a\x03"
+	"\xe4\x22\xf2\x63\x92\x7f\xb5\xf5\x54\xc1\x3e\x0a\x69\x42\x9b\xaf"
+	"\x6a\x23\x65\xff\x7c\x3a\x21\x97\x2d\x0a\x80\x02\xcd\x02\x00\x90"
+	"\x20\x20\x20\x21\x22\x23\x24\x25\x26\x27\x28\x29\x2a\x2b\x2c\x2d"
+	"\x2e\x2f\x2f\xac\x60\x3d\x06\x20\x7e\x9f\xe6\x4a\xf4\xd3\x7c\xa5"
+	"\xf9\x34\x5e\xe9\x3e\xad\x57\xee\x4f\xfb\x15\xea\xd3\xe2\xca\xf1"
+	"\x69\xb9\xb2\x7c\xda\xae\x64\x3e\x8d\x2b\xa9\x4f\xd3\x95\xe2\xd3"
+	"\x70\x65\xf3\x69\xb9\x52\x7d\xda\xae\x50\x9f\x86\x2b\xc5\xa7\xe5"
+	"\xca\x66\x3e\xbd\xc2\x12\x15\x29\x79\xf2\x4a\x14";
+static const unsigned long zstd_large_compressed_size = 492;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -282,6 +343,132 @@ static int uncompress_using_lz4(void *in, unsigned long in_size,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	assert(in_size == strlen(plain));
+	assert(memcmp(plain, in, in_size) == 0);
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	size_t output_size = out_max;
+	int ret;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
+#ifdef CONFIG_BOOTM_STREAM
+/* Feed the decompressor a few bytes at a time, as a slow loader would */
+static int uncompress_using_stream(int comp, void *in, unsigned long in_size,
+				   void *out, unsigned long out_max,
+				   unsigned long *out_size)
+{
+	struct bootm_stream bs;
+	unsigned long pos, len;
+	ulong size;
+	int ret;
+
+	ret = bootm_stream_init(&bs, comp, out, out_max);
+	if (ret)
+		return ret;
+	for (pos = 0, ret = 0; !ret && pos < in_size; pos += len) {
+		len = min(in_size - pos, 7UL);
+		ret = bootm_stream_feed(&bs, in + pos, len);
+	}
+	size = bootm_stream_end(&bs);
+	if (out_size)
+		*out_size = size;
+
+	return ret != 1;
+}
+
+static int uncompress_using_gzip_stream(void *in, unsigned long in_size,
+					void *out, unsigned long out_max,
+					unsigned long *out_size)
+{
+	return uncompress_using_stream(IH_COMP_GZIP, in, in_size, out,
+				       out_max, out_size);
+}
+
+static int uncompress_using_lz4_stream(void *in, unsigned long in_size,
+				       void *out, unsigned long out_max,
+				       unsigned long *out_size)
+{
+	return uncompress_using_stream(IH_COMP_LZ4, in, in_size, out,
+				       out_max, out_size);
+}
+#endif
+
+#ifdef CONFIG_BOOTM_CHUNKED
+/* Uncompressed size of each chunk, so that the test text has two */
+#define TEST_CHUNK_SIZE		192
+
+static int compress_using_gzip_chunked(void *in, unsigned long in_size,
+				       void *out, unsigned long out_max,
+				       unsigned long *out_size)
+{
+	struct image_chunk_header *hdr = out;
+	unsigned long pos, len, size;
+	uint count, i;
+	int ret;
+
+	count = DIV_ROUND_UP(in_size, TEST_CHUNK_SIZE);
+	pos = sizeof(*hdr) + count * sizeof(hdr->ch_len[0]);
+	if (pos > out_max)
+		return -ENOSPC;
+	hdr->ch_magic = cpu_to_be32(IH_CHUNK_MAGIC);
+	hdr->ch_count = cpu_to_be32(count);
+	hdr->ch_size = cpu_to_be32(TEST_CHUNK_SIZE);
+	for (i = 0; i < count; i++) {
+		len = min_t(ulong, in_size - i * TEST_CHUNK_SIZE,
+			    TEST_CHUNK_SIZE);
+		ret = compress_using_gzip(in + i * TEST_CHUNK_SIZE, len,
+					  out + pos, out_max - pos, &size);
+		if (ret)
+			return ret;
+		hdr->ch_len[i] = cpu_to_be32(size);
+		pos += size;
+	}
+	if (out_size)
+		*out_size = pos;
+
+	return 0;
+}
+
+static int uncompress_using_chunked(void *in, unsigned long in_size,
+				    void *out, unsigned long out_max,
+				    unsigned long *out_size)
+{
+	ulong size;
+	int ret;
+
+	ret = bootm_chunk_decomp(IH_COMP_GZIP, out, out_max, in, in_size,
+				 &size);
+	if (out_size)
+		*out_size = size;
+
+	return ret;
+}
+#endif
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -371,6 +558,356 @@ out:
 	return ret;
 }
 
+/* Number of times each decompressor is run when timing it */
+#define SPEED_TEST_RUNS		1000
+
+/**
+ * run_speed_test() - Compare the ratio and decompression speed of a method
+ *
+ * @name:	Name of the compression method
+ * @compress:	Our function to compress data
+ * @uncompress:	Our function to uncompress data
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_speed_test(char *name, mutate_func compress,
+			  mutate_func uncompress)
+{
+	ulong orig_size, compressed_size, uncompressed_size;
+	void *compressed_buf = NULL;
+	void *uncompressed_buf = NULL;
+	ulong start, duration;
+	int i, ret;
+
+	orig_size = strlen(plain);
+	compressed_size = TEST_BUFFER_SIZE;
+	compressed_buf = malloc(TEST_BUFFER_SIZE);
+	errcheck(compressed_buf != NULL);
+	uncompressed_buf = malloc(TEST_BUFFER_SIZE);
+	errcheck(uncompressed_buf != NULL);
+	errcheck(compress((void *)plain, orig_size, compressed_buf,
+			  compressed_size, &compressed_size) == 0);
+
+	start = timer_get_us();
+	for (i = 0; i < SPEED_TEST_RUNS; i++) {
+		errcheck(uncompress(compressed_buf, compressed_size,
+				    uncompressed_buf, TEST_BUFFER_SIZE,
+				    &uncompressed_size) == 0);
+	}
+	duration = timer_get_us() - start;
+	errcheck(uncompressed_size == orig_size);
+
+	printf(" %-6s %4lu bytes %3lu%% %6lu ns/decompress\n", name,
+	       compressed_size, compressed_size * 100 / orig_size,
+	       duration * 1000 / SPEED_TEST_RUNS);
+	ret = 0;
+
+out:
+	free(uncompressed_buf);
+	free(compressed_buf);
+
+	return ret;
+}
+
+/* Size of the data used to test inflate's fast path, and times to run it */
+#define GZIP_LARGE_SIZE		SZ_1M
+#define GZIP_LARGE_RUNS		10
+
+/**
+ * run_gzip_large_test() - Check and time gunzip on a larger buffer
+ *
+ * The plain text above is too short for inflate's fast decoding loop to
+ * run for long, so this builds a megabyte of text from pieces of it, with
+ * some changes so that there is a mix of literals and matches at all
+ * distances. It then checks that the data survives gzip and gunzip, with
+ * the output buffer just large enough and one byte too small, and prints
+ * the decompression speed.
+ *
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_gzip_large_test(void)
+{
+	ulong orig_size = GZIP_LARGE_SIZE;
+	ulong compressed_size, uncompressed_size;
+	char *orig_buf, *compressed_buf = NULL, *uncompressed_buf = NULL;
+	ulong plain_len = strlen(plain);
+	ulong start, duration, pos, len;
+	uint seed = 1;
+	int i, ret;
+
+	printf(" testing gzip large ...\n");
+	orig_buf = malloc(orig_size);
+	errcheck(orig_buf != NULL);
+	compressed_buf = malloc(orig_size);
+	errcheck(compressed_buf != NULL);
+	uncompressed_buf = malloc(orig_size + 1);
+	errcheck(uncompressed_buf != NULL);
+
+	for (pos = 0; pos < orig_size; pos += len) {
+		seed = seed * 1103515245 + 12345;
+		len = min_t(ulong, (seed >> 8) % 64 + 1, orig_size - pos);
+		if (seed & 0x80000000) {
+			memcpy(orig_buf + pos, plain + (seed >> 16) %
+			       (plain_len - len), len);
+		} else {
+			orig_buf[pos] = seed >> 16;
+			len = 1;
+		}
+	}
+
+	compressed_size = orig_size;
+	errcheck(compress_using_gzip(orig_buf, orig_size, compressed_buf,
+				     compressed_size, &compressed_size) == 0);
+	printf("\tcompressed_size:%lu\n", compressed_size);
+
+	/* Uncompresses with exactly the right size output buffer */
+	uncompressed_buf[orig_size] = 'A';
+	errcheck(uncompress_using_gzip(compressed_buf, compressed_size,
+				       uncompressed_buf, orig_size,
+				       &uncompressed_size) == 0);
+	errcheck(uncompressed_size == orig_size);
+	errcheck(memcmp(orig_buf, uncompressed_buf, orig_size) == 0);
+	errcheck(uncompressed_buf[orig_size] == 'A');
+
+	/* Make sure decompression does not over-run */
+	uncompressed_buf[orig_size - 1] = 'A';
+	errcheck(uncompress_using_gzip(compressed_buf, compressed_size,
+				       uncompressed_buf, orig_size - 1,
+				       NULL) != 0);
+	errcheck(uncompressed_buf[orig_size - 1] == 'A');
+
+	start = timer_get_us();
+	for (i = 0; i < GZIP_LARGE_RUNS; i++) {
+		errcheck(uncompress_using_gzip(compressed_buf, compressed_size,
+					       uncompressed_buf, orig_size,
+					       NULL) == 0);
+	}
+	duration = max(timer_get_us() - start, 1UL);
+	printf("\t%lu MB/s\n", orig_size * GZIP_LARGE_RUNS / duration);
+	ret = 0;
+
+out:
+	printf(" gzip large: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	free(uncompressed_buf);
+	free(compressed_buf);
+	free(orig_buf);
+
+	return ret;
+}
+
+/* Uncompressed block size and number of raw blocks in the LZ4 range test */
+#define LZ4_RANGE_BLOCK		SZ_64K
+#define LZ4_RANGE_RAW_BLOCKS	2
+
+/**
+ * run_lz4_range_test() - Check decompressing parts of an LZ4 frame
+ *
+ * There is no LZ4 compressor here, so this builds a frame from raw
+ * (uncompressed) 64KB blocks followed by the compressed block of
+ * lz4_compressed. It then reads ranges from the start, across block
+ * boundaries and off the end, and checks that a frame whose blocks are not
+ * full is rejected.
+ *
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_lz4_range_test(void)
+{
+	static const ulong ranges[][2] = {
+		{ 0, 16 },
+		{ LZ4_RANGE_BLOCK - 8, 16 },
+		{ LZ4_RANGE_BLOCK, LZ4_RANGE_BLOCK },
+		{ 100, 2 * LZ4_RANGE_BLOCK },
+		{ 2 * LZ4_RANGE_BLOCK + 5, 40 },
+		{ 2 * LZ4_RANGE_BLOCK + 5, 41 },
+		{ 0, 3 * LZ4_RANGE_BLOCK },
+		{ 3 * LZ4_RANGE_BLOCK, 10 },
+	};
+	/* Frame header, then header and data of the compressed block */
+	const ulong frame_hdr_len = 7;
+	const ulong lz4_block_len = lz4_compressed_size - frame_hdr_len - 8;
+	ulong plain_len = strlen(plain);
+	ulong orig_size = LZ4_RANGE_RAW_BLOCKS * LZ4_RANGE_BLOCK + plain_len;
+	char *orig_buf, *frame = NULL, *out = NULL;
+	struct ulz4_index idx = { };
+	ulong frame_size, pos, expect;
+	size_t len;
+	uint seed = 1;
+	int i, ret;
+
+	printf(" testing lz4 range ...\n");
+	orig_buf = malloc(orig_size);
+	errcheck(orig_buf != NULL);
+	frame = malloc(LZ4_RANGE_RAW_BLOCKS * (LZ4_RANGE_BLOCK + 4) +
+		       lz4_compressed_size);
+	errcheck(frame != NULL);
+	out = malloc(3 * LZ4_RANGE_BLOCK + 1);
+	errcheck(out != NULL);
+
+	for (pos = 0; pos < LZ4_RANGE_RAW_BLOCKS * LZ4_RANGE_BLOCK; pos++) {
+		seed = seed * 1103515245 + 12345;
+		orig_buf[pos] = seed >> 16;
+	}
+	memcpy(orig_buf + pos, plain, plain_len);
+
+	/* Version 1, independent blocks, 64KB maximum block size */
+	memcpy(frame, "\x04\x22\x4d\x18\x60\x40\x00", frame_hdr_len);
+	frame_size = frame_hdr_len;
+	for (i = 0; i < LZ4_RANGE_RAW_BLOCKS; i++) {
+		put_unaligned_le32(LZ4_RANGE_BLOCK | 0x80000000,
+				   frame + frame_size);
+		memcpy(frame + frame_size + 4, orig_buf + i * LZ4_RANGE_BLOCK,
+		       LZ4_RANGE_BLOCK);
+		frame_size += 4 + LZ4_RANGE_BLOCK;
+	}
+	memcpy(frame + frame_size, lz4_compressed + frame_hdr_len,
+	       lz4_block_len);
+	frame_size += lz4_block_len;
+	put_unaligned_le32(0, frame + frame_size);
+	frame_size += 4;
+
+	len = orig_size;
+	errcheck(ulz4fn(frame, frame_size, out, &len) == 0);
+	errcheck(len == orig_size);
+	errcheck(memcmp(orig_buf, out, orig_size) == 0);
+
+	errcheck(ulz4_index_init(&idx, frame, frame_size) == 0);
+	errcheck(idx.count == LZ4_RANGE_RAW_BLOCKS + 1);
+	for (i = 0; i < ARRAY_SIZE(ranges); i++) {
+		pos = ranges[i][0];
+		expect = pos < orig_size ? min(ranges[i][1], orig_size - pos) :
+			 0;
+		len = ranges[i][1];
+		out[expect] = 'A';
+		errcheck(ulz4_index_read(&idx, pos, out, &len) == 0);
+		errcheck(len == expect);
+		errcheck(memcmp(orig_buf + pos, out, expect) == 0);
+		/* Beyond the data, the decompressor may use the whole buffer */
+		if (expect == ranges[i][1])
+			errcheck(out[expect] == 'A');
+	}
+	ulz4_index_free(&idx);
+
+	len = 16;
+	errcheck(ulz4fn_range(frame, frame_size, LZ4_RANGE_BLOCK, out,
+			      &len) == 0);
+	errcheck(len == 16);
+	errcheck(memcmp(orig_buf + LZ4_RANGE_BLOCK, out, len) == 0);
+
+	/* Shorten the first block so that the second one is misplaced */
+	memmove(frame + frame_hdr_len + 4 + LZ4_RANGE_BLOCK - 1,
+		frame + frame_hdr_len + 4 + LZ4_RANGE_BLOCK,
+		frame_size - frame_hdr_len - 4 - LZ4_RANGE_BLOCK);
+	frame_size--;
+	put_unaligned_le32((LZ4_RANGE_BLOCK - 1) | 0x80000000,
+			   frame + frame_hdr_len);
+	len = 16;
+	errcheck(ulz4fn_range(frame, frame_size, 0, out, &len) != 0);
+	ret = 0;
+
+out:
+	printf(" lz4 range: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	ulz4_index_free(&idx);
+	free(out);
+	free(frame);
+	free(orig_buf);
+
+	return ret;
+}
+
+/* Size of the data in zstd_large_compressed, more than one 128KB block */
+#define ZSTD_LARGE_SIZE		(192 * 1024)
+
+/* Magic number of a skippable frame; the low four bits may be anything */
+#define ZSTD_SKIPPABLE_MAGIC	0x184d2a50
+
+/* Build the data compressed in zstd_large_compressed */
+static void zstd_large_data(char *buf)
+{
+	ulong plain_len = strlen(plain);
+	ulong pos;
+
+	for (pos = 0; pos < ZSTD_LARGE_SIZE; pos++)
+		buf[pos] = plain[pos % plain_len];
+	for (pos = 0; pos < ZSTD_LARGE_SIZE; pos += 4096)
+		put_unaligned_le32(pos / 4096 * 0x01010101, buf + pos);
+}
+
+/**
+ * run_zstd_frames_test() - Check zstd input with several frames
+ *
+ * This decompresses a large frame, then a skippable frame, then the small
+ * frame of zstd_compressed, all in one input, with the output buffer just
+ * large enough and one byte too small. It then checks that a corrupt
+ * content checksum is rejected.
+ *
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_zstd_frames_test(void)
+{
+	ulong plain_len = strlen(plain);
+	ulong out_size = ZSTD_LARGE_SIZE + plain_len;
+	char *orig_buf, *in = NULL, *out = NULL;
+	ulong in_size;
+	size_t len;
+	int ret;
+
+	printf(" testing zstd frames ...\n");
+	orig_buf = malloc(out_size);
+	errcheck(orig_buf != NULL);
+	in = malloc(zstd_large_compressed_size + 16 + zstd_compressed_size);
+	errcheck(in != NULL);
+	out = malloc(out_size + 1);
+	errcheck(out != NULL);
+
+	zstd_large_data(orig_buf);
+	memcpy(orig_buf + ZSTD_LARGE_SIZE, plain, plain_len);
+
+	in_size = 0;
+	memcpy(in, zstd_large_compressed, zstd_large_compressed_size);
+	in_size += zstd_large_compressed_size;
+	put_unaligned_le32(ZSTD_SKIPPABLE_MAGIC | 5, in + in_size);
+	put_unaligned_le32(8, in + in_size + 4);
+	memset(in + in_size + 8, 0xff, 8);
+	in_size += 16;
+	memcpy(in + in_size, zstd_compressed, zstd_compressed_size);
+	in_size += zstd_compressed_size;
+
+	/* The large frame on its own */
+	len = out_size;
+	errcheck(zstd_decompress(in, zstd_large_compressed_size, out,
+				 &len) == 0);
+	errcheck(len == ZSTD_LARGE_SIZE);
+	errcheck(memcmp(orig_buf, out, len) == 0);
+
+	/* All the frames, with exactly the right size output buffer */
+	len = out_size;
+	out[out_size] = 'A';
+	errcheck(zstd_decompress(in, in_size, out, &len) == 0);
+	errcheck(len == out_size);
+	errcheck(memcmp(orig_buf, out, len) == 0);
+	errcheck(out[out_size] == 'A');
+
+	/* One byte too small */
+	len = out_size - 1;
+	errcheck(zstd_decompress(in, in_size, out, &len) == -ENOBUFS);
+
+	/* The checksum is the last four bytes of the large frame */
+	in[zstd_large_compressed_size - 1] ^= 1;
+	len = out_size;
+	errcheck(zstd_decompress(in, in_size, out, &len) == -EINVAL);
+	ret = 0;
+
+out:
+	printf(" zstd frames: %s\n", ret == 0 ? "ok" : "FAILED");
+
+	free(out);
+	free(in);
+	free(orig_buf);
+
+	return ret;
+}
+
 static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 			     char *const argv[])
 {
@@ -381,6 +918,29 @@ static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 	err += run_test("lzma", compress_using_lzma, uncompress_using_lzma);
 	err += run_test("lzo", compress_using_lzo, uncompress_using_lzo);
 	err += run_test("lz4", compress_using_lz4, uncompress_using_lz4);
+	err += run_test("zstd", compress_using_zstd, uncompress_using_zstd);
+#ifdef CONFIG_BOOTM_STREAM
+	err += run_test("gzip stream", compress_using_gzip,
+			uncompress_using_gzip_stream);
+	err += run_test("lz4 stream", compress_using_lz4,
+			uncompress_using_lz4_stream);
+#endif
+#ifdef CONFIG_BOOTM_CHUNKED
+	err += run_test("gzip chunked", compress_using_gzip_chunked,
+			uncompress_using_chunked);
+#endif
+
+	printf(" method  size ratio speed\n");
+	err += run_speed_test("gzip", compress_using_gzip,
+			      uncompress_using_gzip);
+	err += run_speed_test("lzma", compress_using_lzma,
+			      uncompress_using_lzma);
+	err += run_speed_test("lz4", compress_using_lz4, uncompress_using_lz4);
+	err += run_speed_test("zstd", compress_using_zstd,
+			      uncompress_using_zstd);
+	err += run_gzip_large_test();
+	err += run_lz4_range_test();
+	err += run_zstd_frames_test();
 
 	printf("ut_compression %s\n", err == 0 ? "ok" : "FAILED");
 
@@ -458,6 +1018,7 @@ static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 	err |= run_bootm_test(IH_COMP_LZMA, compress_using_lzma);
 	err |= run_bootm_test(IH_COMP_LZO, compress_using_lzo);
 	err |= run_bootm_test(IH_COMP_LZ4, compress_using_lz4);
+	err |= run_bootm_test(IH_COMP_ZSTD, compress_using_zstd);
 	err |= run_bootm_test(IH_COMP_NONE, compress_using_none);
 
 	printf("ut_image_decomp %s\n", err == 0 ? "ok" : "FAILED");
@@ -467,7 +1028,7 @@ static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 
 U_BOOT_CMD(
 	ut_compression,	5,	1,	do_ut_compression,
-	"Basic test of compressors: gzip bzip2 lzma lzo", ""
+	"Basic test of compressors: gzip bzip2 lzma lzo lz4 zstd", ""
 );
 
 U_BOOT_CMD(
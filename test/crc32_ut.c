@@ -0,0 +1,138 @@
+/*
+ * Tests for the CRC32 functions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <malloc.h>
+#include <u-boot/crc.h>
+
+/* Size of the buffer used to measure throughput */
+#define CRC32_BENCH_SIZE	(1 << 20)
+
+/* Simple bit-at-a-time CRC32, for checking the results against */
+static uint32_t crc32_bitwise(uint32_t crc, const unsigned char *p, uint len)
+{
+	int i;
+
+	crc = ~crc;
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (crc & 1 ? 0xedb88320 : 0);
+	}
+
+	return ~crc;
+}
+
+static int test_crc32_vectors(void)
+{
+	static const unsigned char check[] = "123456789";
+	uint32_t crc;
+
+	crc = crc32(0, check, 9);
+	if (crc != 0xcbf43926) {
+		printf("%s: crc32 of \"%s\" is %08x, expected cbf43926\n",
+		       __func__, check, crc);
+		return -EINVAL;
+	}
+	crc = crc32_no_comp(~0U, check, 9);
+	if (crc != ~0xcbf43926) {
+		printf("%s: crc32_no_comp of \"%s\" is %08x, expected %08x\n",
+		       __func__, check, crc, ~0xcbf43926);
+		return -EINVAL;
+	}
+	if (crc32(0, NULL, 0) != 0) {
+		printf("%s: crc32 of nothing is not 0\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Check every alignment and the lengths around the word and block sizes */
+static int test_crc32_alignment(void)
+{
+	unsigned char buf[128 + 8];
+	uint32_t crc, expect;
+	uint align, len, split;
+
+	for (len = 0; len < sizeof(buf); len++)
+		buf[len] = len * 37 + 11;
+
+	for (align = 0; align < 8; align++) {
+		for (len = 0; len <= 128; len++) {
+			expect = crc32_bitwise(0x12345678, buf + align, len);
+			crc = crc32(0x12345678, buf + align, len);
+			if (crc != expect) {
+				printf("%s: align %u, len %u: got %08x, expected %08x\n",
+				       __func__, align, len, crc, expect);
+				return -EINVAL;
+			}
+
+			/* the CRC can be computed piecewise */
+			split = len / 3;
+			crc = crc32(0x12345678, buf + align, split);
+			crc = crc32(crc, buf + align + split, len - split);
+			if (crc != expect) {
+				printf("%s: align %u, len %u split at %u: got %08x, expected %08x\n",
+				       __func__, align, len, split, crc, expect);
+				return -EINVAL;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* Print the throughput of crc32() and of the bitwise version for comparison */
+static int test_crc32_speed(void)
+{
+	ulong start, fast_us, slow_us;
+	uint32_t fast, slow;
+	unsigned char *buf;
+	int i;
+
+	buf = malloc(CRC32_BENCH_SIZE);
+	if (!buf)
+		return -ENOMEM;
+	for (i = 0; i < CRC32_BENCH_SIZE; i++)
+		buf[i] = i ^ (i >> 8);
+
+	start = timer_get_us();
+	for (i = 0; i < 16; i++)
+		fast = crc32(0, buf, CRC32_BENCH_SIZE);
+	fast_us = timer_get_us() - start;
+
+	start = timer_get_us();
+	slow = crc32_bitwise(0, buf, CRC32_BENCH_SIZE);
+	slow_us = timer_get_us() - start;
+	free(buf);
+
+	fast_us = max(fast_us / 16, 1UL);
+	slow_us = max(slow_us, 1UL);
+	printf("%s: crc32 %lu MB/s, bitwise %lu MB/s\n", __func__,
+	       CRC32_BENCH_SIZE / fast_us, CRC32_BENCH_SIZE / slow_us);
+	if (fast != slow) {
+		printf("%s: got %08x, expected %08x\n", __func__, fast, slow);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+int do_ut_crc32(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	ret |= test_crc32_vectors();
+	ret |= test_crc32_alignment();
+	ret |= test_crc32_speed();
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
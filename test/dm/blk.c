@@ -6,8 +6,11 @@
 
 #include <common.h>
 #include <dm.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -94,3 +97,235 @@ static int dm_test_blk_usb(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_usb, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_BLOCK_CACHE
+/* Test that the block cache merges, serves and evicts ranges */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats, orig;
+	char buf[4 * 512], out[4 * 512];
+	int i;
+
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i / 512 + 1;
+
+	/* Four blocks per entry, at most four entries */
+	blkcache_stats(&orig);
+	blkcache_configure(4, 4, 4 * 4 * 512);
+
+	/* Two adjacent single-block fills are merged into one entry */
+	blkcache_fill(IF_TYPE_HOST, 0, 8, 1, 512, buf);
+	blkcache_fill(IF_TYPE_HOST, 0, 9, 1, 512, buf + 512);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.entries);
+	ut_asserteq(2 * 512, stats.bytes);
+
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 0, 8, 2, 512, out));
+	ut_assertok(memcmp(buf, out, 2 * 512));
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 8, 3, 512, out));
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 1, 8, 1, 512, out));
+
+	/* A range crossing a line boundary is split but still served */
+	blkcache_fill(IF_TYPE_HOST, 0, 14, 4, 512, buf);
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 0, 14, 4, 512, out));
+	ut_assertok(memcmp(buf, out, 4 * 512));
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_asserteq(2, stats.misses);
+	ut_asserteq(3, stats.entries);
+
+	/* Filling two more entries evicts the least-recently used one */
+	blkcache_fill(IF_TYPE_HOST, 0, 32, 1, 512, buf);
+	blkcache_fill(IF_TYPE_HOST, 0, 40, 1, 512, buf);
+	blkcache_stats(&stats);
+	ut_asserteq(4, stats.entries);
+	ut_asserteq(1, stats.evictions);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 8, 1, 512, out));
+
+	/* Big reads are not cached */
+	blkcache_fill(IF_TYPE_HOST, 0, 64, 5, 512, buf);
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 0, 64, 1, 512, out));
+
+	blkcache_invalidate(IF_TYPE_HOST, 0);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, stats.bytes);
+
+	blkcache_configure(orig.max_blocks_per_entry, orig.max_entries,
+			   orig.max_bytes);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+
+/* Test that a device's cache entries go when the device does */
+static int dm_test_blk_cache_unbind(struct unit_test_state *uts)
+{
+	struct block_cache_stats stats;
+	char buf[512], out[512];
+	struct udevice *blk;
+
+	memset(buf, 0x5a, sizeof(buf));
+	ut_assertok(blk_create_device(gd->dm_root, "sandbox_host_blk", "test",
+				      IF_TYPE_HOST, 1, 512, 1024, &blk));
+	ut_assertok(device_probe(blk));
+	blkcache_fill(IF_TYPE_HOST, 1, 0, 1, 512, buf);
+	ut_asserteq(1, blkcache_read(IF_TYPE_HOST, 1, 0, 1, 512, out));
+
+	ut_assertok(device_remove(blk));
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 1, 0, 1, 512, out));
+
+	blkcache_fill(IF_TYPE_HOST, 1, 0, 1, 512, buf);
+	ut_assertok(device_unbind(blk));
+	ut_asserteq(0, blkcache_read(IF_TYPE_HOST, 1, 0, 1, 512, out));
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache_unbind, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_BLOCK_READAHEAD
+/* Test that sequential reads are satisfied by read-ahead */
+static int dm_test_blk_readahead(struct unit_test_state *uts)
+{
+	struct blk_readahead_stats stats, start;
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	char buf[512];
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	ut_assert(dev_desc->lba >= 4);
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	blk_readahead_invalidate(dev_desc->bdev);
+	ut_assertok(blk_readahead_get_stats(dev_desc->bdev, &start));
+
+	/*
+	 * The first read goes to the device, the second is seen as
+	 * sequential and fills the window, which satisfies the third.
+	 */
+	for (i = 1; i <= 3; i++)
+		ut_asserteq(1, blk_dread(dev_desc, i, 1, buf));
+	ut_assertok(blk_readahead_get_stats(dev_desc->bdev, &stats));
+	ut_asserteq(3, stats.reads - start.reads);
+	ut_asserteq(2, stats.cmds - start.cmds);
+	ut_asserteq(1, stats.hits - start.hits);
+
+	/* A random read resets the window */
+	ut_asserteq(1, blk_dread(dev_desc, 0, 1, buf));
+	ut_assertok(blk_readahead_get_stats(dev_desc->bdev, &stats));
+	ut_asserteq(0, stats.window);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_readahead, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
+#ifdef CONFIG_BLK_ASYNC
+static void blk_async_test_callback(struct blk_request *req)
+{
+	int *count = req->priv;
+
+	(*count)++;
+}
+
+/* Test asynchronous requests on the sandbox host driver */
+static int blk_async_test_host(struct unit_test_state *uts, char *fname,
+			       int *completed)
+{
+	struct blk_request wr, rd[2];
+	char data[1024], buf[1024];
+	struct udevice *dev;
+	int i;
+
+	/* The sandbox host driver queues requests and completes them in poll */
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+	memset(buf, '\0', sizeof(buf));
+	ut_assertok(host_dev_bind(0, fname));
+	ut_assertok(blk_get_device(IF_TYPE_HOST, 0, &dev));
+
+	memset(&wr, '\0', sizeof(wr));
+	wr.dev = dev;
+	wr.op = BLK_REQ_WRITE;
+	wr.blkcnt = 2;
+	wr.buffer = data;
+	wr.callback = blk_async_test_callback;
+	wr.priv = completed;
+	ut_assertok(blk_submit(&wr));
+	ut_assert(!wr.complete);
+	ut_asserteq(2, blk_wait(&wr));
+	ut_asserteq(1, *completed);
+
+	for (i = 0; i < 2; i++) {
+		memset(&rd[i], '\0', sizeof(rd[i]));
+		rd[i].dev = dev;
+		rd[i].op = BLK_REQ_READ;
+		rd[i].start = i;
+		rd[i].blkcnt = 1;
+		rd[i].buffer = buf + i * 512;
+		rd[i].callback = blk_async_test_callback;
+		rd[i].priv = completed;
+		ut_assertok(blk_submit(&rd[i]));
+	}
+	ut_asserteq(1, blk_poll(dev));
+	ut_assert(rd[0].complete);
+	ut_assert(!rd[1].complete);
+	ut_asserteq(0, blk_poll(dev));
+	ut_asserteq(1, rd[1].result);
+	ut_asserteq(3, *completed);
+	ut_assertok(memcmp(data, buf, sizeof(buf)));
+
+	return 0;
+}
+
+/* Test asynchronous requests on native and fallback drivers */
+static int dm_test_blk_async(struct unit_test_state *uts)
+{
+	char fname[] = "/tmp/u-boot.blk_async.XXXXXX";
+	char zero[1024], data[512], buf[512];
+	struct blk_request rd;
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	int completed = 0;
+	int fd, ret;
+
+	/* Use a temporary backing file, removed even if the test fails */
+	memset(zero, '\0', sizeof(zero));
+	fd = os_mkstemp(fname);
+	ut_assert(fd >= 0);
+	ret = os_write(fd, zero, sizeof(zero));
+	os_close(fd);
+	if (ret == sizeof(zero))
+		ret = blk_async_test_host(uts, fname, &completed);
+	else
+		ret = -EIO;
+	host_dev_bind(0, NULL);
+	os_unlink(fname);
+	ut_assertok(ret);
+
+	/* MMC has no native support, so uses the fallback */
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	ut_asserteq(1, blk_dread(dev_desc, 0, 1, data));
+	memset(&rd, '\0', sizeof(rd));
+	rd.dev = dev_desc->bdev;
+	rd.op = BLK_REQ_READ;
+	rd.blkcnt = 1;
+	rd.buffer = buf;
+	rd.callback = blk_async_test_callback;
+	rd.priv = &completed;
+	ut_assertok(blk_submit(&rd));
+	ut_assert(!rd.complete);
+	ut_asserteq(0, blk_poll(NULL));
+	ut_asserteq(1, rd.result);
+	ut_asserteq(4, completed);
+	ut_assertok(memcmp(data, buf, 512));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
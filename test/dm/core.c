@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <slab.h>
 #include <dm/device-internal.h>
 #include <dm/root.h>
 #include <dm/util.h>
@@ -69,6 +70,10 @@ static struct driver_info driver_info_pre_reloc = {
 
 void dm_leak_check_start(struct unit_test_state *uts)
 {
+	struct slab_stats slab;
+
+	slab_get_stats(&slab);
+	uts->start_slab = slab.inuse;
 	uts->start = mallinfo();
 	if (!uts->start.uordblks)
 		puts("Warning: Please add '#define DEBUG' to the top of common/dlmalloc.c\n");
@@ -76,6 +81,7 @@ void dm_leak_check_start(struct unit_test_state *uts)
 
 int dm_leak_check_end(struct unit_test_state *uts)
 {
+	struct slab_stats slab;
 	struct mallinfo end;
 	int id, diff;
 
@@ -97,6 +103,12 @@ int dm_leak_check_end(struct unit_test_state *uts)
 		printf("Leak: gained %#xd bytes\n", -diff);
 	ut_asserteq(uts->start.uordblks, end.uordblks);
 
+	slab_get_stats(&slab);
+	diff = slab.inuse - uts->start_slab;
+	if (diff)
+		printf("Leak: %d slab bytes\n", diff);
+	ut_asserteq(uts->start_slab, slab.inuse);
+
 	return 0;
 }
 
@@ -499,6 +511,58 @@ static int dm_test_leak(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_leak, 0);
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+/* Test that small objects come from the slab size classes and are reused */
+static int dm_test_slab(struct unit_test_state *uts)
+{
+	struct slab_stats before, after;
+	const int size = 100, cls = 3;	/* 65..128 bytes */
+	void *obj[20], *big;
+	int i;
+
+	slab_get_stats(&before);
+	for (i = 0; i < ARRAY_SIZE(obj); i++) {
+		obj[i] = slab_zalloc(size);
+		ut_assertnonnull(obj[i]);
+		ut_asserteq(0, *(u8 *)obj[i]);
+		ut_asserteq(0, ((u8 *)obj[i])[size - 1]);
+		memset(obj[i], 0xff, size);
+	}
+	big = slab_zalloc(SLAB_MAX_SIZE + 1);
+	ut_assertnonnull(big);
+	slab_get_stats(&after);
+
+	/* Objects which did not fit in the arena are counted as fallbacks */
+	ut_asserteq(before.cls[cls].used + before.fallbacks +
+		    ARRAY_SIZE(obj) + 1,
+		    after.cls[cls].used + after.fallbacks);
+	ut_assert(after.cls[cls].peak >= after.cls[cls].used);
+	ut_assert(after.pages_peak >= after.pages_used);
+	if (after.arena_size) {
+		ut_asserteq(SLAB_MIN_SIZE << cls, after.cls[cls].size);
+		ut_assert(after.inuse >= before.inuse);
+	}
+
+	/* Freeing everything must give back any pages taken */
+	slab_free(big);
+	for (i = ARRAY_SIZE(obj) - 1; i >= 0; i--)
+		slab_free(obj[i]);
+	slab_get_stats(&after);
+	ut_asserteq(before.cls[cls].used, after.cls[cls].used);
+	ut_asserteq(before.pages_used, after.pages_used);
+	ut_asserteq(before.inuse, after.inuse);
+
+	/* A reused object must be zeroed again */
+	obj[0] = slab_zalloc(size);
+	ut_assertnonnull(obj[0]);
+	ut_asserteq(0, ((u8 *)obj[0])[size - 1]);
+	slab_free(obj[0]);
+
+	return 0;
+}
+DM_TEST(dm_test_slab, 0);
+#endif
+
 /* Test uclass init/destroy methods */
 static int dm_test_uclass(struct unit_test_state *uts)
 {
@@ -517,6 +581,101 @@ static int dm_test_uclass(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_uclass, 0);
 
+#if CONFIG_IS_ENABLED(DM_UCLASS_INDEX)
+#define INDEX_TEST_COUNT	40
+
+/* Test that devices are found through the uclass indexes */
+static int dm_test_uclass_index(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *dev[INDEX_TEST_COUNT], *found;
+	const void *blob = gd->fdt_blob;
+	int offset[INDEX_TEST_COUNT];
+	struct uclass_index_stats stats;
+	uint lookups, phandles;
+	struct uclass *uc;
+	char name[20];
+	int i;
+
+	for (i = 0; i < INDEX_TEST_COUNT; i++) {
+		ut_assertok(device_bind_by_name(dms->root, false,
+						&driver_info_manual, &dev[i]));
+	}
+
+	/* Of devices with the same name, the first is found */
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "test_manual_drv",
+					       &found));
+	ut_asserteq_ptr(dev[0], found);
+
+	/* Changing the name or node must update the indexes */
+	for (i = 0, phandles = 0; i < INDEX_TEST_COUNT; i++) {
+		snprintf(name, sizeof(name), "index%d", i);
+		ut_assertok(device_set_name(dev[i], name));
+		offset[i] = fdt_next_node(blob, i ? offset[i - 1] : 0, NULL);
+		ut_assert(offset[i] > 0);
+		dev_set_of_offset(dev[i], offset[i]);
+		if (fdt_get_phandle(blob, offset[i]))
+			phandles++;
+	}
+	ut_assertok(uclass_get(UCLASS_TEST, &uc));
+	ut_assertok(uclass_get_index_stats(uc, &stats));
+	ut_asserteq(INDEX_TEST_COUNT, stats.count[UCLASS_INDEX_NAME]);
+	ut_asserteq(INDEX_TEST_COUNT, stats.count[UCLASS_INDEX_OF_OFFSET]);
+	ut_asserteq(phandles, stats.count[UCLASS_INDEX_PHANDLE]);
+	ut_assert(stats.buckets[UCLASS_INDEX_NAME] >= INDEX_TEST_COUNT);
+	lookups = stats.lookups;
+
+	for (i = 0; i < INDEX_TEST_COUNT; i++) {
+		snprintf(name, sizeof(name), "index%d", i);
+		ut_assertok(uclass_find_device_by_name(UCLASS_TEST, name,
+						       &found));
+		ut_asserteq_ptr(dev[i], found);
+		ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST,
+							    offset[i], &found));
+		ut_asserteq_ptr(dev[i], found);
+		ut_assertok(device_probe(dev[i]));
+		ut_assertok(uclass_find_device_by_seq(UCLASS_TEST, dev[i]->seq,
+						      false, &found));
+		ut_asserteq_ptr(dev[i], found);
+	}
+	ut_asserteq(-ENODEV,
+		    uclass_find_device_by_of_offset(UCLASS_TEST, 0, &found));
+	ut_assertok(uclass_get_index_stats(uc, &stats));
+	ut_assert(stats.lookups >= lookups + INDEX_TEST_COUNT * 3 + 1);
+
+	/* The start of a name is still enough to find a device */
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "index", &found));
+	ut_asserteq_ptr(dev[0], found);
+
+	/* but a device with exactly the name comes first */
+	ut_assertok(device_set_name(dev[0], "index2x"));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "index2", &found));
+	ut_asserteq_ptr(dev[2], found);
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST, "index2x",
+					       &found));
+	ut_asserteq_ptr(dev[0], found);
+
+	/* Removed and unbound devices must not be found */
+	i = dev[3]->seq;
+	ut_assertok(device_remove(dev[3]));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST, i, false,
+						       &found));
+	ut_assertok(device_probe(dev[3]));
+	ut_asserteq(i, dev[3]->seq);
+	ut_assertok(device_remove(dev[5]));
+	ut_assertok(device_unbind(dev[5]));
+	ut_asserteq(-ENODEV, uclass_find_device_by_name(UCLASS_TEST, "index5",
+							&found));
+	ut_asserteq(-ENODEV, uclass_find_device_by_of_offset(UCLASS_TEST,
+							     offset[5], &found));
+	ut_assertok(uclass_get_index_stats(uc, &stats));
+	ut_asserteq(INDEX_TEST_COUNT - 1, stats.count[UCLASS_INDEX_NAME]);
+
+	return 0;
+}
+DM_TEST(dm_test_uclass_index, 0);
+#endif
+
 /**
  * create_children() - Create children of a parent node
  *
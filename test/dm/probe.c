@@ -0,0 +1,229 @@
+/*
+ * Tests for probing devices concurrently
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <fdtdec.h>
+#include <asm/test.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <dm/uclass-internal.h>
+#include <dm/util.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * struct probe_test_priv - progress of a test device's probe
+ *
+ * @polls:	Number of calls to probe_poll() left before it is ready
+ * @started:	Value of probe_test_ticks when probe() was called
+ * @finished:	Value of probe_test_ticks when probe_poll() finished
+ */
+struct probe_test_priv {
+	int polls;
+	int started;
+	int finished;
+};
+
+static int probe_test_ticks;
+static int probe_test_pending;
+static int probe_test_max_pending;
+static const char *probe_test_fail;
+static const char *probe_test_hang;
+static int probe_test_removed;
+
+static int probe_test_probe(struct udevice *dev)
+{
+	struct probe_test_priv *priv = dev_get_priv(dev);
+
+	priv->polls = fdtdec_get_int(gd->fdt_blob, dev_of_offset(dev),
+				     "sandbox,polls", 0);
+	priv->started = ++probe_test_ticks;
+	if (++probe_test_pending > probe_test_max_pending)
+		probe_test_max_pending = probe_test_pending;
+
+	return 0;
+}
+
+static int probe_test_probe_poll(struct udevice *dev)
+{
+	struct probe_test_priv *priv = dev_get_priv(dev);
+
+	probe_test_ticks++;
+	if (probe_test_hang && !strcmp(dev->name, probe_test_hang)) {
+		sandbox_timer_add_offset(CONFIG_DM_PROBE_TIMEOUT / 4);
+		return -EAGAIN;
+	}
+	if (priv->polls) {
+		priv->polls--;
+		return -EAGAIN;
+	}
+	priv->finished = probe_test_ticks;
+	probe_test_pending--;
+	if (probe_test_fail && !strcmp(dev->name, probe_test_fail))
+		return -EIO;
+
+	return 0;
+}
+
+static int probe_test_remove(struct udevice *dev)
+{
+	struct probe_test_priv *priv = dev_get_priv(dev);
+
+	if (!priv->finished)
+		probe_test_pending--;
+	probe_test_removed++;
+
+	return 0;
+}
+
+static const struct udevice_id probe_test_ids[] = {
+	{ .compatible = "sandbox,probe-test" },
+	{ }
+};
+
+U_BOOT_DRIVER(probe_test_drv) = {
+	.name	= "probe_test_drv",
+	.of_match	= probe_test_ids,
+	.id	= UCLASS_TEST_PROBE,
+	.bind	= dm_scan_fdt_dev,
+	.probe	= probe_test_probe,
+	.probe_poll	= probe_test_probe_poll,
+	.remove	= probe_test_remove,
+	.priv_auto_alloc_size	= sizeof(struct probe_test_priv),
+};
+
+UCLASS_DRIVER(probe_test) = {
+	.name		= "probe_test",
+	.id		= UCLASS_TEST_PROBE,
+};
+
+static void probe_test_reset(void)
+{
+	probe_test_ticks = 0;
+	probe_test_pending = 0;
+	probe_test_max_pending = 0;
+	probe_test_fail = NULL;
+	probe_test_hang = NULL;
+	probe_test_removed = 0;
+}
+
+static struct probe_test_priv *probe_test_find(const char *name)
+{
+	struct udevice *dev;
+
+	if (uclass_find_device_by_name(UCLASS_TEST_PROBE, name, &dev))
+		return NULL;
+
+	return dev_get_priv(dev);
+}
+
+/* Test that independent devices are probed together, in dependency order */
+static int dm_test_probe_async(struct unit_test_state *uts)
+{
+	struct probe_test_priv *a, *b, *c, *d;
+	struct udevice *dev;
+	struct uclass *uc;
+
+	probe_test_reset();
+	ut_assertok(dm_probe_uclasses("probe_test"));
+	ut_assertok(uclass_get(UCLASS_TEST_PROBE, &uc));
+	ut_asserteq(4, list_count_items(&uc->dev_head));
+	uclass_foreach_dev(dev, uc) {
+		ut_assert(device_active(dev));
+		ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	}
+	ut_asserteq(0, probe_test_pending);
+
+	a = probe_test_find("probe-test-a");
+	b = probe_test_find("probe-test-b");
+	c = probe_test_find("probe-test-c");
+	d = probe_test_find("probe-test-d");
+	ut_assert(a && b && c && d);
+
+	/* b uses a clock from a, and d is a child of c */
+	ut_assert(b->started > a->finished);
+	ut_assert(d->started > c->finished);
+
+	/* a and c do not depend on each other, so their probes overlap */
+	ut_assert(c->started < a->finished);
+	ut_asserteq(2, probe_test_max_pending);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that a failed probe does not stop the others */
+static int dm_test_probe_async_fail(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+
+	probe_test_reset();
+	probe_test_fail = "probe-test-a";
+	ut_asserteq(-EIO, dm_probe_uclasses("probe_test"));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-a", &dev));
+	ut_assert(!device_active(dev));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-d", &dev));
+	ut_assert(device_active(dev));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-b", &dev));
+	ut_assert(device_active(dev));
+
+	/* device_probe() waits for probe_poll() itself */
+	probe_test_fail = NULL;
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-a", &dev));
+	ut_assertok(device_probe(dev));
+	ut_assert(device_active(dev));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(0, probe_test_pending);
+
+	/* Unknown uclasses are skipped */
+	ut_assertok(dm_probe_uclasses(" nonexistent probe_test "));
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_fail, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that a device which never becomes ready is given up on */
+static int dm_test_probe_async_timeout(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+
+	probe_test_reset();
+	probe_test_hang = "probe-test-c";
+	ut_asserteq(-ETIMEDOUT, dm_probe_uclasses("probe_test"));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-c", &dev));
+	ut_assert(!device_active(dev));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-b", &dev));
+	ut_assert(device_active(dev));
+
+	/* Probing its child tries it again, and gives up again */
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-d", &dev));
+	ut_assert(!device_active(dev));
+	ut_asserteq(2, probe_test_removed);
+
+	/* device_probe() gives up too */
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_PROBE,
+					       "probe-test-c", &dev));
+	ut_asserteq(-ETIMEDOUT, device_probe(dev));
+	ut_assert(!device_active(dev));
+	ut_assert(!(dev->flags & DM_FLAG_PROBE_PENDING));
+	ut_asserteq(3, probe_test_removed);
+	ut_asserteq(0, probe_test_pending);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async_timeout, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
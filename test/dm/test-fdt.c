@@ -9,11 +9,18 @@
 #include <errno.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <asm/io.h>
+#include <dm/bind_table.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
+#include <dm/lists.h>
+#include <dm/of_access.h>
+#include <dm/ofnode.h>
 #include <dm/root.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
+#include <u-boot/crc.h>
 #include <test/ut.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -183,6 +190,367 @@ static int dm_test_fdt_pre_reloc(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_fdt_pre_reloc, 0);
 
+/* Find the first driver with a compatible string by searching them all */
+static struct driver *compat_scan(const char *compat,
+				  const struct udevice_id **idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id;
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			if (!strcmp(id->compatible, compat)) {
+				*idp = id;
+				return entry;
+			}
+		}
+	}
+	*idp = NULL;
+
+	return NULL;
+}
+
+/* Test that each compatible string finds the first driver which has it */
+static int dm_test_fdt_compat_lookup(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *id, *found, *expect;
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (id = entry->of_match; id && id->compatible; id++) {
+			ut_asserteq_ptr(compat_scan(id->compatible, &expect),
+					lists_driver_lookup_compat(
+						id->compatible, &found));
+			ut_asserteq_ptr(expect, found);
+		}
+	}
+	ut_asserteq_ptr(NULL, lists_driver_lookup_compat("denx,u-boot-fdt-none",
+							 &found));
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_compat_lookup, 0);
+
+/* Check that a node handle gives the same results as the flat tree */
+static int ofnode_check(struct unit_test_state *uts, const void *blob,
+			int offset)
+{
+	ofnode node = offset_to_ofnode(offset);
+	ofnode parent;
+	const char *name;
+	const void *val;
+	int prop, len, size;
+
+	ut_assert(ofnode_valid(node));
+	ut_asserteq(offset, ofnode_to_offset(node));
+	ut_asserteq_str(fdt_get_name(blob, offset, NULL),
+			ofnode_get_name(node));
+	parent = ofnode_get_parent(node);
+	if (offset) {
+		ut_asserteq(fdt_parent_offset(blob, offset),
+			    ofnode_to_offset(parent));
+		ut_asserteq(max(fdt_next_subnode(blob, offset), -1),
+			    ofnode_to_offset(ofnode_next_subnode(node)));
+	} else {
+		ut_assert(!ofnode_valid(parent));
+	}
+	ut_asserteq(max(fdt_first_subnode(blob, offset), -1),
+		    ofnode_to_offset(ofnode_first_subnode(node)));
+
+	/* Property values are not copied */
+	fdt_for_each_property_offset(prop, blob, offset) {
+		val = fdt_getprop_by_offset(blob, prop, &name, &len);
+		ut_asserteq_ptr(val, ofnode_read_prop(node, name, &size));
+		ut_asserteq(len, size);
+		ut_asserteq_ptr(val, fdtdec_getprop(blob, offset, name, NULL));
+	}
+
+	return 0;
+}
+
+/* Test reading the device tree through node handles */
+static int dm_test_fdt_ofnode(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+#ifdef CONFIG_OF_LIVE
+	struct device_node *root;
+#endif
+	ofnode node, subnode;
+	int offset, depth, count;
+	u32 val;
+
+#ifdef CONFIG_OF_LIVE
+	root = gd->of_root;
+	ut_assert(of_live_active());
+
+	/* Devices point to the nodes, so the tree is only built once */
+	ut_asserteq(-EBUSY, of_live_init());
+	ut_asserteq_ptr(root, gd->of_root);
+#endif
+
+	for (offset = 0, depth = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth))
+		ut_assertok(ofnode_check(uts, blob, offset));
+
+	node = offset_to_ofnode(fdt_path_offset(blob, "/b-test"));
+	ut_assertok(ofnode_read_u32(node, "ping-expect", &val));
+	ut_asserteq(3, val);
+	ut_asserteq(-EINVAL, ofnode_read_u32(node, "no-such-prop", &val));
+	ut_asserteq(3, ofnode_read_u32_default(node, "ping-add", 0));
+	ut_asserteq(7, ofnode_read_u32_default(node, "no-such-prop", 7));
+	ut_asserteq_str("denx,u-boot-fdt-test",
+			ofnode_read_string(node, "compatible"));
+	ut_assert(!ofnode_read_bool(node, "u-boot,dm-pre-reloc"));
+	ut_assert(ofnode_is_available(node));
+
+	/* A name without a unit address matches the first such node */
+	node = offset_to_ofnode(fdt_path_offset(blob, "/some-bus"));
+	subnode = ofnode_find_subnode(node, "c-test");
+	ut_asserteq(fdt_subnode_offset(blob, ofnode_to_offset(node), "c-test"),
+		    ofnode_to_offset(subnode));
+	ut_asserteq_str("c-test@5", ofnode_get_name(subnode));
+	subnode = ofnode_find_subnode(node, "c-test@0");
+	ut_asserteq_str("c-test@0", ofnode_get_name(subnode));
+	ut_assert(!ofnode_valid(ofnode_find_subnode(node, "c-test@9")));
+	ut_assert(!ofnode_valid(ofnode_find_subnode(node, "c-tes")));
+
+	/* Each subnode is found once */
+	count = 0;
+	ofnode_for_each_subnode(subnode, node) {
+		ut_assert(ofnode_equal(node, ofnode_get_parent(subnode)));
+		count++;
+	}
+	ut_asserteq(fdtdec_get_child_count(blob, ofnode_to_offset(node)),
+		    count);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_ofnode, 0);
+
+#ifdef CONFIG_OF_LIVE
+/* Test replacing the control FDT while the live tree is in use */
+static int dm_test_fdt_live_replace(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	struct device_node *root = gd->of_root;
+	int size = fdt_totalsize(blob);
+	ofnode node, old_node;
+	char cmd[40];
+	void *copy;
+
+	copy = malloc(size);
+	ut_assertnonnull(copy);
+	memcpy(copy, blob, size);
+	ut_assertok(fdt_setprop_inplace_u32(copy,
+					    fdt_path_offset(copy, "/b-test"),
+					    "ping-expect", 5));
+	old_node = offset_to_ofnode(fdt_path_offset(blob, "/b-test"));
+
+	snprintf(cmd, sizeof(cmd), "fdt addr -c %lx",
+		 (ulong)map_to_sysmem(copy));
+	ut_assertok(run_command(cmd, 0));
+	ut_asserteq_ptr(copy, gd->fdt_blob);
+	ut_assert(gd->of_root != root);
+	node = offset_to_ofnode(fdt_path_offset(copy, "/b-test"));
+	ut_asserteq(5, ofnode_read_u32_default(node, "ping-expect", 0));
+
+	/* Devices may still hold nodes from the old tree */
+	ut_asserteq(3, ofnode_read_u32_default(old_node, "ping-expect", 0));
+
+	/* The FDT in use cannot be changed in place */
+	snprintf(cmd, sizeof(cmd), "fdt addr %lx 0x10000",
+		 (ulong)map_to_sysmem(copy));
+	ut_asserteq(1, run_command(cmd, 0));
+
+	ut_assertok(of_live_replace(blob));
+	ut_asserteq_ptr(blob, gd->fdt_blob);
+	free(copy);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_live_replace, 0);
+#endif
+
+#ifdef CONFIG_OF_BIND_TABLE
+#define BIND_TEST_MAX_DEPTH	16
+#define BIND_TEST_MAX_DEVS	200
+#define BIND_TEST_MAX_ALIASES	100
+
+/**
+ * struct bind_test_dev - what binding gave one device
+ *
+ * @drv:		Driver bound
+ * @offset:		Device tree offset of the device
+ * @parent_offset:	Device tree offset of its parent device
+ * @req_seq:		Sequence number requested, from the aliases
+ */
+struct bind_test_dev {
+	const struct driver *drv;
+	int offset;
+	int parent_offset;
+	int req_seq;
+};
+
+/* Build a bind table from the device tree, as dtoc does */
+static int bind_test_make_table(struct unit_test_state *uts, const void *blob,
+				struct dm_bind_table *table)
+{
+	struct dm_bind_node *nodes;
+	struct dm_bind_alias *aliases;
+	int last[BIND_TEST_MAX_DEPTH + 1];
+	int offset, depth, count, alias_count, aliases_offset;
+
+	for (offset = 0, depth = 0, count = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth))
+		count++;
+	aliases_offset = fdt_path_offset(blob, "/aliases");
+	nodes = calloc(count, sizeof(*nodes));
+	aliases = calloc(BIND_TEST_MAX_ALIASES, sizeof(*aliases));
+	ut_assert(nodes && aliases);
+
+	count = 0;
+	alias_count = 0;
+	for (offset = 0, depth = 0; offset >= 0 && depth >= 0;
+	     offset = fdt_next_node(blob, offset, &depth)) {
+		struct dm_bind_node *node = &nodes[count];
+		const char *find_name;
+		int prop, len;
+
+		ut_assert(depth < BIND_TEST_MAX_DEPTH);
+		node->offset = offset;
+		node->child = -1;
+		node->sibling = -1;
+		if (fdtdec_get_is_enabled(blob, offset))
+			node->flags |= DM_BIND_ENABLED;
+		if (fdt_getprop(blob, offset, "u-boot,dm-pre-reloc", NULL))
+			node->flags |= DM_BIND_PRE_RELOC;
+		node->compat = fdt_getprop(blob, offset, "compatible", &len);
+		node->compat_len = node->compat ? len : 0;
+		if (depth && last[depth] != -1)
+			nodes[last[depth]].sibling = count;
+		else if (depth)
+			nodes[last[depth - 1]].child = count;
+		last[depth] = count++;
+		last[depth + 1] = -1;
+
+		find_name = fdt_get_name(blob, offset, &len);
+		fdt_for_each_property_offset(prop, blob, aliases_offset) {
+			const char *path, *name;
+			int plen, seq;
+
+			path = fdt_getprop_by_offset(blob, prop, &name, &plen);
+			if (plen < len || *path != '/' || path[plen - 1] ||
+			    strcmp(strrchr(path, '/') + 1, find_name))
+				continue;
+			seq = trailing_strtol(name);
+			if (seq == -1)
+				continue;
+			ut_assert(alias_count < BIND_TEST_MAX_ALIASES);
+			aliases[alias_count].offset = offset;
+			aliases[alias_count].name = name;
+			aliases[alias_count++].seq = seq;
+		}
+	}
+	table->fdt_size = fdt_totalsize(blob);
+	table->fdt_crc32 = crc32(0, blob, table->fdt_size);
+	table->node_count = count;
+	table->nodes = nodes;
+	table->alias_count = alias_count;
+	table->aliases = aliases;
+
+	return 0;
+}
+
+/* Record the devices below @parent, returning the new count */
+static int bind_test_record(struct udevice *parent, struct bind_test_dev *devs,
+			    int count)
+{
+	struct udevice *dev;
+
+	list_for_each_entry(dev, &parent->child_head, sibling_node) {
+		if (count == BIND_TEST_MAX_DEVS)
+			return -ENOSPC;
+		devs[count].drv = dev->driver;
+		devs[count].offset = dev_of_offset(dev);
+		devs[count].parent_offset = dev_of_offset(parent);
+		devs[count].req_seq = dev->req_seq;
+		count = bind_test_record(dev, devs, count + 1);
+		if (count < 0)
+			return count;
+	}
+
+	return count;
+}
+
+/* Bind devices from the device tree, record them and then unbind them */
+static int bind_test_scan(struct unit_test_state *uts, bool pre_reloc_only,
+			  struct bind_test_dev *devs, int *countp)
+{
+	struct udevice *dev, *next;
+
+	ut_assertok(dm_scan_fdt(gd->fdt_blob, pre_reloc_only));
+	*countp = bind_test_record(dm_root(), devs, 0);
+	ut_assert(*countp > 0);
+	list_for_each_entry_safe(dev, next, &dm_root()->child_head,
+				 sibling_node) {
+		ut_assertok(device_remove(dev));
+		ut_assertok(device_unbind(dev));
+	}
+
+	return 0;
+}
+
+/* Test that binding from a bind table gives the same devices */
+static int dm_test_fdt_bind_table(struct unit_test_state *uts)
+{
+	struct bind_test_dev *expect, *found;
+	const void *blob = gd->fdt_blob;
+	struct dm_bind_table table;
+	int pre_reloc_only, count, found_count, i;
+
+	expect = calloc(BIND_TEST_MAX_DEVS * 2, sizeof(*expect));
+	ut_assert(expect);
+	found = expect + BIND_TEST_MAX_DEVS;
+	ut_assertok(bind_test_make_table(uts, blob, &table));
+
+	for (pre_reloc_only = 0; pre_reloc_only < 2; pre_reloc_only++) {
+		ut_asserteq(-ENOENT, dm_bind_table_init(NULL));
+		ut_assertok(bind_test_scan(uts, pre_reloc_only, expect,
+					   &count));
+
+		ut_assertok(dm_bind_table_init(&table));
+		ut_asserteq_ptr(&table.nodes[0], dm_bind_table_find(blob, 0));
+		ut_assertok(bind_test_scan(uts, pre_reloc_only, found,
+					   &found_count));
+		ut_asserteq(count, found_count);
+		for (i = 0; i < count; i++) {
+			ut_asserteq_ptr(expect[i].drv, found[i].drv);
+			ut_asserteq(expect[i].offset, found[i].offset);
+			ut_asserteq(expect[i].parent_offset,
+				    found[i].parent_offset);
+			ut_asserteq(expect[i].req_seq, found[i].req_seq);
+		}
+	}
+
+	/* A table for a different device tree is not used */
+	table.fdt_crc32 ^= 1;
+	ut_asserteq(-EINVAL, dm_bind_table_init(&table));
+	ut_assert(!dm_bind_table_find(blob, 0));
+
+	ut_asserteq(-ENOENT, dm_bind_table_init(NULL));
+	free((void *)table.nodes);
+	free((void *)table.aliases);
+	free(expect);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_bind_table, 0);
+#endif
+
 /* Test that sequence numbers are allocated properly */
 static int dm_test_fdt_uclass_seq(struct unit_test_state *uts)
 {
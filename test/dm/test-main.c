@@ -109,7 +109,8 @@ static int dm_test_main(const char *test_name)
 		run_count++;
 		ut_assertok(dm_test_init(uts));
 
-		uts->start = mallinfo();
+		/* Tests may call dm_leak_check_end() without starting */
+		dm_leak_check_start(uts);
 		if (test->flags & DM_TESTF_SCAN_PDATA)
 			ut_assertok(dm_scan_platdata(false));
 		if (test->flags & DM_TESTF_PROBE_TEST)
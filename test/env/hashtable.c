@@ -0,0 +1,149 @@
+/*
+ * Tests for the environment hash table
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+#define HTAB_TEST_COUNT	300
+
+static void htab_test_entry(int i, char *key, char *data)
+{
+	sprintf(key, "var%d", i);
+	sprintf(data, "value%d", i * 7);
+}
+
+static int htab_test_find(struct unit_test_state *uts,
+			  struct hsearch_data *htab, int i, bool present)
+{
+	char key[20], data[20];
+	ENTRY e, *ep;
+
+	htab_test_entry(i, key, data);
+	e.key = key;
+	e.data = NULL;
+	if (!present) {
+		ut_asserteq(0, hsearch_r(e, FIND, &ep, htab, 0));
+		return 0;
+	}
+	ut_assert(hsearch_r(e, FIND, &ep, htab, 0) > 0);
+	ut_asserteq_str(key, ep->key);
+	ut_asserteq_str(data, ep->data);
+
+	return 0;
+}
+
+/* Compare the keys of two exported "key=value" lines, as the table does */
+static int htab_test_keycmp(const char *a, const char *b)
+{
+	for (; *a && *a == *b && *a != '='; a++, b++)
+		;
+
+	return (*a == '=' ? 0 : *a) - (*b == '=' ? 0 : *b);
+}
+
+/* Test that the table grows as entries are added and deleted */
+static int env_test_htab_grow(struct unit_test_state *uts)
+{
+	struct hsearch_data htab = { .table = NULL };
+	struct mallinfo start = mallinfo();
+	struct hsearch_stats stats;
+	char key[20], data[20];
+	ENTRY e, *ep;
+	int count, idx, i;
+
+	ut_asserteq(1, hcreate_r(4, &htab));
+	for (i = 0; i < HTAB_TEST_COUNT; i++) {
+		htab_test_entry(i, key, data);
+		e.key = key;
+		e.data = data;
+		ut_asserteq(1, hsearch_r(e, ENTER, &ep, &htab, 0));
+
+		/* Earlier entries must be found while the table is moved */
+		ut_assertok(htab_test_find(uts, &htab, i / 2, true));
+	}
+	hstats_r(&htab, &stats);
+	ut_asserteq(HTAB_TEST_COUNT, stats.filled);
+	ut_assert(stats.grows > 0);
+	ut_assert(stats.filled <= stats.size - stats.size / 4);
+
+	/* Delete every other entry */
+	for (i = 0; i < HTAB_TEST_COUNT; i += 2) {
+		htab_test_entry(i, key, data);
+		ut_asserteq(1, hdelete_r(key, &htab, 0));
+	}
+	for (i = 0; i < HTAB_TEST_COUNT; i++)
+		ut_assertok(htab_test_find(uts, &htab, i, i & 1));
+
+	/* hmatch_r() must see each entry once */
+	for (count = 0, idx = 0; (idx = hmatch_r("var", idx, &ep, &htab));)
+		count++;
+	ut_asserteq(HTAB_TEST_COUNT / 2, count);
+
+	hdestroy_r(&htab);
+	ut_asserteq(start.uordblks, mallinfo().uordblks);
+
+	return 0;
+}
+ENV_TEST(env_test_htab_grow, 0);
+
+/* Test that export is sorted, and that import sizes the table to suit */
+static int env_test_htab_export(struct unit_test_state *uts)
+{
+	struct hsearch_data htab = { .table = NULL };
+	struct hsearch_stats stats;
+	char *buf = NULL, *prev, *p;
+	char key[20], data[20];
+	ENTRY *ep;
+	ssize_t len;
+	int i;
+
+	ut_asserteq(1, hcreate_r(4, &htab));
+	for (i = HTAB_TEST_COUNT - 1; i >= 0; i--) {
+		ENTRY e;
+
+		htab_test_entry(i, key, data);
+		e.key = key;
+		e.data = data;
+		ut_asserteq(1, hsearch_r(e, ENTER, &ep, &htab, 0));
+	}
+
+	len = hexport_r(&htab, '\0', 0, &buf, 0, 0, NULL);
+	ut_assert(len > 0);
+	for (prev = NULL, p = buf, i = 0; *p; p += strlen(p) + 1, i++) {
+		if (prev)
+			ut_assert(htab_test_keycmp(prev, p) < 0);
+		prev = p;
+	}
+	ut_asserteq(HTAB_TEST_COUNT, i);
+
+	/* hnext_r() must step through the same keys in the same order */
+	for (ep = hnext_r(&htab, NULL), p = buf; ep;
+	     ep = hnext_r(&htab, ep->key)) {
+		ut_asserteq(0, strncmp(p, ep->key, strlen(ep->key)));
+		ut_asserteq('=', p[strlen(ep->key)]);
+		p += strlen(p) + 1;
+	}
+	ut_asserteq(0, *p);
+	ut_asserteq_str("var0", hnext_r(&htab, "var")->key);
+	ut_asserteq_ptr(NULL, hnext_r(&htab, "var99"));
+	hdestroy_r(&htab);
+
+	/* The imported table should not need to grow */
+	ut_asserteq(1, himport_r(&htab, buf, len, '\0', 0, 0, 0, NULL));
+	free(buf);
+	hstats_r(&htab, &stats);
+	ut_asserteq(HTAB_TEST_COUNT, stats.filled);
+	ut_asserteq(0, stats.grows);
+	for (i = 0; i < HTAB_TEST_COUNT; i++)
+		ut_assertok(htab_test_find(uts, &htab, i, true));
+	hdestroy_r(&htab);
+
+	return 0;
+}
+ENV_TEST(env_test_htab_export, 0);
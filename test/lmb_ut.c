@@ -0,0 +1,168 @@
+/*
+ * Tests for logical memory blocks
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <errno.h>
+#include <lmb.h>
+
+#define RAM_BASE	0x40000000
+#define RAM_SIZE	0x10000000
+
+/* Check the number and total size of the reserved regions */
+static int lmb_check(struct lmb *lmb, const char *func, ulong cnt,
+		     phys_size_t size)
+{
+	if (lmb->reserved.cnt != cnt || lmb->reserved.size != size) {
+		printf("%s: %lu reserved regions of 0x%llx bytes, expected %lu of 0x%llx\n",
+		       func, lmb->reserved.cnt,
+		       (unsigned long long)lmb->reserved.size, cnt,
+		       (unsigned long long)size);
+		lmb_dump_all(lmb);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void lmb_setup(struct lmb *lmb)
+{
+	lmb_init(lmb);
+	lmb_add(lmb, RAM_BASE, RAM_SIZE);
+}
+
+/* Freeing a reservation inside another must leave the outer one in place */
+static int test_lmb_overlap(void)
+{
+	phys_addr_t outer = RAM_BASE + 0x1000000;
+	phys_addr_t inner = outer + 0x80000;
+	struct lmb lmb;
+	int ret = 0;
+
+	lmb_setup(&lmb);
+	ret |= lmb_reserve(&lmb, outer, 0x100000);
+	ret |= lmb_reserve(&lmb, inner, 0x10000);
+	ret |= lmb_check(&lmb, __func__, 3, 0x100000);
+	ret |= lmb_free(&lmb, inner, 0x10000);
+	ret |= lmb_check(&lmb, __func__, 1, 0x100000);
+	if (!lmb_is_reserved(&lmb, inner)) {
+		printf("%s: outer reservation was freed\n", __func__);
+		ret = -EINVAL;
+	}
+
+	/* The outer one can then be freed as usual */
+	ret |= lmb_free(&lmb, outer, 0x100000);
+	ret |= lmb_check(&lmb, __func__, 0, 0);
+	lmb_uninit(&lmb);
+
+	return ret ? -EINVAL : 0;
+}
+
+/* The same range reserved twice stays reserved until freed twice */
+static int test_lmb_count(void)
+{
+	phys_addr_t base = RAM_BASE + 0x2000000;
+	struct lmb lmb;
+	int ret = 0;
+
+	lmb_setup(&lmb);
+	ret |= lmb_reserve(&lmb, base, 0x20000);
+	ret |= lmb_reserve(&lmb, base, 0x20000);
+	ret |= lmb_check(&lmb, __func__, 1, 0x20000);
+	ret |= lmb_free(&lmb, base, 0x20000);
+	ret |= lmb_check(&lmb, __func__, 1, 0x20000);
+	ret |= lmb_free(&lmb, base, 0x20000);
+	ret |= lmb_check(&lmb, __func__, 0, 0);
+
+	/* Overlapping at one end, then freeing the first */
+	ret |= lmb_reserve(&lmb, base, 0x20000);
+	ret |= lmb_reserve(&lmb, base + 0x10000, 0x20000);
+	ret |= lmb_check(&lmb, __func__, 3, 0x30000);
+	ret |= lmb_free(&lmb, base, 0x20000);
+	ret |= lmb_check(&lmb, __func__, 1, 0x20000);
+	if (lmb_is_reserved(&lmb, base) ||
+	    !lmb_is_reserved(&lmb, base + 0x10000)) {
+		printf("%s: wrong part freed\n", __func__);
+		ret = -EINVAL;
+	}
+	lmb_uninit(&lmb);
+
+	return ret ? -EINVAL : 0;
+}
+
+/* Check splitting, merging and freeing what is not reserved */
+static int test_lmb_split(void)
+{
+	phys_addr_t base = RAM_BASE + 0x3000000;
+	phys_size_t largest;
+	struct lmb lmb;
+	int ret = 0;
+
+	lmb_setup(&lmb);
+	ret |= lmb_reserve(&lmb, base, 0x10000);
+	ret |= lmb_reserve(&lmb, base + 0x10000, 0x10000);
+	ret |= lmb_check(&lmb, __func__, 1, 0x20000);
+	ret |= lmb_free(&lmb, base + 0x8000, 0x10000);
+	ret |= lmb_check(&lmb, __func__, 2, 0x10000);
+
+	/* Nothing changes if any of the range is not reserved */
+	if (lmb_free(&lmb, base, 0x10000) != -1 ||
+	    lmb_free(&lmb, base - 0x1000, 0x2000) != -1) {
+		printf("%s: freed memory which was not reserved\n", __func__);
+		ret = -EINVAL;
+	}
+	ret |= lmb_check(&lmb, __func__, 2, 0x10000);
+
+	ret |= lmb_reserve(&lmb, base + 0x8000, 0x10000);
+	ret |= lmb_check(&lmb, __func__, 1, 0x20000);
+	if (lmb_get_free(&lmb, &largest) != RAM_SIZE - 0x20000 ||
+	    largest != RAM_BASE + RAM_SIZE - (base + 0x20000)) {
+		printf("%s: wrong free size\n", __func__);
+		ret = -EINVAL;
+	}
+	lmb_uninit(&lmb);
+
+	return ret ? -EINVAL : 0;
+}
+
+/* Allocations avoid reservations and can be freed */
+static int test_lmb_alloc(void)
+{
+	phys_addr_t top = RAM_BASE + RAM_SIZE - 0x100000;
+	phys_addr_t addr;
+	struct lmb lmb;
+	int ret = 0;
+
+	lmb_setup(&lmb);
+	ret |= lmb_reserve(&lmb, top, 0x100000);
+	addr = lmb_alloc(&lmb, 0x4000, 0x1000);
+	if (addr != top - 0x4000) {
+		printf("%s: allocated at %llx, expected %llx\n", __func__,
+		       (unsigned long long)addr,
+		       (unsigned long long)(top - 0x4000));
+		ret = -EINVAL;
+	}
+	ret |= lmb_check(&lmb, __func__, 1, 0x104000);
+	ret |= lmb_free(&lmb, addr, 0x4000);
+	ret |= lmb_check(&lmb, __func__, 1, 0x100000);
+	lmb_uninit(&lmb);
+
+	return ret ? -EINVAL : 0;
+}
+
+int do_ut_lmb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	int ret = 0;
+
+	ret |= test_lmb_overlap();
+	ret |= test_lmb_count();
+	ret |= test_lmb_split();
+	ret |= test_lmb_alloc();
+
+	printf("Test %s\n", ret ? "failed" : "passed");
+
+	return ret ? CMD_RET_FAILURE : CMD_RET_SUCCESS;
+}
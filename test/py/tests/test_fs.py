@@ -0,0 +1,532 @@
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Test the state which the FAT and ext4 drivers keep between commands. Each
+# test loads files from images bound to sandbox host devices, checks that
+# repeated loads give the same data, and then changes the image under the
+# filesystem (by writing through it, writing raw blocks, or switching to
+# another device or partition) and checks that the new contents are seen.
+
+import os
+import os.path
+import pytest
+import re
+import shutil
+import struct
+import zlib
+import u_boot_utils as util
+
+def crc32(data):
+    """Return the CRC32 of some data, formatted as the crc32 command does."""
+
+    return '%08x' % (zlib.crc32(data) & 0xffffffff)
+
+def make_data(size, seed):
+    """Return some data which differs for each seed.
+
+    Unlike random data, this is the same every time the test runs.
+    """
+
+    data = bytearray()
+    val = seed
+    while len(data) < size:
+        val = (val * 1103515245 + 12345) & 0x7fffffff
+        data += struct.pack('<I', val)
+    return bytes(data[:size])
+
+def data_path(u_boot_console, fn):
+    """Return the path of a file in the persistent data directory."""
+
+    return os.path.join(u_boot_console.config.persistent_data_dir, fn)
+
+def write_file(fn, data):
+    with open(fn, 'wb') as fh:
+        fh.write(data)
+
+def mkfs_fat(u_boot_console, fn, files, size_kb=2048, args=''):
+    """Create a FAT image holding some files.
+
+    The volume ID is fixed, so images created with the same size have the
+    same boot sector whatever files they hold.
+
+    Args:
+        u_boot_console: A console connection to U-Boot.
+        fn: Filename of the image to create.
+        files: List of (name, data) tuples to put in the root directory, in
+            order.
+        size_kb: Size of the image in KiB.
+        args: Extra arguments for mkfs.vfat.
+    """
+
+    if os.path.exists(fn):
+        os.remove(fn)
+    util.run_and_log(u_boot_console,
+                     'mkfs.vfat -C -i 12345678 -n TESTFS %s %s %d' %
+                     (args, fn, size_kb))
+    for name, data in files:
+        src = fn + '.' + name
+        write_file(src, data)
+        util.run_and_log(u_boot_console, 'mcopy -i %s %s ::%s' %
+                         (fn, src, name))
+        os.remove(src)
+
+def mkfs_ext4(u_boot_console, fn, files, size_kb=8192, args='',
+              index=False):
+    """Create an ext4 image holding some files.
+
+    Blocks of zeroes in the files become holes. The UUID, hash seed and
+    timestamps are fixed, so images holding files of the same sizes have the
+    same superblock.
+
+    Args:
+        u_boot_console: A console connection to U-Boot.
+        fn: Filename of the image to create.
+        files: List of (name, data) tuples to put in the image. The name
+            may include directories, which are created as needed.
+        size_kb: Size of the image in KiB.
+        args: Extra arguments for mkfs.ext4.
+        index: True to give large directories a hash tree index.
+    """
+
+    src = fn + '.d'
+    if os.path.exists(src):
+        shutil.rmtree(src)
+    for name, data in files:
+        path = os.path.join(src, name)
+        if not os.path.isdir(os.path.dirname(path)):
+            os.makedirs(os.path.dirname(path))
+        write_file(path, data)
+    old_time = os.environ.get('E2FSPROGS_FAKE_TIME')
+    os.environ['E2FSPROGS_FAKE_TIME'] = '1500000000'
+    try:
+        util.run_and_log(u_boot_console,
+                         'mkfs.ext4 -q -F -O ^metadata_csum,^64bit '
+                         '-U 01234567-89ab-cdef-0123-456789abcdef '
+                         '-E hash_seed=89abcdef-0123-4567-89ab-cdef01234567 '
+                         '-d %s %s %s %d' % (src, args, fn, size_kb))
+        if index:
+            # This exits with 1 as it changes the filesystem
+            util.run_and_log(u_boot_console, 'e2fsck -fyD %s' % fn,
+                             ignore_errors=True)
+            util.run_and_log(u_boot_console, 'e2fsck -fn %s' % fn)
+    finally:
+        if old_time is None:
+            del os.environ['E2FSPROGS_FAKE_TIME']
+        else:
+            os.environ['E2FSPROGS_FAKE_TIME'] = old_time
+    shutil.rmtree(src)
+
+def fragment_fat16(fn, name):
+    """Scatter the clusters of a file in a FAT16 image.
+
+    The file must be in the root directory and its clusters contiguous. They
+    are linked in an interleaved order (0, 2, 4, ..., 1, 3, 5, ...) and its
+    data moved to match, so that its chain is made of many short runs. The
+    first cluster stays where it was.
+
+    Args:
+        fn: Filename of the image.
+        name: Name of the file, which must be a valid 8.3 name.
+    """
+
+    with open(fn, 'r+b') as fh:
+        bs = fh.read(512)
+        sect_size, clust_sects, reserved, nfats, root_ents = \
+            struct.unpack_from('<HBHBH', bs, 11)
+        fat_sects = struct.unpack_from('<H', bs, 22)[0]
+        fat_start = reserved * sect_size
+        fat_len = fat_sects * sect_size
+        root_start = fat_start + nfats * fat_len
+        data_start = root_start + root_ents * 32
+        clust_size = clust_sects * sect_size
+
+        base, ext = name.upper().split('.')
+        short = ('%-8s%-3s' % (base, ext)).encode('ascii')
+        fh.seek(root_start)
+        root = fh.read(root_ents * 32)
+        for off in range(0, len(root), 32):
+            if root[off:off + 11] == short:
+                break
+        else:
+            raise Exception('%s not found in %s' % (name, fn))
+        start = struct.unpack_from('<H', root, off + 26)[0]
+        size = struct.unpack_from('<I', root, off + 28)[0]
+        count = (size + clust_size - 1) // clust_size
+
+        def clust_pos(clust):
+            return data_start + (clust - 2) * clust_size
+
+        fh.seek(clust_pos(start))
+        data = fh.read(count * clust_size)
+        fh.seek(fat_start)
+        fat = bytearray(fh.read(fat_len))
+        order = list(range(0, count, 2)) + list(range(1, count, 2))
+        for i, phys in enumerate(order):
+            fh.seek(clust_pos(start + phys))
+            fh.write(data[i * clust_size:(i + 1) * clust_size])
+            if i + 1 < count:
+                next_clust = start + order[i + 1]
+            else:
+                next_clust = 0xffff
+            struct.pack_into('<H', fat, (start + phys) * 2, next_clust)
+        for i in range(nfats):
+            fh.seek(fat_start + i * fat_len)
+            fh.write(fat)
+
+def mkdisk(fn, parts):
+    """Create a disk image with an MBR partition table.
+
+    Args:
+        fn: Filename of the disk image to create.
+        parts: List of (image filename, partition type) tuples. Each image
+            is copied into a partition of its own, starting on a 1MiB
+            boundary.
+
+    Returns:
+        List of the start sector of each partition.
+    """
+
+    mbr = bytearray(512)
+    starts = []
+    start = 2048
+    with open(fn, 'wb') as fh:
+        for i, (img, part_type) in enumerate(parts):
+            with open(img, 'rb') as src:
+                data = src.read()
+            sectors = (len(data) + 511) // 512
+            struct.pack_into('<B3sB3sII', mbr, 446 + i * 16, 0,
+                             b'\xfe\xff\xff', part_type, b'\xfe\xff\xff',
+                             start, sectors)
+            fh.seek(start * 512)
+            fh.write(data)
+            starts.append(start)
+            start += (sectors + 2047) // 2048 * 2048
+        mbr[510:512] = b'\x55\xaa'
+        fh.seek(0)
+        fh.write(mbr)
+        fh.truncate(start * 512)
+    return starts
+
+def fs_load(u_boot_console, fstype, dev, fn, size=None, pos=None):
+    """Load a file (or part of one) and return the CRC32 of what was read.
+
+    Args:
+        u_boot_console: A console connection to U-Boot.
+        fstype: Filesystem type, 'fat' or 'ext4'.
+        dev: Device and partition on the host interface, e.g. '0:1'.
+        fn: Filename to load.
+        size: Number of bytes to load, or None for all.
+        pos: Offset in the file to load from, or None for the start.
+
+    Returns:
+        Tuple (number of bytes read, CRC32 of those bytes).
+    """
+
+    addr = util.find_ram_base(u_boot_console)
+    cmd = '%sload host %s %x %s' % (fstype, dev, addr, fn)
+    if size is not None:
+        cmd += ' %x %x' % (size, pos or 0)
+    output = u_boot_console.run_command(cmd)
+    m = re.search(r'(\d+) bytes read', output)
+    assert m, output
+    size = int(m.group(1))
+    output = u_boot_console.run_command('crc32 %x %x' % (addr, size))
+    m = re.search(r'==> ([0-9a-f]{8})', output)
+    assert m, output
+    return size, m.group(1)
+
+def check_load(u_boot_console, fstype, dev, fn, data):
+    """Check that a file loads with the expected contents."""
+
+    assert fs_load(u_boot_console, fstype, dev, fn) == (len(data), crc32(data))
+
+def check_load_part(u_boot_console, fstype, dev, fn, data, size, pos):
+    """Check that part of a file loads with the expected contents."""
+
+    expect = data[pos:pos + size]
+    assert (fs_load(u_boot_console, fstype, dev, fn, size, pos) ==
+            (len(expect), crc32(expect)))
+
+def ext4_stats(u_boot_console):
+    """Return the ext4 directory lookup counters as a dict."""
+
+    output = u_boot_console.run_command('ext4stats')
+    stats = {}
+    for line in output.splitlines():
+        m = re.match(r'([a-z ]+):\s+(\d+)', line.strip())
+        if m:
+            stats[m.group(1)] = int(m.group(2))
+    return stats
+
+def raw_write(u_boot_console, dev, sector, fn):
+    """Copy a host file to a host device, without going through a filesystem.
+
+    Args:
+        u_boot_console: A console connection to U-Boot.
+        dev: Host device number.
+        sector: First sector to write.
+        fn: Host file to write, a whole number of sectors long.
+    """
+
+    addr = util.find_ram_base(u_boot_console)
+    count = os.path.getsize(fn) // 512
+    u_boot_console.run_command('host load hostfs - %x %s' % (addr, fn))
+    output = u_boot_console.run_command('blk write host %d %x %x %x' %
+                                        (dev, addr, sector, count))
+    assert 'blocks written: OK' in output
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fat')
+@pytest.mark.buildconfigspec('cmd_blk')
+def test_fs_fat_volume(u_boot_console):
+    """Test that FAT notices when its volume changes between commands.
+
+    The two images used have the same boot sector, so only the device
+    number, partition or change sequence can tell them apart.
+    """
+
+    cons = u_boot_console
+    data_a = make_data(8 * 1024, 1)
+    data_b = make_data(24 * 1024, 2)
+    img_a = data_path(cons, 'fat-volume-a.img')
+    img_b = data_path(cons, 'fat-volume-b.img')
+    disk = data_path(cons, 'fat-volume-disk.img')
+    mkfs_fat(cons, img_a, [('file.bin', data_a)])
+    mkfs_fat(cons, img_b, [('pad.bin', data_a), ('file.bin', data_b)])
+    with open(img_a, 'rb') as fa, open(img_b, 'rb') as fb:
+        assert fa.read(512) == fb.read(512)
+    mkdisk(disk, [(img_a, 0x0e), (img_b, 0x0e)])
+
+    cons.run_command('host bind 0 %s' % img_a)
+    cons.run_command('host bind 1 %s' % img_b)
+    try:
+        # Loading again uses the mounted state
+        check_load(cons, 'fat', '0', 'file.bin', data_a)
+        check_load(cons, 'fat', '0', 'file.bin', data_a)
+
+        # Switching devices
+        check_load(cons, 'fat', '1', 'file.bin', data_b)
+        check_load(cons, 'fat', '0', 'file.bin', data_a)
+
+        # Writing raw blocks over the volume
+        raw_write(cons, 0, 0, img_b)
+        check_load(cons, 'fat', '0', 'file.bin', data_b)
+
+        # Switching partitions
+        cons.run_command('host bind 0 %s' % disk)
+        check_load(cons, 'fat', '0:1', 'file.bin', data_a)
+        check_load(cons, 'fat', '0:2', 'file.bin', data_b)
+        check_load(cons, 'fat', '0:1', 'file.bin', data_a)
+    finally:
+        cons.run_command('host bind 0')
+        cons.run_command('host bind 1')
+        for fn in (img_a, img_b, disk):
+            os.remove(fn)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_fat')
+@pytest.mark.buildconfigspec('fat_write')
+def test_fs_fat_chain(u_boot_console):
+    """Test reading fragmented FAT files through the cluster chain cache.
+
+    The files in both images start at the same cluster, which is what the
+    chain cache is looked up by.
+    """
+
+    cons = u_boot_console
+    data_a = make_data(64 * 1024, 3)
+    data_b = make_data(64 * 1024, 4)
+    data_c = make_data(40 * 1024 + 100, 5)
+    img_a = data_path(cons, 'fat-chain-a.img')
+    img_b = data_path(cons, 'fat-chain-b.img')
+    disk = data_path(cons, 'fat-chain-disk.img')
+    new = data_path(cons, 'fat-chain-new.bin')
+    for img, data in ((img_a, data_a), (img_b, data_b)):
+        mkfs_fat(cons, img, [('frag.bin', data)], 8192, '-F 16 -s 2')
+        fragment_fat16(img, 'frag.bin')
+    mkdisk(disk, [(img_a, 0x0e), (img_b, 0x0e)])
+    write_file(new, data_c)
+
+    cons.run_command('host bind 0 %s' % img_a)
+    cons.run_command('host bind 1 %s' % img_b)
+    try:
+        # Decode part of the chain, then extend it, then use it
+        check_load_part(cons, 'fat', '0', 'frag.bin', data_a, 3000, 1000)
+        check_load(cons, 'fat', '0', 'frag.bin', data_a)
+        for size, pos in ((2, 1023), (20000, 5000), (5536, 60000)):
+            check_load_part(cons, 'fat', '0', 'frag.bin', data_a, size, pos)
+
+        # Switching devices
+        check_load(cons, 'fat', '1', 'frag.bin', data_b)
+        check_load(cons, 'fat', '0', 'frag.bin', data_a)
+
+        # Writing the file
+        addr = util.find_ram_base(cons)
+        cons.run_command('host load hostfs - %x %s' % (addr, new))
+        cons.run_command('fatwrite host 0 %x frag.bin %x' %
+                         (addr, len(data_c)))
+        check_load(cons, 'fat', '0', 'frag.bin', data_c)
+
+        # Switching partitions
+        cons.run_command('host bind 0 %s' % disk)
+        check_load(cons, 'fat', '0:1', 'frag.bin', data_a)
+        check_load(cons, 'fat', '0:2', 'frag.bin', data_b)
+        check_load(cons, 'fat', '0:1', 'frag.bin', data_a)
+    finally:
+        cons.run_command('host bind 0')
+        cons.run_command('host bind 1')
+        for fn in (img_a, img_b, disk, new):
+            os.remove(fn)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_ext4')
+@pytest.mark.buildconfigspec('cmd_ext4_write')
+def test_fs_ext4_extents(u_boot_console):
+    """Test reading ext4 files by extent.
+
+    The sparse file has one extent for each 1KiB block of data, which needs
+    several leaf blocks in the extent tree, so reads of part of it skip
+    some index entries.
+    """
+
+    def sparse_data(seed):
+        data = bytearray(300 * 4096 + 1234)
+        for i in range(300):
+            data[i * 4096:i * 4096 + 1024] = make_data(1024, seed + i)
+        return bytes(data)
+
+    cons = u_boot_console
+    sparse_a = sparse_data(1000)
+    sparse_b = sparse_data(2000)
+    big_a = make_data(3 * 1024 * 1024 + 17, 6)
+    big_b = make_data(3 * 1024 * 1024 + 17, 7)
+    big_c = make_data(1024 * 1024 + 5, 8)
+    img_a = data_path(cons, 'ext4-extents-a.img')
+    img_b = data_path(cons, 'ext4-extents-b.img')
+    disk = data_path(cons, 'ext4-extents-disk.img')
+    new = data_path(cons, 'ext4-extents-new.bin')
+    mkfs_ext4(cons, img_a, [('sparse.bin', sparse_a), ('big.bin', big_a)],
+              args='-b 1024')
+    mkfs_ext4(cons, img_b, [('sparse.bin', sparse_b), ('big.bin', big_b)],
+              args='-b 1024')
+    mkdisk(disk, [(img_a, 0x83), (img_b, 0x83)])
+    write_file(new, big_c)
+
+    cons.run_command('host bind 0 %s' % img_a)
+    cons.run_command('host bind 1 %s' % img_b)
+    try:
+        # Whole files, then pieces starting and ending in data and holes
+        for i in range(2):
+            check_load(cons, 'ext4', '0', '/sparse.bin', sparse_a)
+            check_load(cons, 'ext4', '0', '/big.bin', big_a)
+        for size, pos in ((5000, 1000), (100000, 300000), (3000, 700000),
+                          (20, len(sparse_a) - 20), (1, 1023)):
+            check_load_part(cons, 'ext4', '0', '/sparse.bin', sparse_a,
+                            size, pos)
+        check_load_part(cons, 'ext4', '0', '/big.bin', big_a, 123456, 7)
+
+        # Switching devices
+        check_load(cons, 'ext4', '1', '/sparse.bin', sparse_b)
+        check_load(cons, 'ext4', '1', '/big.bin', big_b)
+        check_load(cons, 'ext4', '0', '/big.bin', big_a)
+
+        # Writing the file
+        addr = util.find_ram_base(cons)
+        cons.run_command('host load hostfs - %x %s' % (addr, new))
+        cons.run_command('ext4write host 0 %x /big.bin %x' %
+                         (addr, len(big_c)))
+        check_load(cons, 'ext4', '0', '/big.bin', big_c)
+
+        # Switching partitions
+        cons.run_command('host bind 0 %s' % disk)
+        check_load(cons, 'ext4', '0:1', '/sparse.bin', sparse_a)
+        check_load(cons, 'ext4', '0:2', '/sparse.bin', sparse_b)
+        check_load(cons, 'ext4', '0:1', '/big.bin', big_a)
+    finally:
+        cons.run_command('host bind 0')
+        cons.run_command('host bind 1')
+        for fn in (img_a, img_b, disk, new):
+            os.remove(fn)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_ext4')
+@pytest.mark.buildconfigspec('cmd_ext4_write')
+@pytest.mark.buildconfigspec('cmd_ext4_stats')
+@pytest.mark.buildconfigspec('cmd_blk')
+def test_fs_ext4_dcache(u_boot_console):
+    """Test the ext4 dentry cache and hash tree lookups.
+
+    The two images have the same superblock, as A/B copies of a root
+    filesystem might, but /boot/f123 has a different size in each, so a
+    stale cache entry would load the wrong number of bytes.
+    """
+
+    def boot_files(big, seed):
+        files = []
+        for i in range(300):
+            name = 'f%03d' % i
+            if name == big:
+                size = 3000
+            elif name in ('f123', 'f124'):
+                size = 1000
+            else:
+                size = 100 + i
+            files.append(('boot/' + name, make_data(size, seed + i)))
+        return files
+
+    cons = u_boot_console
+    files_a = boot_files('f123', 3000)
+    files_b = boot_files('f124', 4000)
+    data_a = dict(files_a)['boot/f123']
+    data_b = dict(files_b)['boot/f123']
+    other_a = dict(files_a)['boot/f124']
+    other_b = dict(files_b)['boot/f124']
+    data_c = make_data(2000, 5000)
+    img_a = data_path(cons, 'ext4-dcache-a.img')
+    img_b = data_path(cons, 'ext4-dcache-b.img')
+    disk = data_path(cons, 'ext4-dcache-disk.img')
+    new = data_path(cons, 'ext4-dcache-new.bin')
+    mkfs_ext4(cons, img_a, files_a, 4096, '-b 1024', index=True)
+    mkfs_ext4(cons, img_b, files_b, 4096, '-b 1024', index=True)
+    with open(img_a, 'rb') as fa, open(img_b, 'rb') as fb:
+        fa.seek(1024)
+        fb.seek(1024)
+        assert fa.read(1024) == fb.read(1024)
+    starts = mkdisk(disk, [(img_a, 0x83), (img_b, 0x83)])
+    write_file(new, data_c)
+
+    cons.run_command('host bind 0 %s' % disk)
+    cons.run_command('host bind 1 %s' % img_b)
+    try:
+        # The first lookup uses the hash tree, the second the cache
+        before = ext4_stats(cons)
+        check_load(cons, 'ext4', '0:1', '/boot/f123', data_a)
+        first = ext4_stats(cons)
+        assert first['htree'] > before['htree']
+        check_load(cons, 'ext4', '0:1', '/boot/f123', data_a)
+        second = ext4_stats(cons)
+        assert second['cache hits'] > first['cache hits']
+        assert second['dir blocks'] == first['dir blocks']
+
+        # Switching partitions and devices
+        check_load(cons, 'ext4', '0:2', '/boot/f123', data_b)
+        check_load(cons, 'ext4', '0:1', '/boot/f123', data_a)
+        check_load(cons, 'ext4', '1', '/boot/f123', data_b)
+        check_load(cons, 'ext4', '0:1', '/boot/f123', data_a)
+
+        # Writing raw blocks over the partition, with the same superblock
+        check_load(cons, 'ext4', '0:1', '/boot/f124', other_a)
+        raw_write(cons, 0, starts[0], img_b)
+        check_load(cons, 'ext4', '0:1', '/boot/f123', data_b)
+        check_load(cons, 'ext4', '0:1', '/boot/f124', other_b)
+
+        # Writing the file
+        addr = util.find_ram_base(cons)
+        cons.run_command('host load hostfs - %x %s' % (addr, new))
+        cons.run_command('ext4write host 0:1 %x /boot/f123 %x' %
+                         (addr, len(data_c)))
+        check_load(cons, 'ext4', '0:1', '/boot/f123', data_c)
+    finally:
+        cons.run_command('host bind 0')
+        cons.run_command('host bind 1')
+        for fn in (img_a, img_b, disk, new):
+            os.remove(fn)
@@ -0,0 +1,46 @@
+# SPDX-License-Identifier: GPL-2.0+
+
+import pytest
+import re
+
+# Space which must be left free in the pre-relocation pool by a normal boot
+EARLY_HEADROOM = 0x400
+
+@pytest.mark.buildconfigspec('cmd_malloc')
+@pytest.mark.buildconfigspec('malloc_trace')
+def test_malloc_trace_boot(u_boot_console):
+    """Test that the heap used by a normal boot stays within its budget.
+
+    The pre-relocation pool must keep some headroom, and the peak usage of
+    the full pool up to the prompt must be well below its size, so that a
+    change which allocates much more memory at start-up is noticed."""
+
+    cons = u_boot_console
+    cons.restart_uboot()
+    response = cons.run_command('malloc info')
+    m = re.search(r'malloc\(\) pool: (0x[0-9a-f]+) bytes', response)
+    assert m
+    pool_size = int(m.group(1), 16)
+
+    response = cons.run_command('malloc trace 5')
+    m = re.search(r'Pre-relocation pool peak: (0x[0-9a-f]+|0) bytes',
+                  response)
+    assert m
+    early_peak = int(m.group(1), 16)
+    m = re.search(r'Live: (0x[0-9a-f]+|0) bytes, peak (0x[0-9a-f]+|0) bytes',
+                  response)
+    assert m
+    peak = int(m.group(2), 16)
+
+    early_size = int(cons.config.buildconfig['config_sys_malloc_f_len'], 16)
+    assert early_peak > 0
+    assert early_peak <= early_size - EARLY_HEADROOM
+    assert peak > 0
+    assert peak <= pool_size // 4
+
+    # The callers are listed with the largest peak first
+    peaks = [int(p, 16) for p in
+             re.findall(r'^\S+\s+f?\s+\d+\s+[0-9a-f]+\s+([0-9a-f]+)\s*$',
+                        response, re.MULTILINE)]
+    assert peaks
+    assert peaks == sorted(peaks, reverse=True)
@@ -9,8 +9,10 @@
 import copy
 from optparse import OptionError, OptionParser
 import os
+import re
 import struct
 import sys
+import zlib
 
 # Bring in the patman libraries
 our_path = os.path.dirname(os.path.realpath(__file__))
@@ -43,6 +45,10 @@ TYPE_NAMES = {
 STRUCT_PREFIX = 'dtd_'
 VAL_PREFIX = 'dtv_'
 
+# Tokens in the structure block of a device tree binary
+(FDT_BEGIN_NODE, FDT_END_NODE, FDT_PROP, FDT_NOP) = range(1, 5)
+FDT_END = 9
+
 def Conv_name_to_c(name):
     """Convert a device-tree name to a C identifier
 
@@ -63,6 +69,122 @@ def TabTo(num_tabs, str):
         return str + ' '
     return str + '\t' * (num_tabs - len(str) // 8)
 
+def Align4(pos):
+    return (pos + 3) & ~3
+
+def CString(data):
+    """Convert a property value to a C string literal
+
+    Each nul character ends a literal, so that strings in a list cannot run
+    into escapes. The final nul is left to the C compiler.
+
+    Args:
+        data: Property value, as a bytearray
+    Return:
+        String containing one or more C string literals
+    """
+    if data and data[-1] == 0:
+        data = data[:-1]
+    out = '"'
+    for ch in data:
+        if ch == 0:
+            out += '\\0" "'
+        elif ch in (ord('"'), ord('\\')):
+            out += '\\' + chr(ch)
+        elif ch < 0x20 or ch > 0x7e:
+            out += '\\%03o' % ch
+        else:
+            out += chr(ch)
+    return out + '"'
+
+def TrailingNumber(name):
+    """Get the number at the end of a name, as trailing_strtol() does
+
+    Args:
+        name: Name to check, e.g. 'i2c0'
+    Return:
+        The number, or -1 if there is none. As with trailing_strtol(), the
+        number must follow a non-digit which is not the first character.
+    """
+    match = re.match('.+[^0-9]([0-9]+)$', name)
+    if not match:
+        return -1
+    return int(match.group(1))
+
+class BindNode:
+    """A node in a device tree binary, as seen when binding devices
+
+    Properties:
+        offset: Offset of the node in the device tree, as used by libfdt
+        name: Node name, including any unit address
+        parent: Parent BindNode, or None for the root
+        props: List of (name, value) tuples, in device tree order. Each
+            value is a bytearray.
+        subnodes: List of subnodes, each a BindNode
+        index: Position of this node in the list of all nodes
+    """
+    def __init__(self, offset, name, parent):
+        self.offset = offset
+        self.name = name
+        self.parent = parent
+        self.props = []
+        self.subnodes = []
+        self.index = None
+
+    def GetProp(self, name):
+        for pname, value in self.props:
+            if pname == name:
+                return value
+        return None
+
+def ScanBindNodes(data):
+    """Read the nodes and properties from a device tree binary
+
+    This reads the binary directly, since it needs the offset of each node,
+    which is what driver model and libfdt use to refer to nodes.
+
+    Args:
+        data: Contents of the device tree binary, as a bytearray
+    Return:
+        List of BindNode objects, in order of offset. The root is first.
+    """
+    def GetString(pos):
+        end = data.index(b'\0', pos)
+        return bytes(data[pos:end]).decode('ascii'), end
+
+    magic, totalsize, off_struct, off_strings = struct.unpack(
+            '>4L', bytes(data[:16]))
+    if magic != 0xd00dfeed:
+        raise ValueError('Not a device tree binary')
+    nodes = []
+    parent = None
+    pos = off_struct
+    while True:
+        tag_pos = pos
+        tag, = struct.unpack('>L', bytes(data[pos:pos + 4]))
+        pos += 4
+        if tag == FDT_BEGIN_NODE:
+            name, end = GetString(pos)
+            pos = Align4(end + 1)
+            parent = BindNode(tag_pos - off_struct, name, parent)
+            parent.index = len(nodes)
+            if parent.parent:
+                parent.parent.subnodes.append(parent)
+            nodes.append(parent)
+        elif tag == FDT_END_NODE:
+            parent = parent.parent
+        elif tag == FDT_PROP:
+            size, nameoff = struct.unpack('>2L', bytes(data[pos:pos + 8]))
+            pos += 8
+            name, _ = GetString(off_strings + nameoff)
+            parent.props.append((name, data[pos:pos + size]))
+            pos = Align4(pos + size)
+        elif tag == FDT_END:
+            break
+        elif tag != FDT_NOP:
+            raise ValueError('Bad tag %d at offset %d' % (tag, tag_pos))
+    return nodes
+
 class DtbPlatdata:
     """Provide a means to convert device tree binary data to platform data
 
@@ -353,6 +475,77 @@ class DtbPlatdata:
             self.Out(''.join(node_txt))
 
 
+    def GenerateBindTable(self):
+        """Generate a table for driver model to bind devices from
+
+        This writes out a struct dm_bind_table (see dm/bind_table.h) with a
+        node for each node in the device tree, giving what driver model
+        reads from the tree when binding devices, and a list of the
+        aliases which give nodes their sequence numbers.
+        """
+        with open(self._dtb_fname, 'rb') as fd:
+            data = bytearray(fd.read())
+        nodes = ScanBindNodes(data)
+
+        self.Out('#include <common.h>\n')
+        self.Out('#include <dm/bind_table.h>\n')
+        self.Out('\n')
+        self.Out('static const struct dm_bind_node dm_bind_nodes[] = {\n')
+        for node in nodes:
+            flags = []
+            status = node.GetProp('status')
+            if status is None or status.split(b'\0')[0] == b'okay':
+                flags.append('DM_BIND_ENABLED')
+            if node.GetProp('u-boot,dm-pre-reloc') is not None:
+                flags.append('DM_BIND_PRE_RELOC')
+            compat = node.GetProp('compatible')
+            siblings = node.parent.subnodes if node.parent else [node]
+            pos = siblings.index(node)
+            sibling = siblings[pos + 1] if pos + 1 < len(siblings) else None
+            self.Out('\t{ %#x, %d, %d, %s, %d, %s },\n' %
+                     (node.offset,
+                      node.subnodes[0].index if node.subnodes else -1,
+                      sibling.index if sibling else -1,
+                      ' | '.join(flags) or '0',
+                      len(compat) if compat is not None else 0,
+                      CString(compat) if compat is not None else 'NULL'))
+        self.Out('};\n')
+        self.Out('\n')
+
+        # Find the aliases as fdtdec_get_alias_seq() does, which only
+        # compares the last part of the path with the node name
+        aliases = []
+        alias_node = [node for node in nodes[0].subnodes
+                      if node.name == 'aliases']
+        alias_props = alias_node[0].props if alias_node else []
+        for node in nodes:
+            for name, value in alias_props:
+                if (len(value) < len(node.name) or not value or
+                    value[0] != ord('/') or value[-1]):
+                    continue
+                path = bytes(value).split(b'\0')[0].decode('ascii')
+                if path.rsplit('/', 1)[1] != node.name:
+                    continue
+                seq = TrailingNumber(name)
+                if seq != -1:
+                    aliases.append((node.offset, name, seq))
+        self.Out('static const struct dm_bind_alias dm_bind_aliases[] = {\n')
+        for offset, name, seq in aliases:
+            self.Out('\t{ %#x, "%s", %d },\n' % (offset, name, seq))
+        self.Out('};\n')
+        self.Out('\n')
+
+        self.Out('const struct dm_bind_table dm_bind_table = {\n')
+        self.Out('\t.fdt_size\t= %#x,\n' % len(data))
+        self.Out('\t.fdt_crc32\t= %#x,\n' % (zlib.crc32(bytes(data)) &
+                                               0xffffffff))
+        self.Out('\t.node_count\t= ARRAY_SIZE(dm_bind_nodes),\n')
+        self.Out('\t.nodes\t\t= dm_bind_nodes,\n')
+        self.Out('\t.alias_count\t= ARRAY_SIZE(dm_bind_aliases),\n')
+        self.Out('\t.aliases\t= dm_bind_aliases,\n')
+        self.Out('};\n')
+
+
 if __name__ != "__main__":
     pass
 
@@ -366,18 +559,25 @@ parser.add_option('-o', '--output', action='store', default='-',
 (options, args) = parser.parse_args()
 
 if not args:
-    raise ValueError('Please specify a command: struct, platdata')
+    raise ValueError('Please specify a command: struct, platdata, bindtable')
 
 plat = DtbPlatdata(options.dtb_file, options)
-plat.ScanDtb()
-plat.ScanTree()
+cmds = args[0].split(',')
 plat.SetupOutput(options.output)
-structs = plat.ScanStructs()
 
-for cmd in args[0].split(','):
+# The bind table is read straight from the binary
+if [cmd for cmd in cmds if cmd != 'bindtable']:
+    plat.ScanDtb()
+    plat.ScanTree()
+    structs = plat.ScanStructs()
+
+for cmd in cmds:
     if cmd == 'struct':
         plat.GenerateStructs(structs)
     elif cmd == 'platdata':
         plat.GenerateTables()
+    elif cmd == 'bindtable':
+        plat.GenerateBindTable()
     else:
-        raise ValueError("Unknown command '%s': (use: struct, platdata)" % cmd)
+        raise ValueError("Unknown command '%s': (use: struct, platdata, "
+                         "bindtable)" % cmd)
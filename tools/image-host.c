@@ -395,13 +395,60 @@ static const char *fit_config_get_image_list(void *fit, int noffset,
 	return default_list;
 }
 
+/**
+ * fit_config_add_image() - add an image and its hashes to the nodes to sign
+ *
+ * @fit:		FIT being signed
+ * @image_noffset:	Offset of the image node
+ * @node_inc:		List of node paths to add to
+ * @return number of hash nodes added, or -ve on error
+ */
+static int fit_config_add_image(void *fit, int image_noffset,
+				struct strlist *node_inc)
+{
+	char path[200];
+	int hash_count = 0;
+	int noffset;
+	int ret;
+
+	ret = fdt_get_path(fit, image_noffset, path, sizeof(path));
+	if (ret < 0)
+		goto err_path;
+	if (strlist_add(node_inc, path))
+		return -ENOMEM;
+
+	/* Add all this image's hashes */
+	for (noffset = fdt_first_subnode(fit, image_noffset);
+	     noffset >= 0;
+	     noffset = fdt_next_subnode(fit, noffset)) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		ret = fdt_get_path(fit, noffset, path, sizeof(path));
+		if (ret < 0)
+			goto err_path;
+		if (strlist_add(node_inc, path))
+			return -ENOMEM;
+		hash_count++;
+	}
+
+	return hash_count;
+
+err_path:
+	printf("Failed to get path for image '%s': %s\n",
+	       fit_get_name(fit, image_noffset, NULL), fdt_strerror(ret));
+	return -ENOENT;
+}
+
 static int fit_config_get_hash_list(void *fit, int conf_noffset,
 				    int sig_offset, struct strlist *node_inc)
 {
 	int allow_missing;
-	const char *prop, *iname, *end;
+	const char *prop, *iname, *end, *bundle;
 	const char *conf_name, *sig_name;
-	char name[200], path[200];
+	char name[200];
 	int image_count;
 	int ret, len;
 
@@ -428,7 +475,6 @@ static int fit_config_get_hash_list(void *fit, int conf_noffset,
 	end = prop + len;
 	image_count = 0;
 	for (iname = prop; iname < end; iname += strlen(iname) + 1) {
-		int noffset;
 		int image_noffset;
 		int hash_count;
 
@@ -443,31 +489,33 @@ static int fit_config_get_hash_list(void *fit, int conf_noffset,
 			return -ENOENT;
 		}
 
-		ret = fdt_get_path(fit, image_noffset, path, sizeof(path));
-		if (ret < 0)
-			goto err_path;
-		if (strlist_add(node_inc, path))
+		ret = fit_config_add_image(fit, image_noffset, node_inc);
+		if (ret == -ENOMEM)
 			goto err_mem;
+		if (ret < 0)
+			return ret;
+		hash_count = ret;
 
-		snprintf(name, sizeof(name), "%s/%s", FIT_CONFS_PATH,
-			 conf_name);
-
-		/* Add all this image's hashes */
-		hash_count = 0;
-		for (noffset = fdt_first_subnode(fit, image_noffset);
-		     noffset >= 0;
-		     noffset = fdt_next_subnode(fit, noffset)) {
-			const char *name = fit_get_name(fit, noffset, NULL);
-
-			if (strncmp(name, FIT_HASH_NODENAME,
-				    strlen(FIT_HASH_NODENAME)))
-				continue;
-			ret = fdt_get_path(fit, noffset, path, sizeof(path));
-			if (ret < 0)
-				goto err_path;
-			if (strlist_add(node_inc, path))
+		/*
+		 * An FDT in a bundle takes its data from the bundle, so the
+		 * bundle must be signed too
+		 */
+		bundle = fdt_getprop(fit, image_noffset, FIT_BUNDLE_PROP, NULL);
+		if (bundle) {
+			int bundle_noffset = fit_image_get_node(fit, bundle);
+
+			if (bundle_noffset < 0) {
+				printf("Failed to find bundle '%s' for image '%s' in configuration '%s/%s'\n",
+				       bundle, iname, conf_name, sig_name);
+				return -ENOENT;
+			}
+			ret = fit_config_add_image(fit, bundle_noffset,
+						   node_inc);
+			if (ret == -ENOMEM)
 				goto err_mem;
-			hash_count++;
+			if (ret < 0)
+				return ret;
+			hash_count += ret;
 		}
 
 		if (!hash_count) {
@@ -491,11 +539,6 @@ err_mem:
 	printf("Out of memory processing configuration '%s/%s'\n", conf_name,
 	       sig_name);
 	return -ENOMEM;
-
-err_path:
-	printf("Failed to get path for image '%s' in configuration '%s/%s': %s\n",
-	       iname, conf_name, sig_name, fdt_strerror(ret));
-	return -ENOENT;
 }
 
 static int fit_config_get_data(void *fit, int conf_noffset, int noffset,
@@ -0,0 +1,181 @@
+/*
+ * Chunked image data for mkimage -Z
+ *
+ * The data file is split into chunks which are compressed one by one with
+ * the external gzip or zstd tool, so that U-Boot can decompress them in
+ * parallel (see common/bootm_chunk.c).
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include "imagetool.h"
+#include <image.h>
+
+static char *chunk_tmpfile;
+
+static void chunk_cleanup(void)
+{
+	if (chunk_tmpfile)
+		unlink(chunk_tmpfile);
+}
+
+static const char *chunk_compressor(int comp)
+{
+	switch (comp) {
+	case IH_COMP_GZIP:
+		return "gzip -9 -n -c";
+	case IH_COMP_ZSTD:
+		return "zstd -19 -q -c";
+	}
+
+	return NULL;
+}
+
+/* Read the whole of a file into a newly allocated buffer */
+static void *chunk_read_file(const char *fname, size_t *sizep)
+{
+	struct stat sbuf;
+	void *buf;
+	FILE *f;
+
+	f = fopen(fname, "rb");
+	if (!f || fstat(fileno(f), &sbuf)) {
+		fprintf(stderr, "Can't open %s: %s\n", fname, strerror(errno));
+		goto err;
+	}
+	buf = malloc(sbuf.st_size + 1);
+	if (!buf) {
+		fprintf(stderr, "Out of memory reading %s\n", fname);
+		goto err;
+	}
+	if (fread(buf, 1, sbuf.st_size, f) != (size_t)sbuf.st_size) {
+		fprintf(stderr, "Can't read %s: %s\n", fname, strerror(errno));
+		free(buf);
+		goto err;
+	}
+	fclose(f);
+	*sizep = sbuf.st_size;
+
+	return buf;
+err:
+	if (f)
+		fclose(f);
+	return NULL;
+}
+
+/* Compress one chunk with @tool, writing the result to @outname */
+static int chunk_compress(const char *tool, const void *data, size_t len,
+			  const char *outname)
+{
+	char *cmd;
+	FILE *fp;
+	int ret;
+
+	cmd = malloc(strlen(tool) + strlen(outname) + 8);
+	if (!cmd)
+		return -ENOMEM;
+	sprintf(cmd, "%s > '%s'", tool, outname);
+	fp = popen(cmd, "w");
+	free(cmd);
+	if (!fp) {
+		fprintf(stderr, "Can't run %s: %s\n", tool, strerror(errno));
+		return -EIO;
+	}
+	ret = fwrite(data, 1, len, fp) != len;
+	if (pclose(fp) || ret) {
+		fprintf(stderr, "Failed to compress with '%s'\n", tool);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int imagetool_chunk_datafile(struct image_tool_params *params)
+{
+	const char *tool = chunk_compressor(params->comp);
+	struct image_chunk_header *hdr;
+	char *tmpname, *partname;
+	size_t size, hdr_size, pos;
+	void *data, *part;
+	uint32_t count, i;
+	FILE *out = NULL;
+	int ret = -EIO;
+	size_t len;
+
+	if (!tool) {
+		fprintf(stderr, "%s: chunks need gzip or zstd compression\n",
+			params->cmdname);
+		return -EINVAL;
+	}
+	data = chunk_read_file(params->datafile, &size);
+	if (!data)
+		return -EIO;
+	count = size ? (size - 1) / params->chunk_size + 1 : 1;
+
+	tmpname = malloc(strlen(params->imagefile) + 16);
+	partname = malloc(strlen(params->imagefile) + 16);
+	hdr_size = sizeof(*hdr) + count * sizeof(hdr->ch_len[0]);
+	hdr = calloc(1, hdr_size);
+	if (!tmpname || !partname || !hdr) {
+		fprintf(stderr, "%s: out of memory\n", params->cmdname);
+		ret = -ENOMEM;
+		goto out;
+	}
+	sprintf(tmpname, "%s.chunks", params->imagefile);
+	sprintf(partname, "%s.chunk", params->imagefile);
+	chunk_tmpfile = tmpname;
+	atexit(chunk_cleanup);
+
+	out = fopen(tmpname, "wb");
+	if (!out || fseek(out, hdr_size, SEEK_SET)) {
+		fprintf(stderr, "%s: can't create %s: %s\n", params->cmdname,
+			tmpname, strerror(errno));
+		goto out;
+	}
+	for (i = 0, pos = 0; i < count; i++, pos += params->chunk_size) {
+		size_t chunk_len = size - pos;
+
+		if (chunk_len > params->chunk_size)
+			chunk_len = params->chunk_size;
+		if (chunk_compress(tool, (char *)data + pos, chunk_len,
+				   partname))
+			goto out;
+		part = chunk_read_file(partname, &len);
+		if (!part)
+			goto out;
+		if (fwrite(part, 1, len, out) != len) {
+			free(part);
+			fprintf(stderr, "%s: can't write %s: %s\n",
+				params->cmdname, tmpname, strerror(errno));
+			goto out;
+		}
+		free(part);
+		hdr->ch_len[i] = cpu_to_be32(len);
+	}
+	hdr->ch_magic = cpu_to_be32(IH_CHUNK_MAGIC);
+	hdr->ch_count = cpu_to_be32(count);
+	hdr->ch_size = cpu_to_be32(params->chunk_size);
+	if (fseek(out, 0, SEEK_SET) ||
+	    fwrite(hdr, 1, hdr_size, out) != hdr_size) {
+		fprintf(stderr, "%s: can't write %s: %s\n", params->cmdname,
+			tmpname, strerror(errno));
+		goto out;
+	}
+	if (!params->quiet)
+		printf("Compressed %zu bytes in %u chunks of %#x bytes\n", size,
+		       count, params->chunk_size);
+	params->datafile = tmpname;
+	ret = 0;
+out:
+	if (out && fclose(out))
+		ret = -EIO;
+	if (partname)
+		unlink(partname);
+	if (ret)
+		free(tmpname);
+	free(partname);
+	free(hdr);
+	free(data);
+
+	return ret;
+}
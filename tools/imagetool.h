@@ -77,6 +77,7 @@ struct image_tool_params {
 	bool quiet;		/* Don't output text in normal operation */
 	unsigned int external_offset;	/* Add padding to external data */
 	const char *engine_id;	/* Engine to use for signing */
+	unsigned int chunk_size;	/* Compress the data in chunks of this size */
 };
 
 /*
@@ -224,6 +225,19 @@ time_t imagetool_get_source_date(
 	struct image_tool_params *params,
 	time_t fallback);
 
+/**
+ * imagetool_chunk_datafile() - Compress the data file in chunks
+ *
+ * Splits the data file into chunks of params->chunk_size bytes, compresses
+ * each one separately with params->comp and writes them, preceded by a
+ * struct image_chunk_header, to a temporary file. params->datafile is
+ * updated to point to this file, which is removed when mkimage exits.
+ *
+ * @params:	mkimage parameters
+ * @return 0 if OK, -ve on error
+ */
+int imagetool_chunk_datafile(struct image_tool_params *params);
+
 /*
  * There is a c file associated with supported image type low level code
  * for ex. default_image.c, fit_image.c
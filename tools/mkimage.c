@@ -86,7 +86,8 @@ static void usage(const char *msg)
 		"          -e ==> set entry point to 'ep' (hex)\n"
 		"          -n ==> set image name to 'name'\n"
 		"          -d ==> use image data from 'datafile'\n"
-		"          -x ==> set XIP (execute in place)\n",
+		"          -x ==> set XIP (execute in place)\n"
+		"          -Z ==> compress 'datafile' in chunks of 'size' bytes (hex)\n",
 		params.cmdname);
 	fprintf(stderr,
 		"       %s [-D dtc_options] [-f fit-image.its|-f auto|-F] [-b <dtb> [-b <dtb>]] [-i <ramdisk.cpio.gz>] fit-image\n"
@@ -144,7 +145,7 @@ static void process_args(int argc, char **argv)
 	int opt;
 
 	while ((opt = getopt(argc, argv,
-			     "a:A:b:c:C:d:D:e:Ef:Fk:i:K:ln:N:p:O:rR:qsT:vVx")) != -1) {
+			     "a:A:b:c:C:d:D:e:Ef:Fk:i:K:ln:N:p:O:rR:qsT:vVxZ:")) != -1) {
 		switch (opt) {
 		case 'a':
 			params.addr = strtoull(optarg, &ptr, 16);
@@ -275,6 +276,14 @@ static void process_args(int argc, char **argv)
 		case 'x':
 			params.xflag++;
 			break;
+		case 'Z':
+			params.chunk_size = strtoull(optarg, &ptr, 16);
+			if (*ptr || !params.chunk_size) {
+				fprintf(stderr, "%s: invalid chunk size %s\n",
+					params.cmdname, optarg);
+				exit(EXIT_FAILURE);
+			}
+			break;
 		default:
 			usage("Invalid option");
 		}
@@ -302,6 +311,16 @@ static void process_args(int argc, char **argv)
 
 	if (!params.imagefile)
 		usage("Missing output filename");
+
+	if (params.chunk_size) {
+		if (params.comp != IH_COMP_GZIP && params.comp != IH_COMP_ZSTD)
+			usage("Chunked data needs gzip or zstd compression");
+		if (!params.datafile || params.type == IH_TYPE_MULTI ||
+		    params.type == IH_TYPE_SCRIPT)
+			usage("Chunked data needs a single data file (use -d)");
+		if (params.fflag && !params.auto_its)
+			usage("Chunked data needs -f auto, not a .its file");
+	}
 }
 
 int main(int argc, char **argv)
@@ -320,6 +339,9 @@ int main(int argc, char **argv)
 
 	process_args(argc, argv);
 
+	if (params.chunk_size && imagetool_chunk_datafile(&params))
+		exit(EXIT_FAILURE);
+
 	/* set tparams as per input type_id */
 	tparams = imagetool_get_type(params.type);
 	if (tparams == NULL) {